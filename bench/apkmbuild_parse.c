@@ -0,0 +1,208 @@
+/*
+ * bench/apkmbuild_parse.c - Débit du parseur APKMBUILD
+ *
+ * Génère des APKMBUILD synthétiques (graine fixe) et mesure le parseur
+ * partagé (src/bools/apkmbuild.c) :
+ *   typical  fichier réaliste (~30 lignes, blocs make/install)
+ *   files    milliers d'entrées $APKMFILE
+ *   blocks   longs blocs de commandes multi-lignes
+ *   long     valeurs de plusieurs dizaines de Ko (au-delà des anciennes
+ *            limites à 1024/2048 octets)
+ *
+ * Résultat en JSON (Mo/s, lignes/s, µs par parse) sur stdout ou dans -o.
+ *
+ * Usage: bench_apkmbuild [-o résultat.json] [-t secondes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "apkmbuild.h"
+
+// ============================================================================
+// CORPUS
+// ============================================================================
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} bench_buf_t;
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static void buf_printf(bench_buf_t *b, const char *fmt, ...) {
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && (size_t)n < b->cap - b->len) {
+            b->len += n;
+            return;
+        }
+        b->cap = b->cap * 2 + n + 1;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+}
+
+static void gen_header(bench_buf_t *b, uint64_t *s) {
+    buf_printf(b, "# APKMBUILD généré pour bench_apkmbuild\n");
+    buf_printf(b, "$APKNAME:: bench-%llu\n", (unsigned long long)(rng_next(s) % 10000));
+    buf_printf(b, "$APKMVERSION:: %llu.%llu.%llu\n",
+               (unsigned long long)(rng_next(s) % 10), (unsigned long long)(rng_next(s) % 100),
+               (unsigned long long)(rng_next(s) % 100));
+    buf_printf(b, "$APKMRELEASE:: r%llu\n", (unsigned long long)(rng_next(s) % 9));
+    buf_printf(b, "$APKMARCH:: x86_64\n");
+    buf_printf(b, "$APKMMAINT:: \"Bench Maintainer <bench@example.org>\"\n");
+    buf_printf(b, "$APKMDESC:: \"Synthetic package used to benchmark the APKMBUILD parser\"\n");
+    buf_printf(b, "$APKMLICENSE:: MIT\n");
+    buf_printf(b, "$APKMURL:: https://example.org/bench\n");
+    buf_printf(b, "$APKMDEP:: libc, zlib>=1.2, openssl>=3.0, libarchive, zstd\n");
+    buf_printf(b, "$APKMBUILDDEP:: gcc, make, cmake, pkgconf\n");
+    buf_printf(b, "$APKMCOMPRESS:: zstd\n");
+    buf_printf(b, "$APKMDOC:: [%%OPEN+==README.md]\n\n");
+}
+
+static void gen_typical(bench_buf_t *b, uint64_t *s) {
+    gen_header(b, s);
+    buf_printf(b, "$APKMMAKE:: {\n    ./configure --prefix=/usr\n    make -j4\n}\n");
+    buf_printf(b, "$APKMCHECK:: { make check }\n");
+    buf_printf(b, "$APKMINSTALL:: {\n    make DESTDIR=\"$DESTDIR\" install\n"
+                  "    install -Dm644 README.md \"$DESTDIR/usr/share/doc/bench/README.md\"\n}\n");
+    for (int i = 0; i < 8; i++) {
+        buf_printf(b, "$APKMFILE:: bin/tool%d usr/bin/tool%d 755\n", i, i);
+    }
+}
+
+static void gen_files(bench_buf_t *b, uint64_t *s) {
+    gen_header(b, s);
+    for (int i = 0; i < 5000; i++) {
+        buf_printf(b, "$APKMFILE:: share/data/%04llx/file%d.dat usr/share/bench/file%d.dat 644\n",
+                   (unsigned long long)(rng_next(s) & 0xffff), i, i);
+    }
+}
+
+static void gen_blocks(bench_buf_t *b, uint64_t *s) {
+    gen_header(b, s);
+    static const char *keys[] = {"APKMMAKE", "APKMCHECK", "APKMINSTALL"};
+    for (int k = 0; k < 3; k++) {
+        buf_printf(b, "$%s:: {\n", keys[k]);
+        for (int i = 0; i < 2000; i++) {
+            buf_printf(b, "    step_%d --flag=%llu input_%d.o\n",
+                       i, (unsigned long long)(rng_next(s) % 1000), i);
+        }
+        buf_printf(b, "}\n");
+    }
+}
+
+static void gen_long(bench_buf_t *b, uint64_t *s) {
+    gen_header(b, s);
+    buf_printf(b, "$APKMDESC:: \"");
+    for (int i = 0; i < 8000; i++) buf_printf(b, "word%llu ", (unsigned long long)(rng_next(s) % 100));
+    buf_printf(b, "\"\n$APKMDEP:: ");
+    for (int i = 0; i < 4000; i++) buf_printf(b, "dep%d>=1.%d, ", i, i % 10);
+    buf_printf(b, "last\n");
+}
+
+// ============================================================================
+// MESURE
+// ============================================================================
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    const char *name;
+    void (*gen)(bench_buf_t *, uint64_t *);
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    {"typical", gen_typical},
+    {"files", gen_files},
+    {"blocks", gen_blocks},
+    {"long", gen_long},
+};
+
+int main(int argc, char *argv[]) {
+    const char *out_path = NULL;
+    double min_time = 1.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:t:h")) != -1) {
+        switch (opt) {
+        case 'o': out_path = optarg; break;
+        case 't': min_time = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-o result.json] [-t seconds]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"bench\": \"apkmbuild_parse\",\n  \"results\": [\n");
+
+    size_t ncases = sizeof(cases) / sizeof(cases[0]);
+    for (size_t c = 0; c < ncases; c++) {
+        bench_buf_t b = {malloc(4096), 0, 4096};
+        uint64_t seed = 0x5e1f00d + c;
+        cases[c].gen(&b, &seed);
+
+        // Contrôle : le corpus doit se parser
+        build_info_t info;
+        char err[256];
+        if (apkmbuild_parse_buffer(b.data, b.len, &info, err, sizeof(err)) != 0) {
+            fprintf(stderr, "bench_apkmbuild: %s: %s\n", cases[c].name, err);
+            return 1;
+        }
+        size_t lines = info.lines;
+        size_t files = info.file_count;
+        apkmbuild_free(&info);
+
+        uint64_t iters = 0;
+        double start = now_sec(), elapsed;
+        do {
+            for (int i = 0; i < 16; i++) {
+                apkmbuild_parse_buffer(b.data, b.len, &info, NULL, 0);
+                apkmbuild_free(&info);
+            }
+            iters += 16;
+            elapsed = now_sec() - start;
+        } while (elapsed < min_time);
+
+        double mbps = (double)b.len * iters / elapsed / (1024.0 * 1024.0);
+        double lps = (double)lines * iters / elapsed;
+        fprintf(out, "    {\"corpus\": \"%s\", \"bytes\": %zu, \"lines\": %zu, \"files\": %zu, "
+                     "\"iterations\": %llu, \"us_per_parse\": %.3f, \"mb_per_s\": %.1f, "
+                     "\"lines_per_s\": %.0f}%s\n",
+                cases[c].name, b.len, lines, files, (unsigned long long)iters,
+                elapsed * 1e6 / iters, mbps, lps, c + 1 < ncases ? "," : "");
+        free(b.data);
+    }
+
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
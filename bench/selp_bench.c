@@ -0,0 +1,425 @@
+/*
+ * bench/selp_bench.c - Suite de performance SELP (compression, liste,
+ * vérification, extraction)
+ *
+ * Génère des corpus déterministes (graine fixe) puis mesure chaque
+ * opération pour chaque niveau / mode :
+ *   tiny      beaucoup de petits fichiers texte
+ *   huge      quelques gros fichiers (moitié texte, moitié aléatoire)
+ *   sparse    images disque creuses
+ *   redundant arborescence recopiée avec de petites retouches (dédup)
+ *
+ * Chaque opération tourne dans un processus fils : le pic de RSS rapporté
+ * (wait4) est celui de l'opération seule. Résultat en JSON sur stdout ou
+ * dans le fichier de -o, pour comparer d'une version à l'autre.
+ *
+ * Usage: bench_selp [-o résultat.json] [-s échelle] [-d dossier] [-k]
+ *   cmake --build build --target bench_selp_run   (écrit build/bench_selp.json)
+ */
+
+#include "bool.h"
+#include <fcntl.h>
+#include <ftw.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// ============================================================================
+// CORPUS DÉTERMINISTES
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    uint64_t files;
+    uint64_t bytes;               // Taille apparente totale
+} bench_corpus_t;
+
+static uint64_t rng_next(uint64_t *s) {
+    // xorshift64* : même contenu d'une machine à l'autre
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static const char *words[] = {
+    "package", "build", "depends", "install", "version", "archive", "selp",
+    "license", "source", "checksum", "static", "shared", "include", "config",
+    "return", "struct", "uint64_t", "const", "void", "printf", "error", "path"
+};
+
+// Texte pseudo-aléatoire compressible
+static void fill_text(uint8_t *buf, size_t len, uint64_t *s) {
+    size_t n = 0;
+    while (n < len) {
+        const char *w = words[rng_next(s) % (sizeof(words) / sizeof(words[0]))];
+        size_t wl = strlen(w);
+        for (size_t i = 0; i < wl && n < len; i++) buf[n++] = (uint8_t)w[i];
+        if (n < len) buf[n++] = (rng_next(s) % 8 == 0) ? '\n' : ' ';
+    }
+}
+
+static void fill_random(uint8_t *buf, size_t len, uint64_t *s) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v = rng_next(s);
+        memcpy(buf + i, &v, 8);
+    }
+    while (i < len) buf[i++] = (uint8_t)rng_next(s);
+}
+
+static void mkdir_p(const char *path) {
+    char tmp[MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(tmp, 0755);
+}
+
+static int write_file(const char *path, const uint8_t *data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return SELP_ERR_OPEN;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) {
+            close(fd);
+            return SELP_ERR_WRITE;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return close(fd) == 0 ? SELP_OK : SELP_ERR_WRITE;
+}
+
+static int gen_tiny(const char *dir, int scale, bench_corpus_t *c) {
+    uint64_t seed = 0x7417;
+    uint8_t buf[4096];
+    uint64_t count = 5000ULL * scale;
+
+    for (uint64_t i = 0; i < count; i++) {
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s/d%03llu", dir, (unsigned long long)(i % 100));
+        if (i < 100) mkdir_p(path);
+        snprintf(path, sizeof(path), "%s/d%03llu/f%06llu.txt", dir,
+                 (unsigned long long)(i % 100), (unsigned long long)i);
+
+        size_t len = (size_t)(rng_next(&seed) % sizeof(buf));
+        fill_text(buf, len, &seed);
+        if (write_file(path, buf, len) != SELP_OK) return SELP_ERR_WRITE;
+        c->files++;
+        c->bytes += len;
+    }
+    return SELP_OK;
+}
+
+static int gen_huge(const char *dir, int scale, bench_corpus_t *c) {
+    uint64_t seed = 0x8086;
+    size_t len = (size_t)64 * 1024 * 1024 * scale;
+    uint8_t *buf = malloc(len);
+    if (!buf) return SELP_ERR_MEMORY;
+
+    mkdir_p(dir);
+    for (int i = 0; i < 2; i++) {
+        fill_text(buf, len / 2, &seed);
+        fill_random(buf + len / 2, len - len / 2, &seed);
+
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s/huge%d.bin", dir, i);
+        if (write_file(path, buf, len) != SELP_OK) {
+            free(buf);
+            return SELP_ERR_WRITE;
+        }
+        c->files++;
+        c->bytes += len;
+    }
+    free(buf);
+    return SELP_OK;
+}
+
+static int gen_sparse(const char *dir, int scale, bench_corpus_t *c) {
+    uint64_t seed = 0x5ba5e;
+    uint64_t size = 1024ULL * 1024 * 1024 * scale;
+    uint8_t buf[256 * 1024];
+
+    mkdir_p(dir);
+    for (int i = 0; i < 2; i++) {
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s/disk%d.img", dir, i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return SELP_ERR_OPEN;
+
+        // 32 extents de données (16 Mo par Go) dans une image vide
+        for (int e = 0; e < 32; e++) {
+            off_t at = (off_t)(rng_next(&seed) % (size - sizeof(buf))) & ~(off_t)4095;
+            fill_text(buf, sizeof(buf), &seed);
+            if (pwrite(fd, buf, sizeof(buf), at) != (ssize_t)sizeof(buf)) {
+                close(fd);
+                return SELP_ERR_WRITE;
+            }
+        }
+        if (ftruncate(fd, (off_t)size) != 0 || close(fd) != 0) return SELP_ERR_WRITE;
+        c->files++;
+        c->bytes += size;
+    }
+    return SELP_OK;
+}
+
+static int gen_redundant(const char *dir, int scale, bench_corpus_t *c) {
+    enum { BASE_FILES = 64, COPIES = 8 };
+    uint64_t seed = 0xdeadbeef;
+    size_t len = (size_t)64 * 1024 * scale;
+    uint8_t *base = malloc((size_t)BASE_FILES * len);
+    if (!base) return SELP_ERR_MEMORY;
+
+    for (int f = 0; f < BASE_FILES; f++) fill_random(base + (size_t)f * len, len, &seed);
+
+    for (int copy = 0; copy < COPIES; copy++) {
+        char sub[MAX_PATH];
+        snprintf(sub, sizeof(sub), "%s/release-%d", dir, copy);
+        mkdir_p(sub);
+
+        for (int f = 0; f < BASE_FILES; f++) {
+            uint8_t *data = base + (size_t)f * len;
+            // Quelques octets changent d'une copie à l'autre
+            for (int k = 0; k < 4; k++) data[rng_next(&seed) % len] ^= 0xff;
+
+            char path[MAX_PATH];
+            snprintf(path, sizeof(path), "%s/obj%02d.o", sub, f);
+            if (write_file(path, data, len) != SELP_OK) {
+                free(base);
+                return SELP_ERR_WRITE;
+            }
+            c->files++;
+            c->bytes += len;
+        }
+    }
+    free(base);
+    return SELP_OK;
+}
+
+// ============================================================================
+// MESURE
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    int level;
+    int crypt;
+    int flags;
+} bench_codec_t;
+
+static const bench_codec_t codecs[] = {
+    {"none",    SELP_COMPRESS_NONE,  SELP_CRYPT_NONE,  0},
+    {"fast",    SELP_COMPRESS_FAST,  SELP_CRYPT_NONE,  0},
+    {"best",    SELP_COMPRESS_BEST,  SELP_CRYPT_NONE,  0},
+    {"ultra",   SELP_COMPRESS_ULTRA, SELP_CRYPT_NONE,  0},
+    {"dedup",   SELP_COMPRESS_FAST,  SELP_CRYPT_NONE,  SELP_FLAG_DEDUP},
+    {"encrypt", SELP_COMPRESS_FAST,  SELP_CRYPT_LIGHT, 0},
+};
+
+enum { OP_COMPRESS, OP_LIST, OP_VERIFY, OP_EXTRACT };
+static const char *op_names[] = {"compress", "list", "verify", "extract"};
+
+typedef struct {
+    double seconds;
+    long peak_rss_kb;
+    int ok;
+} bench_run_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int rm_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st; (void)type; (void)ftw;
+    return remove(path);
+}
+
+static void rm_tree(const char *path) {
+    nftw(path, rm_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static int run_op(int op, const char *src, const char *archive, const char *out,
+                  const bench_codec_t *codec) {
+    switch (op) {
+    case OP_COMPRESS:
+        return selp_compress_directory_ex(src, archive, codec->level, codec->crypt,
+                                          "bench", NULL, codec->flags);
+    case OP_LIST:
+        return selp_list(archive);
+    case OP_VERIFY:
+        return selp_verify(archive);
+    default:
+        return selp_extract(archive, out);
+    }
+}
+
+// Une opération dans un fils, sortie muette ; temps et RSS vus du parent
+static bench_run_t measure(int op, const char *src, const char *archive, const char *out,
+                           const bench_codec_t *codec) {
+    bench_run_t run = {0, 0, 0};
+
+    fflush(stdout);
+    double start = now_sec();
+    pid_t pid = fork();
+    if (pid < 0) return run;
+
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        _exit(run_op(op, src, archive, out, codec) == SELP_OK ? 0 : 1);
+    }
+
+    int status = 0;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) != pid) return run;
+
+    run.seconds = now_sec() - start;
+    run.peak_rss_kb = ru.ru_maxrss;
+    run.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return run;
+}
+
+static uint64_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+// ============================================================================
+// PROGRAMME
+// ============================================================================
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-o result.json] [-s scale] [-d workdir] [-k]\n", prog);
+    fprintf(stderr, "  -o  JSON output file (default: stdout)\n");
+    fprintf(stderr, "  -s  corpus scale factor (default: 1)\n");
+    fprintf(stderr, "  -d  working directory (default: $TMPDIR or /tmp)\n");
+    fprintf(stderr, "  -k  keep generated corpora\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *base = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    int scale = 1;
+    int keep = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:s:d:kh")) != -1) {
+        switch (opt) {
+        case 'o': output = optarg; break;
+        case 's': scale = atoi(optarg); break;
+        case 'd': base = optarg; break;
+        case 'k': keep = 1; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (scale < 1) scale = 1;
+
+    char work[MAX_PATH];
+    snprintf(work, sizeof(work), "%s/selp-bench-XXXXXX", base);
+    if (!mkdtemp(work)) {
+        fprintf(stderr, "❌ Cannot create working directory in %s\n", base);
+        return 1;
+    }
+
+    // Passphrase fixe pour le mode chiffré, jamais une vraie clé
+    selp_set_passphrase("selp-bench");
+
+    FILE *json = output ? fopen(output, "w") : stdout;
+    if (!json) {
+        fprintf(stderr, "❌ Cannot write %s\n", output);
+        rm_tree(work);
+        return 1;
+    }
+
+    struct {
+        bench_corpus_t corpus;
+        int (*gen)(const char *, int, bench_corpus_t *);
+    } corpora[] = {
+        {{"tiny", 0, 0}, gen_tiny},
+        {{"huge", 0, 0}, gen_huge},
+        {{"sparse", 0, 0}, gen_sparse},
+        {{"redundant", 0, 0}, gen_redundant},
+    };
+    size_t ncorpora = sizeof(corpora) / sizeof(corpora[0]);
+    size_t ncodecs = sizeof(codecs) / sizeof(codecs[0]);
+
+    fprintf(json, "{\n  \"bench\": \"selp\",\n  \"bool_version\": \"%s\",\n", BOOL_VERSION);
+    fprintf(json, "  \"selp_format\": %d,\n  \"scale\": %d,\n", SELP_VERSION, scale);
+    fprintf(json, "  \"cpus\": %ld,\n  \"results\": [", sysconf(_SC_NPROCESSORS_ONLN));
+
+    int failed = 0;
+    int first = 1;
+
+    for (size_t c = 0; c < ncorpora; c++) {
+        bench_corpus_t *corpus = &corpora[c].corpus;
+
+        char src[MAX_PATH];
+        snprintf(src, sizeof(src), "%s/%s", work, corpus->name);
+        mkdir_p(src);
+
+        fprintf(stderr, "📁 Generating corpus: %s\n", corpus->name);
+        if (corpora[c].gen(src, scale, corpus) != SELP_OK) {
+            fprintf(stderr, "❌ Cannot generate corpus %s\n", corpus->name);
+            failed = 1;
+            break;
+        }
+
+        for (size_t k = 0; k < ncodecs; k++) {
+            const bench_codec_t *codec = &codecs[k];
+
+            char archive[MAX_PATH], out[MAX_PATH];
+            snprintf(archive, sizeof(archive), "%s/%s-%s.selp", work, corpus->name, codec->name);
+            snprintf(out, sizeof(out), "%s/%s-%s.out", work, corpus->name, codec->name);
+
+            for (int op = OP_COMPRESS; op <= OP_EXTRACT; op++) {
+                fprintf(stderr, "⚡ %-9s %-7s %s\n", corpus->name, codec->name, op_names[op]);
+                bench_run_t run = measure(op, src, archive, out, codec);
+                if (!run.ok) failed = 1;
+
+                double ratio = corpus->bytes ? (double)file_size(archive) / corpus->bytes : 0;
+                double secs = run.seconds > 0 ? run.seconds : 1e-9;
+
+                fprintf(json, "%s\n    {\"corpus\": \"%s\", \"codec\": \"%s\", \"op\": \"%s\", "
+                        "\"ok\": %s, \"files\": %llu, \"bytes\": %llu, \"seconds\": %.6f, "
+                        "\"mb_s\": %.2f, \"files_s\": %.1f, \"peak_rss_kb\": %ld, \"ratio\": %.4f}",
+                        first ? "" : ",", corpus->name, codec->name, op_names[op],
+                        run.ok ? "true" : "false",
+                        (unsigned long long)corpus->files, (unsigned long long)corpus->bytes,
+                        run.seconds, corpus->bytes / secs / (1024.0 * 1024.0),
+                        corpus->files / secs, run.peak_rss_kb, ratio);
+                first = 0;
+            }
+
+            remove(archive);
+            rm_tree(out);
+        }
+
+        if (!keep) rm_tree(src);
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    if (output) fclose(json);
+
+    if (keep) {
+        fprintf(stderr, "📁 Corpora kept in %s\n", work);
+    } else {
+        rm_tree(work);
+    }
+
+    selp_set_passphrase(NULL);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+# bench/selp_dict.sh - Gain du dictionnaire zstd SELP sur des arborescences de petits fichiers
+#
+# Usage: bench/selp_dict.sh [bool] [dossier...]
+#   par défaut : ./build/bool sur include/ et test/
+
+BOOL="${1:-./build/bool}"
+[ $# -gt 0 ] && shift
+DIRS="${*:-include test}"
+
+if [ ! -x "$BOOL" ]; then
+    echo "bool introuvable: $BOOL"
+    exit 1
+fi
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+printf "%-12s %-6s %-8s %12s %12s %8s %10s\n" \
+    "tree" "level" "dict" "input" "output" "ratio" "time"
+
+for dir in $DIRS; do
+    [ -d "$dir" ] || continue
+    input=$(find "$dir" -type f -exec cat {} + | wc -c)
+
+    for level in fast best ultra; do
+        for dict in off on; do
+            opt=""
+            [ "$dict" = "off" ] && opt="--no-dict"
+
+            start=$(now_ms)
+            "$BOOL" --quiet -c "$dir" "$TMP/out.selp" --level "$level" $opt > /dev/null || exit 1
+            end=$(now_ms)
+
+            # Contrôle aller-retour
+            rm -rf "$TMP/x"
+            "$BOOL" --quiet -x "$TMP/out.selp" "$TMP/x" > /dev/null || exit 1
+            diff -r "$dir" "$TMP/x" > /dev/null || { echo "❌ round-trip mismatch: $dir"; exit 1; }
+
+            output=$(wc -c < "$TMP/out.selp")
+            printf "%-12s %-6s %-8s %12d %12d %7.1f%% %8dms\n" \
+                "$(basename "$dir")" "$level" "$dict" "$input" "$output" \
+                "$(awk "BEGIN { print 100 * $output / $input }")" $((end - start))
+        done
+    done
+done
@@ -0,0 +1,112 @@
+/*
+ * bench/selp_gcm.c - Débit du chiffrement SELP (AES-256-GCM par bloc)
+ *
+ * Scelle puis ouvre des blocs de SELP_BLOCK_SIZE avec 1 à N threads, chacun
+ * avec son propre selp_cipher_t comme le fait la vérification parallèle.
+ *
+ * Usage: selp_gcm_bench [Mo par thread] [threads max]
+ *   cmake --build build --target selp_gcm_bench && ./build/selp_gcm_bench
+ */
+
+#include "bool.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/rand.h>
+
+typedef struct {
+    const selp_cipher_t *master;
+    uint64_t first;              // Premier index de bloc (nonces distincts)
+    int blocks;
+    int failed;
+} gcm_job_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *gcm_worker(void *arg) {
+    gcm_job_t *job = arg;
+    selp_cipher_t c;
+
+    uint8_t *plain = malloc(SELP_BLOCK_SIZE);
+    uint8_t *sealed = malloc(SELP_BLOCK_SIZE + SELP_GCM_TAG_SIZE);
+    if (!plain || !sealed || selp_cipher_clone(&c, job->master) != SELP_OK) {
+        job->failed = 1;
+        free(plain);
+        free(sealed);
+        return NULL;
+    }
+    memset(plain, 0x5a, SELP_BLOCK_SIZE);
+
+    for (int i = 0; i < job->blocks; i++) {
+        uint64_t index = job->first + (uint64_t)i;
+        if (selp_cipher_seal(&c, index, plain, SELP_BLOCK_SIZE, sealed) != SELP_OK ||
+            selp_cipher_open(&c, index, sealed, SELP_BLOCK_SIZE + SELP_GCM_TAG_SIZE, plain) != SELP_OK) {
+            job->failed = 1;
+            break;
+        }
+    }
+
+    selp_cipher_free(&c);
+    free(plain);
+    free(sealed);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int mb = argc > 1 ? atoi(argv[1]) : 512;
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (mb < 1) mb = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    uint8_t key[32], prefix[4];
+    RAND_bytes(key, sizeof(key));
+    RAND_bytes(prefix, sizeof(prefix));
+
+    selp_cipher_t master;
+    if (selp_cipher_init_key(&master, key, prefix) != SELP_OK) {
+        fprintf(stderr, "EVP AES-256-GCM unavailable\n");
+        return 1;
+    }
+
+    int blocks = (int)((uint64_t)mb * 1024 * 1024 / SELP_BLOCK_SIZE);
+    if (blocks < 1) blocks = 1;
+
+    printf("%-8s %12s %12s\n", "threads", "seal+open", "GB/s");
+
+    for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        gcm_job_t *jobs = calloc(threads, sizeof(gcm_job_t));
+        pthread_t *tids = calloc(threads, sizeof(pthread_t));
+        if (!jobs || !tids) return 1;
+
+        double start = now_sec();
+        for (int t = 0; t < threads; t++) {
+            jobs[t].master = &master;
+            jobs[t].first = (uint64_t)t * blocks;
+            jobs[t].blocks = blocks;
+            pthread_create(&tids[t], NULL, gcm_worker, &jobs[t]);
+        }
+        int failed = 0;
+        for (int t = 0; t < threads; t++) {
+            pthread_join(tids[t], NULL);
+            failed |= jobs[t].failed;
+        }
+        double elapsed = now_sec() - start;
+
+        // Chaque octet est chiffré puis déchiffré : 2 passes
+        double bytes = 2.0 * threads * blocks * (double)SELP_BLOCK_SIZE;
+        printf("%-8d %9d MiB %12.2f%s\n", threads, threads * blocks,
+               bytes / elapsed / 1e9, failed ? "  (FAILED)" : "");
+
+        free(jobs);
+        free(tids);
+        if (failed) return 1;
+        if (threads == max_threads) break;
+    }
+
+    selp_cipher_free(&master);
+    return 0;
+}
@@ -10,57 +10,9 @@
 #include <openssl/sha.h>
 #include <openssl/evp.h>
 
-#define BOOL_VERSION "2.1.0"
-#define SIGNATURE_SIZE 128
-
-typedef struct {
-    char name[128];
-    char version[64];
-    char release[16];
-    char arch[32];
-    char maintainer[256];
-    char description[512];
-    char license[64];
-    char url[256];
-    char deps[1024];
-    char build_cmd[1024];
-    char install_cmd[1024];
-    char check_cmd[1024];
-    char script_path[512];
-    char includes[512];
-    char libs[512];
-    char pkgconfig[512];
-    char sha256[128];
-    char signature[SIGNATURE_SIZE];
-    char build_date[32];
-    char build_host[128];
-// Dans la structure apkm_build_t, ajouter :
-    char docs[2048];        // Documentation (peut contenir des chemins de fichiers)
-    char readme_path[512];  // Chemin vers le README
-    char doc_content[8192]; // Contenu de la documentation
-    long long file_size;
-    int dep_count;
-    char** deps_array;
-} apkm_build_t;
+#include "src/bools/apkmbuild.h"
 
-// Nettoyer une chaîne
-void clean_string(char *str) {
-    int len = strlen(str);
-    if (len >= 2 && str[0] == '"' && str[len-1] == '"') {
-        memmove(str, str + 1, len - 2);
-        str[len - 2] = '\0';
-    }
-    
-    char *start = str;
-    while (*start == ' ' || *start == '\t') start++;
-    if (start != str) memmove(str, start, strlen(start) + 1);
-    
-    char *end = str + strlen(str) - 1;
-    while (end > str && (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r')) {
-        *end = '\0';
-        end--;
-    }
-}
+#define BOOL_VERSION "2.1.0"
 
 // Calculer SHA256 d'un fichier
 int calculate_file_sha256(const char *filepath, char *output) {
@@ -92,154 +44,13 @@ int calculate_file_sha256(const char *filepath, char *output) {
     return 0;
 }
 
-// Parser le fichier APKMBUILD
-void parse_apkmbuild(const char *filename, apkm_build_t *b) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        perror("[BOOL] Error opening APKMBUILD");
+// Parser le fichier APKMBUILD (parseur partagé avec src/bools/bool.c)
+void parse_apkmbuild(const char *filename, build_info_t *b) {
+    char err[512];
+    if (apkmbuild_parse_file(filename, b, err, sizeof(err)) != 0) {
+        fprintf(stderr, "[BOOL] Error: %s\n", err);
         exit(1);
     }
-
-    char line[1024];
-    int in_block = 0;
-    char current_block[1024] = "";
-    
-    // Initialisation
-    memset(b, 0, sizeof(apkm_build_t));
-    strcpy(b->arch, "x86_64");
-    strcpy(b->release, "r0");
-    strcpy(b->script_path, "install.sh");
-    strcpy(b->includes, "include");
-    strcpy(b->libs, "lib");
-    strcpy(b->pkgconfig, "lib/pkgconfig");
-    
-    // Date de build
-    time_t t = time(NULL);
-    struct tm *tm = localtime(&t);
-    strftime(b->build_date, sizeof(b->build_date), "%Y-%m-%d %H:%M:%S", tm);
-    
-    // Hostname
-    gethostname(b->build_host, sizeof(b->build_host));
-    
-    while (fgets(line, sizeof(line), fp)) {
-        // Enlever les retours à la ligne
-        line[strcspn(line, "\n")] = 0;
-        
-        if (strstr(line, "$APKMMAKE::")) {
-            in_block = 1;
-            strcpy(current_block, "make");
-            char *val = strstr(line, "::") + 2;
-            strcpy(b->build_cmd, val);
-            clean_string(b->build_cmd);
-            continue;
-        }
-        if (strstr(line, "$APKMINSTALL::")) {
-            in_block = 1;
-            strcpy(current_block, "install");
-            char *val = strstr(line, "::") + 2;
-            strcpy(b->install_cmd, val);
-            clean_string(b->install_cmd);
-            continue;
-        }
-        if (strstr(line, "$APKMCHECK::")) {
-            in_block = 1;
-            strcpy(current_block, "check");
-            char *val = strstr(line, "::") + 2;
-            strcpy(b->check_cmd, val);
-            clean_string(b->check_cmd);
-            continue;
-        }
-        
-        if (in_block) {
-            if (strstr(line, "}")) {
-                in_block = 0;
-            } else {
-                if (strcmp(current_block, "make") == 0) {
-                    strcat(b->build_cmd, " ");
-                    strcat(b->build_cmd, line);
-                } else if (strcmp(current_block, "install") == 0) {
-                    strcat(b->install_cmd, " ");
-                    strcat(b->install_cmd, line);
-                } else if (strcmp(current_block, "check") == 0) {
-                    strcat(b->check_cmd, " ");
-                    strcat(b->check_cmd, line);
-                }
-            }
-            continue;
-        }
-        
-        char *val;
-        if ((val = strstr(line, "$APKNAME::"))) {
-            strcpy(b->name, val + 10);
-            clean_string(b->name);
-        }
-        else if ((val = strstr(line, "$APKMVERSION::"))) {
-            strcpy(b->version, val + 14);
-            clean_string(b->version);
-        }
-        else if ((val = strstr(line, "$APKMRELEASE::"))) {
-            strcpy(b->release, val + 14);
-            clean_string(b->release);
-        }
-        else if ((val = strstr(line, "$APKMARCH::"))) {
-            strcpy(b->arch, val + 11);
-            clean_string(b->arch);
-        }
-        else if ((val = strstr(line, "$APKMMAINT::"))) {
-            strcpy(b->maintainer, val + 12);
-            clean_string(b->maintainer);
-        }
-        else if ((val = strstr(line, "$APKMDESC::"))) {
-            strcpy(b->description, val + 11);
-            clean_string(b->description);
-        }
-        else if ((val = strstr(line, "$APKMLICENSE::"))) {
-            strcpy(b->license, val + 14);
-            clean_string(b->license);
-        }
-        else if ((val = strstr(line, "$APKMURL::"))) {
-            strcpy(b->url, val + 10);
-            clean_string(b->url);
-        }
-        else if ((val = strstr(line, "$APKMDEP::"))) {
-            strcpy(b->deps, val + 10);
-            clean_string(b->deps);
-        }
-        else if ((val = strstr(line, "$APKMPATH::"))) {
-            strcpy(b->script_path, val + 11);
-            clean_string(b->script_path);
-        }
-        else if ((val = strstr(line, "$APKMINCLUDES::"))) {
-            strcpy(b->includes, val + 15);
-            clean_string(b->includes);
-        }
-            // Dans parse_apkmbuild, ajouter :
-else if ((val = strstr(line, "$APKMDOC::"))) {
-    strcpy(b->docs, val + 10);
-    clean_string(b->docs);
-    
-    // Parser le format spécial [%OPEN+==fichier]
-    char *open_marker = strstr(b->docs, "[%OPEN+==");
-    if (open_marker) {
-        char *file_start = open_marker + 9;
-        char *file_end = strchr(file_start, ']');
-        if (file_end) {
-            int file_len = file_end - file_start;
-            strncpy(b->readme_path, file_start, file_len);
-            b->readme_path[file_len] = '\0';
-        }
-    }
-}
-        else if ((val = strstr(line, "$APKMLIBS::"))) {
-            strcpy(b->libs, val + 11);
-            clean_string(b->libs);
-        }
-        else if ((val = strstr(line, "$APKMPKGCONFIG::"))) {
-            strcpy(b->pkgconfig, val + 16);
-            clean_string(b->pkgconfig);
-        }
-    }
-    fclose(fp);
 }
 
 // Dans bool.c, ajouter cette fonction
@@ -283,7 +94,7 @@ char* load_readme_content(const char *readme_path, char *buffer, size_t buffer_s
 }
 
 // Créer la structure complète du paquet
-int create_package_structure(apkm_build_t *b, const char *build_dir) {
+int create_package_structure(build_info_t *b, const char *build_dir) {
     char pkg_dir[512];
     snprintf(pkg_dir, sizeof(pkg_dir), "%s/pkg-%s", build_dir, b->name);
     
@@ -327,7 +138,7 @@ int create_package_structure(apkm_build_t *b, const char *build_dir) {
 }
 
 // Créer un fichier de signature séparé
-void create_signature_file(apkm_build_t *b, const char *pkg_dir) {
+void create_signature_file(build_info_t *b, const char *pkg_dir) {
     char sig_path[512];
     snprintf(sig_path, sizeof(sig_path), "%s/.BOOL.sig", pkg_dir);
     
@@ -354,7 +165,7 @@ void create_signature_file(apkm_build_t *b, const char *pkg_dir) {
 }
 
 // Builder le paquet
-int build_package(apkm_build_t *b) {
+int build_package(build_info_t *b) {
     printf("\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
     printf("  BOOL - APKM Package Builder v%s\n", BOOL_VERSION);
     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
@@ -578,10 +389,11 @@ int main(int argc, char *argv[]) {
             return 1;
         }
         
-        apkm_build_t build_info = {0};
+        build_info_t build_info;
         parse_apkmbuild("APKMBUILD", &build_info);
         
-        if (build_package(&build_info) == 0) {
+        int ret = build_package(&build_info);
+        if (ret == 0) {
             printf("\n[BOOL] ✅ Build completed successfully!\n");
             printf("[BOOL] 📦 Package: build/%s-v%s-%s.%s.tar.bool\n",
                    build_info.name, build_info.version, 
@@ -591,8 +403,9 @@ int main(int argc, char *argv[]) {
                    build_info.release, build_info.arch);
         } else {
             printf("\n[BOOL] ❌ Build failed\n");
-            return 1;
         }
+        apkmbuild_free(&build_info);
+        if (ret != 0) return 1;
     }
     else if (strcmp(argv[1], "--info") == 0) {
         if (argc < 3) {
@@ -27,6 +27,10 @@ team created new release logiciel
 #define ALPINE_DB_PATH "/lib/apk/db/installed"
 #define APKM_DB_PATH "/var/lib/apkm"
 #define APKM_SANDBOX_PATH "/tmp/apkm_sandbox"
+#define APKM_CONF_PATH "/etc/apkm/repositories.conf"
+#define APKM_CACHE_PATH "/usr/local/share/apkm/cache"
+// Paquets installés par apkm : <nom>/Manifest.toml (+ cache .bin)
+#define APKM_LOCAL_DB_PATH "/usr/local/share/apkm/database"
 
 // Formats de sortie
 typedef enum {
@@ -1,7 +1,123 @@
 #ifndef CORE_H
 #define CORE_H
 
-int extract_package(const char *filepath, const char *dest_path);
-int run_install_script(const char *staging_path, const char *pkg_name);
+#include <stddef.h>
+#include <curl/curl.h>
+#include "apkm.h"
 
-#endif
\ No newline at end of file
+/*
+ * Démon apkmd : un processus apkm persistant (boucle epoll + signalfd +
+ * timerfd du contexte) garde les dépôts, les paquets installés et le
+ * catalogue chargés et à jour (inotify), et exécute les commandes des
+ * clients apkm dans des fils qui en héritent.
+ *
+ * Socket : $APKMD_SOCK, sinon APKMD_SOCKET_PATH (SOCK_SEQPACKET).
+ * Requêtes (un message) :
+ *   RUN\0<conf>\0<db>\0<cache>\0<arg>\0<arg>...
+ *                         + stdin/stdout/stderr et dossier courant du client
+ *                         (SCM_RIGHTS) -> "OK <code>" à la fin de la commande,
+ *                         ou "FALLBACK" (à exécuter localement)
+ *   STATUS                -> "OK <pid>"
+ *   STOP                  -> "OK"
+ * <conf>, <db>, <cache> : apkm_conf_path, apkm_db_dir, apkm_cache_dir du
+ * client ; différents de ceux du démon, ou client d'un autre utilisateur :
+ * FALLBACK. Une requête qui n'arrive pas en APKMD_REQUEST_TIMEOUT est
+ * abandonnée sans bloquer la boucle.
+ */
+
+/*
+ * Invalidation des caches : ctx.inotify_fd surveille les sources d'état et
+ * chaque cache compare la génération de sa source à celle de sa construction.
+ *   APKM_STATE_INSTALLED  /lib/apk/db/installed, base locale des manifests
+ *   APKM_STATE_REPOS      /etc/apkm/repositories.conf
+ *   APKM_STATE_CATALOGUE  packages.db (available_packages)
+ * Sans inotify, les générations changent à chaque consultation : pas de cache.
+ */
+
+#define APKM_STATE_INSTALLED 0x1
+#define APKM_STATE_REPOS     0x2
+#define APKM_STATE_CATALOGUE 0x4
+#define APKM_STATE_ALL       0x7
+
+// Processus durable (apkmd) : surveille aussi les répertoires ajoutés
+int apkm_watch_init(void);
+// Lit les événements en attente, renvoie les états invalidés
+unsigned apkm_watch_poll(void);
+// Génération courante d'un état (APKM_STATE_*), après lecture des événements
+unsigned long apkm_state_generation(unsigned state);
+// Surveille aussi un répertoire (ex. celui d'un paquet installé) ; sans
+// effet tant qu'apkm_watch_init n'a pas été appelé
+int apkm_watch_path(const char *dir, unsigned state);
+
+// repositories.conf ($APKM_CONF) et répertoire de packages.db ($APKM_DB_DIR)
+const char *apkm_conf_path(void);
+const char *apkm_db_dir(void);
+// Cache des réponses du hub (voir plus bas), "" s'il n'y en a pas
+const char *apkm_cache_dir(void);
+
+/*
+ * Cache des réponses de métadonnées du hub (JSON), par URL. Le disque
+ * (<cache>/http/<sha256(url)>) est partagé entre processus ; la mémoire est
+ * la couche chaude du processus, sous ctx.cache_lock.
+ * Une réponse est fraîche pendant CACHE_TTL. Ensuite, pendant CACHE_STALE,
+ * elle est servie telle quelle et revalidée à côté (apkmd : curl multi dans
+ * sa boucle epoll ; apkm seul : processus détaché) ; plus
+ * vieille, elle est revalidée avant d'être servie (If-None-Match /
+ * If-Modified-Since, 304 = inchangée). Hub injoignable : dernière réponse.
+ * Répertoire : $APKM_CACHE_DIR/http, APKM_CACHE_PATH/http si accessible en
+ * écriture, sinon ~/.cache/apkm/http.
+ */
+
+// 0 et *body (à libérer, terminé par '\0') si une réponse 2xx est connue
+int apkm_http_get(CURL *curl, const char *url, long timeout, char **body, size_t *size);
+
+/*
+ * Mode hors ligne : forcé (apkm --offline, APKM_OFFLINE=1) ou repli quand un
+ * hub ne répond pas (connexion refusée ou expirée, APKM_CONNECT_TIMEOUT).
+ * Un hub injoignable n'est plus appelé pendant une minute, par aucun
+ * processus ; apkm_http_get sert alors le cache quel que soit son âge et
+ * les paquets se résolvent depuis available_packages et le cache local.
+ */
+
+#define APKM_ONLINE           0
+#define APKM_OFFLINE_FORCED   1
+#define APKM_OFFLINE_FALLBACK 2
+
+#define APKM_CONNECT_TIMEOUT 3L
+
+void apkm_set_offline(int offline);
+// APKM_ONLINE, ou la raison du mode hors ligne de la commande en cours
+int apkm_offline(void);
+// 0 si le hub de l'URL ne doit pas être appelé (hors ligne)
+int apkm_hub_reachable(const char *url);
+// Résultat d'une requête vers le hub de l'URL (note ou lève le repli)
+void apkm_hub_result(const char *url, CURLcode res);
+
+// available_packages : version la plus récente d'un paquet, 0 si trouvé
+int apkm_catalogue_find(const char *name, package_t *pkg);
+int apkm_catalogue_record(const package_t *pkg, const char *repository);
+
+#define APKMD_SOCKET_PATH "/run/apkm/apkmd.sock"
+
+typedef struct {
+    // Exécute une commande apkm (argv[0] = "apkm"), renvoie le code de sortie
+    int (*run)(int argc, char **argv);
+    // SIGHUP : recharger la configuration
+    void (*reload)(void);
+    // Recharger à l'avance ce qui a changé (démarrage, inotify, SIGHUP)
+    void (*warm)(void);
+    // Dans le fils d'une requête : oublier les connexions du parent
+    void (*after_fork)(void);
+} apkmd_ops_t;
+
+int apkmd_socket_path(char *path, size_t size);
+// Boucle du démon (processus courant) ; idle_timeout en secondes, 0 = jamais
+int apkmd_serve(const apkmd_ops_t *ops, int idle_timeout);
+
+// 0 si le démon a exécuté la commande (*status = code), -1 sinon
+int apkmd_forward(int argc, char **argv, int *status);
+// 0 si un démon répond (*pid renseigné), -1 sinon
+int apkmd_status(long *pid);
+int apkmd_stop(void);
+
+#endif
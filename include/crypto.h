@@ -0,0 +1,47 @@
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <stddef.h>
+
+#define BLAKE3_HASH_LEN 32
+
+// AES-256-GCM (IV 12 octets, tag 16 octets)
+int aes256_gcm_encrypt(const unsigned char* plaintext, size_t plaintext_len,
+                       const unsigned char* key, const unsigned char* iv,
+                       unsigned char* ciphertext, unsigned char* tag);
+int aes256_gcm_decrypt(const unsigned char* ciphertext, size_t ciphertext_len,
+                       const unsigned char* key, const unsigned char* iv,
+                       const unsigned char* tag, unsigned char* plaintext);
+
+// Ed25519
+int ed25519_keypair(unsigned char *pk, unsigned char *sk);
+int ed25519_sign(const unsigned char* message, size_t msg_len,
+                 const unsigned char* sk, unsigned char* signature);
+int ed25519_verify(const unsigned char* message, size_t msg_len,
+                   const unsigned char* pk, const unsigned char* signature);
+
+// BLAKE3
+void blake3_hash(const void* data, size_t len, unsigned char* hash);
+int blake3_hash_file(const char *filename, unsigned char *hash);
+int blake3_hash_files(const char *const *filenames, size_t count,
+                      unsigned char (*hashes)[BLAKE3_HASH_LEN], int *status,
+                      int threads);
+
+// Dérivation de clé et aléa
+int argon2id_derive_key(const char* password, const unsigned char* salt,
+                        unsigned char* key, size_t key_len);
+int random_bytes(unsigned char *buf, size_t len);
+
+// Chiffrement hybride (X25519 + XSalsa20-Poly1305)
+int hybrid_encrypt(const unsigned char* plaintext, size_t plaintext_len,
+                   const unsigned char* recipient_pubkey,
+                   unsigned char* ciphertext, size_t* ciphertext_len);
+int hybrid_decrypt(const unsigned char* ciphertext, size_t ciphertext_len,
+                   const unsigned char* recipient_sk,
+                   unsigned char* plaintext, size_t* plaintext_len);
+
+// Conversion
+void bytes_to_hex(const unsigned char *bytes, size_t len, char *hex);
+int hex_to_bytes(const char *hex, unsigned char *bytes, size_t len);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Manifest.toml des paquets .tar.bool, partagé par apkm et apsm.
+ *
+ * Le fichier est lu une fois dans une arène et découpé sur place : les
+ * valeurs pointent dans ce tampon (chaînes TOML déséchappées en place).
+ * Les champs texte ne sont jamais NULL ("" si absents).
+ *
+ * manifest_load() sert aux manifests installés : il lit d'abord le cache
+ * binaire "<path>.bin" (en-tête, offsets, chaînes) et ne parse le TOML que
+ * si ce cache est absent ou plus vieux que le fichier, puis le réécrit.
+ */
+
+// Champs texte : X(champ, section, clé)
+#define MANIFEST_FIELDS(X) \
+    X(name,        "metadata",  "name") \
+    X(version,     "metadata",  "version") \
+    X(release,     "metadata",  "release") \
+    X(arch,        "metadata",  "arch") \
+    X(description, "metadata",  "description") \
+    X(maintainer,  "metadata",  "maintainer") \
+    X(license,     "metadata",  "license") \
+    X(homepage,    "metadata",  "homepage") \
+    X(repository,  "metadata",  "repository") \
+    X(tags,        "metadata",  "tags") \
+    X(install,     "scripts",   "install") \
+    X(postinst,    "scripts",   "postinst") \
+    X(sha256,      "signature", "sha256") \
+    X(timestamp,   "signature", "timestamp")
+
+// Dépendance : nom et contrainte ("*", ">=1.2"...)
+typedef struct {
+    const char *name;
+    const char *constraint;
+} manifest_dep_t;
+
+// Table [[file]]
+typedef struct {
+    const char *source;
+    const char *dest;
+    uint32_t mode;
+} manifest_file_t;
+
+typedef struct manifest_chunk manifest_chunk_t;
+
+typedef struct {
+#define MANIFEST_FIELD_DECL(field, section, key) const char *field;
+    MANIFEST_FIELDS(MANIFEST_FIELD_DECL)
+#undef MANIFEST_FIELD_DECL
+
+    manifest_dep_t *deps;          // [dependencies]
+    size_t dep_count;
+    manifest_dep_t *build_deps;    // [build-dependencies]
+    size_t build_dep_count;
+    manifest_file_t *files;        // [[file]]
+    size_t file_count;
+
+    int from_cache;                // 1 si lu depuis le cache binaire
+    manifest_chunk_t *arena;
+} manifest_t;
+
+// Manifest vide (champs à "") ; les fonctions ci-dessous l'appellent
+void manifest_init(manifest_t *m);
+
+// 0 si succès, -1 sinon
+int manifest_parse_file(const char *path, manifest_t *m);
+int manifest_parse_buffer(const char *data, size_t len, manifest_t *m);
+
+// Lecture via le cache binaire (écrit au besoin, sans erreur si impossible)
+int manifest_load(const char *path, manifest_t *m);
+// Écrit le cache binaire de path à partir de m
+int manifest_compile(const char *path, const manifest_t *m);
+
+// Dépendances jointes "nom=contrainte;..." (à libérer)
+char *manifest_join_deps(const manifest_dep_t *deps, size_t count);
+
+void manifest_free(manifest_t *m);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <curl/curl.h>
+#include "manifest.h"
+
+/*
+ * Upload découpé et reprenable des paquets vers Zarch Hub (apsm push).
+ *
+ * Protocole :
+ *   HEAD {api}/package/sha256/{sha256}             200 si le paquet existe déjà
+ *   POST {api}/package/upload/chunked/{nom}        métadonnées, taille, sha256,
+ *                                                  empreintes des parties
+ *                                                  -> {"upload_id": ...,
+ *                                                      "received": [i, ...]}
+ *   GET  {api}/package/upload/chunked/{id}         -> {"received": [i, ...]}
+ *   PUT  {api}/package/upload/chunked/{id}/{i}     partie i (X-Chunk-SHA256)
+ *   POST {api}/package/upload/chunked/{id}/commit  {"sha256", "size", "chunks"}
+ *
+ * Un paquet déjà présent (relance d'une CI) n'est pas renvoyé, et seules
+ * les parties que le hub ne connaît pas encore ("received") sont envoyées.
+ * Les parties partent en parallèle (curl multi, connexions partagées) et
+ * chaque partie acceptée est notée dans un journal local
+ * (<journal_dir>/<sha256>-<chunk>.journal) : une publication interrompue
+ * reprend là où elle s'était arrêtée. Le journal est supprimé au commit.
+ */
+
+#define PUBLISH_DEFAULT_CHUNK_MB 8
+#define PUBLISH_DEFAULT_JOBS 4
+#define PUBLISH_MAX_JOBS 32
+
+// Le serveur ne connaît pas le protocole découpé (404/405 à l'ouverture)
+#define PUBLISH_UNSUPPORTED 1
+// Le hub a déjà ce paquet octet pour octet : rien n'a été envoyé
+#define PUBLISH_EXISTS 2
+
+typedef struct {
+    const char *api_url;
+    const char *token;
+    size_t chunk_size;           // octets, 0 = défaut
+    int jobs;                    // parties simultanées, 0 = défaut
+    const char *journal_dir;     // NULL = $XDG_CACHE_HOME/apsm/uploads
+    CURLSH *share;               // NULL = connexions propres à cet upload
+    // Appelé à chaque partie acceptée
+    void (*progress)(uint64_t done_bytes, uint64_t total_bytes, void *userdata);
+    void *userdata;
+} publish_options_t;
+
+typedef struct {
+    size_t chunks;               // nombre total de parties
+    size_t resumed;              // déjà envoyées (reprise du journal)
+    size_t deduped;              // déjà connues du hub (autre upload)
+    size_t sent;                 // envoyées par cet appel
+    size_t retries;
+    uint64_t bytes_sent;
+    char sha256[65];
+} publish_stats_t;
+
+// Connexions, DNS et sessions TLS réutilisés d'un upload à l'autre
+// (apsm publish --batch). libcurl ne sait pas partager des connexions
+// entre threads : un cache par thread.
+CURLSH *publish_share_new(void);
+void publish_share_free(CURLSH *share);
+
+// 0 si succès, PUBLISH_EXISTS, PUBLISH_UNSUPPORTED, -1 sinon (message dans err)
+int publish_chunked_upload(const char *filepath, const manifest_t *manifest,
+                           const publish_options_t *opts, publish_stats_t *stats,
+                           char *err, size_t err_size);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <stddef.h>
+
+/*
+ * Agent de token : un processus par utilisateur garde le token Zarch Hub
+ * déchiffré en mémoire verrouillée (mlock, hors core dump) et le donne à
+ * apkm/apsm sur une socket unix. Seuls les processus du même utilisateur
+ * sont servis (SO_PEERCRED). L'agent s'arrête quand le token expire ;
+ * sans token (démarré sans, ou après CLEAR) il attend un PUT ou un STOP.
+ *
+ * Socket : $APKM_AGENT_SOCK, sinon $XDG_RUNTIME_DIR/apkm-agent.sock,
+ * sinon /tmp/apkm-agent-<uid>/agent.sock.
+ *
+ * Protocole (une requête par connexion, réponse "OK ..." ou "ERR ...") :
+ *   GET                 -> OK <token>
+ *   PUT <ttl> <token>   -> OK
+ *   CLEAR               -> OK (token effacé, l'agent continue)
+ *   STATUS              -> OK <secondes restantes> <pid>
+ *   STOP                -> OK
+ */
+
+#define TOKEN_AGENT_DEFAULT_TTL (8 * 3600)
+#define TOKEN_AGENT_MAX_TOKEN 2048
+
+int token_agent_socket_path(char *path, size_t size);
+
+// 0 si l'agent a fourni un token, -1 sinon (pas d'agent, pas de token)
+int token_agent_get(char *token, size_t size);
+int token_agent_put(const char *token, int ttl);
+int token_agent_clear(void);
+// 0 : agent avec token, 1 : agent sans token, -1 : pas d'agent
+int token_agent_status(long *remaining, long *pid);
+int token_agent_stop(void);
+
+// Boucle de l'agent (processus courant). Le token initial est la première
+// ligne de token_file (NULL ou illisible : démarrage sans token), lue
+// directement dans la mémoire verrouillée
+int token_agent_serve(const char *token_file, int ttl);
+
+#endif
@@ -3,15 +3,22 @@
 #include <string.h>
 #include <curl/curl.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <dirent.h>
 #include <libgen.h>
+#include <pthread.h>
 #include <json-c/json.h>
+#include <archive.h>
+#include <archive_entry.h>
 #include "apkm.h"
 #include "security.h"
+#include "manifest.h"
+#include "publish.h"
+#include "token.h"
 
 // Configuration
 /*
@@ -20,6 +27,7 @@
     */
 #define TOKEN_PATH "/usr/local/share/apkm/PROTOCOLE/security/tokens/auth.token"
 #define MANIFEST_NAME "Manifest.toml"
+#define MANIFEST_MAX_SIZE (4 * 1024 * 1024)
 
 struct curl_response {
     char *data;
@@ -28,22 +36,11 @@ struct curl_response {
 
 static int debug_mode = 0;
 static int quiet_mode = 0;
-
-// Structure pour Manifest.toml
-typedef struct {
-    char name[256];
-    char version[64];
-    char release[16];
-    char arch[32];
-    char description[1024];
-    char maintainer[256];
-    char license[64];
-    char homepage[256];
-    char repository[256];
-    char dependencies[2048];
-    char build_deps[1024];
-    char tags[512];
-} manifest_t;
+static int assume_yes = 0;
+static size_t upload_chunk_mb = 0;
+static int upload_jobs = 0;
+static int batch_parallel = 0;
+static const char *report_path = NULL;
 
 // ============================================================================
 // FONCTIONS UTILITAIRES
@@ -63,6 +60,12 @@ static size_t write_callback(void *ptr, size_t size, size_t nmemb, void *userdat
     return total;
 }
 
+// APSM_API_URL permet de viser un autre hub (miroir, serveur de test)
+static const char *api_url(void) {
+    const char *url = getenv("APSM_API_URL");
+    return url && *url ? url : ZARCH_API_URL;
+}
+
 void debug_print(const char *format, ...) {
     if (!debug_mode) return;
     
@@ -129,99 +132,24 @@ void print_step(const char *format, ...) {
 }
 
 // ============================================================================
-// PARSEUR MANIFEST.TOML (version améliorée)
+// PARSEUR MANIFEST.TOML (module partagé manifest.c)
 // ============================================================================
 
+static void manifest_defaults(manifest_t *manifest) {
+    if (!manifest->arch[0]) manifest->arch = "x86_64";
+    if (!manifest->release[0]) manifest->release = "r0";
+    if (!manifest->license[0]) manifest->license = "MIT";
+}
+
 int parse_manifest(const char *path, manifest_t *manifest) {
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    if (manifest_parse_file(path, manifest) != 0) {
         debug_print("Cannot open manifest: %s", path);
         return -1;
     }
+    manifest_defaults(manifest);
     
-    char line[1024];
-    char section[64] = "";
-    int in_deps = 0;
-    int in_build_deps = 0;
-    
-    memset(manifest, 0, sizeof(manifest_t));
-    strcpy(manifest->arch, "x86_64");  // Default
-    strcpy(manifest->release, "r0");   // Default
-    strcpy(manifest->license, "MIT");  // Default
-    
-    while (fgets(line, sizeof(line), f)) {
-        // Enlever le saut de ligne
-        line[strcspn(line, "\n")] = 0;
-        
-        // Ignorer les lignes vides
-        if (line[0] == '\0') continue;
-        
-        // Commentaires
-        if (line[0] == '#') continue;
-        
-        // Détection des sections
-        if (line[0] == '[') {
-            char *end = strchr(line, ']');
-            if (end) {
-                *end = 0;
-                strcpy(section, line + 1);
-                in_deps = (strcmp(section, "dependencies") == 0);
-                in_build_deps = (strcmp(section, "build-dependencies") == 0);
-            }
-            continue;
-        }
-        
-        // Parser les clés/valeurs
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
-        
-        *eq = 0;
-        char *key = line;
-        char *value = eq + 1;
-        
-        // Nettoyer les espaces
-        while (*key == ' ') key++;
-        char *kend = key + strlen(key) - 1;
-        while (kend > key && (*kend == ' ' || *kend == '\t')) *kend-- = 0;
-        
-        while (*value == ' ' || *value == '\t') value++;
-        if (*value == '"') {
-            value++;
-            char *vend = strchr(value, '"');
-            if (vend) *vend = 0;
-        }
-        
-        debug_print("Section: %s, Key: %s, Value: %s", section, key, value);
-        
-        if (strcmp(section, "metadata") == 0) {
-            if (strcmp(key, "name") == 0) strcpy(manifest->name, value);
-            else if (strcmp(key, "version") == 0) strcpy(manifest->version, value);
-            else if (strcmp(key, "release") == 0) strcpy(manifest->release, value);
-            else if (strcmp(key, "arch") == 0) strcpy(manifest->arch, value);
-            else if (strcmp(key, "description") == 0) strcpy(manifest->description, value);
-            else if (strcmp(key, "maintainer") == 0) strcpy(manifest->maintainer, value);
-            else if (strcmp(key, "license") == 0) strcpy(manifest->license, value);
-            else if (strcmp(key, "homepage") == 0) strcpy(manifest->homepage, value);
-            else if (strcmp(key, "repository") == 0) strcpy(manifest->repository, value);
-        }
-        else if (in_deps) {
-            if (strlen(manifest->dependencies) > 0)
-                strcat(manifest->dependencies, ";");
-            strcat(manifest->dependencies, key);
-            strcat(manifest->dependencies, "=");
-            strcat(manifest->dependencies, value);
-        }
-        else if (in_build_deps) {
-            if (strlen(manifest->build_deps) > 0)
-                strcat(manifest->build_deps, ";");
-            strcat(manifest->build_deps, key);
-            strcat(manifest->build_deps, "=");
-            strcat(manifest->build_deps, value);
-        }
-    }
-    
-    fclose(f);
-    debug_print("Manifest parsed: %s %s-%s", manifest->name, manifest->version, manifest->release);
+    debug_print("Manifest parsed: %s %s-%s (%zu deps, %zu files)", manifest->name,
+                manifest->version, manifest->release, manifest->dep_count, manifest->file_count);
     return 0;
 }
 
@@ -229,25 +157,42 @@ int parse_manifest(const char *path, manifest_t *manifest) {
 // GESTION DU TOKEN
 // ============================================================================
 
+// APSM_TOKEN_PATH déplace le token sauvegardé (tests, installations isolées)
+static const char *token_path(void) {
+    const char *path = getenv("APSM_TOKEN_PATH");
+    return path && *path ? path : TOKEN_PATH;
+}
+
 static int save_token(const char *token) {
-    mkdir("/usr/local/share/apkm/PROTOCOLE/security/tokens", 0755);
+    if (strcmp(token_path(), TOKEN_PATH) == 0) {
+        mkdir("/usr/local/share/apkm/PROTOCOLE/security/tokens", 0755);
+    }
     
-    FILE *f = fopen(TOKEN_PATH, "w");
+    FILE *f = fopen(token_path(), "w");
     if (!f) return -1;
     
     fprintf(f, "%s\n", token);
     fclose(f);
-    chmod(TOKEN_PATH, 0600);
+    chmod(token_path(), 0600);
     
-    debug_print("Token saved to %s", TOKEN_PATH);
+    debug_print("Token saved to %s", token_path());
     return 0;
 }
 
 static char* load_token(void) {
-    FILE *f = fopen(TOKEN_PATH, "r");
+    // En CI le token arrive par l'environnement
+    char *env = getenv("APSM_TOKEN");
+    if (env && *env) return env;
+    
+    static char token[TOKEN_AGENT_MAX_TOKEN + 1];
+    if (token_agent_get(token, sizeof(token)) == 0) {
+        debug_print("Token from agent");
+        return token;
+    }
+    
+    FILE *f = fopen(token_path(), "r");
     if (!f) return NULL;
     
-    static char token[512];
     if (fgets(token, sizeof(token), f)) {
         token[strcspn(token, "\n")] = 0;
         fclose(f);
@@ -270,7 +215,7 @@ int zarch_login(const char *username, const char *password, char *token, size_t
     struct curl_slist *headers = NULL;
     
     char url[512];
-    snprintf(url, sizeof(url), "%s/auth/login", ZARCH_API_URL);
+    snprintf(url, sizeof(url), "%s/auth/login", api_url());
     
     char post_data[1024];
     snprintf(post_data, sizeof(post_data),
@@ -328,43 +273,64 @@ int zarch_login(const char *username, const char *password, char *token, size_t
 // EXTRACTION DU MANIFEST DEPUIS L'ARCHIVE
 // ============================================================================
 
+// Lecture en flux : on s'arrête à l'entrée Manifest.toml (la première dans
+// les paquets produits par bool), sans rien écrire sur le disque
 int extract_manifest(const char *archive_path, manifest_t *manifest) {
-    char extract_dir[512];
-    snprintf(extract_dir, sizeof(extract_dir), "/tmp/apsm_extract_%d", getpid());
+    manifest_init(manifest);
     
-    mkdir(extract_dir, 0755);
+    struct archive *a = archive_read_new();
+    if (!a) return -1;
     
-    // Extraire avec tar
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd), "tar -xf '%s' -C '%s' 2>/dev/null", archive_path, extract_dir);
+    archive_read_support_filter_all(a);
+    archive_read_support_format_tar(a);
     
-    if (system(cmd) != 0) {
-        debug_print("Failed to extract archive");
-        rmdir(extract_dir);
+    if (archive_read_open_filename(a, archive_path, 64 * 1024) != ARCHIVE_OK) {
+        debug_print("Cannot open archive: %s", archive_error_string(a));
+        archive_read_free(a);
         return -1;
     }
     
-    // Chercher Manifest.toml
-    char manifest_path[512];
-    snprintf(manifest_path, sizeof(manifest_path), "%s/%s", extract_dir, MANIFEST_NAME);
-    
-    // Chercher aussi à la racine si pas trouvé
-    if (access(manifest_path, F_OK) != 0) {
-        snprintf(manifest_path, sizeof(manifest_path), "%s/Manifest.toml", extract_dir);
-    }
-    
     int result = -1;
-    if (access(manifest_path, F_OK) == 0) {
-        debug_print("Found manifest at %s", manifest_path);
-        result = parse_manifest(manifest_path, manifest);
-    } else {
-        debug_print("No manifest found in archive");
-    }
+    int entries = 0;
+    struct archive_entry *entry;
     
-    // Nettoyer
-    snprintf(cmd, sizeof(cmd), "rm -rf %s", extract_dir);
-    system(cmd);
+    while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+        const char *path = archive_entry_pathname(entry);
+        entries++;
+        if (path && strncmp(path, "./", 2) == 0) path += 2;
+        
+        if (!path || strcmp(path, MANIFEST_NAME) != 0) {
+            archive_read_data_skip(a);
+            continue;
+        }
+        
+        la_int64_t size = archive_entry_size(entry);
+        if (size < 0 || size > MANIFEST_MAX_SIZE) {
+            debug_print("Manifest too large: %lld bytes", (long long)size);
+            break;
+        }
+        
+        char *buf = malloc(size + 1);
+        size_t got = 0;
+        la_ssize_t n = 0;
+        while (buf && got < (size_t)size &&
+               (n = archive_read_data(a, buf + got, size - got)) > 0) {
+            got += n;
+        }
+        
+        if (buf && n >= 0 && got == (size_t)size) {
+            debug_print("Found manifest after %d entries (%lld bytes)", entries, (long long)size);
+            result = manifest_parse_buffer(buf, got, manifest);
+            if (result == 0) manifest_defaults(manifest);
+        } else {
+            debug_print("Cannot read manifest: %s", archive_error_string(a));
+        }
+        free(buf);
+        break;
+    }
     
+    if (result != 0) debug_print("No manifest found in archive");
+    archive_read_free(a);
     return result;
 }
 
@@ -372,24 +338,13 @@ int extract_manifest(const char *archive_path, manifest_t *manifest) {
 // UPLOAD DU PACKAGE
 // ============================================================================
 
-static int zarch_upload_package(const char *filepath, manifest_t *manifest) {
-    char *token = load_token();
-    if (!token) {
-        print_error("Not authenticated. Please run 'apsm login' first");
-        return -1;
-    }
-    
-    struct stat file_stat;
-    if (stat(filepath, &file_stat) != 0) {
-        print_error("File not found: %s", filepath);
-        return -1;
-    }
-    
+// Ancien envoi en un seul POST multipart, pour les hubs sans upload découpé
+static int zarch_upload_multipart(const char *filepath, manifest_t *manifest, const char *token) {
     CURL *curl = curl_easy_init();
     if (!curl) return -1;
     
     char url[512];
-    snprintf(url, sizeof(url), "%s/package/upload/public/%s", ZARCH_API_URL, manifest->name);
+    snprintf(url, sizeof(url), "%s/package/upload/public/%s", api_url(), manifest->name);
     
     struct curl_slist *headers = NULL;
     char auth_header[512];
@@ -435,22 +390,19 @@ static int zarch_upload_package(const char *filepath, manifest_t *manifest) {
                  CURLFORM_COPYCONTENTS, manifest->maintainer,
                  CURLFORM_END);
     
+    char *dependencies = manifest_join_deps(manifest->deps, manifest->dep_count);
     curl_formadd(&formpost, &lastptr,
                  CURLFORM_COPYNAME, "dependencies",
-                 CURLFORM_COPYCONTENTS, manifest->dependencies,
+                 CURLFORM_COPYCONTENTS, dependencies ? dependencies : "",
                  CURLFORM_END);
+    free(dependencies);
     
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_HTTPPOST, formpost);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
-    
-    printf("\n");
-    print_info("Uploading package...");
-    print_info("  Name:    %s", manifest->name);
-    print_info("  Version: %s-%s", manifest->version, manifest->release);
-    print_info("  Arch:    %s", manifest->arch);
-    print_info("  Size:    %.2f KB", file_stat.st_size / 1024.0);
+    // Pas de délai global : on n'abandonne que si le débit s'effondre
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
     
     CURLcode res = curl_easy_perform(curl);
     
@@ -475,6 +427,84 @@ static int zarch_upload_package(const char *filepath, manifest_t *manifest) {
     }
 }
 
+static int progress_line = 0;
+
+static void upload_progress(uint64_t done, uint64_t total, void *userdata) {
+    (void)userdata;
+    if (quiet_mode) return;
+    
+    progress_line = done < total;
+    printf("\r\033[36m  ▸ \033[0m%3d%%  %.1f / %.1f MB", (int)(done * 100 / total),
+           done / (1024.0 * 1024.0), total / (1024.0 * 1024.0));
+    if (done == total) printf("\n");
+    fflush(stdout);
+}
+
+static int zarch_upload_package(const char *filepath, manifest_t *manifest) {
+    char *token = load_token();
+    if (!token) {
+        print_error("Not authenticated. Please run 'apsm login' first");
+        return -1;
+    }
+    
+    struct stat file_stat;
+    if (stat(filepath, &file_stat) != 0) {
+        print_error("File not found: %s", filepath);
+        return -1;
+    }
+    
+    publish_options_t opts = {
+        .api_url = api_url(),
+        .token = token,
+        .chunk_size = upload_chunk_mb * 1024 * 1024,
+        .jobs = upload_jobs,
+        .progress = upload_progress,
+    };
+    
+    printf("\n");
+    print_info("Uploading package...");
+    print_info("  Name:    %s", manifest->name);
+    print_info("  Version: %s-%s", manifest->version, manifest->release);
+    print_info("  Arch:    %s", manifest->arch);
+    print_info("  Size:    %.2f KB", file_stat.st_size / 1024.0);
+    
+    publish_stats_t stats;
+    char err[512];
+    int ret = publish_chunked_upload(filepath, manifest, &opts, &stats, err, sizeof(err));
+    if (progress_line) {
+        printf("\n");
+        progress_line = 0;
+    }
+    
+    if (ret == PUBLISH_UNSUPPORTED) {
+        print_warning("Hub does not support chunked uploads, sending in one request");
+        return zarch_upload_multipart(filepath, manifest, token);
+    }
+    
+    if (ret == PUBLISH_EXISTS) {
+        print_success("Package already on the hub, nothing to upload");
+        debug_print("sha256 %s", stats.sha256);
+        return 0;
+    }
+    
+    if (stats.resumed > 0) {
+        print_info("Resumed upload: %zu/%zu chunks already sent", stats.resumed, stats.chunks);
+    }
+    if (stats.deduped > 0) {
+        print_info("Skipped %zu/%zu chunks already on the hub", stats.deduped, stats.chunks);
+    }
+    debug_print("sha256 %s, %zu chunks sent, %zu retries", stats.sha256, stats.sent, stats.retries);
+    
+    if (ret != 0) {
+        print_error("Upload failed: %s", err);
+        print_info("Run the same command again to resume");
+        return -1;
+    }
+    
+    print_success("Upload complete!");
+    return 0;
+}
+
 // ============================================================================
 // VALIDATION DU MANIFEST
 // ============================================================================
@@ -491,11 +521,11 @@ int validate_manifest(manifest_t *manifest) {
         errors++;
     }
     if (strlen(manifest->release) == 0) {
-        strcpy(manifest->release, "r0");
+        manifest->release = "r0";
         print_warning("Using default release: r0");
     }
     if (strlen(manifest->arch) == 0) {
-        strcpy(manifest->arch, "x86_64");
+        manifest->arch = "x86_64";
         print_warning("Using default arch: x86_64");
     }
     
@@ -527,7 +557,7 @@ static int publish_package(const char *filepath) {
     
     // Extraire et lire le manifest
     manifest_t manifest;
-    memset(&manifest, 0, sizeof(manifest));
+    manifest_init(&manifest);
     
     int manifest_result = extract_manifest(filepath, &manifest);
     
@@ -544,13 +574,18 @@ static int publish_package(const char *filepath) {
         printf("  Maintainer:  %s\n", manifest.maintainer);
         printf("  License:     %s\n", manifest.license);
         
-        if (strlen(manifest.dependencies) > 0) {
-            printf("  Dependencies: %s\n", manifest.dependencies);
+        if (manifest.dep_count > 0) {
+            printf("  Dependencies:");
+            for (size_t i = 0; i < manifest.dep_count; i++) {
+                printf("%s %s", i ? "," : "", manifest.deps[i].name);
+            }
+            printf("\n");
         }
         
         // Valider le manifest
         if (validate_manifest(&manifest) != 0) {
             print_error("Invalid manifest");
+            manifest_free(&manifest);
             return -1;
         }
         
@@ -575,10 +610,10 @@ static int publish_package(const char *filepath) {
             strcpy(name, temp);
         }
         
-        strcpy(manifest.name, name);
-        strcpy(manifest.version, version);
-        strcpy(manifest.release, release);
-        strcpy(manifest.arch, arch);
+        manifest.name = name;
+        manifest.version = version;
+        manifest.release = release;
+        manifest.arch = arch;
         
         printf("\n");
         printf("📦 Package Information (from filename):\n");
@@ -587,18 +622,325 @@ static int publish_package(const char *filepath) {
         printf("  Arch:    %s\n", manifest.arch);
     }
     
-    // Demander confirmation
-    printf("\n");
-    printf("Proceed with upload? [Y/n] ");
+    // Demander confirmation (pas de question sans terminal)
+    if (!assume_yes && isatty(STDIN_FILENO)) {
+        printf("\n");
+        printf("Proceed with upload? [Y/n] ");
+        fflush(stdout);
+        
+        int response = getchar();
+        if (response == 'n' || response == 'N') {
+            print_info("Upload cancelled");
+            manifest_free(&manifest);
+            return 0;
+        }
+    }
+    
+    int ret = zarch_upload_package(filepath, &manifest);
+    manifest_free(&manifest);
+    return ret;
+}
+
+// ============================================================================
+// PUBLICATION PAR LOTS
+// ============================================================================
+
+/*
+ * apsm publish --batch <dir> : tous les .tar.bool du dossier dans une seule
+ * invocation. Les manifests sont validés en parallèle (un thread par cœur),
+ * puis les paquets valides partent à BATCH_DEFAULT_PARALLEL à la fois,
+ * avec un seul token ; chaque thread garde ses connexions d'un paquet à
+ * l'autre. Résultat par
+ * paquet en JSON avec --report <fichier|->.
+ */
+
+#define BATCH_DEFAULT_PARALLEL 4
+
+enum { BATCH_PENDING, BATCH_INVALID, BATCH_PUBLISHED, BATCH_EXISTS, BATCH_FAILED };
+
+static const char *batch_status_names[] = {
+    "pending", "invalid", "published", "exists", "failed"
+};
+
+typedef struct {
+    char *path;
+    manifest_t manifest;
+    int status;
+    publish_stats_t stats;
+    char error[512];
+    double seconds;
+} batch_item_t;
+
+typedef struct {
+    batch_item_t *items;
+    size_t count;
+    size_t next;
+    int upload;                  // 0 : validation, 1 : upload
+    publish_options_t opts;
+    pthread_mutex_t lock;
+} batch_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t len = strlen(s), slen = strlen(suffix);
+    return len >= slen && strcmp(s + len - slen, suffix) == 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void batch_validate(batch_item_t *item) {
+    if (extract_manifest(item->path, &item->manifest) != 0) {
+        item->status = BATCH_INVALID;
+        snprintf(item->error, sizeof(item->error), "No Manifest.toml in package");
+    } else if (!item->manifest.name[0] || !item->manifest.version[0]) {
+        item->status = BATCH_INVALID;
+        snprintf(item->error, sizeof(item->error), "Missing '%s' in manifest",
+                 item->manifest.name[0] ? "version" : "name");
+    }
+}
+
+static void batch_upload(batch_t *batch, const publish_options_t *opts, batch_item_t *item) {
+    double start = now_seconds();
+    int ret = publish_chunked_upload(item->path, &item->manifest, opts, &item->stats,
+                                     item->error, sizeof(item->error));
+    
+    if (ret == PUBLISH_UNSUPPORTED) {
+        item->error[0] = '\0';
+        ret = zarch_upload_multipart(item->path, &item->manifest, opts->token);
+        if (ret != 0) snprintf(item->error, sizeof(item->error), "Legacy upload failed");
+    }
+    item->seconds = now_seconds() - start;
+    
+    if (ret == PUBLISH_EXISTS) item->status = BATCH_EXISTS;
+    else item->status = ret == 0 ? BATCH_PUBLISHED : BATCH_FAILED;
+    
+    // Les lignes de plusieurs threads ne doivent pas se mélanger
+    pthread_mutex_lock(&batch->lock);
+    const manifest_t *m = &item->manifest;
+    if (item->status == BATCH_PUBLISHED) {
+        print_success("%s %s-%s published in %.1fs (%zu/%zu chunks sent)", m->name, m->version,
+                      m->release, item->seconds, item->stats.sent, item->stats.chunks);
+    } else if (item->status == BATCH_EXISTS) {
+        print_info("%s %s-%s already on the hub", m->name, m->version, m->release);
+    } else {
+        print_error("%s %s-%s: %s", m->name, m->version, m->release, item->error);
+    }
     fflush(stdout);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void *batch_worker(void *arg) {
+    batch_t *batch = arg;
+    
+    // Connexions gardées ouvertes d'un paquet à l'autre par ce thread
+    publish_options_t opts = batch->opts;
+    if (batch->upload) opts.share = publish_share_new();
+    
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->count) break;
+        
+        batch_item_t *item = &batch->items[i];
+        if (!batch->upload) batch_validate(item);
+        else if (item->status == BATCH_PENDING) batch_upload(batch, &opts, item);
+    }
+    
+    publish_share_free(opts.share);
+    return NULL;
+}
+
+static void batch_run(batch_t *batch, int threads) {
+    if ((size_t)threads > batch->count) threads = (int)batch->count;
+    if (threads < 1) threads = 1;
+    batch->next = 0;
+    
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; tids && t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, batch_worker, batch) == 0) started++;
+    }
+    if (started == 0) batch_worker(batch);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    free(tids);
+}
+
+static int batch_write_report(const batch_t *batch, const char *path, double wall) {
+    json_object *root = json_object_new_object();
+    json_object *packages = json_object_new_array();
+    int counts[5] = {0};
+    
+    for (size_t i = 0; i < batch->count; i++) {
+        const batch_item_t *item = &batch->items[i];
+        const manifest_t *m = &item->manifest;
+        counts[item->status]++;
+        
+        json_object *p = json_object_new_object();
+        json_object_object_add(p, "file", json_object_new_string(item->path));
+        json_object_object_add(p, "name", json_object_new_string(m->name));
+        json_object_object_add(p, "version", json_object_new_string(m->version));
+        json_object_object_add(p, "release", json_object_new_string(m->release));
+        json_object_object_add(p, "arch", json_object_new_string(m->arch));
+        json_object_object_add(p, "status", json_object_new_string(batch_status_names[item->status]));
+        json_object_object_add(p, "sha256", json_object_new_string(item->stats.sha256));
+        json_object_object_add(p, "chunks", json_object_new_int64((int64_t)item->stats.chunks));
+        json_object_object_add(p, "chunks_sent", json_object_new_int64((int64_t)item->stats.sent));
+        json_object_object_add(p, "chunks_skipped",
+                               json_object_new_int64((int64_t)(item->stats.deduped + item->stats.resumed)));
+        json_object_object_add(p, "bytes_sent", json_object_new_int64((int64_t)item->stats.bytes_sent));
+        json_object_object_add(p, "seconds", json_object_new_double(item->seconds));
+        if (item->error[0]) {
+            json_object_object_add(p, "error", json_object_new_string(item->error));
+        }
+        json_object_array_add(packages, p);
+    }
     
-    char response = getchar();
-    if (response == 'n' || response == 'N') {
+    json_object_object_add(root, "packages", packages);
+    json_object_object_add(root, "total", json_object_new_int((int)batch->count));
+    for (int s = BATCH_INVALID; s <= BATCH_FAILED; s++) {
+        json_object_object_add(root, batch_status_names[s], json_object_new_int(counts[s]));
+    }
+    json_object_object_add(root, "seconds", json_object_new_double(wall));
+    
+    int ret = 0;
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out) {
+        fprintf(out, "%s\n", json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY));
+        if (out != stdout) fclose(out);
+    } else {
+        print_error("Cannot write report %s", path);
+        ret = -1;
+    }
+    json_object_put(root);
+    return ret;
+}
+
+static int publish_batch(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        print_error("Cannot open %s", dir);
+        return -1;
+    }
+    
+    char **paths = NULL;
+    size_t count = 0;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (!ends_with(e->d_name, ".tar.bool")) continue;
+        char **p = realloc(paths, (count + 1) * sizeof(char *));
+        if (!p) break;
+        paths = p;
+        if (asprintf(&paths[count], "%s/%s", dir, e->d_name) < 0) break;
+        count++;
+    }
+    closedir(d);
+    
+    if (count == 0) {
+        print_error("No .tar.bool package in %s", dir);
+        free(paths);
+        return -1;
+    }
+    qsort(paths, count, sizeof(char *), compare_paths);
+    
+    char *token = load_token();
+    if (!token) {
+        print_error("Not authenticated. Please run 'apsm login' first");
+        for (size_t i = 0; i < count; i++) free(paths[i]);
+        free(paths);
+        return -1;
+    }
+    
+    batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.items = calloc(count, sizeof(batch_item_t));
+    batch.count = count;
+    pthread_mutex_init(&batch.lock, NULL);
+    for (size_t i = 0; i < count; i++) {
+        batch.items[i].path = paths[i];
+        manifest_init(&batch.items[i].manifest);
+    }
+    free(paths);
+    
+    double wall_start = now_seconds();
+    
+    print_step("Validating %zu packages", count);
+    batch_run(&batch, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        batch_item_t *item = &batch.items[i];
+        if (item->status == BATCH_PENDING) {
+            valid++;
+        } else {
+            print_error("%s: %s", item->path, item->error);
+        }
+    }
+    
+    int parallel = batch_parallel > 0 ? batch_parallel : BATCH_DEFAULT_PARALLEL;
+    int cancelled = 0;
+    if (valid > 0 && !assume_yes && isatty(STDIN_FILENO)) {
+        // En mode silencieux (--report -), stdout porte le rapport JSON
+        FILE *prompt = quiet_mode ? stderr : stdout;
+        fprintf(prompt, "\nPublish %zu packages? [Y/n] ", valid);
+        fflush(prompt);
+        int response = getchar();
+        cancelled = response == 'n' || response == 'N';
+    }
+    
+    if (valid > 0 && !cancelled) {
+        batch.opts.api_url = api_url();
+        batch.opts.token = token;
+        batch.opts.chunk_size = upload_chunk_mb * 1024 * 1024;
+        batch.opts.jobs = upload_jobs;
+        batch.upload = 1;
+        
+        print_step("Publishing %zu packages (%d at a time)", valid, parallel);
+        batch_run(&batch, parallel);
+    }
+    
+    double wall = now_seconds() - wall_start;
+    
+    int failed = 0, published = 0;
+    if (!quiet_mode) {
+        printf("\n📊 Publish summary\n");
+        printf("%-32s %-16s %-10s %10s\n", "package", "version", "status", "time");
+    }
+    for (size_t i = 0; i < count; i++) {
+        batch_item_t *item = &batch.items[i];
+        if (item->status == BATCH_PUBLISHED || item->status == BATCH_EXISTS) published++;
+        else failed++;
+        if (!quiet_mode) {
+            printf("%-32s %-16s %-10s %9.1fs\n",
+                   item->manifest.name[0] ? item->manifest.name : basename(item->path),
+                   item->manifest.version, batch_status_names[item->status], item->seconds);
+        }
+    }
+    if (!quiet_mode) {
+        printf("\n⏱️  %d/%zu packages published in %.1fs\n", published, count, wall);
+    }
+    
+    if (report_path && batch_write_report(&batch, report_path, wall) != 0) failed++;
+    
+    for (size_t i = 0; i < count; i++) {
+        manifest_free(&batch.items[i].manifest);
+        free(batch.items[i].path);
+    }
+    free(batch.items);
+    pthread_mutex_destroy(&batch.lock);
+    
+    if (cancelled) {
         print_info("Upload cancelled");
         return 0;
     }
-    
-    return zarch_upload_package(filepath, &manifest);
+    return failed ? -1 : 0;
 }
 
 // ============================================================================
@@ -635,9 +977,16 @@ static int cmd_login(void) {
     
     int result = zarch_login(username, password, token, sizeof(token));
     if (result == 0) {
-        save_token(token);
-        print_success("Token saved");
+        // Avec un agent, le token ne touche pas le disque
+        if (token_agent_put(token, TOKEN_AGENT_DEFAULT_TTL) == 0) {
+            print_success("Token stored in agent");
+        } else {
+            save_token(token);
+            print_success("Token saved");
+        }
     }
+    explicit_bzero(password, sizeof(password));
+    explicit_bzero(token, sizeof(token));
     
     return result;
 }
@@ -647,6 +996,14 @@ static int cmd_login(void) {
 // ============================================================================
 
 static int cmd_status(void) {
+    long remaining, pid;
+    int agent = token_agent_status(&remaining, &pid);
+    if (agent == 0) {
+        print_info("Token agent (pid %ld): token expires in %ldm", pid, remaining / 60);
+    } else if (agent == 1) {
+        print_info("Token agent (pid %ld): no token", pid);
+    }
+    
     char *token = load_token();
     if (token) {
         print_success("Authenticated");
@@ -664,7 +1021,8 @@ static int cmd_status(void) {
 // ============================================================================
 
 static int cmd_logout(void) {
-    if (unlink(TOKEN_PATH) == 0) {
+    int cleared = token_agent_clear() == 0;
+    if (unlink(token_path()) == 0 || cleared) {
         print_success("Logged out successfully");
         return 0;
     } else {
@@ -673,6 +1031,115 @@ static int cmd_logout(void) {
     }
 }
 
+// ============================================================================
+// AGENT DE TOKEN
+// ============================================================================
+
+static int cmd_agent(int argc, char *argv[]) {
+    const char *action = argc >= 3 ? argv[2] : "status";
+    int ttl = TOKEN_AGENT_DEFAULT_TTL;
+    int foreground = 0;
+    
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--ttl") == 0 && i + 1 < argc) ttl = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--foreground") == 0) foreground = 1;
+    }
+    
+    char sock[108];
+    token_agent_socket_path(sock, sizeof(sock));
+    
+    if (strcmp(action, "start") == 0) {
+        if (token_agent_status(NULL, NULL) >= 0) {
+            print_info("Token agent already running (%s)", sock);
+            return 0;
+        }
+        
+        // Le fichier de token est lu par l'agent, dans sa mémoire verrouillée
+        if (foreground) {
+            print_info("Token agent listening on %s", sock);
+            int ret = token_agent_serve(token_path(), ttl);
+            if (ret != 0) print_error("Cannot start token agent on %s", sock);
+            return ret;
+        }
+        
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            print_error("Cannot fork token agent");
+            return -1;
+        }
+        if (pid == 0) {
+            setsid();
+            int null = open("/dev/null", O_RDWR);
+            if (null >= 0) {
+                dup2(null, STDIN_FILENO);
+                dup2(null, STDOUT_FILENO);
+                dup2(null, STDERR_FILENO);
+                if (null > STDERR_FILENO) close(null);
+            }
+            int ret = token_agent_serve(token_path(), ttl);
+            _exit(ret == 0 ? 0 : 1);
+        }
+        
+        // Attendre que la socket réponde
+        for (int i = 0; i < 40; i++) {
+            int agent = token_agent_status(NULL, NULL);
+            if (agent >= 0) {
+                print_success("Token agent started (pid %d, %s)", (int)pid, sock);
+                if (agent == 0) print_info("Saved token loaded, expires in %dm", ttl / 60);
+                return 0;
+            }
+            int status;
+            if (waitpid(pid, &status, WNOHANG) == pid) break;
+            usleep(50000);
+        }
+        print_error("Cannot start token agent on %s", sock);
+        return -1;
+    }
+    
+    if (strcmp(action, "add") == 0) {
+        // Token sur stdin (CI, gestionnaire de secrets)
+        char token[TOKEN_AGENT_MAX_TOKEN + 2];
+        if (!fgets(token, sizeof(token), stdin)) {
+            print_error("No token on stdin");
+            return -1;
+        }
+        token[strcspn(token, "\r\n")] = '\0';
+        int ret = token_agent_put(token, ttl);
+        explicit_bzero(token, sizeof(token));
+        if (ret != 0) {
+            print_error("No token agent running (apsm agent start)");
+            return -1;
+        }
+        print_success("Token stored in agent, expires in %dm", ttl / 60);
+        return 0;
+    }
+    
+    if (strcmp(action, "stop") == 0) {
+        if (token_agent_stop() != 0) {
+            print_error("No token agent running");
+            return -1;
+        }
+        print_success("Token agent stopped");
+        return 0;
+    }
+    
+    if (strcmp(action, "status") == 0) {
+        long remaining, pid;
+        int ret = token_agent_status(&remaining, &pid);
+        if (ret < 0) {
+            print_info("No token agent running (%s)", sock);
+            return 1;
+        }
+        if (ret == 0) print_success("Token agent (pid %ld): token expires in %lds", pid, remaining);
+        else print_info("Token agent (pid %ld): no token", pid);
+        return 0;
+    }
+    
+    print_error("Unknown agent command: %s", action);
+    return 1;
+}
+
 // ============================================================================
 // COMMANDE DE VERIFICATION DE MANIFEST
 // ============================================================================
@@ -724,7 +1191,10 @@ static int cmd_verify_manifest(const char *path) {
     
     printf("\n");
     
-    if (validate_manifest(&manifest) == 0) {
+    int valid = validate_manifest(&manifest) == 0;
+    manifest_free(&manifest);
+    
+    if (valid) {
         print_success("Manifest is valid");
         return 0;
     } else {
@@ -754,16 +1224,22 @@ static int cmd_extract_manifest(const char *archive_path) {
     printf("Maintainer:  %s\n", manifest.maintainer);
     printf("License:     %s\n", manifest.license);
     
-    if (strlen(manifest.dependencies) > 0) {
+    if (manifest.dep_count > 0) {
         printf("\nDependencies:\n");
-        char *deps = manifest.dependencies;
-        char *dep = strtok(deps, ";");
-        while (dep) {
-            printf("  • %s\n", dep);
-            dep = strtok(NULL, ";");
+        for (size_t i = 0; i < manifest.dep_count; i++) {
+            printf("  • %s %s\n", manifest.deps[i].name, manifest.deps[i].constraint);
+        }
+    }
+    
+    if (manifest.file_count > 0) {
+        printf("\nFiles:\n");
+        for (size_t i = 0; i < manifest.file_count; i++) {
+            printf("  • %s -> %s (%o)\n", manifest.files[i].source, manifest.files[i].dest,
+                   manifest.files[i].mode);
         }
     }
     
+    manifest_free(&manifest);
     return 0;
 }
 
@@ -781,17 +1257,34 @@ void print_help(void) {
     printf("  apsm <command> [arguments]\n\n");
     
     printf("COMMANDS:\n");
-    printf("  push <file>             Publish package to Zarch Hub\n");
+    printf("  push [options] <file>    Publish package to Zarch Hub\n");
+    printf("  publish --batch <dir>    Publish every .tar.bool in dir\n");
     printf("  login                    Authenticate to Zarch Hub\n");
     printf("  status                   Check authentication status\n");
     printf("  logout                   Remove saved token\n");
+    printf("  agent start|stop|status  Keep the token in memory (agent add: token on stdin)\n");
     printf("  manifest verify <file>   Validate Manifest.toml\n");
     printf("  manifest extract <file>  Extract manifest from archive\n");
     printf("  help                     Show this help\n\n");
     
+    printf("PUSH OPTIONS:\n");
+    printf("  -y, --yes                Do not ask for confirmation\n");
+    printf("  --chunk-size <MiB>       Upload chunk size (default: %d)\n", PUBLISH_DEFAULT_CHUNK_MB);
+    printf("  --jobs <n>               Parallel chunk uploads (default: %d)\n", PUBLISH_DEFAULT_JOBS);
+    printf("  --parallel <n>           Packages uploaded at once with --batch (default: %d)\n",
+           BATCH_DEFAULT_PARALLEL);
+    printf("  --report <file|->        Write a JSON result per package (--batch)\n\n");
+    
+    printf("ENVIRONMENT:\n");
+    printf("  APSM_TOKEN               Token to use instead of the saved one\n");
+    printf("  APSM_API_URL             Hub API URL (default: %s)\n", ZARCH_API_URL);
+    printf("  APSM_TOKEN_PATH          Saved token file (default: %s)\n", TOKEN_PATH);
+    printf("  APKM_AGENT_SOCK          Token agent socket\n\n");
+    
     printf("EXAMPLES:\n");
     printf("  apsm login\n");
     printf("  apsm push build/mypkg-v1.0.0-r1.x86_64.tar.bool\n");
+    printf("  apsm publish --batch build/ --yes --report report.json\n");
     printf("  apsm manifest verify Manifest.toml\n");
     printf("  apsm manifest extract mypkg.tar.bool\n\n");
 }
@@ -835,12 +1328,37 @@ int main(int argc, char *argv[]) {
     
     int result = 0;
     
-    if (strcmp(argv[1], "push") == 0) {
-        if (argc < 3) {
+    if (strcmp(argv[1], "push") == 0 || strcmp(argv[1], "publish") == 0) {
+        const char *file = NULL;
+        const char *batch_dir = NULL;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "-y") == 0 || strcmp(argv[i], "--yes") == 0) {
+                assume_yes = 1;
+            } else if (strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc) {
+                upload_chunk_mb = strtoul(argv[++i], NULL, 10);
+            } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+                upload_jobs = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+                batch_dir = argv[++i];
+            } else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+                batch_parallel = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+                report_path = argv[++i];
+            } else if (!file) {
+                file = argv[i];
+            }
+        }
+        
+        // Rapport JSON sur stdout : rien d'autre ne doit y passer
+        if (report_path && strcmp(report_path, "-") == 0) quiet_mode = 1;
+        
+        if (batch_dir) {
+            result = publish_batch(batch_dir) == 0 ? 0 : 1;
+        } else if (!file) {
             print_error("Missing file");
             result = 1;
         } else {
-            result = publish_package(argv[2]);
+            result = publish_package(file);
         }
     }
     else if (strcmp(argv[1], "login") == 0) {
@@ -852,6 +1370,9 @@ int main(int argc, char *argv[]) {
     else if (strcmp(argv[1], "logout") == 0) {
         result = cmd_logout();
     }
+    else if (strcmp(argv[1], "agent") == 0) {
+        result = cmd_agent(argc, argv);
+    }
     else if (strcmp(argv[1], "manifest") == 0 && argc >= 3) {
         if (strcmp(argv[2], "verify") == 0 && argc >= 4) {
             result = cmd_verify_manifest(argv[3]);
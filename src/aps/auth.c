@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include "apkm.h"
 #include "security.h"
+#include "token.h"
 
 #define BTS_SALT 0x1B 
 
@@ -50,6 +51,13 @@ void get_config_path(char *path, size_t size) {
 // ============================================================================
 
 char* load_token_from_home(void) {
+    char agent_token[TOKEN_AGENT_MAX_TOKEN + 1];
+    if (token_agent_get(agent_token, sizeof(agent_token)) == 0) {
+        char *token = strdup(agent_token);
+        explicit_bzero(agent_token, sizeof(agent_token));
+        return token;
+    }
+
     char config_path[512];
     get_config_path(config_path, sizeof(config_path));
 
@@ -1 +1,828 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include <openssl/evp.h>
+#include "publish.h"
 
+#define PUBLISH_MAX_ATTEMPTS 5
+#define PUBLISH_RETRY_BASE_MS 500
+#define PUBLISH_RETRY_MAX_MS 30000
+#define PUBLISH_HASH_BUFFER (1 << 20)
+#define PUBLISH_BODY_MAX 4096
+
+enum { PART_PENDING, PART_ACTIVE, PART_DONE };
+
+typedef struct {
+    uint64_t offset;
+    size_t len;
+    char sha256[65];
+    int state;
+    int attempts;
+    double retry_at;             // ms (horloge monotone)
+} part_t;
+
+typedef struct {
+    char data[PUBLISH_BODY_MAX];
+    size_t size;
+} body_t;
+
+typedef struct upload upload_t;
+
+// Un transfert en cours : un handle curl réutilisé de partie en partie
+typedef struct {
+    CURL *easy;
+    upload_t *up;
+    size_t part;
+    uint64_t sent;
+    int busy;
+    struct curl_slist *headers;
+    body_t body;
+} slot_t;
+
+struct upload {
+    const publish_options_t *opts;
+    publish_stats_t *stats;
+    int fd;
+    uint64_t size;
+    size_t chunk_size;
+    part_t *parts;
+    size_t part_count;
+    uint64_t done_bytes;
+    char sha256[65];
+    char upload_id[128];
+    char journal_path[4096];
+    FILE *journal;
+    CURLSH *share;
+    char *auth_header;
+    char *err;
+    size_t err_size;
+};
+
+// ============================================================================
+// UTILITAIRES
+// ============================================================================
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void set_error(upload_t *up, const char *fmt, ...) {
+    if (!up->err || up->err_size == 0) return;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(up->err, up->err_size, fmt, args);
+    va_end(args);
+}
+
+static void to_hex(const unsigned char *bytes, size_t len, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0xf];
+    }
+    hex[len * 2] = '\0';
+}
+
+static int mkdir_p(const char *path) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+            *p = '/';
+        }
+    }
+    return mkdir(tmp, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+// Identifiant renvoyé par le serveur : il finit dans une URL et le journal
+static int valid_upload_id(const char *id) {
+    size_t len = strlen(id);
+    if (len == 0 || len >= 128) return 0;
+    for (const char *p = id; *p; p++) {
+        if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+              (*p >= '0' && *p <= '9') || *p == '-' || *p == '_' || *p == '.')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t body_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    body_t *body = userdata;
+    size_t total = size * nmemb;
+    size_t room = sizeof(body->data) - 1 - body->size;
+    size_t n = total < room ? total : room;
+
+    memcpy(body->data + body->size, ptr, n);
+    body->size += n;
+    body->data[body->size] = '\0';
+    return total;
+}
+
+// Options communes : connexions partagées, pas de délai global (un gros
+// paquet peut prendre longtemps), abandon seulement si le débit s'effondre
+static CURL *new_easy(upload_t *up, body_t *body) {
+    CURL *curl = curl_easy_init();
+    if (!curl) return NULL;
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, up->share);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, body_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, body);
+    return curl;
+}
+
+// Requête JSON synchrone ; 0 si une réponse HTTP a été reçue
+static int json_request(upload_t *up, const char *url, json_object *req,
+                        long *http_code, json_object **resp) {
+    body_t body = {{0}, 0};
+    CURL *curl = new_easy(up, &body);
+    if (!curl) {
+        set_error(up, "Cannot initialize curl");
+        return -1;
+    }
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, up->auth_header);
+    headers = curl_slist_append(headers, "Accept: application/json");
+    if (req) {
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        // Pas d'attente du "100 Continue" (liste des empreintes > 1 Ko)
+        headers = curl_slist_append(headers, "Expect:");
+        curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS,
+                         json_object_to_json_string_ext(req, JSON_C_TO_STRING_PLAIN));
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK) {
+        set_error(up, "%s", curl_easy_strerror(res));
+        return -1;
+    }
+
+    if (resp) *resp = body.size ? json_tokener_parse(body.data) : NULL;
+    if (*http_code >= 400) {
+        set_error(up, "HTTP %ld%s%s", *http_code, body.size ? ": " : "", body.data);
+    }
+    return 0;
+}
+
+// ============================================================================
+// EMPREINTES
+// ============================================================================
+
+// Une seule lecture du fichier : SHA-256 global et SHA-256 de chaque partie
+static int hash_file(upload_t *up) {
+    unsigned char *buf = malloc(PUBLISH_HASH_BUFFER);
+    EVP_MD_CTX *file_ctx = EVP_MD_CTX_new();
+    EVP_MD_CTX *part_ctx = EVP_MD_CTX_new();
+    int ret = -1;
+
+    if (!buf || !file_ctx || !part_ctx) {
+        set_error(up, "Out of memory");
+        goto out;
+    }
+
+    EVP_DigestInit_ex(file_ctx, EVP_sha256(), NULL);
+    EVP_DigestInit_ex(part_ctx, EVP_sha256(), NULL);
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len;
+    uint64_t pos = 0;
+    size_t part = 0;
+
+    while (pos < up->size) {
+        ssize_t n = pread(up->fd, buf, PUBLISH_HASH_BUFFER, pos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            set_error(up, "Cannot read package: %s", n < 0 ? strerror(errno) : "truncated");
+            goto out;
+        }
+        if ((uint64_t)n > up->size - pos) n = up->size - pos;
+
+        EVP_DigestUpdate(file_ctx, buf, n);
+
+        size_t off = 0;
+        while (off < (size_t)n) {
+            part_t *p = &up->parts[part];
+            uint64_t part_end = p->offset + p->len;
+            size_t take = (size_t)n - off;
+            if (take > part_end - (pos + off)) take = part_end - (pos + off);
+
+            EVP_DigestUpdate(part_ctx, buf + off, take);
+            off += take;
+
+            if (pos + off == part_end) {
+                EVP_DigestFinal_ex(part_ctx, md, &md_len);
+                to_hex(md, md_len, p->sha256);
+                EVP_DigestInit_ex(part_ctx, EVP_sha256(), NULL);
+                part++;
+            }
+        }
+        pos += n;
+    }
+
+    EVP_DigestFinal_ex(file_ctx, md, &md_len);
+    to_hex(md, md_len, up->sha256);
+    ret = 0;
+
+out:
+    EVP_MD_CTX_free(file_ctx);
+    EVP_MD_CTX_free(part_ctx);
+    free(buf);
+    return ret;
+}
+
+// ============================================================================
+// JOURNAL DE REPRISE
+// ============================================================================
+
+static void journal_locate(upload_t *up) {
+    char dir[4096];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (up->opts->journal_dir) {
+        snprintf(dir, sizeof(dir), "%s", up->opts->journal_dir);
+    } else if (xdg && *xdg) {
+        snprintf(dir, sizeof(dir), "%s/apsm/uploads", xdg);
+    } else if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.cache/apsm/uploads", home);
+    } else {
+        snprintf(dir, sizeof(dir), "/tmp/apsm-uploads");
+    }
+    mkdir_p(dir);
+
+    snprintf(up->journal_path, sizeof(up->journal_path), "%s/%s-%zu.journal",
+             dir, up->sha256, up->chunk_size);
+}
+
+// Relit l'identifiant de session et les parties déjà acceptées ; un journal
+// qui ne correspond pas au fichier (taille, découpe, empreinte) est ignoré
+static void journal_load(upload_t *up) {
+    FILE *f = fopen(up->journal_path, "r");
+    if (!f) return;
+
+    char line[256];
+    char id[128] = "";
+    int matches = 0;
+    unsigned long long ull;
+    size_t index;
+    char word[128];
+
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "size %llu", &ull) == 1) {
+            matches += ull == up->size;
+        } else if (sscanf(line, "chunk %llu", &ull) == 1) {
+            matches += ull == up->chunk_size;
+        } else if (sscanf(line, "sha256 %127s", word) == 1) {
+            matches += strcmp(word, up->sha256) == 0;
+        } else if (sscanf(line, "upload %127s", word) == 1) {
+            snprintf(id, sizeof(id), "%s", word);
+        } else if (sscanf(line, "done %zu", &index) == 1 && index < up->part_count) {
+            up->parts[index].state = PART_DONE;
+        }
+    }
+    fclose(f);
+
+    if (matches == 3 && valid_upload_id(id)) {
+        snprintf(up->upload_id, sizeof(up->upload_id), "%s", id);
+    } else {
+        for (size_t i = 0; i < up->part_count; i++) up->parts[i].state = PART_PENDING;
+    }
+}
+
+static int journal_open(upload_t *up, int fresh, const char *filepath) {
+    up->journal = fopen(up->journal_path, fresh ? "w" : "a");
+    if (!up->journal) return -1;
+
+    if (fresh) {
+        fprintf(up->journal, "# apsm upload journal\n");
+        fprintf(up->journal, "file %s\n", filepath);
+        fprintf(up->journal, "size %llu\n", (unsigned long long)up->size);
+        fprintf(up->journal, "chunk %zu\n", up->chunk_size);
+        fprintf(up->journal, "sha256 %s\n", up->sha256);
+        fprintf(up->journal, "upload %s\n", up->upload_id);
+        fflush(up->journal);
+    }
+    return 0;
+}
+
+static void journal_done(upload_t *up, size_t index) {
+    if (!up->journal) return;
+    fprintf(up->journal, "done %zu\n", index);
+    fflush(up->journal);
+}
+
+static void journal_remove(upload_t *up) {
+    if (up->journal) {
+        fclose(up->journal);
+        up->journal = NULL;
+    }
+    unlink(up->journal_path);
+}
+
+// ============================================================================
+// SESSION
+// ============================================================================
+
+// Le hub a-t-il déjà ces octets ? Dans le doute (erreur, 405...) on envoie.
+static int package_exists(upload_t *up) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s/package/sha256/%s", up->opts->api_url, up->sha256);
+
+    body_t body = {{0}, 0};
+    CURL *curl = new_easy(up, &body);
+    if (!curl) return 0;
+
+    struct curl_slist *headers = curl_slist_append(NULL, up->auth_header);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+
+    long code = 0;
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    return res == CURLE_OK && code == 200;
+}
+
+// "received": [i, ...] fait foi quand le serveur le fournit
+static void apply_received(upload_t *up, json_object *resp) {
+    json_object *received;
+    if (!resp || !json_object_object_get_ex(resp, "received", &received) ||
+        !json_object_is_type(received, json_type_array)) {
+        return;
+    }
+
+    for (size_t i = 0; i < up->part_count; i++) up->parts[i].state = PART_PENDING;
+    size_t n = json_object_array_length(received);
+    for (size_t i = 0; i < n; i++) {
+        int64_t index = json_object_get_int64(json_object_array_get_idx(received, i));
+        if (index >= 0 && (uint64_t)index < up->part_count) {
+            up->parts[index].state = PART_DONE;
+        }
+    }
+}
+
+// Reprend la session du journal si le serveur la connaît encore
+static int resume_session(upload_t *up) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s/package/upload/chunked/%s", up->opts->api_url, up->upload_id);
+
+    long code = 0;
+    json_object *resp = NULL;
+    if (json_request(up, url, NULL, &code, &resp) != 0) return -1;
+
+    int ret = 0;
+    if (code == 200) {
+        apply_received(up, resp);
+    } else if (code == 404 || code == 410) {
+        // Session expirée : on repart de zéro
+        up->upload_id[0] = '\0';
+        for (size_t i = 0; i < up->part_count; i++) up->parts[i].state = PART_PENDING;
+    } else {
+        ret = -1;
+    }
+    if (resp) json_object_put(resp);
+    return ret;
+}
+
+static int create_session(upload_t *up, const manifest_t *m) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s/package/upload/chunked/%s", up->opts->api_url, m->name);
+
+    char *dependencies = manifest_join_deps(m->deps, m->dep_count);
+    json_object *req = json_object_new_object();
+    json_object_object_add(req, "version", json_object_new_string(m->version));
+    json_object_object_add(req, "release", json_object_new_string(m->release));
+    json_object_object_add(req, "arch", json_object_new_string(m->arch));
+    json_object_object_add(req, "description", json_object_new_string(m->description));
+    json_object_object_add(req, "license", json_object_new_string(m->license));
+    json_object_object_add(req, "maintainer", json_object_new_string(m->maintainer));
+    json_object_object_add(req, "dependencies", json_object_new_string(dependencies ? dependencies : ""));
+    json_object_object_add(req, "size", json_object_new_int64((int64_t)up->size));
+    json_object_object_add(req, "chunk_size", json_object_new_int64((int64_t)up->chunk_size));
+    json_object_object_add(req, "chunks", json_object_new_int64((int64_t)up->part_count));
+    json_object_object_add(req, "sha256", json_object_new_string(up->sha256));
+    free(dependencies);
+
+    // Le hub indexe les parties par contenu : celles qu'il a déjà (autre
+    // version du paquet, upload abandonné) reviennent dans "received"
+    json_object *hashes = json_object_new_array();
+    for (size_t i = 0; i < up->part_count; i++) {
+        json_object_array_add(hashes, json_object_new_string(up->parts[i].sha256));
+    }
+    json_object_object_add(req, "chunk_hashes", hashes);
+
+    long code = 0;
+    json_object *resp = NULL;
+    int ret = json_request(up, url, req, &code, &resp);
+    json_object_put(req);
+    if (ret != 0) return -1;
+
+    json_object *id;
+    if (code == 404 || code == 405) {
+        ret = PUBLISH_UNSUPPORTED;
+    } else if (code != 200 && code != 201) {
+        ret = -1;
+    } else if (!resp || !json_object_object_get_ex(resp, "upload_id", &id) ||
+               !valid_upload_id(json_object_get_string(id))) {
+        set_error(up, "Invalid response to upload request");
+        ret = -1;
+    } else {
+        snprintf(up->upload_id, sizeof(up->upload_id), "%s", json_object_get_string(id));
+        apply_received(up, resp);
+    }
+
+    if (resp) json_object_put(resp);
+    return ret;
+}
+
+static int commit_session(upload_t *up) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s/package/upload/chunked/%s/commit",
+             up->opts->api_url, up->upload_id);
+
+    json_object *req = json_object_new_object();
+    json_object_object_add(req, "sha256", json_object_new_string(up->sha256));
+    json_object_object_add(req, "size", json_object_new_int64((int64_t)up->size));
+    json_object_object_add(req, "chunks", json_object_new_int64((int64_t)up->part_count));
+
+    long code = 0;
+    int ret = json_request(up, url, req, &code, NULL);
+    json_object_put(req);
+    if (ret != 0) return -1;
+
+    if (code == 200 || code == 201) {
+        journal_remove(up);
+        return 0;
+    }
+    // Session refusée (empreinte, parties manquantes) : inutile de la reprendre
+    if (code >= 400 && code < 500) journal_remove(up);
+    return -1;
+}
+
+// ============================================================================
+// TRANSFERT DES PARTIES
+// ============================================================================
+
+static size_t read_part(char *buffer, size_t size, size_t nitems, void *userdata) {
+    slot_t *slot = userdata;
+    part_t *p = &slot->up->parts[slot->part];
+    size_t want = size * nitems;
+    uint64_t remain = p->len - slot->sent;
+
+    if (want > remain) want = remain;
+    if (want == 0) return 0;
+
+    ssize_t n;
+    do {
+        n = pread(slot->up->fd, buffer, want, p->offset + slot->sent);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return CURL_READFUNC_ABORT;
+
+    slot->sent += n;
+    return n;
+}
+
+// Rembobinage demandé par curl (redirection, renvoi après erreur)
+static int seek_part(void *userdata, curl_off_t offset, int origin) {
+    slot_t *slot = userdata;
+    if (origin != SEEK_SET || offset < 0 ||
+        (uint64_t)offset > slot->up->parts[slot->part].len) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    slot->sent = offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+static int start_part(upload_t *up, CURLM *multi, slot_t *slot, size_t index) {
+    part_t *p = &up->parts[index];
+    char url[1024], hash_header[128], offset_header[64];
+
+    snprintf(url, sizeof(url), "%s/package/upload/chunked/%s/%zu",
+             up->opts->api_url, up->upload_id, index);
+    snprintf(hash_header, sizeof(hash_header), "X-Chunk-SHA256: %s", p->sha256);
+    snprintf(offset_header, sizeof(offset_header), "X-Chunk-Offset: %llu",
+             (unsigned long long)p->offset);
+
+    curl_slist_free_all(slot->headers);
+    slot->headers = NULL;
+    slot->headers = curl_slist_append(slot->headers, up->auth_header);
+    slot->headers = curl_slist_append(slot->headers, "Content-Type: application/octet-stream");
+    slot->headers = curl_slist_append(slot->headers, hash_header);
+    slot->headers = curl_slist_append(slot->headers, offset_header);
+    slot->headers = curl_slist_append(slot->headers, "Expect:");
+
+    slot->part = index;
+    slot->sent = 0;
+    slot->body.size = 0;
+    slot->body.data[0] = '\0';
+
+    curl_easy_setopt(slot->easy, CURLOPT_URL, url);
+    curl_easy_setopt(slot->easy, CURLOPT_HTTPHEADER, slot->headers);
+    curl_easy_setopt(slot->easy, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(slot->easy, CURLOPT_INFILESIZE_LARGE, (curl_off_t)p->len);
+    curl_easy_setopt(slot->easy, CURLOPT_READFUNCTION, read_part);
+    curl_easy_setopt(slot->easy, CURLOPT_READDATA, slot);
+    curl_easy_setopt(slot->easy, CURLOPT_SEEKFUNCTION, seek_part);
+    curl_easy_setopt(slot->easy, CURLOPT_SEEKDATA, slot);
+    curl_easy_setopt(slot->easy, CURLOPT_PRIVATE, slot);
+
+    if (curl_multi_add_handle(multi, slot->easy) != CURLM_OK) {
+        set_error(up, "Cannot schedule chunk %zu", index);
+        return -1;
+    }
+    p->state = PART_ACTIVE;
+    slot->busy = 1;
+    return 0;
+}
+
+// Fin d'une partie : journalisée si acceptée, sinon replanifiée avec un
+// délai exponentiel tant que l'erreur est transitoire. 0 ou -1 (abandon).
+static int finish_part(upload_t *up, slot_t *slot, CURLcode res) {
+    part_t *p = &up->parts[slot->part];
+    long code = 0;
+    curl_easy_getinfo(slot->easy, CURLINFO_RESPONSE_CODE, &code);
+    slot->busy = 0;
+
+    if (res == CURLE_OK && code >= 200 && code < 300) {
+        p->state = PART_DONE;
+        journal_done(up, slot->part);
+        up->done_bytes += p->len;
+        up->stats->sent++;
+        up->stats->bytes_sent += p->len;
+        if (up->opts->progress) {
+            up->opts->progress(up->done_bytes, up->size, up->opts->userdata);
+        }
+        return 0;
+    }
+
+    p->state = PART_PENDING;
+    p->attempts++;
+
+    int transient = res != CURLE_OK || code == 408 || code == 429 || code >= 500;
+    if (transient && p->attempts < PUBLISH_MAX_ATTEMPTS) {
+        double delay = PUBLISH_RETRY_BASE_MS * (double)(1 << (p->attempts - 1));
+        if (delay > PUBLISH_RETRY_MAX_MS) delay = PUBLISH_RETRY_MAX_MS;
+        p->retry_at = now_ms() + delay;
+        up->stats->retries++;
+        return 0;
+    }
+
+    if (res != CURLE_OK) {
+        set_error(up, "Chunk %zu: %s", slot->part, curl_easy_strerror(res));
+    } else {
+        set_error(up, "Chunk %zu: HTTP %ld%s%s", slot->part, code,
+                  slot->body.size ? ": " : "", slot->body.data);
+    }
+    return -1;
+}
+
+// Prochaine partie à envoyer ; *wait_ms = attente avant la prochaine reprise
+static ssize_t next_part(upload_t *up, double now, double *wait_ms) {
+    for (size_t i = 0; i < up->part_count; i++) {
+        part_t *p = &up->parts[i];
+        if (p->state != PART_PENDING) continue;
+        if (p->retry_at <= now) return (ssize_t)i;
+        if (p->retry_at - now < *wait_ms) *wait_ms = p->retry_at - now;
+    }
+    return -1;
+}
+
+static int send_parts(upload_t *up) {
+    size_t pending = 0;
+    for (size_t i = 0; i < up->part_count; i++) pending += up->parts[i].state != PART_DONE;
+    if (pending == 0) return 0;
+
+    int jobs = up->opts->jobs > 0 ? up->opts->jobs : PUBLISH_DEFAULT_JOBS;
+    if (jobs > PUBLISH_MAX_JOBS) jobs = PUBLISH_MAX_JOBS;
+    if ((size_t)jobs > pending) jobs = (int)pending;
+
+    CURLM *multi = curl_multi_init();
+    slot_t *slots = calloc(jobs, sizeof(slot_t));
+    int ret = -1;
+    if (!multi || !slots) {
+        set_error(up, "Out of memory");
+        goto out;
+    }
+
+    // Une connexion par transfert simultané, réutilisée d'une partie à l'autre
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)jobs);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)jobs);
+
+    for (int i = 0; i < jobs; i++) {
+        slots[i].up = up;
+        slots[i].easy = new_easy(up, &slots[i].body);
+        if (!slots[i].easy) {
+            set_error(up, "Cannot initialize curl");
+            goto out;
+        }
+    }
+
+    int active = 0, failed = 0;
+    for (;;) {
+        double now = now_ms();
+        double wait_ms = 1000;
+
+        if (!failed) {
+            for (int i = 0; i < jobs; i++) {
+                if (slots[i].busy) continue;
+                ssize_t index = next_part(up, now, &wait_ms);
+                if (index < 0) break;
+                if (start_part(up, multi, &slots[i], (size_t)index) != 0) {
+                    failed = 1;
+                    break;
+                }
+                active++;
+            }
+        }
+
+        if (active == 0) {
+            if (failed) break;
+            size_t left = 0;
+            for (size_t i = 0; i < up->part_count; i++) left += up->parts[i].state != PART_DONE;
+            if (left == 0) break;
+        }
+
+        int running;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *msg;
+        int queued, completed = 0;
+        while ((msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            slot_t *slot;
+            CURL *easy = msg->easy_handle;
+            CURLcode res = msg->data.result;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&slot);
+            curl_multi_remove_handle(multi, easy);
+            active--;
+            completed++;
+            if (finish_part(up, slot, res) != 0) failed = 1;
+        }
+
+        // Une partie vient de finir : replanifier sans attendre
+        if (completed) continue;
+        curl_multi_poll(multi, NULL, 0, wait_ms > 0 ? (int)wait_ms + 1 : 1, NULL);
+    }
+
+    ret = failed ? -1 : 0;
+
+out:
+    if (slots) {
+        for (int i = 0; i < jobs; i++) {
+            if (!slots[i].easy) continue;
+            if (slots[i].busy) curl_multi_remove_handle(multi, slots[i].easy);
+            curl_easy_cleanup(slots[i].easy);
+            curl_slist_free_all(slots[i].headers);
+        }
+        free(slots);
+    }
+    if (multi) curl_multi_cleanup(multi);
+    return ret;
+}
+
+// ============================================================================
+// CONNEXIONS PARTAGÉES
+// ============================================================================
+
+CURLSH *publish_share_new(void) {
+    CURLSH *share = curl_share_init();
+    if (!share) return NULL;
+
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    return share;
+}
+
+void publish_share_free(CURLSH *share) {
+    if (share) curl_share_cleanup(share);
+}
+
+// ============================================================================
+// POINT D'ENTRÉE
+// ============================================================================
+
+int publish_chunked_upload(const char *filepath, const manifest_t *manifest,
+                           const publish_options_t *opts, publish_stats_t *stats,
+                           char *err, size_t err_size) {
+    upload_t up;
+    memset(&up, 0, sizeof(up));
+    memset(stats, 0, sizeof(*stats));
+    up.opts = opts;
+    up.stats = stats;
+    up.err = err;
+    up.err_size = err_size;
+    up.fd = -1;
+    if (err && err_size) err[0] = '\0';
+
+    if (!opts->token || !opts->api_url) {
+        set_error(&up, "Missing API URL or token");
+        return -1;
+    }
+
+    int ret = -1;
+    up.fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (up.fd < 0 || fstat(up.fd, &st) != 0) {
+        set_error(&up, "Cannot open %s: %s", filepath, strerror(errno));
+        goto out;
+    }
+    if (st.st_size == 0) {
+        set_error(&up, "Empty package: %s", filepath);
+        goto out;
+    }
+
+    up.size = (uint64_t)st.st_size;
+    up.chunk_size = opts->chunk_size ? opts->chunk_size
+                                     : (size_t)PUBLISH_DEFAULT_CHUNK_MB * 1024 * 1024;
+    up.part_count = (up.size + up.chunk_size - 1) / up.chunk_size;
+    up.parts = calloc(up.part_count, sizeof(part_t));
+    if (!up.parts || asprintf(&up.auth_header, "Authorization: Bearer %s", opts->token) < 0) {
+        up.auth_header = NULL;
+        set_error(&up, "Out of memory");
+        goto out;
+    }
+    for (size_t i = 0; i < up.part_count; i++) {
+        up.parts[i].offset = (uint64_t)i * up.chunk_size;
+        up.parts[i].len = i + 1 < up.part_count ? up.chunk_size
+                                                : up.size - up.parts[i].offset;
+    }
+
+    if (hash_file(&up) != 0) goto out;
+    memcpy(stats->sha256, up.sha256, sizeof(stats->sha256));
+    stats->chunks = up.part_count;
+
+    up.share = opts->share ? opts->share : publish_share_new();
+    if (!up.share) {
+        set_error(&up, "Cannot initialize curl");
+        goto out;
+    }
+
+    journal_locate(&up);
+    journal_load(&up);
+
+    if (!up.upload_id[0] && package_exists(&up)) {
+        ret = PUBLISH_EXISTS;
+        goto out;
+    }
+
+    int fresh = 1;
+    if (up.upload_id[0]) {
+        if (resume_session(&up) != 0) goto out;
+        fresh = up.upload_id[0] == '\0';
+    }
+    if (fresh) {
+        ret = create_session(&up, manifest);
+        if (ret != 0) goto out;
+        ret = -1;
+    }
+
+    // Le journal est un confort : sans lui l'upload fonctionne, sans reprise
+    journal_open(&up, fresh, filepath);
+
+    for (size_t i = 0; i < up.part_count; i++) {
+        if (up.parts[i].state == PART_DONE) {
+            if (fresh) stats->deduped++;
+            else stats->resumed++;
+            up.done_bytes += up.parts[i].len;
+        }
+    }
+
+    if (send_parts(&up) != 0) goto out;
+    if (commit_session(&up) != 0) goto out;
+    ret = 0;
+
+out:
+    if (up.journal) fclose(up.journal);
+    if (up.share && up.share != opts->share) curl_share_cleanup(up.share);
+    if (up.fd >= 0) close(up.fd);
+    free(up.auth_header);
+    free(up.parts);
+    return ret;
+}
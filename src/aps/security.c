@@ -1,5 +1,6 @@
 #include "apkm.h"
 #include "security.h"
+#include "token.h"
 extern void btscrypt_process(char *data, int encrypt);
 #include <curl/curl.h>
 #include <openssl/sha.h>
@@ -31,6 +32,13 @@ int security_load_token(security_token_t *token) {
     
     memset(token, 0, sizeof(security_token_t));
     
+    // L'agent garde le token en clair en mémoire verrouillée
+    if (token_agent_get(token->token, sizeof(token->token)) == 0) {
+        token->last_update = time(NULL);
+        token->validated = 1;
+        return 0;
+    }
+    
     FILE *f = fopen(TOKEN_PATH, "r");
     if (!f) return -1;
     
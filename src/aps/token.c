@@ -1 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <fcntl.h>
+#include "token.h"
 
+#define AGENT_IO_TIMEOUT 2
+#define AGENT_IO_SIZE (TOKEN_AGENT_MAX_TOKEN + 64)
+
+// ============================================================================
+// SOCKET
+// ============================================================================
+
+int token_agent_socket_path(char *path, size_t size) {
+    const char *env = getenv("APKM_AGENT_SOCK");
+    const char *run = getenv("XDG_RUNTIME_DIR");
+    int n;
+
+    if (env && *env) {
+        n = snprintf(path, size, "%s", env);
+    } else if (run && *run) {
+        n = snprintf(path, size, "%s/apkm-agent.sock", run);
+    } else {
+        n = snprintf(path, size, "/tmp/apkm-agent-%u/agent.sock", (unsigned)getuid());
+    }
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+static int fill_addr(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    return token_agent_socket_path(addr->sun_path, sizeof(addr->sun_path));
+}
+
+// L'autre bout doit appartenir au même utilisateur
+static int peer_is_us(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return 0;
+    return cred.uid == getuid();
+}
+
+static void set_timeouts(int fd) {
+    struct timeval tv = { AGENT_IO_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Lit jusqu'au '\n' (ou EOF) ; renvoie la longueur sans le '\n'
+static ssize_t read_line(int fd, char *buf, size_t size) {
+    size_t len = 0;
+    while (len + 1 < size) {
+        ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        len += n;
+        if (memchr(buf + len - n, '\n', n)) break;
+    }
+    buf[len] = '\0';
+
+    char *nl = memchr(buf, '\n', len);
+    if (nl) {
+        *nl = '\0';
+        len = nl - buf;
+    }
+    return (ssize_t)len;
+}
+
+// ============================================================================
+// CLIENT
+// ============================================================================
+
+// Envoie une requête ; 0 si l'agent répond "OK", la suite dans reply
+static int agent_request(const char *req, char *reply, size_t size) {
+    struct sockaddr_un addr;
+    if (fill_addr(&addr) != 0) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !peer_is_us(fd)) {
+        close(fd);
+        return -1;
+    }
+    set_timeouts(fd);
+
+    int ret = -1;
+    if (write_all(fd, req, strlen(req)) == 0) {
+        shutdown(fd, SHUT_WR);
+        ssize_t len = read_line(fd, reply, size);
+        if (len >= 2 && strncmp(reply, "OK", 2) == 0 && (reply[2] == '\0' || reply[2] == ' ')) {
+            size_t skip = reply[2] ? 3 : 2;
+            memmove(reply, reply + skip, len - skip + 1);
+            ret = 0;
+        }
+    }
+    close(fd);
+    return ret;
+}
+
+int token_agent_get(char *token, size_t size) {
+    char reply[AGENT_IO_SIZE];
+    int ret = -1;
+
+    if (agent_request("GET\n", reply, sizeof(reply)) == 0) {
+        size_t len = strlen(reply);
+        if (len > 0 && len < size) {
+            memcpy(token, reply, len + 1);
+            ret = 0;
+        }
+    }
+    explicit_bzero(reply, sizeof(reply));
+    return ret;
+}
+
+int token_agent_put(const char *token, int ttl) {
+    size_t len = strlen(token);
+    if (len == 0 || len > TOKEN_AGENT_MAX_TOKEN || strpbrk(token, " \t\r\n")) return -1;
+
+    char req[AGENT_IO_SIZE];
+    char reply[64];
+    snprintf(req, sizeof(req), "PUT %d %s\n", ttl > 0 ? ttl : TOKEN_AGENT_DEFAULT_TTL, token);
+    int ret = agent_request(req, reply, sizeof(reply));
+    explicit_bzero(req, sizeof(req));
+    return ret;
+}
+
+int token_agent_clear(void) {
+    char reply[64];
+    return agent_request("CLEAR\n", reply, sizeof(reply));
+}
+
+int token_agent_status(long *remaining, long *pid) {
+    char reply[64];
+    long r = 0, p = 0;
+
+    if (agent_request("STATUS\n", reply, sizeof(reply)) != 0) return -1;
+    sscanf(reply, "%ld %ld", &r, &p);
+    if (remaining) *remaining = r;
+    if (pid) *pid = p;
+    return r > 0 ? 0 : 1;
+}
+
+int token_agent_stop(void) {
+    char reply[64];
+    return agent_request("STOP\n", reply, sizeof(reply));
+}
+
+// ============================================================================
+// AGENT
+// ============================================================================
+
+typedef struct {
+    char *token;                 // Mémoire verrouillée, hors core dump
+    char *io;                    // Requêtes et réponses (contiennent le token)
+    time_t expires;              // 0 : pas de token
+} agent_t;
+
+static volatile sig_atomic_t agent_terminate = 0;
+
+static void agent_signal(int sig) {
+    (void)sig;
+    agent_terminate = 1;
+}
+
+static void agent_wipe(agent_t *a) {
+    explicit_bzero(a->token, TOKEN_AGENT_MAX_TOKEN + 1);
+    a->expires = 0;
+}
+
+static int agent_store(agent_t *a, const char *token, size_t len, long ttl) {
+    if (len == 0 || len > TOKEN_AGENT_MAX_TOKEN) return -1;
+    agent_wipe(a);
+    memcpy(a->token, token, len);
+    a->token[len] = '\0';
+    a->expires = time(NULL) + (ttl > 0 ? ttl : TOKEN_AGENT_DEFAULT_TTL);
+    return 0;
+}
+
+// Première ligne du fichier, lue par read() dans la zone verrouillée :
+// ni tampon stdio ni pile ne voient le token
+static int agent_load_file(agent_t *a, const char *path, long ttl) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    size_t len = 0;
+    ssize_t n;
+    while (len < AGENT_IO_SIZE - 1 &&
+           (n = read(fd, a->io + len, AGENT_IO_SIZE - 1 - len)) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        len += (size_t)n;
+    }
+    close(fd);
+    a->io[len] = '\0';
+
+    int ret = agent_store(a, a->io, strcspn(a->io, "\r\n"), ttl);
+    explicit_bzero(a->io, AGENT_IO_SIZE);
+    return ret;
+}
+
+// Dossier de repli dans /tmp : créé par nous, à nous seuls
+static int agent_prepare_dir(const char *path) {
+    char dir[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir) return 0;
+    *slash = '\0';
+
+    if (strncmp(dir, "/tmp/apkm-agent-", 16) != 0) return 0;
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) return -1;
+    struct stat st;
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() ||
+        (st.st_mode & 077) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int agent_listen(void) {
+    struct sockaddr_un addr;
+    if (fill_addr(&addr) != 0 || agent_prepare_dir(addr.sun_path) != 0) return -1;
+
+    // Socket existante : un agent tourne déjà, ou c'est un reste à effacer
+    if (token_agent_status(NULL, NULL) >= 0) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    unlink(addr.sun_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    mode_t old = umask(077);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+
+    if (ret != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void agent_reply(int fd, const char *msg) {
+    write_all(fd, msg, strlen(msg));
+}
+
+static void agent_handle(agent_t *a, int fd, int *stop) {
+    if (!peer_is_us(fd)) return;
+    set_timeouts(fd);
+
+    ssize_t len = read_line(fd, a->io, AGENT_IO_SIZE);
+    if (len < 0) return;
+
+    char *req = a->io;
+    if (strcmp(req, "GET") == 0) {
+        if (a->expires) {
+            // Réponse construite dans la zone verrouillée
+            char *out = a->io;
+            int n = snprintf(out, AGENT_IO_SIZE, "OK %s\n", a->token);
+            write_all(fd, out, n);
+        } else {
+            agent_reply(fd, "ERR no token\n");
+        }
+    } else if (strncmp(req, "PUT ", 4) == 0) {
+        char *end;
+        long ttl = strtol(req + 4, &end, 10);
+        if (*end == ' ' && agent_store(a, end + 1, strlen(end + 1), ttl) == 0) {
+            agent_reply(fd, "OK\n");
+        } else {
+            agent_reply(fd, "ERR invalid token\n");
+        }
+    } else if (strcmp(req, "CLEAR") == 0) {
+        agent_wipe(a);
+        agent_reply(fd, "OK\n");
+    } else if (strcmp(req, "STATUS") == 0) {
+        char out[64];
+        long remaining = a->expires ? (long)(a->expires - time(NULL)) : 0;
+        snprintf(out, sizeof(out), "OK %ld %ld\n", remaining > 0 ? remaining : 0, (long)getpid());
+        agent_reply(fd, out);
+    } else if (strcmp(req, "STOP") == 0) {
+        agent_reply(fd, "OK\n");
+        *stop = 1;
+    } else {
+        agent_reply(fd, "ERR unknown request\n");
+    }
+
+    explicit_bzero(a->io, AGENT_IO_SIZE);
+}
+
+int token_agent_serve(const char *token_file, int ttl) {
+    // Ni core dump ni ptrace par un autre processus du même utilisateur
+    prctl(PR_SET_DUMPABLE, 0);
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t size = TOKEN_AGENT_MAX_TOKEN + 1 + AGENT_IO_SIZE;
+    size = (size + page - 1) / page * page;
+
+    char *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return -1;
+    if (mlock(mem, size) != 0) {
+        munmap(mem, size);
+        return -1;
+    }
+    madvise(mem, size, MADV_DONTDUMP);
+
+    agent_t agent = { mem, mem + TOKEN_AGENT_MAX_TOKEN + 1, 0 };
+    if (token_file) agent_load_file(&agent, token_file, ttl);
+
+    int fd = agent_listen();
+    if (fd < 0) {
+        agent_wipe(&agent);
+        munlock(mem, size);
+        munmap(mem, size);
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = agent_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int stop = 0;
+    while (!stop && !agent_terminate) {
+        int timeout = -1;
+        if (agent.expires) {
+            time_t left = agent.expires - time(NULL);
+            // Token expiré : plus rien à servir
+            if (left <= 0) break;
+            timeout = left > INT_MAX / 1000 ? INT_MAX : (int)left * 1000;
+        }
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int rc = poll(&pfd, 1, timeout);
+        if (rc <= 0) continue;
+
+        int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        agent_handle(&agent, client, &stop);
+        close(client);
+    }
+
+    struct sockaddr_un addr;
+    if (fill_addr(&addr) == 0) unlink(addr.sun_path);
+    close(fd);
+
+    agent_wipe(&agent);
+    explicit_bzero(mem, size);
+    munlock(mem, size);
+    munmap(mem, size);
+    return 0;
+}
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "apkmbuild.h"
+#include "apkmbuild_keys.h"
+
+#define APKM_ARENA_BLOCK 4096
+
+// ============================================================================
+// ARÈNE
+// ============================================================================
+
+static void *arena_alloc(apkm_arena_t *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+
+    apkm_arena_block_t *b = arena->head;
+    if (!b || b->size - b->used < size) {
+        size_t cap = size > APKM_ARENA_BLOCK ? size : APKM_ARENA_BLOCK;
+        b = malloc(sizeof(*b) + cap);
+        if (!b) return NULL;
+        b->size = cap;
+        b->used = 0;
+        // Les grosses allocations (le fichier lui-même) ne doivent pas
+        // condamner le reste du bloc courant
+        if (arena->head && size > APKM_ARENA_BLOCK) {
+            b->next = arena->head->next;
+            arena->head->next = b;
+        } else {
+            b->next = arena->head;
+            arena->head = b;
+        }
+    }
+
+    void *p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+static void arena_free(apkm_arena_t *arena) {
+    apkm_arena_block_t *b = arena->head;
+    while (b) {
+        apkm_arena_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena->head = NULL;
+}
+
+// ============================================================================
+// TABLE DES CLÉS
+// ============================================================================
+
+int apkmbuild_key_lookup(const char *key, size_t len) {
+    uint32_t slot = apkmbuild_hash(APKM_HASH_SEED, key, len) & ((1u << APKM_HASH_BITS) - 1);
+    if (apkm_key_table[slot].len != len) return -1;
+    if (memcmp(apkm_key_table[slot].key, key, len) != 0) return -1;
+    return apkm_key_table[slot].id;
+}
+
+// Champ texte de build_info_t associé à une clé X(...)
+static const char **key_field(build_info_t *info, int id) {
+    switch (id) {
+#define X(id, key, field) case APKM_KEY_##id: return &info->field;
+#define S(id, key)
+#include "apkmbuild_keys.def"
+#undef X
+#undef S
+    default: return NULL;
+    }
+}
+
+// ============================================================================
+// DÉCOUPAGE
+// ============================================================================
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int is_key_char(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Bornes [*s, *e) sans espaces ni guillemets englobants
+static void trim(char **s, char **e) {
+    while (*s < *e && is_blank(**s)) (*s)++;
+    while (*e > *s && is_blank((*e)[-1])) (*e)--;
+    if (*e - *s >= 2 && **s == '"' && (*e)[-1] == '"') {
+        (*s)++;
+        (*e)--;
+    }
+}
+
+// Commentaire en fin de ligne ("zstd    # optionnel"), sauf valeur entre
+// guillemets : coupé au premier '#' précédé d'un blanc
+static void strip_comment(char *s, char **e) {
+    while (s < *e && is_blank(*s)) s++;
+    if (s < *e && *s == '"') return;
+    for (char *p = s + 1; p < *e; p++) {
+        if (*p == '#' && is_blank(p[-1])) {
+            *e = p;
+            return;
+        }
+    }
+}
+
+// Cherche "$CLÉ::" dans la ligne ; renvoie l'id et le début de la valeur
+static int find_key(char *line, char *eol, char **value) {
+    char *p = line;
+    while ((p = memchr(p, '$', eol - p))) {
+        char *k = ++p;
+        while (p < eol && is_key_char(*p)) p++;
+        if (p > k && eol - p >= 2 && p[0] == ':' && p[1] == ':') {
+            int id = apkmbuild_key_lookup(k, p - k);
+            if (id >= 0) {
+                *value = p + 2;
+                return id;
+            }
+        }
+    }
+    return -1;
+}
+
+static const char *terminate(char *s, char *e) {
+    *e = '\0';
+    return s;
+}
+
+static int add_file(build_info_t *info, char *s, char *e) {
+    char *tok[3] = {NULL, NULL, NULL};
+    int n = 0;
+
+    while (s < e && n < 3) {
+        while (s < e && is_blank(*s)) s++;
+        if (s >= e) break;
+        tok[n++] = s;
+        while (s < e && !is_blank(*s)) s++;
+        *s++ = '\0';
+    }
+    if (n == 0) return 0;
+
+    if (info->file_count == info->file_cap) {
+        size_t cap = info->file_cap ? info->file_cap * 2 : 16;
+        apkm_file_t *files = realloc(info->files, cap * sizeof(*files));
+        if (!files) return -1;
+        info->files = files;
+        info->file_cap = cap;
+    }
+
+    apkm_file_t *f = &info->files[info->file_count++];
+    f->source = tok[0];
+    f->dest = tok[1] ? tok[1] : tok[0];
+    f->mode = tok[2] ? (mode_t)strtoul(tok[2], NULL, 8) : 0;     // 0 : celui de la source
+    return 0;
+}
+
+// Bloc { ... } : les lignes sont compactées sur place, jointes par '\n'.
+// Renvoie le début de la ligne qui suit l'accolade fermante.
+static char *read_block(build_info_t *info, char *first, char *first_end,
+                        char *next, char *end, const char **out) {
+    char *dst = first;
+    char *s = first, *e = first_end;
+
+    trim(&s, &e);
+    // Bloc sur une seule ligne : "{ make }"
+    if (e > s && e[-1] == '}') {
+        e--;
+        trim(&s, &e);
+        *out = terminate(s, e);
+        return next;
+    }
+    if (e > s) {
+        memmove(dst, s, e - s);
+        dst += e - s;
+    }
+
+    while (next < end) {
+        char *line = next;
+        char *eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        next = eol < end ? eol + 1 : end;
+        info->lines++;
+
+        s = line;
+        e = eol;
+        while (s < e && is_blank(*s)) s++;
+        while (e > s && is_blank(e[-1])) e--;
+        if (s < e && *s == '}') break;
+        if (s == e) continue;
+
+        if (dst > first) *dst++ = '\n';
+        memmove(dst, s, e - s);
+        dst += e - s;
+    }
+
+    *out = terminate(first, dst);
+    return next;
+}
+
+// ============================================================================
+// PARSEUR
+// ============================================================================
+
+static void set_defaults(build_info_t *info) {
+    memset(info, 0, sizeof(*info));
+#define X(id, key, field) info->field = "";
+#define S(id, key)
+#include "apkmbuild_keys.def"
+#undef X
+#undef S
+    info->arch = "x86_64";
+    info->release = "r0";
+    info->license = "MIT";
+    info->script_path = "install.sh";
+    info->includes = "include";
+    info->libs = "lib";
+    info->pkgconfig = "lib/pkgconfig";
+
+    // Date et machine de build
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(info->build_date, sizeof(info->build_date), "%Y-%m-%d %H:%M:%S", &tm);
+    gethostname(info->build_host, sizeof(info->build_host));
+}
+
+// Découpe buf (len octets, buf[len] réservé) ; les valeurs pointent dedans
+static int parse_in_place(char *buf, size_t len, build_info_t *info,
+                          char *err, size_t err_size) {
+    char *end = buf + len;
+    char *next = buf;
+
+    while (next < end) {
+        char *line = next;
+        char *eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        next = eol < end ? eol + 1 : end;
+        info->lines++;
+
+        char *s = line;
+        while (s < eol && is_blank(*s)) s++;
+        if (s == eol || *s == '#') continue;
+
+        char *val;
+        int id = find_key(s, eol, &val);
+        if (id < 0) continue;
+
+        char *ve = eol;
+        switch (id) {
+        case APKM_KEY_MAKE:
+        case APKM_KEY_INSTALL:
+        case APKM_KEY_CHECK: {
+            const char **field = key_field(info, id);
+            char *bs = val;
+            while (bs < ve && is_blank(*bs)) bs++;
+            if (bs < ve && *bs == '{') {
+                next = read_block(info, bs + 1, ve, next, end, field);
+            } else {
+                trim(&val, &ve);
+                *field = terminate(val, ve);
+            }
+            break;
+        }
+        case APKM_KEY_FILE:
+            strip_comment(val, &ve);
+            if (add_file(info, val, ve) != 0) {
+                if (err) snprintf(err, err_size, "Out of memory");
+                return -1;
+            }
+            break;
+        case APKM_KEY_COMPRESS:
+            strip_comment(val, &ve);
+            trim(&val, &ve);
+            info->compress_zstd = ve - val == 4 && memcmp(val, "zstd", 4) == 0;
+            break;
+        case APKM_KEY_DOC: {
+            trim(&val, &ve);
+            // Format spécial [%OPEN+==fichier] : chemin du README
+            static const char marker[] = "[%OPEN+==";
+            char *m = memmem(val, ve - val, marker, sizeof(marker) - 1);
+            if (m) {
+                char *fs = m + sizeof(marker) - 1;
+                char *fe = memchr(fs, ']', ve - fs);
+                if (fe) {
+                    char *copy = arena_alloc(&info->arena, fe - fs + 1);
+                    if (!copy) {
+                        if (err) snprintf(err, err_size, "Out of memory");
+                        return -1;
+                    }
+                    memcpy(copy, fs, fe - fs);
+                    info->readme_path = terminate(copy, copy + (fe - fs));
+                }
+            }
+            info->docs = terminate(val, ve);
+            break;
+        }
+        default:
+            strip_comment(val, &ve);
+            trim(&val, &ve);
+            *key_field(info, id) = terminate(val, ve);
+            break;
+        }
+    }
+
+    if (info->name[0] == '\0') {
+        if (err) snprintf(err, err_size, "Missing $APKNAME in APKMBUILD");
+        return -1;
+    }
+    return 0;
+}
+
+int apkmbuild_parse_buffer(const char *data, size_t len, build_info_t *info,
+                           char *err, size_t err_size) {
+    set_defaults(info);
+
+    char *buf = arena_alloc(&info->arena, len + 1);
+    if (!buf) {
+        if (err) snprintf(err, err_size, "Out of memory");
+        return -1;
+    }
+    memcpy(buf, data, len);
+    buf[len] = '\0';
+    return parse_in_place(buf, len, info, err, err_size);
+}
+
+int apkmbuild_parse_file(const char *path, build_info_t *info, char *err, size_t err_size) {
+    set_defaults(info);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (err) snprintf(err, err_size, "Cannot open %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // Lecture en une fois dans l'arène : le fichier sert de stockage aux valeurs
+    size_t cap = (size_t)st.st_size;
+    char *buf = arena_alloc(&info->arena, cap + 1);
+    if (!buf) {
+        close(fd);
+        if (err) snprintf(err, err_size, "Out of memory");
+        return -1;
+    }
+
+    size_t len = 0;
+    while (len < cap) {
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            if (err) snprintf(err, err_size, "Cannot read %s: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        if (n == 0) break;
+        len += n;
+    }
+    close(fd);
+
+    buf[len] = '\0';
+    return parse_in_place(buf, len, info, err, err_size);
+}
+
+void apkmbuild_free(build_info_t *info) {
+    if (!info) return;
+    arena_free(&info->arena);
+    free(info->files);
+    info->files = NULL;
+    info->file_count = info->file_cap = 0;
+#define X(id, key, field) info->field = "";
+#define S(id, key)
+#include "apkmbuild_keys.def"
+#undef X
+#undef S
+}
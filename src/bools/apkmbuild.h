@@ -0,0 +1,123 @@
+#ifndef APKMBUILD_H
+#define APKMBUILD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+/*
+ * Parseur APKMBUILD partagé par les deux binaires bool (src/bools/bool.c
+ * et bool.c à la racine).
+ *
+ * Le fichier est lu en une fois puis découpé en une seule passe : chaque
+ * ligne "$CLÉ::valeur" est aiguillée par une table de hachage parfait
+ * générée au build (apkmbuild_keys.def -> apkmbuild_keys.h). Les valeurs
+ * vivent dans une arène propre à build_info_t : aucune limite de taille,
+ * libérées d'un coup par apkmbuild_free().
+ *
+ * Blocs multi-lignes ($APKMMAKE, $APKMINSTALL, $APKMCHECK) :
+ *   $APKMMAKE:: {
+ *       ./configure
+ *       make
+ *   }
+ * Les lignes sont jointes par '\n' (script shell). Une ligne commençant
+ * par '}' ferme le bloc ; "$APKMMAKE:: { make }" tient sur une ligne.
+ *
+ * Fichiers du paquet : "$APKMFILE:: source [dest [mode octal]]", répétable.
+ * Sans mode, le fichier garde celui de la source (bit exécutable compris).
+ * Hors commandes et valeurs entre guillemets, " # ..." en fin de ligne est
+ * un commentaire.
+ */
+
+// Identifiants des clés, dans l'ordre de apkmbuild_keys.def
+enum {
+#define X(id, key, field) APKM_KEY_##id,
+#define S(id, key) APKM_KEY_##id,
+#include "apkmbuild_keys.def"
+#undef X
+#undef S
+    APKM_KEY_COUNT
+};
+
+typedef struct apkm_arena_block {
+    struct apkm_arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} apkm_arena_block_t;
+
+typedef struct {
+    apkm_arena_block_t *head;
+} apkm_arena_t;
+
+// Fichier à inclure dans le paquet
+typedef struct {
+    const char *source;
+    const char *dest;
+    mode_t mode;                  // 0 : mode du fichier source
+} apkm_file_t;
+
+typedef struct {
+    // Champs de l'APKMBUILD : jamais NULL ("" si absents), dans l'arène
+    const char *name;
+    const char *version;
+    const char *release;
+    const char *arch;
+    const char *maintainer;
+    const char *description;
+    const char *license;
+    const char *url;
+    const char *deps;
+    const char *build_deps;
+    const char *build_cmd;
+    const char *install_cmd;
+    const char *check_cmd;
+    const char *script_path;
+    const char *readme_path;
+    const char *sources;          // $APKMSOURCES:: (clé du cache de build)
+    const char *includes;
+    const char *libs;
+    const char *pkgconfig;
+    const char *docs;
+    apkm_file_t *files;
+    size_t file_count;
+    size_t file_cap;
+    int compress_zstd;            // $APKMCOMPRESS::zstd
+
+    // État du build
+    char sha256[128];
+    char blake3[72];
+    char signature[256];
+    char build_date[32];
+    char build_host[128];
+    long long file_size;
+    int dep_count;
+    int reproducible;             // --reproducible ou $SOURCE_DATE_EPOCH
+    time_t source_date_epoch;
+    int no_cache;                 // --no-cache
+
+    apkm_arena_t arena;
+    size_t lines;                 // Lignes lues (statistiques)
+} build_info_t;
+
+// 0 si succès, -1 sinon (message dans err si non NULL)
+int apkmbuild_parse_file(const char *path, build_info_t *info, char *err, size_t err_size);
+int apkmbuild_parse_buffer(const char *data, size_t len, build_info_t *info,
+                           char *err, size_t err_size);
+void apkmbuild_free(build_info_t *info);
+
+// Identifiant de la clé (APKM_KEY_*) ou -1, via la table de hachage parfait
+int apkmbuild_key_lookup(const char *key, size_t len);
+
+// FNV-1a avec graine : fonction commune au générateur et au parseur
+static inline uint32_t apkmbuild_hash(uint32_t seed, const char *s, size_t len) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Générateur de la table de hachage parfait des clés APKMBUILD.
+ *
+ * Lit la liste des clés (apkmbuild_keys.def), cherche la plus petite table
+ * (puissance de deux) et une graine FNV-1a sans collision, puis écrit
+ * apkmbuild_keys.h. Lancé par CMake à chaque modification du .def.
+ *
+ * Usage : apkmbuild_gen <sortie.h>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apkmbuild.h"
+
+typedef struct {
+    const char *key;
+    const char *ident;
+} gen_key_t;
+
+static const gen_key_t keys[] = {
+#define X(id, key, field) { key, "APKM_KEY_" #id },
+#define S(id, key) { key, "APKM_KEY_" #id },
+#include "apkmbuild_keys.def"
+#undef X
+#undef S
+};
+
+#define KEY_COUNT (sizeof(keys) / sizeof(keys[0]))
+#define MAX_BITS 12
+#define MAX_SEEDS 1000000u
+
+static int try_seed(uint32_t seed, int bits, int *slots) {
+    size_t size = (size_t)1 << bits;
+    for (size_t i = 0; i < size; i++) slots[i] = -1;
+
+    for (size_t k = 0; k < KEY_COUNT; k++) {
+        uint32_t slot = apkmbuild_hash(seed, keys[k].key, strlen(keys[k].key)) & (size - 1);
+        if (slots[slot] >= 0) return 0;
+        slots[slot] = (int)k;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output.h>\n", argv[0]);
+        return 1;
+    }
+
+    int slots[1 << MAX_BITS];
+    int bits = 1;
+    while (((size_t)1 << bits) < KEY_COUNT) bits++;
+
+    uint32_t seed = 0;
+    int found = 0;
+    for (; bits <= MAX_BITS && !found; bits++) {
+        for (seed = 0; seed < MAX_SEEDS; seed++) {
+            if (try_seed(seed, bits, slots)) {
+                found = 1;
+                break;
+            }
+        }
+        if (found) break;
+    }
+
+    if (!found) {
+        fprintf(stderr, "apkmbuild_gen: no perfect hash found for %zu keys\n", KEY_COUNT);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    size_t size = (size_t)1 << bits;
+    fprintf(out, "/* Généré par apkmbuild_gen depuis apkmbuild_keys.def : ne pas éditer. */\n");
+    fprintf(out, "#ifndef APKMBUILD_KEYS_H\n#define APKMBUILD_KEYS_H\n\n");
+    fprintf(out, "#define APKM_HASH_SEED 0x%08xu\n", seed);
+    fprintf(out, "#define APKM_HASH_BITS %d\n\n", bits);
+    fprintf(out, "static const struct {\n    const char *key;\n    unsigned char len;\n"
+                 "    signed char id;\n} apkm_key_table[%zu] = {\n", size);
+    for (size_t i = 0; i < size; i++) {
+        if (slots[i] < 0) {
+            fprintf(out, "    { NULL, 0, -1 },\n");
+        } else {
+            const gen_key_t *k = &keys[slots[i]];
+            fprintf(out, "    { \"%s\", %zu, %s },\n", k->key, strlen(k->key), k->ident);
+        }
+    }
+    fprintf(out, "};\n\n#endif\n");
+
+    if (fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
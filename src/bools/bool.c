@@ -10,53 +10,21 @@
 #include <time.h>
 #include <pwd.h>
 #include <grp.h>
+#include <sys/utsname.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <archive.h>
+#include <archive_entry.h>
 #include <openssl/sha.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
-#define BOOL_VERSION "2.1.0"
+#include "bool.h"
+#include "apkmbuild.h"
+
 #define MANIFEST_NAME "Manifest.toml"
 #define APKMBUILD_NAME "APKMBUILD"
 
-// ============================================================================
-// STRUCTURES
-// ============================================================================
-
-typedef struct {
-    char name[256];
-    char version[64];
-    char release[16];
-    char arch[32];
-    char maintainer[256];
-    char description[1024];
-    char license[64];
-    char url[256];
-    char deps[2048];
-    char build_deps[1024];
-    char build_cmd[1024];
-    char install_cmd[1024];
-    char check_cmd[1024];
-    char script_path[512];
-    char readme_path[512];
-    char sha256[128];
-    char signature[256];
-    char build_date[32];
-    char build_host[128];
-    long long file_size;
-    int dep_count;
-} build_info_t;
-
-// Structure pour les fichiers à inclure
-typedef struct {
-    char source[512];
-    char dest[512];
-    mode_t mode;
-} file_entry_t;
-
-#define MAX_FILES 1024
-static file_entry_t files[MAX_FILES];
-static int file_count = 0;
-
 static int debug_mode = 0;
 static int quiet_mode = 0;
 
@@ -188,12 +156,13 @@ int calculate_file_sha256(const char *filepath, char *output) {
 // ============================================================================
 
 void generate_signature(build_info_t *info, unsigned char *signature) {
-    // Signature simple basée sur les métadonnées
+    // Signature simple basée sur les métadonnées (build_date suit
+    // SOURCE_DATE_EPOCH en mode reproductible, pas l'horloge)
     char buffer[4096];
     snprintf(buffer, sizeof(buffer),
-             "%s:%s:%s:%s:%s:%s:%ld",
+             "%s:%s:%s:%s:%s:%s",
              info->name, info->version, info->release, info->arch,
-             info->maintainer, info->build_date, time(NULL));
+             info->maintainer, info->build_date);
     
     SHA256_CTX ctx;
     SHA256_Init(&ctx);
@@ -210,168 +179,78 @@ void generate_signature(build_info_t *info, unsigned char *signature) {
 // PARSEUR APKMBUILD
 // ============================================================================
 
+// Parseur partagé (apkmbuild.c) ; libérer avec apkmbuild_free()
 int parse_apkmbuild(const char *filename, build_info_t *info) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        print_error("Cannot open %s", filename);
+    char err[512];
+    if (apkmbuild_parse_file(filename, info, err, sizeof(err)) != 0) {
+        print_error("%s", err);
+        apkmbuild_free(info);
         return -1;
     }
-
-    char line[1024];
-    int in_block = 0;
-    char current_block[64] = "";
-    
-    // Initialisation
-    memset(info, 0, sizeof(build_info_t));
-    strcpy(info->arch, "x86_64");
-    strcpy(info->release, "r0");
-    strcpy(info->license, "MIT");
-    
-    // Date de build
-    time_t t = time(NULL);
-    struct tm *tm = localtime(&t);
-    strftime(info->build_date, sizeof(info->build_date), "%Y-%m-%d %H:%M:%S", tm);
-    
-    // Hostname
-    gethostname(info->build_host, sizeof(info->build_host));
-    
-    while (fgets(line, sizeof(line), fp)) {
-        line[strcspn(line, "\n")] = 0;
-        
-        // Gestion des blocs multi-lignes
-        if (strstr(line, "$APKMMAKE::")) {
-            in_block = 1;
-            strcpy(current_block, "make");
-            char *val = strstr(line, "::") + 2;
-            strcpy(info->build_cmd, val);
-            clean_string(info->build_cmd);
-            continue;
-        }
-        if (strstr(line, "$APKMINSTALL::")) {
-            in_block = 1;
-            strcpy(current_block, "install");
-            char *val = strstr(line, "::") + 2;
-            strcpy(info->install_cmd, val);
-            clean_string(info->install_cmd);
-            continue;
-        }
-        if (strstr(line, "$APKMCHECK::")) {
-            in_block = 1;
-            strcpy(current_block, "check");
-            char *val = strstr(line, "::") + 2;
-            strcpy(info->check_cmd, val);
-            clean_string(info->check_cmd);
-            continue;
-        }
-        
-        if (in_block) {
-            if (strstr(line, "}")) {
-                in_block = 0;
-            } else {
-                if (strcmp(current_block, "make") == 0) {
-                    strcat(info->build_cmd, " ");
-                    strcat(info->build_cmd, line);
-                } else if (strcmp(current_block, "install") == 0) {
-                    strcat(info->install_cmd, " ");
-                    strcat(info->install_cmd, line);
-                } else if (strcmp(current_block, "check") == 0) {
-                    strcat(info->check_cmd, " ");
-                    strcat(info->check_cmd, line);
-                }
-            }
-            continue;
-        }
-        
-        // Variables simples
-        char *val;
-        if ((val = strstr(line, "$APKNAME::"))) {
-            strcpy(info->name, val + 10);
-            clean_string(info->name);
-        }
-        else if ((val = strstr(line, "$APKMVERSION::"))) {
-            strcpy(info->version, val + 14);
-            clean_string(info->version);
-        }
-        else if ((val = strstr(line, "$APKMRELEASE::"))) {
-            strcpy(info->release, val + 14);
-            clean_string(info->release);
-        }
-        else if ((val = strstr(line, "$APKMARCH::"))) {
-            strcpy(info->arch, val + 11);
-            clean_string(info->arch);
-        }
-        else if ((val = strstr(line, "$APKMMAINT::"))) {
-            strcpy(info->maintainer, val + 12);
-            clean_string(info->maintainer);
-        }
-        else if ((val = strstr(line, "$APKMDESC::"))) {
-            strcpy(info->description, val + 11);
-            clean_string(info->description);
-        }
-        else if ((val = strstr(line, "$APKMLICENSE::"))) {
-            strcpy(info->license, val + 14);
-            clean_string(info->license);
-        }
-        else if ((val = strstr(line, "$APKMURL::"))) {
-            strcpy(info->url, val + 10);
-            clean_string(info->url);
-        }
-        else if ((val = strstr(line, "$APKMDEP::"))) {
-            strcpy(info->deps, val + 10);
-            clean_string(info->deps);
-        }
-        else if ((val = strstr(line, "$APKMBUILDDEP::"))) {
-            strcpy(info->build_deps, val + 15);
-            clean_string(info->build_deps);
-        }
-        else if ((val = strstr(line, "$APKMPATH::"))) {
-            strcpy(info->script_path, val + 11);
-            clean_string(info->script_path);
-        }
-        else if ((val = strstr(line, "$APKMREADME::"))) {
-            strcpy(info->readme_path, val + 13);
-            clean_string(info->readme_path);
-        }
-        else if ((val = strstr(line, "$APKMINSTALL::"))) {
-            // Pour les fichiers à installer
-            char *file = val + 14;
-            clean_string(file);
-            if (strlen(file) > 0 && file_count < MAX_FILES) {
-                strcpy(files[file_count].source, file);
-                strcpy(files[file_count].dest, file);
-                files[file_count].mode = 0644;
-                file_count++;
-            }
-        }
-    }
-    
-    fclose(fp);
-    
-    if (strlen(info->name) == 0) {
-        print_error("Missing $APKNAME in APKMBUILD");
-        return -1;
-    }
-    
+    debug_print("Parsed %s: %zu lines, %zu files", filename, info->lines, info->file_count);
     return 0;
 }
 
+// Build reproductible : date tirée de SOURCE_DATE_EPOCH (0 par défaut),
+// pas de nom de machine. Mêmes sources => même .tar.bool, octet pour octet.
+void set_reproducible(build_info_t *info) {
+    const char *env = getenv("SOURCE_DATE_EPOCH");
+    info->reproducible = 1;
+    info->source_date_epoch = env ? (time_t)strtoll(env, NULL, 10) : 0;
+    if (info->source_date_epoch < 0) info->source_date_epoch = 0;
+    
+    struct tm tm;
+    gmtime_r(&info->source_date_epoch, &tm);
+    strftime(info->build_date, sizeof(info->build_date), "%Y-%m-%d %H:%M:%S", &tm);
+    info->build_host[0] = '\0';
+}
+
 // ============================================================================
 // GÉNÉRATION DE MANIFEST.TOML
 // ============================================================================
 
-int generate_manifest(build_info_t *info, const char *output_dir) {
-    char manifest_path[512];
-    snprintf(manifest_path, sizeof(manifest_path), "%s/%s", output_dir, MANIFEST_NAME);
+// Chaîne TOML entre guillemets (les blocs $APKMMAKE/$APKMINSTALL sont
+// multi-lignes)
+static void fprint_toml_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        switch (*s) {
+        case '"':  fputs("\\\"", f); break;
+        case '\\': fputs("\\\\", f); break;
+        case '\n': fputs("\\n", f); break;
+        case '\t': fputs("\\t", f); break;
+        case '\r': fputs("\\r", f); break;
+        default:   fputc(*s, f); break;
+        }
+    }
+    fputc('"', f);
+}
+
+// Mode installé d'un $APKMFILE : celui imposé, sinon celui de la source
+// (normalisé comme dans l'archive en mode reproductible)
+static mode_t file_mode(const build_info_t *info, const apkm_file_t *file) {
+    if (file->mode != 0) return file->mode;
     
-    FILE *f = fopen(manifest_path, "w");
+    struct stat st;
+    if (stat(file->source, &st) != 0) return 0644;
+    if (info->reproducible) return (st.st_mode & 0111) ? 0755 : 0644;
+    return st.st_mode & 07777;
+}
+
+// Manifest en mémoire, écrit directement dans l'archive (à libérer)
+char *generate_manifest(build_info_t *info, size_t *len) {
+    char *manifest = NULL;
+    FILE *f = open_memstream(&manifest, len);
     if (!f) {
         print_error("Cannot create manifest");
-        return -1;
+        return NULL;
     }
     
     fprintf(f, "# Generated by BOOL v%s\n", BOOL_VERSION);
-    fprintf(f, "# Build date: %s\n", info->build_date);
-    fprintf(f, "# Build host: %s\n", info->build_host);
+    if (!info->reproducible) {
+        fprintf(f, "# Build date: %s\n", info->build_date);
+        fprintf(f, "# Build host: %s\n", info->build_host);
+    }
     fprintf(f, "\n");
     
     fprintf(f, "[metadata]\n");
@@ -398,8 +277,7 @@ int generate_manifest(build_info_t *info, const char *output_dir) {
     // Dépendances
     if (strlen(info->deps) > 0) {
         fprintf(f, "[dependencies]\n");
-        char deps_copy[2048];
-        strcpy(deps_copy, info->deps);
+        char *deps_copy = strdup(info->deps);
         
         char *dep = strtok(deps_copy, ";");
         while (dep) {
@@ -412,14 +290,14 @@ int generate_manifest(build_info_t *info, const char *output_dir) {
             }
             dep = strtok(NULL, ";");
         }
+        free(deps_copy);
         fprintf(f, "\n");
     }
     
     // Dépendances de build
     if (strlen(info->build_deps) > 0) {
         fprintf(f, "[build-dependencies]\n");
-        char deps_copy[1024];
-        strcpy(deps_copy, info->build_deps);
+        char *deps_copy = strdup(info->build_deps);
         
         char *dep = strtok(deps_copy, ";");
         while (dep) {
@@ -432,17 +310,18 @@ int generate_manifest(build_info_t *info, const char *output_dir) {
             }
             dep = strtok(NULL, ";");
         }
+        free(deps_copy);
         fprintf(f, "\n");
     }
     
     // Fichiers
-    if (file_count > 0) {
+    if (info->file_count > 0) {
         fprintf(f, "[files]\n");
-        for (int i = 0; i < file_count; i++) {
+        for (size_t i = 0; i < info->file_count; i++) {
             fprintf(f, "[[file]]\n");
-            fprintf(f, "source = \"%s\"\n", files[i].source);
-            fprintf(f, "dest = \"%s\"\n", files[i].dest);
-            fprintf(f, "mode = \"%o\"\n", files[i].mode);
+            fprintf(f, "source = \"%s\"\n", info->files[i].source);
+            fprintf(f, "dest = \"%s\"\n", info->files[i].dest);
+            fprintf(f, "mode = \"%o\"\n", file_mode(info, &info->files[i]));
         }
         fprintf(f, "\n");
     }
@@ -451,7 +330,9 @@ int generate_manifest(build_info_t *info, const char *output_dir) {
     if (strlen(info->install_cmd) > 0 || access("install.sh", F_OK) == 0) {
         fprintf(f, "[scripts]\n");
         if (strlen(info->install_cmd) > 0) {
-            fprintf(f, "install = \"%s\"\n", info->install_cmd);
+            fprintf(f, "install = ");
+            fprint_toml_string(f, info->install_cmd);
+            fprintf(f, "\n");
         }
         if (access("install.sh", F_OK) == 0) {
             fprintf(f, "postinst = \"install.sh\"\n");
@@ -464,152 +345,277 @@ int generate_manifest(build_info_t *info, const char *output_dir) {
     fprintf(f, "sha256 = \"%s\"\n", info->sha256);
     fprintf(f, "timestamp = \"%s\"\n", info->build_date);
     
-    fclose(f);
+    if (fclose(f) != 0) {
+        free(manifest);
+        print_error("Cannot create manifest");
+        return NULL;
+    }
     print_success("Generated %s", MANIFEST_NAME);
-    return 0;
+    return manifest;
 }
 
 // ============================================================================
-// CRÉATION DE LA STRUCTURE DU PAQUET
+// EXÉCUTION DES COMMANDES DE BUILD
 // ============================================================================
 
-int create_package_structure(build_info_t *info, const char *build_dir) {
-    char pkg_dir[512];
-    snprintf(pkg_dir, sizeof(pkg_dir), "%s/pkg-%s", build_dir, info->name);
-    
-    // Créer le répertoire principal
-    mkdir(pkg_dir, 0755);
-    
-    // Créer la structure standard
-    char path[1024];
-    snprintf(path, sizeof(path), "%s/usr", pkg_dir);
-    mkdir(path, 0755);
-    
-    snprintf(path, sizeof(path), "%s/usr/bin", pkg_dir);
-    mkdir(path, 0755);
+// Code de sortie du shell (128 + signal s'il a été tué, -1 sans shell)
+static int command_status(const char *cmd) {
+    int ret = system(cmd);
+    if (ret == -1) return -1;
+    if (WIFEXITED(ret)) return WEXITSTATUS(ret);
+    return WIFSIGNALED(ret) ? 128 + WTERMSIG(ret) : -1;
+}
+
+int run_build_commands(build_info_t *info) {
+    if (strlen(info->build_cmd) == 0) return 0;
     
-    snprintf(path, sizeof(path), "%s/usr/lib", pkg_dir);
-    mkdir(path, 0755);
+    print_step("Running build commands");
+    debug_print("Executing: %s", info->build_cmd);
     
-    snprintf(path, sizeof(path), "%s/usr/include", pkg_dir);
-    mkdir(path, 0755);
+    int ret = command_status(info->build_cmd);
+    if (ret != 0) {
+        print_error("Build command exited with code %d", ret);
+    }
     
-    snprintf(path, sizeof(path), "%s/usr/share", pkg_dir);
-    mkdir(path, 0755);
+    return ret;
+}
+
+int run_check_commands(build_info_t *info) {
+    if (strlen(info->check_cmd) == 0) return 0;
     
-    snprintf(path, sizeof(path), "%s/usr/share/doc", pkg_dir);
-    mkdir(path, 0755);
+    print_step("Running tests");
+    debug_print("Executing: %s", info->check_cmd);
     
-    snprintf(path, sizeof(path), "%s/usr/share/doc/%s", pkg_dir, info->name);
-    mkdir(path, 0755);
+    int ret = command_status(info->check_cmd);
+    if (ret != 0) {
+        print_error("Tests failed with code %d", ret);
+    }
     
-    print_info("Created package structure in %s", pkg_dir);
-    return 0;
+    return ret;
 }
 
 // ============================================================================
-// COPIE DES FICHIERS
+// CRÉATION DE L'ARCHIVE FINALE
 // ============================================================================
 
-int copy_files(build_info_t *info, const char *build_dir) {
-    char pkg_dir[512];
-    snprintf(pkg_dir, sizeof(pkg_dir), "%s/pkg-%s", build_dir, info->name);
-    
-    // Copier les fichiers spécifiés
-    for (int i = 0; i < file_count; i++) {
-        char dest_path[1024];
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", pkg_dir, files[i].dest);
-        
-        // Créer les répertoires parents si nécessaire
-        char *last_slash = strrchr(dest_path, '/');
-        if (last_slash) {
-            *last_slash = '\0';
-            mkdir(dest_path, 0755);
-            *last_slash = '/';
-        }
-        
-        char cmd[2048];
-        snprintf(cmd, sizeof(cmd), "cp '%s' '%s'", files[i].source, dest_path);
-        system(cmd);
-        
-        if (files[i].mode != 0) {
-            chmod(dest_path, files[i].mode);
+/*
+ * L'archive tar est écrite par libarchive, sans dossier pkg-<nom>
+ * intermédiaire ni appel à tar/cp : chaque entrée est lue depuis son
+ * chemin source et SHA-256 + BLAKE3 sont calculés sur les octets au
+ * moment où ils partent sur le disque.
+ */
+
+typedef struct {
+    int fd;
+    SHA256_CTX sha;
+    blake3_hasher blake3;
+    long long written;
+} archive_out_t;
+
+static la_ssize_t archive_out_write(struct archive *a, void *ctx, const void *buf, size_t len) {
+    archive_out_t *out = ctx;
+    const unsigned char *p = buf;
+    size_t left = len;
+    
+    while (left > 0) {
+        ssize_t n = write(out->fd, p, left);
+        if (n <= 0) {
+            archive_set_error(a, errno, "write failed");
+            return -1;
         }
-        
-        debug_print("Copied %s -> %s", files[i].source, dest_path);
+        p += n;
+        left -= (size_t)n;
     }
     
-    // Copier automatiquement les binaires courants
-    if (access(info->name, F_OK) == 0) {
-        char dest[1024];
-        snprintf(dest, sizeof(dest), "%s/usr/bin/%s", pkg_dir, info->name);
-        char cmd[2048];
-        snprintf(cmd, sizeof(cmd), "cp '%s' '%s' && chmod 755 '%s'", info->name, dest, dest);
-        system(cmd);
-        debug_print("Copied binary %s", info->name);
+    SHA256_Update(&out->sha, buf, len);
+    blake3_hasher_update(&out->blake3, buf, len);
+    out->written += (long long)len;
+    return (la_ssize_t)len;
+}
+
+static void hex_digest(const unsigned char *hash, size_t len, char *output) {
+    for (size_t i = 0; i < len; i++) {
+        sprintf(output + (i * 2), "%02x", hash[i]);
     }
-    
-    // Copier la documentation
-    if (strlen(info->readme_path) > 0 && access(info->readme_path, F_OK) == 0) {
-        char dest[1024];
-        snprintf(dest, sizeof(dest), "%s/usr/share/doc/%s/README.md", pkg_dir, info->name);
-        char cmd[2048];
-        snprintf(cmd, sizeof(cmd), "cp '%s' '%s'", info->readme_path, dest);
-        system(cmd);
+    output[len * 2] = '\0';
+}
+
+// Contexte d'écriture : dossiers déjà émis, tampon de lecture, métadonnées
+typedef struct {
+    struct archive *a;
+    char **dirs;                  // Dossiers déjà écrits dans l'archive
+    int dir_count;
+    int dir_cap;
+    unsigned char *buffer;
+    size_t buffer_size;
+    int reproducible;
+    time_t epoch;                 // SOURCE_DATE_EPOCH en mode reproductible
+} archive_ctx_t;
+
+// Une entrée prévue dans l'archive ; source NULL = manifest en mémoire,
+// dest terminé par '/' = dossier
+typedef struct {
+    const char *source;
+    char dest[512];
+    mode_t mode;
+} archive_plan_t;
+
+static int compare_plan(const void *a, const void *b) {
+    return strcmp(((const archive_plan_t *)a)->dest, ((const archive_plan_t *)b)->dest);
+}
+
+// Ajoute une entrée au plan ; -1 si sa destination ne tient pas dans dest
+static int plan_add(archive_plan_t *plan, int *count, const char *source, mode_t mode,
+                    const char *fmt, ...) {
+    archive_plan_t *p = &plan[*count];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(p->dest, sizeof(p->dest), fmt, ap);
+    va_end(ap);
+    
+    if (n < 0 || (size_t)n >= sizeof(p->dest)) {
+        print_error("Destination path too long: %.64s...", p->dest);
+        return -1;
     }
-    
-    // Copier install.sh s'il existe
-    if (access("install.sh", F_OK) == 0) {
-        char dest[1024];
-        snprintf(dest, sizeof(dest), "%s/install.sh", pkg_dir);
-        char cmd[2048];
-        snprintf(cmd, sizeof(cmd), "cp install.sh '%s' && chmod 755 '%s'", dest, dest);
-        system(cmd);
+    p->source = source;
+    p->mode = mode;
+    (*count)++;
+    return 0;
+}
+
+// Mode reproductible : root:root, dates bornées à SOURCE_DATE_EPOCH, pas
+// d'atime/ctime ; les octets ne dépendent plus de la machine ni de l'heure
+static void archive_entry_normalize(const archive_ctx_t *ctx, struct archive_entry *entry,
+                                    time_t mtime) {
+    if (!ctx->reproducible) {
+        archive_entry_set_mtime(entry, mtime, 0);
+        return;
+    }
+    archive_entry_set_mtime(entry, mtime < ctx->epoch ? mtime : ctx->epoch, 0);
+    archive_entry_unset_atime(entry);
+    archive_entry_unset_ctime(entry);
+    archive_entry_unset_birthtime(entry);
+    archive_entry_set_uid(entry, 0);
+    archive_entry_set_gid(entry, 0);
+    archive_entry_set_uname(entry, "root");
+    archive_entry_set_gname(entry, "root");
+}
+
+static time_t archive_now(const archive_ctx_t *ctx) {
+    return ctx->reproducible ? ctx->epoch : time(NULL);
+}
+
+static int archive_add_dir(archive_ctx_t *ctx, const char *path) {
+    for (int i = 0; i < ctx->dir_count; i++) {
+        if (strcmp(ctx->dirs[i], path) == 0) return 0;
     }
     
+    if (ctx->dir_count == ctx->dir_cap) {
+        int cap = ctx->dir_cap ? ctx->dir_cap * 2 : 32;
+        char **p = realloc(ctx->dirs, cap * sizeof(char *));
+        if (!p) return -1;
+        ctx->dirs = p;
+        ctx->dir_cap = cap;
+    }
+    ctx->dirs[ctx->dir_count] = strdup(path);
+    if (!ctx->dirs[ctx->dir_count]) return -1;
+    ctx->dir_count++;
+    
+    struct archive_entry *entry = archive_entry_new();
+    archive_entry_set_pathname(entry, path);
+    archive_entry_set_filetype(entry, AE_IFDIR);
+    archive_entry_set_perm(entry, 0755);
+    archive_entry_normalize(ctx, entry, archive_now(ctx));
+    int ret = archive_write_header(ctx->a, entry);
+    archive_entry_free(entry);
+    return ret == ARCHIVE_OK ? 0 : -1;
+}
+
+// Dossiers parents de dest, du plus haut au plus profond
+static int archive_add_parents(archive_ctx_t *ctx, const char *dest) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s", dest);
+    
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        int ret = archive_add_dir(ctx, path);
+        *p = '/';
+        if (ret != 0) return -1;
+    }
     return 0;
 }
 
-// ============================================================================
-// EXÉCUTION DES COMMANDES DE BUILD
-// ============================================================================
+static int archive_add_buffer(archive_ctx_t *ctx, const char *dest,
+                              const void *data, size_t len, mode_t mode) {
+    if (archive_add_parents(ctx, dest) != 0) return -1;
+    
+    struct archive_entry *entry = archive_entry_new();
+    archive_entry_set_pathname(entry, dest);
+    archive_entry_set_filetype(entry, AE_IFREG);
+    archive_entry_set_perm(entry, mode);
+    archive_entry_set_size(entry, (la_int64_t)len);
+    archive_entry_normalize(ctx, entry, archive_now(ctx));
+    
+    int ret = archive_write_header(ctx->a, entry);
+    archive_entry_free(entry);
+    if (ret != ARCHIVE_OK) return -1;
+    return archive_write_data(ctx->a, data, len) == (la_ssize_t)len ? 0 : -1;
+}
 
-int run_build_commands(build_info_t *info) {
-    if (strlen(info->build_cmd) == 0) return 0;
+// Fichier source copié tel quel dans l'archive ; mode 0 = mode d'origine.
+// Une source absente est ignorée avec un avertissement, -1 sur erreur.
+static int archive_add_file(archive_ctx_t *ctx, const char *source, const char *dest,
+                            mode_t mode) {
+    int fd = open(source, O_RDONLY);
+    if (fd < 0) {
+        print_warning("Cannot read %s, skipped", source);
+        return 0;
+    }
     
-    print_step("Running build commands");
-    debug_print("Executing: %s", info->build_cmd);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        print_warning("Not a regular file: %s, skipped", source);
+        return 0;
+    }
     
-    int ret = system(info->build_cmd);
-    if (ret != 0) {
-        print_warning("Build command exited with code %d", ret);
+    if (archive_add_parents(ctx, dest) != 0) {
+        close(fd);
+        return -1;
     }
     
-    return 0;
-}
-
-int run_check_commands(build_info_t *info) {
-    if (strlen(info->check_cmd) == 0) return 0;
+    // Sans mode imposé, le mode reproductible ne garde que le bit exécutable
+    // (l'umask de la machine de build ne doit pas changer l'archive)
+    if (mode == 0 && ctx->reproducible) mode = (st.st_mode & 0111) ? 0755 : 0644;
     
-    print_step("Running tests");
-    debug_print("Executing: %s", info->check_cmd);
+    struct archive_entry *entry = archive_entry_new();
+    archive_entry_copy_stat(entry, &st);
+    archive_entry_set_pathname(entry, dest);
+    if (mode != 0) archive_entry_set_perm(entry, mode);
+    archive_entry_normalize(ctx, entry, st.st_mtime);
     
-    int ret = system(info->check_cmd);
-    if (ret != 0) {
-        print_warning("Tests failed with code %d", ret);
+    int ret = archive_write_header(ctx->a, entry) == ARCHIVE_OK ? 0 : -1;
+    archive_entry_free(entry);
+    
+    off_t left = st.st_size;
+    while (ret == 0 && left > 0) {
+        ssize_t n = read(fd, ctx->buffer, ctx->buffer_size);
+        if (n <= 0) {
+            ret = -1;
+            break;
+        }
+        if (n > left) n = (ssize_t)left;
+        if (archive_write_data(ctx->a, ctx->buffer, (size_t)n) != n) ret = -1;
+        left -= n;
     }
+    close(fd);
     
-    return 0;
+    debug_print("Added %s -> %s", source, dest);
+    return ret;
 }
 
-// ============================================================================
-// CRÉATION DE L'ARCHIVE FINALE
-// ============================================================================
-
-int create_archive(build_info_t *info, const char *build_dir) {
-    char pkg_dir[512];
-    snprintf(pkg_dir, sizeof(pkg_dir), "%s/pkg-%s", build_dir, info->name);
-    
+int create_archive(build_info_t *info, const char *manifest, size_t manifest_len) {
     // S'assurer que le répertoire build existe
     mkdir("build", 0755);
     
@@ -618,50 +624,415 @@ int create_archive(build_info_t *info, const char *build_dir) {
              "build/%s-v%s-%s.%s.tar.bool", 
              info->name, info->version, info->release, info->arch);
     
+    char tmp_name[600];
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", archive_name);
+    
     print_step("Creating archive");
     
-    // Créer l'archive avec tar
-    char cmd[4096];
-    snprintf(cmd, sizeof(cmd), 
-             "cd '%s' && tar -cf '%s' * 2>/dev/null", 
-             pkg_dir, archive_name);
+    // Contenu du paquet : manifest et install.sh à la racine, puis usr/
+    size_t plan_cap = info->file_count + 8;
+    archive_plan_t *plan = calloc(plan_cap, sizeof(archive_plan_t));
+    if (!plan) {
+        print_error("Out of memory");
+        return -1;
+    }
+    int plan_count = 0;
+    int planned = plan_add(plan, &plan_count, NULL, 0644, "%s", MANIFEST_NAME);
     
-    debug_print("Running: %s", cmd);
+    if (planned == 0 && access("install.sh", F_OK) == 0) {
+        planned = plan_add(plan, &plan_count, "install.sh", 0755, "install.sh");
+    }
     
-    int tar_result = system(cmd);
+    const char *layout[] = {"usr/bin/", "usr/lib/", "usr/include/"};
+    for (size_t i = 0; planned == 0 && i < sizeof(layout) / sizeof(layout[0]); i++) {
+        planned = plan_add(plan, &plan_count, NULL, 0, "%s", layout[i]);
+    }
+    if (planned == 0) {
+        planned = plan_add(plan, &plan_count, NULL, 0, "usr/share/doc/%s/", info->name);
+    }
     
-    if (tar_result == 0 && access(archive_name, F_OK) == 0) {
-        struct stat st;
-        stat(archive_name, &st);
-        info->file_size = st.st_size;
-        
-        // Calculer SHA256
-        if (calculate_file_sha256(archive_name, info->sha256) == 0) {
-            print_success("Archive created: %s (%.2f KB)", 
-                         archive_name, st.st_size / 1024.0);
-            print_info("SHA256: %s", info->sha256);
+    // Binaire du même nom que le paquet
+    if (planned == 0 && access(info->name, F_OK) == 0) {
+        planned = plan_add(plan, &plan_count, info->name, 0755, "usr/bin/%s", info->name);
+    }
+    
+    // Documentation
+    if (planned == 0 && strlen(info->readme_path) > 0 && access(info->readme_path, F_OK) == 0) {
+        planned = plan_add(plan, &plan_count, info->readme_path, 0,
+                           "usr/share/doc/%s/README.md", info->name);
+    }
+    
+    // Fichiers déclarés dans l'APKMBUILD
+    for (size_t i = 0; planned == 0 && i < info->file_count; i++) {
+        planned = plan_add(plan, &plan_count, info->files[i].source, info->files[i].mode,
+                           "%s", info->files[i].dest);
+    }
+    
+    // Ordre stable, indépendant du système de fichiers : les parents
+    // précèdent toujours leurs enfants (préfixe). Deux entrées de même
+    // destination se suivent : la seconde écraserait la première à l'installation.
+    if (planned == 0) qsort(plan, plan_count, sizeof(archive_plan_t), compare_plan);
+    for (int i = 1; planned == 0 && i < plan_count; i++) {
+        if (strcmp(plan[i - 1].dest, plan[i].dest) == 0) {
+            print_error("Two files are packaged as %s", plan[i].dest);
+            planned = -1;
         }
-        
-        return 0;
+    }
+    if (planned != 0) {
+        free(plan);
+        return -1;
     }
     
-    print_error("Failed to create archive");
-    return -1;
+    archive_out_t out;
+    out.fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out.fd < 0) {
+        free(plan);
+        print_error("Cannot create %s", tmp_name);
+        return -1;
+    }
+    SHA256_Init(&out.sha);
+    blake3_hasher_init(&out.blake3);
+    out.written = 0;
+    
+    archive_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.a = archive_write_new();
+    ctx.buffer_size = 1024 * 1024;
+    ctx.buffer = malloc(ctx.buffer_size);
+    ctx.reproducible = info->reproducible;
+    ctx.epoch = info->source_date_epoch;
+    
+    archive_write_set_format_pax_restricted(ctx.a);
+    if (info->compress_zstd) {
+        archive_write_add_filter_zstd(ctx.a);
+    } else {
+        archive_write_add_filter_none(ctx.a);
+    }
+    // Pas de remplissage au bloc de 10 Ko : la taille est celle des données
+    archive_write_set_bytes_in_last_block(ctx.a, 1);
+    
+    int ret = ctx.buffer &&
+              archive_write_open(ctx.a, &out, NULL, archive_out_write, NULL) == ARCHIVE_OK
+              ? 0 : -1;
+    
+    for (int i = 0; ret == 0 && i < plan_count; i++) {
+        const archive_plan_t *p = &plan[i];
+        if (p->dest[strlen(p->dest) - 1] == '/') {
+            ret = archive_add_parents(&ctx, p->dest);
+        } else if (!p->source) {
+            ret = archive_add_buffer(&ctx, p->dest, manifest, manifest_len, p->mode);
+        } else {
+            ret = archive_add_file(&ctx, p->source, p->dest, p->mode);
+        }
+    }
+    
+    if (ret == 0 && archive_write_close(ctx.a) != ARCHIVE_OK) ret = -1;
+    if (ret != 0) {
+        print_error("Failed to create archive: %s", archive_error_string(ctx.a)
+                    ? archive_error_string(ctx.a) : "out of memory");
+    }
+    archive_write_free(ctx.a);
+    
+    for (int i = 0; i < ctx.dir_count; i++) free(ctx.dirs[i]);
+    free(ctx.dirs);
+    free(ctx.buffer);
+    free(plan);
+    
+    if (close(out.fd) != 0) ret = -1;
+    if (ret == 0 && rename(tmp_name, archive_name) != 0) ret = -1;
+    if (ret != 0) {
+        unlink(tmp_name);
+        print_error("Failed to create archive");
+        return -1;
+    }
+    
+    unsigned char sha[SHA256_DIGEST_LENGTH];
+    SHA256_Final(sha, &out.sha);
+    hex_digest(sha, sizeof(sha), info->sha256);
+    
+    unsigned char b3[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(&out.blake3, b3, BLAKE3_OUT_LEN);
+    hex_digest(b3, sizeof(b3), info->blake3);
+    
+    info->file_size = out.written;
+    print_success("Archive created: %s (%.2f KB)", archive_name, out.written / 1024.0);
+    print_info("SHA256: %s", info->sha256);
+    print_info("BLAKE3: %s", info->blake3);
+    return 0;
 }
 
 // ============================================================================
-// NETTOYAGE
+// CACHE DE BUILD
 // ============================================================================
 
-int cleanup(build_info_t *info, const char *build_dir) {
-    char pkg_dir[512];
-    snprintf(pkg_dir, sizeof(pkg_dir), "%s/pkg-%s", build_dir, info->name);
+static void key_add(SHA256_CTX *ctx, const char *s) {
+    SHA256_Update(ctx, s, strlen(s) + 1);
+}
+
+// Sorties du build à ne pas prendre pour des sources
+static int source_is_output(const build_info_t *info, const char *rel) {
+    if (strcmp(rel, info->name) == 0) return 1;
+    if (strncmp(rel, "build/", 6) == 0 || strncmp(rel, ".git/", 5) == 0) return 1;
+    return strncmp(rel, "pkg-", 4) == 0 && strchr(rel, '/') != NULL;
+}
+
+// Hors dépôt git : produits de compilation courants, ignorés par suffixe
+static int source_is_object(const char *rel) {
+    static const char *suffixes[] = {
+        ".o", ".lo", ".a", ".la", ".so", ".obj", ".d", ".gch", ".pyc", ".class"
+    };
+    size_t len = strlen(rel);
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        size_t n = strlen(suffixes[i]);
+        if (len > n && strcmp(rel + len - n, suffixes[i]) == 0) return 1;
+    }
+    return strstr(rel, ".so.") != NULL;
+}
+
+static int compare_cstr(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Fichiers d'un dossier connus de git : suivis, et non suivis hors
+// .gitignore (un nouveau source pas encore ajouté compte). Les produits du
+// build (*.o, générés) sont ignorés par le projet et restent hors de la clé.
+// Tableau trié, chaînes dans *buf ; -1 si le dossier n'est pas dans un dépôt.
+static int git_list_files(const char *dir, char **buf, char ***files, size_t *count) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, STDERR_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execlp("git", "git", "-C", dir, "ls-files", "-z", "--cached", "--others",
+               "--exclude-standard", (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    
+    size_t len = 0, cap = 65536;
+    char *data = malloc(cap);
+    ssize_t n = 0;
+    while (data && (n = read(fds[0], data + len, cap - len)) > 0) {
+        len += (size_t)n;
+        if (len == cap) {
+            char *grown = realloc(data, cap * 2);
+            if (!grown) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            cap *= 2;
+        }
+    }
+    close(fds[0]);
     
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", pkg_dir);
-    system(cmd);
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!data || n < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        free(data);
+        return -1;
+    }
+    
+    data[len] = '\0';      // len < cap : la dernière entrée est terminée
+    size_t total = 0;
+    for (size_t i = 0; i < len; i++) total += data[i] == '\0';
+    char **list = malloc((total + 1) * sizeof(char *));
+    if (!list) {
+        free(data);
+        return -1;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < len; i += strlen(data + i) + 1) {
+        if (k < total) list[k++] = data + i;
+    }
+    qsort(list, k, sizeof(char *), compare_cstr);
     
-    debug_print("Cleaned up %s", pkg_dir);
+    *buf = data;
+    *files = list;
+    *count = k;
+    return 0;
+}
+
+static int key_add_file(SHA256_CTX *ctx, const char *path, const char *rel, mode_t mode) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    
+    // Par pread et non par mmap : un éditeur peut tronquer le fichier
+    // pendant le hachage, ce qui lèverait SIGBUS sur le mapping
+    uint8_t buffer[65536];
+    off_t pos = 0;
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), pos)) > 0) {
+        blake3_hasher_update(&hasher, buffer, (size_t)n);
+        pos += n;
+    }
+    close(fd);
+    
+    uint8_t hash[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
+    
+    key_add(ctx, rel);
+    char exec = (mode & 0111) ? 'x' : '-';
+    SHA256_Update(ctx, &exec, 1);
+    SHA256_Update(ctx, hash, sizeof(hash));
+    return 0;
+}
+
+// Une entrée de $APKMSOURCES : fichier ou dossier parcouru (ordre trié)
+static int key_add_source(SHA256_CTX *ctx, const build_info_t *info, const char *source) {
+    struct stat st;
+    if (stat(source, &st) != 0) {
+        key_add(ctx, source);
+        key_add(ctx, "<missing>");
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) return key_add_file(ctx, source, source, st.st_mode);
+    
+    char *buf;
+    char **files;
+    size_t count;
+    if (git_list_files(source, &buf, &files, &count) == 0) {
+        int ret = 0;
+        for (size_t i = 0; ret == 0 && i < count; i++) {
+            char path[MAX_PATH];
+            snprintf(path, sizeof(path), "%s/%s", source, files[i]);
+            const char *rel = strcmp(source, ".") == 0 ? files[i] : path;
+            if (source_is_output(info, rel)) continue;
+            
+            // Suivi mais supprimé : la clé doit changer aussi
+            if (stat(path, &st) != 0) {
+                key_add(ctx, rel);
+                key_add(ctx, "<missing>");
+                continue;
+            }
+            if (S_ISREG(st.st_mode)) ret = key_add_file(ctx, path, rel, st.st_mode);
+        }
+        free(files);
+        free(buf);
+        return ret;
+    }
+    
+    selp_file_list_t list;
+    if (selp_scan_tree(source, 0, 0, &list) != SELP_OK) return -1;
+    
+    int ret = 0;
+    for (size_t i = 0; ret == 0 && i < list.count; i++) {
+        const char *path = list.entries[i].path;
+        const char *rel = strcmp(source, ".") == 0 ? selp_relative_path(".", path) : path;
+        if (source_is_output(info, rel) || source_is_object(rel)) continue;
+        ret = key_add_file(ctx, path, rel, list.entries[i].st.st_mode);
+    }
+    selp_file_list_free(&list);
+    return ret;
+}
+
+// Fichier copié dans l'archive (install.sh, README, $APKMFILE) : son contenu
+// compte même hors de $APKMSOURCES. Les produits d'une commande de build
+// sont écartés, leurs sources sont déjà dans la clé.
+static int key_add_packaged(SHA256_CTX *ctx, const build_info_t *info, const char *path) {
+    if (info->build_cmd[0] && (source_is_output(info, path) || source_is_object(path))) {
+        return 0;
+    }
+    
+    struct stat st;
+    key_add(ctx, "<packaged>");
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        key_add(ctx, path);
+        key_add(ctx, "<missing>");
+        return 0;
+    }
+    return key_add_file(ctx, path, path, st.st_mode);
+}
+
+// Compilateur, options et machine : un changement de chaîne invalide le cache
+static void key_add_toolchain(SHA256_CTX *ctx) {
+    const char *vars[] = {"CC", "CXX", "CPPFLAGS", "CFLAGS", "CXXFLAGS", "LDFLAGS"};
+    for (size_t i = 0; i < sizeof(vars) / sizeof(vars[0]); i++) {
+        const char *v = getenv(vars[i]);
+        key_add(ctx, v ? v : "");
+    }
+    
+    struct utsname u;
+    if (uname(&u) == 0) key_add(ctx, u.machine);
+    
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", getenv("CC") ? getenv("CC") : "cc");
+    FILE *p = popen(cmd, "r");
+    if (p) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), p)) > 0) SHA256_Update(ctx, buf, n);
+        pclose(p);
+    }
+}
+
+// Clé du build : champs de l'APKMBUILD, contenu des sources ($APKMSOURCES,
+// le dossier du projet par défaut) et des fichiers empaquetés, chaîne de
+// compilation. Hex dans key.
+int compute_build_key(build_info_t *info, char *key) {
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    
+    key_add(&ctx, "bool-build-cache-v1");
+    key_add(&ctx, BOOL_VERSION);
+    
+    const char *fields[] = {
+        info->name, info->version, info->release, info->arch, info->maintainer,
+        info->description, info->license, info->url, info->deps, info->build_deps,
+        info->build_cmd, info->install_cmd, info->check_cmd, info->script_path,
+        info->readme_path, info->sources
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) key_add(&ctx, fields[i]);
+    
+    char flags[64];
+    snprintf(flags, sizeof(flags), "%d:%d:%lld", info->compress_zstd, info->reproducible,
+             (long long)info->source_date_epoch);
+    key_add(&ctx, flags);
+    
+    for (size_t i = 0; i < info->file_count; i++) {
+        snprintf(flags, sizeof(flags), "%o", info->files[i].mode);
+        key_add(&ctx, info->files[i].source);
+        key_add(&ctx, info->files[i].dest);
+        key_add(&ctx, flags);
+    }
+    
+    // Sources séparées par espaces ou ';'
+    char *sources = strdup(info->sources[0] ? info->sources : ".");
+    if (!sources) return -1;
+    int ret = 0;
+    for (char *tok = strtok(sources, " ;"); ret == 0 && tok; tok = strtok(NULL, " ;")) {
+        ret = key_add_source(&ctx, info, tok);
+    }
+    free(sources);
+    
+    // Tout ce que create_archive empaquette, y compris hors des sources
+    if (ret == 0) ret = key_add_packaged(&ctx, info, "install.sh");
+    if (ret == 0 && info->readme_path[0]) ret = key_add_packaged(&ctx, info, info->readme_path);
+    if (ret == 0) ret = key_add_packaged(&ctx, info, info->name);
+    for (size_t i = 0; ret == 0 && i < info->file_count; i++) {
+        ret = key_add_packaged(&ctx, info, info->files[i].source);
+    }
+    if (ret != 0) return -1;
+    
+    key_add_toolchain(&ctx);
+    
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256_Final(hash, &ctx);
+    hex_digest(hash, sizeof(hash), key);
     return 0;
 }
 
@@ -688,51 +1059,318 @@ int build_package(build_info_t *info) {
     }
     printf("\n");
     
-    // Build
-    if (strlen(info->build_cmd) > 0) {
-        run_build_commands(info);
-    }
+    char archive_name[512];
+    snprintf(archive_name, sizeof(archive_name), 
+             "build/%s-v%s-%s.%s.tar.bool", 
+             info->name, info->version, info->release, info->arch);
     
-    // Tests
-    if (strlen(info->check_cmd) > 0) {
-        run_check_commands(info);
+    // Mêmes entrées qu'un build précédent : on reprend son archive
+    char key[SHA256_DIGEST_LENGTH * 2 + 1];
+    int cached = !info->no_cache && compute_build_key(info, key) == 0;
+    if (cached) {
+        debug_print("Build key: %s", key);
+        mkdir("build", 0755);
+        if (bool_cache_lookup(key, archive_name, info->sha256, info->blake3) == 0) {
+            print_success("Cache hit (%.12s), build and tests skipped", key);
+            printf("📦 Output: %s\n", archive_name);
+            printf("🔏 SHA256: %s\n", info->sha256);
+            printf("🔏 BLAKE3: %s\n", info->blake3);
+            return 0;
+        }
     }
     
-    // Créer la structure
-    create_package_structure(info, ".");
-    
-    // Copier les fichiers
-    copy_files(info, ".");
-    
-    // Générer le manifest
-    char pkg_dir[512];
-    snprintf(pkg_dir, sizeof(pkg_dir), "pkg-%s", info->name);
-    generate_manifest(info, pkg_dir);
-    
-    // Créer l'archive
-    if (create_archive(info, ".") != 0) {
-        cleanup(info, ".");
+    // Build puis tests : un échec n'a ni archive ni entrée de cache
+    if (run_build_commands(info) != 0 || run_check_commands(info) != 0) {
+        print_error("Build of %s failed, no archive written", info->name);
         return -1;
     }
     
-    // Nettoyer
-    cleanup(info, ".");
+    // Générer le manifest
+    size_t manifest_len = 0;
+    char *manifest = generate_manifest(info, &manifest_len);
+    if (!manifest) return -1;
+    
+    // Créer l'archive directement depuis les fichiers sources
+    int ret = create_archive(info, manifest, manifest_len);
+    if (ret == 0 && cached &&
+        bool_cache_store(key, archive_name, manifest, manifest_len,
+                         info->sha256, info->blake3) != 0) {
+        print_warning("Could not store build in cache");
+    }
+    free(manifest);
+    if (ret != 0) return -1;
     
     printf("\n");
     print_success("Build completed successfully!");
     
-    char archive_name[512];
-    snprintf(archive_name, sizeof(archive_name), 
-             "build/%s-v%s-%s.%s.tar.bool", 
-             info->name, info->version, info->release, info->arch);
-    
     printf("📦 Output: %s\n", archive_name);
     printf("📄 Manifest: included in archive as %s\n", MANIFEST_NAME);
     printf("🔏 SHA256: %s\n", info->sha256);
+    printf("🔏 BLAKE3: %s\n", info->blake3);
     
     return 0;
 }
 
+// ============================================================================
+// BUILD MULTI-PAQUETS
+// ============================================================================
+
+/*
+ * bool build-all <dir> : chaque APKMBUILD de l'arborescence est un nœud,
+ * $APKMDEP/$APKMBUILDDEP vers un autre paquet de l'arbre une arête. Les
+ * paquets prêts partent en parallèle (jobs max), chacun dans un processus
+ * fils placé dans son propre dossier : "." et "build/" de build_package
+ * désignent alors le dossier du paquet, sans collision entre builds.
+ * Sortie de chaque build dans <dir>/build-logs/<nom>.log (<nom>.<n>.log
+ * pour le n-ième paquet d'un nom déjà vu).
+ */
+
+enum { PKG_PENDING, PKG_RUNNING, PKG_OK, PKG_FAILED, PKG_SKIPPED };
+
+typedef struct {
+    char dir[MAX_PATH];
+    char name[256];
+    char log[MAX_PATH];           // Journal du build, unique par paquet
+    int *deps;                    // Index des paquets dont il dépend
+    int dep_count;
+    int state;
+    pid_t pid;
+    double start;
+    double seconds;
+} pkg_node_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// "libc >=2.30; gcc" : ajoute une arête par dépendance présente dans l'arbre
+static int add_dep_edges(pkg_node_t *nodes, int count, int self, const char *list) {
+    // Listes sans limite de longueur depuis l'arène de l'APKMBUILD
+    char *copy = strdup(list);
+    if (!copy) return -1;
+    
+    int ret = 0;
+    char *save = NULL;
+    for (char *dep = strtok_r(copy, ";", &save); dep; dep = strtok_r(NULL, ";", &save)) {
+        while (*dep == ' ' || *dep == '\t') dep++;
+        dep[strcspn(dep, " \t<>=")] = '\0';
+        if (*dep == '\0') continue;
+        
+        for (int j = 0; j < count; j++) {
+            if (j == self || strcmp(nodes[j].name, dep) != 0) continue;
+            
+            int *p = realloc(nodes[self].deps, (nodes[self].dep_count + 1) * sizeof(int));
+            if (!p) {
+                ret = -1;
+                break;
+            }
+            nodes[self].deps = p;
+            nodes[self].deps[nodes[self].dep_count++] = j;
+        }
+    }
+    free(copy);
+    return ret;
+}
+
+// Processus fils : build isolé dans le dossier du paquet, sortie vers le log
+static void build_child(const pkg_node_t *node, const char *log_path, int reproducible,
+                        int no_cache) {
+    int fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+    
+    if (chdir(node->dir) != 0) {
+        fprintf(stderr, "Cannot enter %s\n", node->dir);
+        _exit(1);
+    }
+    
+    build_info_t info;
+    if (parse_apkmbuild(APKMBUILD_NAME, &info) != 0) exit(1);
+    info.no_cache = no_cache;
+    if (reproducible) set_reproducible(&info);
+    
+    int ret = build_package(&info);
+    apkmbuild_free(&info);
+    exit(ret == 0 ? 0 : 1);
+}
+
+int build_all(const char *root, int jobs, int reproducible, int no_cache) {
+    selp_file_list_t list;
+    if (selp_scan_tree(root, 0, 0, &list) != SELP_OK) {
+        print_error("Cannot scan %s", root);
+        return -1;
+    }
+    
+    pkg_node_t *nodes = calloc(list.count + 1, sizeof(pkg_node_t));
+    if (!nodes) {
+        selp_file_list_free(&list);
+        return -1;
+    }
+    
+    // Découverte : un APKMBUILD par dossier de paquet
+    int count = 0;
+    char **dep_lists = calloc(list.count + 1, sizeof(char *));
+    
+    for (size_t i = 0; dep_lists && i < list.count; i++) {
+        const char *path = list.entries[i].path;
+        const char *base = strrchr(path, '/');
+        base = base ? base + 1 : path;
+        if (strcmp(base, APKMBUILD_NAME) != 0) continue;
+        
+        build_info_t info;
+        if (parse_apkmbuild(path, &info) != 0) continue;
+        
+        pkg_node_t *n = &nodes[count];
+        snprintf(n->dir, sizeof(n->dir), "%.*s", (int)(base - path), path);
+        if (n->dir[0] == '\0') snprintf(n->dir, sizeof(n->dir), ".");
+        snprintf(n->name, sizeof(n->name), "%s", info.name);
+        
+        if (asprintf(&dep_lists[count], "%s;%s", info.deps, info.build_deps) < 0) {
+            dep_lists[count] = NULL;
+        }
+        count++;
+        apkmbuild_free(&info);
+    }
+    selp_file_list_free(&list);
+    
+    if (count == 0) {
+        print_error("No %s found under %s", APKMBUILD_NAME, root);
+        free(dep_lists);
+        free(nodes);
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (dep_lists[i]) add_dep_edges(nodes, count, i, dep_lists[i]);
+        free(dep_lists[i]);
+    }
+    free(dep_lists);
+    
+    char log_dir[MAX_PATH];
+    snprintf(log_dir, sizeof(log_dir), "%s/build-logs", root);
+    mkdir(log_dir, 0755);
+    
+    // Deux dossiers peuvent déclarer le même nom : un journal chacun
+    for (int i = 0; i < count; i++) {
+        int seen = 0;
+        for (int j = 0; j < i; j++) seen += strcmp(nodes[j].name, nodes[i].name) == 0;
+        if (seen == 0) {
+            snprintf(nodes[i].log, sizeof(nodes[i].log), "%s/%s.log", log_dir, nodes[i].name);
+        } else {
+            snprintf(nodes[i].log, sizeof(nodes[i].log), "%s/%s.%d.log",
+                     log_dir, nodes[i].name, seen);
+            print_warning("%s declared again in %s", nodes[i].name, nodes[i].dir);
+        }
+    }
+    
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    
+    print_step("Building %d packages (%d jobs)", count, jobs);
+    
+    double wall_start = now_seconds();
+    int running = 0, finished = 0;
+    
+    while (finished < count) {
+        // Lancer tout ce qui est prêt, dans la limite des jobs
+        for (int i = 0; i < count && running < jobs; i++) {
+            pkg_node_t *n = &nodes[i];
+            if (n->state != PKG_PENDING) continue;
+            
+            int ready = 1, blocked = 0;
+            for (int d = 0; d < n->dep_count; d++) {
+                int s = nodes[n->deps[d]].state;
+                if (s == PKG_FAILED || s == PKG_SKIPPED) blocked = 1;
+                else if (s != PKG_OK) ready = 0;
+            }
+            
+            if (blocked) {
+                n->state = PKG_SKIPPED;
+                finished++;
+                print_warning("%s skipped (dependency failed)", n->name);
+                continue;
+            }
+            if (!ready) continue;
+            
+            fflush(stdout);
+            fflush(stderr);
+            n->start = now_seconds();
+            n->pid = fork();
+            if (n->pid == 0) build_child(n, n->log, reproducible, no_cache);
+            if (n->pid < 0) {
+                n->state = PKG_FAILED;
+                finished++;
+                print_error("%s: cannot fork", n->name);
+                continue;
+            }
+            n->state = PKG_RUNNING;
+            running++;
+            print_info("Building %s (%s)", n->name, n->dir);
+        }
+        
+        if (running == 0) {
+            if (finished < count) {
+                // Plus rien ne peut partir : cycle de dépendances
+                for (int i = 0; i < count; i++) {
+                    if (nodes[i].state != PKG_PENDING) continue;
+                    nodes[i].state = PKG_FAILED;
+                    finished++;
+                    print_error("%s: dependency cycle", nodes[i].name);
+                }
+            }
+            break;
+        }
+        
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        
+        for (int i = 0; i < count; i++) {
+            pkg_node_t *n = &nodes[i];
+            if (n->state != PKG_RUNNING || n->pid != pid) continue;
+            
+            n->seconds = now_seconds() - n->start;
+            n->state = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? PKG_OK : PKG_FAILED;
+            running--;
+            finished++;
+            
+            if (n->state == PKG_OK) {
+                print_success("%s built in %.1fs", n->name, n->seconds);
+            } else {
+                print_error("%s failed after %.1fs, see %s", n->name, n->seconds, n->log);
+            }
+            break;
+        }
+    }
+    
+    double wall = now_seconds() - wall_start;
+    
+    // Résumé
+    int ok = 0, failed = 0;
+    printf("\n📊 Build summary\n");
+    printf("%-32s %-8s %10s\n", "package", "status", "time");
+    for (int i = 0; i < count; i++) {
+        const char *status = "failed";
+        if (nodes[i].state == PKG_OK) status = "ok";
+        else if (nodes[i].state == PKG_SKIPPED) status = "skipped";
+        
+        if (nodes[i].state == PKG_OK) ok++;
+        else failed++;
+        
+        printf("%-32s %-8s %9.1fs\n", nodes[i].name, status, nodes[i].seconds);
+        free(nodes[i].deps);
+    }
+    printf("\n⏱️  %d/%d packages built in %.1fs (logs in %s)\n", ok, count, wall, log_dir);
+    
+    free(nodes);
+    return failed ? -1 : 0;
+}
+
 // ============================================================================
 // INFO SUR LE PAQUET
 // ============================================================================
@@ -823,6 +1461,99 @@ int verify_package(const char *package_path) {
     return 0;
 }
 
+// ============================================================================
+// ARCHIVES SELP
+// ============================================================================
+
+static const char *selp_strerror(int code) {
+    switch (code) {
+        case SELP_ERR_OPEN:       return "cannot open file";
+        case SELP_ERR_READ:       return "read error";
+        case SELP_ERR_WRITE:      return "write error";
+        case SELP_ERR_MAGIC:      return "not a SELP archive";
+        case SELP_ERR_VERSION:    return "unsupported SELP version";
+        case SELP_ERR_SIGNATURE:  return "invalid signature";
+        case SELP_ERR_CHECKSUM:   return "corrupted files";
+        case SELP_ERR_MEMORY:     return "out of memory";
+        case SELP_ERR_NOT_FOUND:  return "no files found";
+        case SELP_ERR_COMPRESS:   return "compression error";
+        case SELP_ERR_DECOMPRESS: return "corrupted compressed block";
+        case SELP_ERR_CRYPTO:     return "decryption failed (missing or wrong passphrase?)";
+        default:                  return "SELP error";
+    }
+}
+
+static int parse_selp_level(const char *name) {
+    if (strcmp(name, "none") == 0)  return SELP_COMPRESS_NONE;
+    if (strcmp(name, "fast") == 0)  return SELP_COMPRESS_FAST;
+    if (strcmp(name, "best") == 0)  return SELP_COMPRESS_BEST;
+    if (strcmp(name, "ultra") == 0) return SELP_COMPRESS_ULTRA;
+    return -1;
+}
+
+// Passphrase des archives chiffrées : --passphrase-file ou $SELP_PASSPHRASE
+static int load_selp_passphrase(const char *file) {
+    char pass[256] = {0};
+    
+    if (file) {
+        FILE *f = fopen(file, "r");
+        if (!f) {
+            print_error("Cannot read passphrase file: %s", file);
+            return -1;
+        }
+        if (!fgets(pass, sizeof(pass), f)) pass[0] = '\0';
+        fclose(f);
+        pass[strcspn(pass, "\r\n")] = '\0';
+    } else if (getenv("SELP_PASSPHRASE")) {
+        strncpy(pass, getenv("SELP_PASSPHRASE"), sizeof(pass) - 1);
+    }
+    
+    selp_set_passphrase(pass);
+    OPENSSL_cleanse(pass, sizeof(pass));
+    return 0;
+}
+
+// bool -c <dir> <archive> [--level L] [--no-dict] [--dedup] [--follow]
+int cmd_selp_compress(int argc, char *argv[]) {
+    if (argc < 4) {
+        print_error("Usage: bool -c <directory> <archive> [--level none|fast|best|ultra] "
+                    "[--no-dict] [--dedup] [--follow] [--encrypt]");
+        return 1;
+    }
+    
+    int flags = 0;
+    int level = SELP_COMPRESS_FAST;
+    int crypt = SELP_CRYPT_NONE;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--encrypt") == 0) {
+            crypt = SELP_CRYPT_STRONG;
+        } else if (strcmp(argv[i], "--dedup") == 0) {
+            flags |= SELP_FLAG_DEDUP;
+        } else if (strcmp(argv[i], "--follow") == 0) {
+            flags |= SELP_FLAG_FOLLOW_LINKS;
+        } else if (strcmp(argv[i], "--no-dict") == 0) {
+            flags |= SELP_FLAG_NO_DICT;
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            level = parse_selp_level(argv[++i]);
+            if (level < 0) {
+                print_error("Unknown level: %s", argv[i]);
+                return 1;
+            }
+        } else {
+            print_error("Unknown option: %s", argv[i]);
+            return 1;
+        }
+    }
+    
+    int ret = selp_compress_directory_ex(argv[2], argv[3], level,
+                                         crypt, NULL, NULL, flags);
+    if (ret != SELP_OK) {
+        print_error("Compression failed: %s", selp_strerror(ret));
+        return 1;
+    }
+    return 0;
+}
+
 // ============================================================================
 // AIDE
 // ============================================================================
@@ -839,20 +1570,43 @@ void print_help(void) {
     
     printf("COMMANDS:\n");
     printf("  --build                 Build package from APKMBUILD\n");
+    printf("       --reproducible     Byte-identical output (SOURCE_DATE_EPOCH, root:root)\n");
+    printf("       --no-cache         Always run build and tests\n");
+    printf("  build-all <dir>         Build every APKMBUILD under dir in dependency order\n");
+    printf("       -j <n>             Parallel builds (default: one per core)\n");
+    printf("  --cache-stats           Show build cache usage (BOOL_CACHE_DIR, BOOL_CACHE_MAX_MB)\n");
+    printf("  --cache-clear           Empty the build cache\n");
     printf("  --info <package>        Show package information\n");
     printf("  --verify <package>      Verify package integrity\n");
     printf("  --init                  Create template APKMBUILD and Manifest.toml\n");
     printf("  --help                  Show this help\n\n");
     
+    printf("SELP ARCHIVES:\n");
+    printf("  -c <dir> <archive>      Create a SELP archive from a directory\n");
+    printf("       --level <l>        none, fast (default), best or ultra (zstd)\n");
+    printf("       --no-dict          Do not train a dictionary for small files\n");
+    printf("       --dedup            Content-defined chunking, store each chunk once\n");
+    printf("       --follow           Follow symbolic links\n");
+    printf("       --encrypt          AES-256-GCM per block (needs a passphrase)\n");
+    printf("  -u <archive> <dir>      Append changed files, write a new TOC (--update)\n");
+    printf("  --compact <archive>     Drop data superseded by --update\n");
+    printf("  -x <archive> <dir>      Extract a SELP archive\n");
+    printf("       --salvage          Skip corrupted files, extract the rest\n");
+    printf("  -t <archive>            Verify signature and per-file checksums\n");
+    printf("  -l <archive>            List archive contents\n");
+    printf("  --magic <archive>       Show SELP header\n\n");
+    
     printf("OPTIONS:\n");
     printf("  --debug                 Enable debug output\n");
-    printf("  --quiet                 Suppress output\n\n");
+    printf("  --quiet                 Suppress output\n");
+    printf("  --passphrase-file <f>   SELP passphrase (or $SELP_PASSPHRASE)\n\n");
     
     printf("EXAMPLES:\n");
     printf("  bool --build\n");
     printf("  bool --info build/package.tar.bool\n");
     printf("  bool --verify build/package.tar.bool\n");
-    printf("  bool --init\n\n");
+    printf("  bool --init\n");
+    printf("  bool -c build/pkg pkg.selp.bool --dedup\n\n");
 }
 
 // ============================================================================
@@ -890,6 +1644,7 @@ int init_project(void) {
     fprintf(f, "$APKMBUILDDEP:: cmake\n");
     fprintf(f, "$APKMPATH::install.sh\n");
     fprintf(f, "$APKMREADME::README.md\n");
+    fprintf(f, "# $APKMFILE:: build/myapp usr/bin/myapp 755\n");
     fprintf(f, "\n");
     fprintf(f, "$APKMMAKE:: {\n");
     fprintf(f, "    mkdir -p build\n");
@@ -979,11 +1734,16 @@ int main(int argc, char *argv[]) {
     
     // Parser les options globales
     int args_processed = 1;
+    const char *passphrase_file = NULL;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--debug") == 0) {
             debug_mode = 1;
             args_processed++;
         }
+        else if (strcmp(argv[i], "--passphrase-file") == 0 && i + 1 < argc) {
+            passphrase_file = argv[++i];
+            args_processed += 2;
+        }
         else if (strcmp(argv[i], "--quiet") == 0) {
             quiet_mode = 1;
             args_processed++;
@@ -998,6 +1758,15 @@ int main(int argc, char *argv[]) {
         argc -= args_processed - 1;
     }
     
+    if (argc < 2) {
+        print_help();
+        return 0;
+    }
+    
+    if (load_selp_passphrase(passphrase_file) != 0) {
+        return 1;
+    }
+    
     if (strcmp(argv[1], "--build") == 0) {
         // Vérifier que APKMBUILD existe
         if (access(APKMBUILD_NAME, F_OK) != 0) {
@@ -1011,7 +1780,38 @@ int main(int argc, char *argv[]) {
             return 1;
         }
         
-        return build_package(&info);
+        int reproducible = getenv("SOURCE_DATE_EPOCH") != NULL;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--reproducible") == 0) reproducible = 1;
+            else if (strcmp(argv[i], "--no-cache") == 0) info.no_cache = 1;
+        }
+        if (reproducible) set_reproducible(&info);
+        
+        int ret = build_package(&info);
+        apkmbuild_free(&info);
+        return ret;
+    }
+    else if (strcmp(argv[1], "build-all") == 0 || strcmp(argv[1], "--build-all") == 0) {
+        if (argc < 3) {
+            print_error("Usage: bool build-all <dir> [-j N] [--reproducible] [--no-cache]");
+            return 1;
+        }
+        int jobs = 0;
+        int reproducible = getenv("SOURCE_DATE_EPOCH") != NULL;
+        int no_cache = 0;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+            else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2]) jobs = atoi(argv[i] + 2);
+            else if (strcmp(argv[i], "--reproducible") == 0) reproducible = 1;
+            else if (strcmp(argv[i], "--no-cache") == 0) no_cache = 1;
+        }
+        return build_all(argv[2], jobs, reproducible, no_cache) == 0 ? 0 : 1;
+    }
+    else if (strcmp(argv[1], "--cache-stats") == 0) {
+        return bool_cache_stats() == 0 ? 0 : 1;
+    }
+    else if (strcmp(argv[1], "--cache-clear") == 0) {
+        return bool_cache_clear() == 0 ? 0 : 1;
     }
     else if (strcmp(argv[1], "--info") == 0) {
         if (argc < 3) {
@@ -1030,6 +1830,72 @@ int main(int argc, char *argv[]) {
     else if (strcmp(argv[1], "--init") == 0) {
         return init_project();
     }
+    else if (strcmp(argv[1], "-c") == 0 || strcmp(argv[1], "--compress") == 0) {
+        return cmd_selp_compress(argc, argv);
+    }
+    else if (strcmp(argv[1], "-u") == 0 || strcmp(argv[1], "--update") == 0) {
+        if (argc < 4) {
+            print_error("Usage: bool --update <archive> <directory>");
+            return 1;
+        }
+        int ret = selp_update_directory(argv[2], argv[3]);
+        if (ret != SELP_OK) {
+            print_error("Update failed: %s", selp_strerror(ret));
+            return 1;
+        }
+        return 0;
+    }
+    else if (strcmp(argv[1], "--compact") == 0) {
+        if (argc < 3) {
+            print_error("Missing archive file");
+            return 1;
+        }
+        int ret = selp_compact(argv[2]);
+        if (ret != SELP_OK) {
+            print_error("Compaction failed: %s", selp_strerror(ret));
+            return 1;
+        }
+        return 0;
+    }
+    else if (strcmp(argv[1], "-x") == 0 || strcmp(argv[1], "--extract") == 0) {
+        if (argc < 4) {
+            print_error("Usage: bool -x <archive> <directory> [--salvage]");
+            return 1;
+        }
+        int options = (argc > 4 && strcmp(argv[4], "--salvage") == 0) ? SELP_EXTRACT_SALVAGE : 0;
+        int ret = selp_extract_ex(argv[2], argv[3], options);
+        if (ret != SELP_OK) {
+            print_error("Extraction failed: %s", selp_strerror(ret));
+            return 1;
+        }
+        return 0;
+    }
+    else if (strcmp(argv[1], "-l") == 0 || strcmp(argv[1], "--list") == 0) {
+        if (argc < 3) {
+            print_error("Missing archive file");
+            return 1;
+        }
+        int ret = selp_list(argv[2]);
+        if (ret != SELP_OK) {
+            print_error("Cannot list %s: %s", argv[2], selp_strerror(ret));
+            return 1;
+        }
+        return 0;
+    }
+    else if (strcmp(argv[1], "-t") == 0 || strcmp(argv[1], "--test") == 0) {
+        if (argc < 3) {
+            print_error("Missing archive file");
+            return 1;
+        }
+        return selp_verify(argv[2]) == SELP_OK ? 0 : 1;
+    }
+    else if (strcmp(argv[1], "--magic") == 0) {
+        if (argc < 3) {
+            print_error("Missing archive file");
+            return 1;
+        }
+        return selp_magic_info(argv[2]) == SELP_OK ? 0 : 1;
+    }
     else if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
         print_help();
         return 0;
@@ -5,14 +5,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <time.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <zstd.h>
+#include <blake3.h>
 
 #define BOOL_VERSION "2.1.0"
 #define SELP_MAGIC "SELP"
-#define SELP_VERSION 1
-#define MAX_FILES 4096
+#define SELP_VERSION 3
+#define SELP_VERSION_LEGACY 1
 #define MAX_PATH 1024
 #define MAX_COMMENT 256
 #define MAX_AUTHOR 128
@@ -23,12 +28,99 @@
 #define SELP_COMPRESS_BEST   2
 #define SELP_COMPRESS_ULTRA  3
 
-// Niveaux de chiffrement
+// Niveaux de chiffrement (AES-256-GCM, le niveau fixe le coût PBKDF2)
 #define SELP_CRYPT_NONE   0
 #define SELP_CRYPT_LIGHT  1
 #define SELP_CRYPT_MEDIUM 2
 #define SELP_CRYPT_STRONG 3
 
+// Flags d'en-tête
+#define SELP_FLAG_FOLLOW_LINKS 0x01
+#define SELP_FLAG_DEDUP        0x02
+#define SELP_FLAG_NO_DICT      0x04   // Option de création, pas stockée
+#define SELP_FLAG_TOC_ZSTD     0x08   // TOC compressée (toc_size octets stockés)
+#define SELP_FLAG_ENTRY_SUMS   0x10   // CRC32C + BLAKE3 renseignés par entrée
+#define SELP_FLAG_SIG_TOC      0x20   // Signature = SHA-256 de la TOC stockée
+
+// Options d'extraction
+#define SELP_EXTRACT_SALVAGE   0x01   // Continuer après un fichier corrompu
+
+// Flags de bloc
+#define SELP_BLOCK_ZSTD        0x01   // Bloc compressé zstd
+#define SELP_BLOCK_DICT        0x02   // Compressé avec le dictionnaire de l'archive
+#define SELP_BLOCK_AES         0x04   // Chiffré AES-256-GCM (tag en fin de bloc)
+#define SELP_BLOCK_HOLE        0x08   // Trou d'un fichier creux : size octets nuls, rien de stocké
+
+// Types d'entrée (v3)
+#define SELP_ENTRY_FILE        0
+#define SELP_ENTRY_HARDLINK    1      // Lien dur vers entries[link], blocs partagés
+
+// Chiffrement AES-256-GCM par bloc : nonce = (nonce_prefix ^ sel) (4 octets)
+// || index du bloc (8 octets). Le dictionnaire et la TOC ont des index
+// réservés ; la TOC utilise SELP_NONCE_TOC | toc_offset car --update en écrit
+// une nouvelle, toujours plus loin dans le fichier. Le sel est celui de la
+// session d'écriture : 0 à la création, tiré au hasard par chaque --update
+// (header.nonce_salt pour la TOC, block.reserved pour ses blocs). Un
+// --update échoué puis tronqué ne laisse donc pas un retry resceller
+// d'autres données sous les mêmes index.
+#define SELP_GCM_TAG_SIZE   16
+#define SELP_NONCE_TOC      (1ULL << 63)
+#define SELP_NONCE_DICT     (UINT64_MAX - 1)
+#define SELP_KDF_SALT_SIZE  16
+
+// Taille max d'un bloc quand la compression est active
+#define SELP_BLOCK_SIZE     (1024 * 1024)
+
+// Dictionnaire zstd entraîné sur les petits fichiers
+#define SELP_DICT_MAX_SIZE      (112 * 1024)
+#define SELP_DICT_MIN_SIZE      (4 * 1024)
+#define SELP_DICT_FILE_MAX      (64 * 1024)        // "petit fichier"
+#define SELP_DICT_MIN_SAMPLES   16
+#define SELP_DICT_SAMPLE_BUDGET (8 * 1024 * 1024)
+
+// Découpage par contenu (FastCDC) pour le mode dédup
+#define SELP_CDC_MIN_SIZE   (2 * 1024)
+#define SELP_CDC_AVG_SIZE   (8 * 1024)
+#define SELP_CDC_MAX_SIZE   (64 * 1024)
+
+/*
+ * Format SELP v3
+ *
+ *   [selp_header_t]
+ *   [dictionnaire zstd optionnel]                <- header.dict_offset
+ *   [données : blocs stockés les uns à la suite des autres]
+ *   [TOC : selp_file_entry_t x file_count
+ *          selp_block_t      x block_count
+ *          uint32_t          x ref_count]     <- header.toc_offset
+ *
+ * Chaque fichier référence une suite de blocs (refs[block_first ..
+ * block_first + block_count]). Sans dédup un fichier = un bloc ; en
+ * mode dédup les blocs sont des chunks FastCDC identifiés par leur
+ * BLAKE3 et partagés entre fichiers.
+ *
+ * Avec compression, chaque bloc (au plus SELP_BLOCK_SIZE) est compressé
+ * en zstd indépendamment ; les blocs des petits fichiers utilisent le
+ * dictionnaire entraîné à la création de l'archive.
+ *
+ * Fichiers creux (v3) : les trous trouvés par SEEK_DATA/SEEK_HOLE sont des
+ * blocs SELP_BLOCK_HOLE sans données. Le CRC32C et le BLAKE3 de l'entrée
+ * portent sur le contenu, trous lus comme des zéros, cf. selp_sum_hole().
+ *
+ * Signature : SHA-256 de la TOC telle que stockée (SELP_FLAG_SIG_TOC). La
+ * TOC porte le CRC32C et le BLAKE3 de chaque fichier, qui couvrent les
+ * données : --update n'a donc pas à relire l'archive pour re-signer.
+ * Sans ce flag (archives antérieures), SHA-256 de tout ce qui suit l'en-tête.
+ *
+ * Liens durs (v3) : une entrée SELP_ENTRY_HARDLINK reprend les blocs de
+ * entries[link], qui la précède toujours dans la TOC.
+ *
+ * Format v2 : en-tête arrêté à ref_count (SELP_HEADER_V2_SIZE), TOC brute,
+ * entrées sans type ni link (selp_file_entry_v2_t), ni dictionnaire ni
+ * chiffrement.
+ * Format v1 : entrées juste après l'en-tête puis données des fichiers
+ * concaténées. Tous deux toujours lisibles via selp_toc_load().
+ */
+
 // Structure d'en-tête SELP (version étendue)
 typedef struct {
     char magic[4];              // "SELP"
@@ -39,25 +131,185 @@ typedef struct {
     uint64_t original_size;      // Taille originale totale
     uint64_t compressed_size;    // Taille compressée totale
     uint64_t file_count;         // Nombre de fichiers
-    uint32_t checksum;           // Checksum simple
+    uint32_t nonce_salt;         // Sel des nonces de la TOC (v3, 0 = création)
     uint32_t signature[8];       // Signature 256-bit
     time_t timestamp;            // Timestamp
     char author[MAX_AUTHOR];     // Auteur
     char comment[MAX_COMMENT];   // Commentaire
+    // --- v2 ---
+    uint64_t toc_offset;         // Offset de la table des matières
+    uint64_t block_count;        // Nombre de blocs de données
+    uint64_t ref_count;          // Nombre de références fichier -> bloc
+    // --- v3 ---
+    uint64_t dict_offset;        // Offset du dictionnaire zstd
+    uint64_t dict_size;          // Taille du dictionnaire (0 = aucun)
+    uint64_t toc_size;           // Taille stockée de la TOC
+    uint8_t kdf_salt[SELP_KDF_SALT_SIZE];  // Sel PBKDF2 (archives chiffrées)
+    uint32_t kdf_iterations;     // Itérations PBKDF2-HMAC-SHA256
+    uint8_t nonce_prefix[4];     // Préfixe aléatoire des nonces GCM
 } selp_header_t;
 
+// Taille de l'en-tête des archives v1 (sans les champs v2)
+#define SELP_HEADER_V1_SIZE offsetof(selp_header_t, toc_offset)
+// Taille de l'en-tête des archives v2 (sans les champs v3)
+#define SELP_HEADER_V2_SIZE offsetof(selp_header_t, dict_offset)
+
+// Entrée de fichier des archives v1
+typedef struct {
+    char path[MAX_PATH];
+    char name[256];
+    uint64_t size;
+    uint32_t crc32;
+    uint8_t hash[32];
+    uint32_t permissions;
+    time_t mtime;
+    uint64_t offset;
+} selp_file_entry_v1_t;
+
+// Entrée de fichier des archives v2
+typedef struct {
+    char path[MAX_PATH];
+    char name[256];
+    uint64_t size;
+    uint32_t crc32;
+    uint8_t hash[32];
+    uint32_t permissions;
+    time_t mtime;
+    uint64_t offset;
+    uint32_t block_first;
+    uint32_t block_count;
+} selp_file_entry_v2_t;
+
 // Structure d'entrée de fichier (améliorée)
 typedef struct {
     char path[MAX_PATH];         // Chemin complet
     char name[256];              // Nom du fichier
     uint64_t size;                // Taille du fichier
-    uint32_t crc32;               // CRC32 du fichier
-    uint8_t hash[32];             // SHA256 du fichier
+    uint32_t crc32;               // CRC32C du fichier
+    uint8_t hash[32];             // BLAKE3 du fichier
     uint32_t permissions;         // Permissions Unix
     time_t mtime;                 // Modification time
-    uint64_t offset;               // Offset dans l'archive
+    uint64_t offset;               // Offset du premier bloc dans l'archive
+    uint32_t block_first;          // Premier index dans la table des refs (v2)
+    uint32_t block_count;          // Nombre de blocs du fichier (v2)
+    uint32_t type;                 // SELP_ENTRY_* (v3)
+    uint32_t link;                 // Entrée cible d'un lien dur (v3)
 } selp_file_entry_t;
 
+// Bloc de données stocké (fichier entier ou chunk dédupliqué)
+typedef struct {
+    uint64_t offset;              // Position dans l'archive
+    uint64_t size;                // Taille originale
+    uint64_t stored_size;         // Taille stockée (== size si brut)
+    uint8_t hash[32];             // BLAKE3 du contenu (mode dédup)
+    uint32_t flags;
+    uint32_t reserved;            // Sel des nonces de la session qui l'a scellé
+} selp_block_t;
+
+// Contexte AES-256-GCM (un par thread)
+typedef struct {
+    EVP_CIPHER_CTX *ctx;
+    uint8_t key[32];
+    uint8_t nonce_prefix[4];
+} selp_cipher_t;
+
+// Table des matières chargée en mémoire
+typedef struct {
+    selp_header_t header;
+    size_t header_size;           // Taille de l'en-tête sur disque
+    selp_file_entry_t *entries;
+    selp_block_t *blocks;
+    uint32_t *refs;
+    uint8_t *dict;                // Dictionnaire zstd (NULL si absent)
+    ZSTD_DCtx *dctx;              // Décompression, créés à la demande
+    ZSTD_DDict *ddict;
+    uint8_t *zbuf;
+    size_t zbuf_cap;
+    selp_cipher_t *cipher;        // NULL si l'archive n'est pas chiffrée
+    const uint8_t *map;           // Archive mappée (selp_toc_map), NULL sinon
+    size_t map_size;
+} selp_toc_t;
+
+// Index des chunks déjà écrits (clé : BLAKE3)
+typedef struct {
+    uint8_t hash[32];
+    uint32_t block;
+    uint32_t used;
+} selp_chunk_slot_t;
+
+typedef struct {
+    selp_chunk_slot_t *slots;
+    size_t capacity;
+    size_t count;
+} selp_chunk_index_t;
+
+// Inodes déjà écrits (fichiers à plusieurs liens) -> entrée
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint32_t entry;
+    uint32_t used;
+} selp_inode_slot_t;
+
+// Écriture d'une archive v2
+typedef struct {
+    FILE *fp;
+    selp_header_t header;
+    selp_file_entry_t *entries;
+    size_t entry_count;
+    size_t entry_cap;
+    selp_block_t *blocks;
+    size_t block_cap;
+    uint32_t *refs;
+    size_t ref_cap;
+    selp_chunk_index_t index;
+    uint8_t *buffer;
+    ZSTD_CCtx *cctx;              // Compression (NULL si SELP_COMPRESS_NONE)
+    ZSTD_CDict *cdict;            // Dictionnaire (NULL si absent)
+    int zlevel;
+    int use_dict;                 // Fichier courant compressé avec le dictionnaire
+    selp_cipher_t *cipher;        // NULL sans chiffrement
+    uint8_t *cbuf;                // Tampon du bloc chiffré
+    uint32_t file_crc;            // CRC32C du fichier courant
+    blake3_hasher file_hasher;    // BLAKE3 du fichier courant
+    uint8_t *zbuf;
+    size_t zbuf_cap;
+    uint64_t dedup_hits;
+    uint64_t dedup_saved;
+    uint64_t append_from;         // Fin de l'archive d'origine (--update), 0 sinon
+    selp_inode_slot_t *inodes;    // Détection des liens durs (st_dev, st_ino)
+    size_t inode_cap;
+    size_t inode_count;
+    uint64_t hardlinks;
+    uint64_t sparse_saved;        // Octets de trous non lus
+} selp_writer_t;
+
+// Arène : blocs chaînés, allocation par incrément, libérés d'un coup
+typedef struct selp_arena_block {
+    struct selp_arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} selp_arena_block_t;
+
+typedef struct {
+    selp_arena_block_t *head;
+} selp_arena_t;
+
+// Fichier trouvé par le parcours d'arborescence
+typedef struct {
+    char *path;                   // Chemin complet (dans l'arène de la liste)
+    struct stat st;
+} selp_scan_entry_t;
+
+// Liste sans limite de taille, triée par chemin
+typedef struct {
+    selp_scan_entry_t *entries;
+    size_t count;
+    size_t cap;
+    selp_arena_t arena;
+} selp_file_list_t;
+
 // Structure de contexte
 typedef struct {
     FILE *fp;
@@ -85,15 +337,100 @@ typedef struct {
 #define SELP_ERR_PERMISSION  -13
 
 // Prototypes
-int selp_compress_files(int argc, char **argv, const char *output, 
-                        int level, int crypt, const char *author, 
+int selp_compress_files(int argc, char **argv, const char *output,
+                        int level, int crypt, const char *author,
                         const char *comment);
 int selp_compress_directory(const char *dir, const char *output,
                            int level, int crypt, const char *author,
                            const char *comment, int follow_links);
+int selp_compress_directory_ex(const char *dir, const char *output,
+                               int level, int crypt, const char *author,
+                               const char *comment, int flags);
+int selp_update_directory(const char *archive, const char *dir);
+int selp_compact(const char *archive);
 int selp_extract(const char *archive, const char *output_dir);
+int selp_extract_ex(const char *archive, const char *output_dir, int options);
 int selp_list(const char *archive);
 int selp_verify(const char *archive);
+int selp_verify_entries(const char *archive, int threads);
 int selp_info(const char *archive);
+int selp_magic_info(const char *path);
+
+// Cache de build de bool --build (bool_cache.c)
+int bool_cache_dir(char *out, size_t size);
+int bool_cache_lookup(const char *key, const char *archive_path, char *sha256, char *blake3);
+int bool_cache_store(const char *key, const char *archive_path,
+                     const char *manifest, size_t manifest_len,
+                     const char *sha256, const char *blake3);
+int bool_cache_stats(void);
+int bool_cache_clear(void);
+
+// Parcours d'arborescence (selp_scan.c)
+void *selp_arena_alloc(selp_arena_t *a, size_t size);
+char *selp_arena_strndup(selp_arena_t *a, const char *s, size_t len);
+void selp_arena_free(selp_arena_t *a);
+int selp_scan_tree(const char *dir, int follow_links, int threads, selp_file_list_t *list);
+const char *selp_relative_path(const char *dir, const char *path);
+void selp_file_list_free(selp_file_list_t *list);
+
+// Chiffrement (selp_crypto.c)
+void selp_set_passphrase(const char *passphrase);
+uint32_t selp_kdf_iterations(int encryption);
+int selp_cipher_derive(selp_cipher_t *c, const selp_header_t *header);
+int selp_cipher_init_key(selp_cipher_t *c, const uint8_t key[32], const uint8_t nonce_prefix[4]);
+int selp_cipher_clone(selp_cipher_t *dst, const selp_cipher_t *src);
+int selp_cipher_seal(selp_cipher_t *c, uint64_t index, uint32_t salt,
+                     const uint8_t *in, size_t len, uint8_t *out);
+int selp_cipher_open(selp_cipher_t *c, uint64_t index, uint32_t salt,
+                     const uint8_t *in, size_t len, uint8_t *out);
+void selp_cipher_free(selp_cipher_t *c);
+
+// Format (selp_format.c)
+int selp_read_header(FILE *fp, selp_header_t *header, size_t *header_size);
+void selp_signature_from_hash(const uint8_t hash[32], uint32_t signature[8]);
+int selp_toc_load(FILE *fp, selp_toc_t *toc);
+void selp_toc_free(selp_toc_t *toc);
+int selp_copy_range(FILE *in, uint64_t offset, uint64_t len, FILE *out);
+const uint8_t *selp_map_file(int fd, size_t *size);
+void selp_unmap_file(const uint8_t *map, size_t size);
+int selp_map_covers(const uint8_t *map, size_t map_size, uint64_t offset, uint64_t len);
+int selp_toc_map(selp_toc_t *toc, FILE *fp);
+int selp_block_copy_fd(selp_toc_t *toc, int in_fd, const selp_block_t *block, int out_fd);
+// data == NULL : trou de len octets (bloc SELP_BLOCK_HOLE)
+typedef int (*selp_sink_t)(void *ctx, const uint8_t *data, size_t len);
+int selp_block_read(FILE *in, selp_toc_t *toc, const selp_block_t *block,
+                    selp_sink_t sink, void *ctx);
+int selp_block_extract(FILE *in, selp_toc_t *toc, const selp_block_t *block, FILE *out);
+int selp_toc_fork_codec(const selp_toc_t *src, selp_toc_t *dst);
+void selp_toc_release_codec(selp_toc_t *toc);
+
+// Écriture (selp_writer.c)
+int selp_writer_open(selp_writer_t *w, const char *output, const selp_header_t *tmpl);
+int selp_writer_set_dict(selp_writer_t *w, const uint8_t *dict, size_t size);
+int selp_writer_add_file(selp_writer_t *w, const char *src, const char *stored_path,
+                         const struct stat *st);
+int selp_writer_reopen(selp_writer_t *w, const char *archive, const selp_toc_t *toc);
+int selp_writer_keep_entry(selp_writer_t *w, const selp_file_entry_t *entry,
+                           const uint32_t *blocks, const struct stat *st);
+int selp_writer_copy_block(selp_writer_t *w, FILE *in, const selp_toc_t *toc,
+                           const selp_block_t *block, uint32_t *id);
+int selp_writer_close(selp_writer_t *w);
+void selp_writer_abort(selp_writer_t *w);
+
+// Découpage et index des chunks (selp_chunk.c)
+size_t selp_cdc_cut(const uint8_t *data, size_t len);
+int selp_chunk_index_init(selp_chunk_index_t *idx, size_t capacity);
+int selp_chunk_index_find(const selp_chunk_index_t *idx, const uint8_t hash[32], uint32_t *block);
+int selp_chunk_index_insert(selp_chunk_index_t *idx, const uint8_t hash[32], uint32_t block);
+void selp_chunk_index_free(selp_chunk_index_t *idx);
+
+// Intégrité par entrée (selp_integrity.c)
+uint32_t selp_crc32c(uint32_t crc, const void *data, size_t len);
+void selp_sum_hole(uint32_t *crc, blake3_hasher *hasher, uint64_t len);
+int selp_entry_check(FILE *in, selp_toc_t *toc, const selp_file_entry_t *entry);
+
+// Compression zstd (selp_zstd.c)
+int selp_zstd_level(int compression);
+size_t selp_dict_train(const char *const *paths, size_t count, uint8_t *dict, size_t capacity);
 
 #endif
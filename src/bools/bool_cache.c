@@ -0,0 +1,374 @@
+#include "bool.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+// ============================================================================
+// CACHE DE BUILD (bool --build)
+// ============================================================================
+
+/*
+ * Une entrée par clé de build (hex SHA-256 calculé par bool.c) :
+ *   <cache>/<clé>/package.tar.bool   l'archive produite
+ *   <cache>/<clé>/Manifest.toml      son manifest
+ *   <cache>/<clé>/meta               sha256, blake3 et nom de l'archive
+ * La date de modification du dossier sert à l'éviction LRU (touchée à
+ * chaque hit). Compteurs dans <cache>/stats, protégés par flock pour les
+ * builds concurrents.
+ */
+
+#define CACHE_ARCHIVE   "package.tar.bool"
+#define CACHE_MANIFEST  "Manifest.toml"
+#define CACHE_META      "meta"
+#define CACHE_STATS     "stats"
+#define CACHE_DEFAULT_MAX_MB 2048
+
+static int mkdir_p(const char *path) {
+    char tmp[MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(tmp, 0755);
+        *p = '/';
+    }
+    return mkdir(tmp, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+// $BOOL_CACHE_DIR, sinon $XDG_CACHE_HOME/bool/builds, sinon ~/.cache/bool/builds
+int bool_cache_dir(char *out, size_t size) {
+    const char *env = getenv("BOOL_CACHE_DIR");
+    if (env && *env) {
+        snprintf(out, size, "%s", env);
+    } else if ((env = getenv("XDG_CACHE_HOME")) && *env) {
+        snprintf(out, size, "%s/bool/builds", env);
+    } else if ((env = getenv("HOME")) && *env) {
+        snprintf(out, size, "%s/.cache/bool/builds", env);
+    } else {
+        return -1;
+    }
+    return mkdir_p(out);
+}
+
+static uint64_t cache_max_bytes(void) {
+    const char *env = getenv("BOOL_CACHE_MAX_MB");
+    long long mb = env ? atoll(env) : CACHE_DEFAULT_MAX_MB;
+    if (mb <= 0) mb = CACHE_DEFAULT_MAX_MB;
+    return (uint64_t)mb * 1024 * 1024;
+}
+
+// ============================================================================
+// STATISTIQUES
+// ============================================================================
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long stores;
+    unsigned long long evictions;
+} cache_stats_t;
+
+// Ajoute les deltas aux compteurs sous verrou ; NULL = lecture seule
+static int cache_stats_update(const char *dir, const cache_stats_t *delta, cache_stats_t *out) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", dir, CACHE_STATS);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    flock(fd, LOCK_EX);
+
+    cache_stats_t st = {0, 0, 0, 0};
+    char buf[256];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n > 0) {
+        buf[n] = '\0';
+        sscanf(buf, "hits %llu\nmisses %llu\nstores %llu\nevictions %llu",
+               &st.hits, &st.misses, &st.stores, &st.evictions);
+    }
+
+    if (delta) {
+        st.hits += delta->hits;
+        st.misses += delta->misses;
+        st.stores += delta->stores;
+        st.evictions += delta->evictions;
+
+        int len = snprintf(buf, sizeof(buf), "hits %llu\nmisses %llu\nstores %llu\nevictions %llu\n",
+                           st.hits, st.misses, st.stores, st.evictions);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, buf, (size_t)len, 0) != len) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return -1;
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (out) *out = st;
+    return 0;
+}
+
+static void cache_count(const char *dir, int hits, int misses, int stores, int evictions) {
+    cache_stats_t delta = {(unsigned long long)hits, (unsigned long long)misses,
+                           (unsigned long long)stores, (unsigned long long)evictions};
+    cache_stats_update(dir, &delta, NULL);
+}
+
+// ============================================================================
+// COPIE
+// ============================================================================
+
+// Reflink si le système de fichiers le permet (btrfs, xfs), copie dans le
+// noyau sinon. Jamais de lien dur : une modification sur place de
+// build/*.tar.bool corromprait l'entrée du cache.
+static int cache_copy(const char *src, const char *dst) {
+    unlink(dst);
+
+    int in = open(src, O_RDONLY);
+    if (in < 0) return -1;
+    int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+
+    int ret = 0;
+    struct stat st;
+    if (fstat(in, &st) != 0) ret = -1;
+    if (ret == 0 && ioctl(out, FICLONE, in) == 0) {
+        close(in);
+        return close(out) == 0 ? 0 : -1;
+    }
+
+    off_t left = ret == 0 ? st.st_size : 0;
+    while (left > 0) {
+        ssize_t n = copy_file_range(in, NULL, out, NULL, (size_t)left, 0);
+        if (n <= 0) {
+            // Repli : lecture/écriture classiques
+            char buf[65536];
+            n = read(in, buf, sizeof(buf));
+            if (n <= 0 || write(out, buf, (size_t)n) != n) {
+                ret = -1;
+                break;
+            }
+        }
+        left -= n;
+    }
+
+    close(in);
+    if (close(out) != 0) ret = -1;
+    if (ret != 0) unlink(dst);
+    return ret;
+}
+
+static void rm_entry(const char *entry) {
+    DIR *d = opendir(entry);
+    if (d) {
+        struct dirent *de;
+        while ((de = readdir(d))) {
+            if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+            char path[MAX_PATH];
+            snprintf(path, sizeof(path), "%s/%s", entry, de->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(entry);
+}
+
+// ============================================================================
+// RECHERCHE ET STOCKAGE
+// ============================================================================
+
+// Hit : l'archive en cache est recopiée vers archive_path, sha256/blake3
+// (hex) remplis depuis meta. 0 sur hit, -1 sur miss.
+int bool_cache_lookup(const char *key, const char *archive_path, char *sha256, char *blake3) {
+    char dir[MAX_PATH];
+    if (bool_cache_dir(dir, sizeof(dir)) != 0) return -1;
+
+    char entry[MAX_PATH], path[MAX_PATH];
+    snprintf(entry, sizeof(entry), "%s/%s", dir, key);
+    snprintf(path, sizeof(path), "%s/%s", entry, CACHE_META);
+
+    FILE *f = fopen(path, "r");
+    int ok = f && fscanf(f, "sha256 %64s\nblake3 %64s", sha256, blake3) == 2;
+    if (f) fclose(f);
+
+    snprintf(path, sizeof(path), "%s/%s", entry, CACHE_ARCHIVE);
+    if (!ok || cache_copy(path, archive_path) != 0) {
+        cache_count(dir, 0, 1, 0, 0);
+        return -1;
+    }
+
+    // Récemment utilisé : dernier à partir à l'éviction
+    utimensat(AT_FDCWD, entry, NULL, 0);
+    cache_count(dir, 1, 0, 0, 0);
+    return 0;
+}
+
+static uint64_t entry_size(const char *entry) {
+    uint64_t total = 0;
+    DIR *d = opendir(entry);
+    if (!d) return 0;
+
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.') continue;
+        char path[MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", entry, de->d_name);
+        if (stat(path, &st) == 0) total += (uint64_t)st.st_blocks * 512;
+    }
+    closedir(d);
+    return total;
+}
+
+typedef struct {
+    char name[80];
+    time_t used;
+    uint64_t size;
+} cache_entry_t;
+
+static int compare_used(const void *a, const void *b) {
+    const cache_entry_t *x = a, *y = b;
+    return (x->used > y->used) - (x->used < y->used);
+}
+
+// Entrées du cache (dossiers nommés par une clé hex de 64 caractères)
+static cache_entry_t *cache_entries(const char *dir, size_t *count, uint64_t *total) {
+    *count = 0;
+    *total = 0;
+
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+
+    size_t cap = 64;
+    cache_entry_t *list = malloc(cap * sizeof(cache_entry_t));
+    struct dirent *de;
+    while (list && (de = readdir(d))) {
+        if (strlen(de->d_name) != 64 || strspn(de->d_name, "0123456789abcdef") != 64) continue;
+
+        char path[MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+
+        if (*count == cap) {
+            cache_entry_t *p = realloc(list, cap * 2 * sizeof(cache_entry_t));
+            if (!p) break;
+            list = p;
+            cap *= 2;
+        }
+        cache_entry_t *e = &list[(*count)++];
+        snprintf(e->name, sizeof(e->name), "%s", de->d_name);
+        e->used = st.st_mtime;
+        e->size = entry_size(path);
+        *total += e->size;
+    }
+    closedir(d);
+    return list;
+}
+
+// LRU : retire les entrées les moins récemment utilisées au-delà de max_bytes
+static int cache_evict(const char *dir, uint64_t max_bytes) {
+    size_t count;
+    uint64_t total;
+    cache_entry_t *list = cache_entries(dir, &count, &total);
+    if (!list) return 0;
+
+    qsort(list, count, sizeof(cache_entry_t), compare_used);
+
+    int evicted = 0;
+    for (size_t i = 0; i < count && total > max_bytes; i++) {
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s/%s", dir, list[i].name);
+        rm_entry(path);
+        total -= list[i].size;
+        evicted++;
+    }
+    free(list);
+
+    if (evicted > 0) cache_count(dir, 0, 0, 0, evicted);
+    return evicted;
+}
+
+// Enregistre l'archive produite sous key ; écrite à part puis renommée,
+// une entrée n'est jamais visible à moitié
+int bool_cache_store(const char *key, const char *archive_path,
+                     const char *manifest, size_t manifest_len,
+                     const char *sha256, const char *blake3) {
+    char dir[MAX_PATH];
+    if (bool_cache_dir(dir, sizeof(dir)) != 0) return -1;
+
+    char tmp[MAX_PATH], entry[MAX_PATH], path[MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s/.%s.%d", dir, key, (int)getpid());
+    snprintf(entry, sizeof(entry), "%s/%s", dir, key);
+    if (mkdir(tmp, 0755) != 0) return -1;
+
+    snprintf(path, sizeof(path), "%s/%s", tmp, CACHE_ARCHIVE);
+    int ret = cache_copy(archive_path, path);
+
+    if (ret == 0) {
+        snprintf(path, sizeof(path), "%s/%s", tmp, CACHE_MANIFEST);
+        FILE *f = fopen(path, "w");
+        if (!f || fwrite(manifest, 1, manifest_len, f) != manifest_len) ret = -1;
+        if (f && fclose(f) != 0) ret = -1;
+    }
+    if (ret == 0) {
+        snprintf(path, sizeof(path), "%s/%s", tmp, CACHE_META);
+        FILE *f = fopen(path, "w");
+        if (!f || fprintf(f, "sha256 %s\nblake3 %s\n", sha256, blake3) < 0) ret = -1;
+        if (f && fclose(f) != 0) ret = -1;
+    }
+
+    // Une entrée de même clé existe déjà (build concurrent) : on garde l'ancienne
+    if (ret != 0 || rename(tmp, entry) != 0) {
+        rm_entry(tmp);
+        return ret;
+    }
+
+    cache_count(dir, 0, 0, 1, 0);
+    cache_evict(dir, cache_max_bytes());
+    return 0;
+}
+
+// ============================================================================
+// COMMANDES
+// ============================================================================
+
+int bool_cache_stats(void) {
+    char dir[MAX_PATH];
+    if (bool_cache_dir(dir, sizeof(dir)) != 0) return -1;
+
+    cache_stats_t st;
+    if (cache_stats_update(dir, NULL, &st) != 0) memset(&st, 0, sizeof(st));
+
+    size_t count;
+    uint64_t total;
+    cache_entry_t *list = cache_entries(dir, &count, &total);
+    free(list);
+
+    unsigned long long lookups = st.hits + st.misses;
+    printf("📦 Build cache: %s\n", dir);
+    printf("   Entries:   %zu\n", count);
+    printf("   Size:      %.2f MB (max %.0f MB)\n",
+           total / (1024.0 * 1024.0), cache_max_bytes() / (1024.0 * 1024.0));
+    printf("   Hits:      %llu\n", st.hits);
+    printf("   Misses:    %llu\n", st.misses);
+    if (lookups > 0) printf("   Hit rate:  %.1f%%\n", 100.0 * st.hits / lookups);
+    printf("   Stored:    %llu\n", st.stores);
+    printf("   Evicted:   %llu\n", st.evictions);
+    return 0;
+}
+
+int bool_cache_clear(void) {
+    char dir[MAX_PATH];
+    if (bool_cache_dir(dir, sizeof(dir)) != 0) return -1;
+
+    int evicted = cache_evict(dir, 0);
+    printf("🗑️  Removed %d cached builds from %s\n", evicted, dir);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "bool.h"
+
+// ============================================================================
+// FASTCDC (découpage par contenu avec hash Gear)
+// ============================================================================
+
+/*
+ * Hash Gear : h = (h << 1) + gear[octet]. Un point de coupe est posé quand
+ * les bits de poids fort sélectionnés par le masque sont à zéro. Masque
+ * "small" (plus de bits) avant la taille moyenne, masque "large" après :
+ * c'est la normalisation FastCDC qui resserre la distribution des tailles.
+ */
+#define SELP_CDC_MASK_S  (((1ULL << 15) - 1) << 49)   // 13 bits + 2
+#define SELP_CDC_MASK_L  (((1ULL << 11) - 1) << 53)   // 13 bits - 2
+
+static uint64_t gear[256];
+
+// Table Gear déterministe (splitmix64) : mêmes données => mêmes coupes
+__attribute__((constructor))
+static void init_gear_table(void) {
+    uint64_t x = 0x53454c5047454152ULL;  // "SELPGEAR"
+    for (int i = 0; i < 256; i++) {
+        x += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+// Retourne la longueur du prochain chunk. L'appelant doit fournir au moins
+// SELP_CDC_MAX_SIZE octets sauf en fin de fichier.
+size_t selp_cdc_cut(const uint8_t *data, size_t len) {
+    if (len <= SELP_CDC_MIN_SIZE) return len;
+
+    size_t normal = SELP_CDC_AVG_SIZE;
+    if (len > SELP_CDC_MAX_SIZE) len = SELP_CDC_MAX_SIZE;
+    if (normal > len) normal = len;
+
+    uint64_t h = 0;
+    size_t i = SELP_CDC_MIN_SIZE;
+
+    for (; i < normal; i++) {
+        h = (h << 1) + gear[data[i]];
+        if (!(h & SELP_CDC_MASK_S)) return i + 1;
+    }
+    for (; i < len; i++) {
+        h = (h << 1) + gear[data[i]];
+        if (!(h & SELP_CDC_MASK_L)) return i + 1;
+    }
+    return len;
+}
+
+// ============================================================================
+// INDEX DES CHUNKS (adressage ouvert, clé BLAKE3)
+// ============================================================================
+
+static size_t slot_of(const uint8_t hash[32], size_t capacity) {
+    uint64_t k;
+    memcpy(&k, hash, sizeof(k));
+    return (size_t)(k & (capacity - 1));
+}
+
+int selp_chunk_index_init(selp_chunk_index_t *idx, size_t capacity) {
+    size_t cap = 1024;
+    while (cap < capacity) cap <<= 1;
+
+    idx->slots = calloc(cap, sizeof(selp_chunk_slot_t));
+    if (!idx->slots) return SELP_ERR_MEMORY;
+    idx->capacity = cap;
+    idx->count = 0;
+    return SELP_OK;
+}
+
+int selp_chunk_index_find(const selp_chunk_index_t *idx, const uint8_t hash[32], uint32_t *block) {
+    if (!idx->slots) return 0;
+
+    size_t i = slot_of(hash, idx->capacity);
+    while (idx->slots[i].used) {
+        if (memcmp(idx->slots[i].hash, hash, 32) == 0) {
+            *block = idx->slots[i].block;
+            return 1;
+        }
+        i = (i + 1) & (idx->capacity - 1);
+    }
+    return 0;
+}
+
+static int index_grow(selp_chunk_index_t *idx) {
+    selp_chunk_index_t bigger;
+    if (selp_chunk_index_init(&bigger, idx->capacity * 2) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+
+    for (size_t i = 0; i < idx->capacity; i++) {
+        if (idx->slots[i].used) {
+            selp_chunk_index_insert(&bigger, idx->slots[i].hash, idx->slots[i].block);
+        }
+    }
+
+    free(idx->slots);
+    *idx = bigger;
+    return SELP_OK;
+}
+
+int selp_chunk_index_insert(selp_chunk_index_t *idx, const uint8_t hash[32], uint32_t block) {
+    // Charge max 70%
+    if ((idx->count + 1) * 10 > idx->capacity * 7) {
+        if (index_grow(idx) != SELP_OK) return SELP_ERR_MEMORY;
+    }
+
+    size_t i = slot_of(hash, idx->capacity);
+    while (idx->slots[i].used) {
+        i = (i + 1) & (idx->capacity - 1);
+    }
+
+    memcpy(idx->slots[i].hash, hash, 32);
+    idx->slots[i].block = block;
+    idx->slots[i].used = 1;
+    idx->count++;
+    return SELP_OK;
+}
+
+void selp_chunk_index_free(selp_chunk_index_t *idx) {
+    free(idx->slots);
+    idx->slots = NULL;
+    idx->capacity = 0;
+    idx->count = 0;
+}
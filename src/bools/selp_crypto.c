@@ -11,41 +11,143 @@ static const uint8_t SELP_SIGNATURE[32] = {
     0x6F, 0x6F, 0x6C, 0x20, 0x28, 0x63, 0x29, 0x20
 };
 
-// Chiffrement léger (XOR avec pattern)
-static void xor_encrypt(uint8_t *data, size_t len, const uint8_t *key, size_t key_len) {
-    for (size_t i = 0; i < len; i++) {
-        data[i] ^= key[i % key_len];
+// ============================================================================
+// AES-256-GCM PAR BLOC
+// ============================================================================
+
+/*
+ * Chaque bloc stocké (déjà compressé) est scellé indépendamment :
+ *   nonce = (header.nonce_prefix ^ sel) (4 octets) || index du bloc (8 octets, LE)
+ *   bloc  = chiffré || tag GCM (16 octets)
+ * La clé vient de PBKDF2-HMAC-SHA256(passphrase, header.kdf_salt) et le sel
+ * PBKDF2 est tiré à chaque archive. Le sel de nonce est propre à chaque
+ * session d'écriture (--update en tire un neuf) : un même index ne sert
+ * jamais deux fois avec la même clé, même si un --update raté est rejoué. Les blocs se déchiffrent donc dans n'importe quel ordre et
+ * en parallèle (un selp_cipher_t par thread). EVP utilise AES-NI/PCLMUL
+ * quand le CPU les a.
+ */
+
+static char selp_passphrase[256];
+
+void selp_set_passphrase(const char *passphrase) {
+    OPENSSL_cleanse(selp_passphrase, sizeof(selp_passphrase));
+    if (passphrase) {
+        strncpy(selp_passphrase, passphrase, sizeof(selp_passphrase) - 1);
     }
 }
 
-// Chiffrement AES
-static int aes_encrypt(const uint8_t *input, size_t in_len,
-                       uint8_t *output, size_t *out_len,
-                       const uint8_t *key, int bits) {
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    const EVP_CIPHER *cipher = (bits == 256) ? 
-        EVP_aes_256_cbc() : EVP_aes_128_cbc();
-    
-    uint8_t iv[16];
-    RAND_bytes(iv, sizeof(iv));
-    
-    // Copier l'IV au début
-    memcpy(output, iv, sizeof(iv));
-    *out_len = sizeof(iv);
-    
-    EVP_EncryptInit_ex(ctx, cipher, NULL, key, iv);
-    
-    int len;
-    EVP_EncryptUpdate(ctx, output + *out_len, &len, input, in_len);
-    *out_len += len;
-    
-    EVP_EncryptFinal_ex(ctx, output + *out_len, &len);
-    *out_len += len;
-    
-    EVP_CIPHER_CTX_free(ctx);
+int selp_cipher_init_key(selp_cipher_t *c, const uint8_t key[32], const uint8_t nonce_prefix[4]) {
+    memset(c, 0, sizeof(selp_cipher_t));
+
+    c->ctx = EVP_CIPHER_CTX_new();
+    if (!c->ctx) return SELP_ERR_MEMORY;
+
+    // Clé posée une fois ; seul le nonce change d'un bloc à l'autre
+    if (EVP_CipherInit_ex(c->ctx, EVP_aes_256_gcm(), NULL, NULL, NULL, 1) != 1 ||
+        EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_SET_IVLEN, 12, NULL) != 1) {
+        selp_cipher_free(c);
+        return SELP_ERR_CRYPTO;
+    }
+
+    memcpy(c->key, key, sizeof(c->key));
+    memcpy(c->nonce_prefix, nonce_prefix, sizeof(c->nonce_prefix));
     return SELP_OK;
 }
 
+// Coût PBKDF2 selon le niveau demandé
+uint32_t selp_kdf_iterations(int encryption) {
+    switch (encryption) {
+        case SELP_CRYPT_LIGHT:  return 100000;
+        case SELP_CRYPT_MEDIUM: return 300000;
+        default:                return 600000;
+    }
+}
+
+// Dérive la clé de l'archive depuis la passphrase (selp_set_passphrase)
+int selp_cipher_derive(selp_cipher_t *c, const selp_header_t *header) {
+    if (selp_passphrase[0] == '\0') return SELP_ERR_CRYPTO;
+
+    uint8_t key[32];
+    if (PKCS5_PBKDF2_HMAC(selp_passphrase, (int)strlen(selp_passphrase),
+                          header->kdf_salt, SELP_KDF_SALT_SIZE,
+                          (int)header->kdf_iterations, EVP_sha256(),
+                          sizeof(key), key) != 1) {
+        return SELP_ERR_CRYPTO;
+    }
+
+    int ret = selp_cipher_init_key(c, key, header->nonce_prefix);
+    OPENSSL_cleanse(key, sizeof(key));
+    return ret;
+}
+
+int selp_cipher_clone(selp_cipher_t *dst, const selp_cipher_t *src) {
+    return selp_cipher_init_key(dst, src->key, src->nonce_prefix);
+}
+
+static void make_nonce(const selp_cipher_t *c, uint64_t index, uint32_t salt, uint8_t nonce[12]) {
+    for (int i = 0; i < 4; i++) {
+        nonce[i] = c->nonce_prefix[i] ^ (uint8_t)(salt >> (8 * i));
+    }
+    for (int i = 0; i < 8; i++) {
+        nonce[4 + i] = (uint8_t)(index >> (8 * i));
+    }
+}
+
+// out reçoit len + SELP_GCM_TAG_SIZE octets
+int selp_cipher_seal(selp_cipher_t *c, uint64_t index, uint32_t salt,
+                     const uint8_t *in, size_t len, uint8_t *out) {
+    uint8_t nonce[12];
+    make_nonce(c, index, salt, nonce);
+
+    int n;
+    size_t done = 0;
+    if (EVP_CipherInit_ex(c->ctx, NULL, NULL, c->key, nonce, 1) != 1) return SELP_ERR_CRYPTO;
+
+    while (done < len) {
+        int chunk = (len - done) > (1u << 30) ? (1 << 30) : (int)(len - done);
+        if (EVP_CipherUpdate(c->ctx, out + done, &n, in + done, chunk) != 1) return SELP_ERR_CRYPTO;
+        done += (size_t)n;
+    }
+    if (EVP_CipherFinal_ex(c->ctx, out + done, &n) != 1) return SELP_ERR_CRYPTO;
+    if (EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_GET_TAG, SELP_GCM_TAG_SIZE, out + len) != 1) {
+        return SELP_ERR_CRYPTO;
+    }
+    return SELP_OK;
+}
+
+// in contient chiffré || tag (len octets au total) ; out reçoit len - tag
+int selp_cipher_open(selp_cipher_t *c, uint64_t index, uint32_t salt,
+                     const uint8_t *in, size_t len, uint8_t *out) {
+    if (len < SELP_GCM_TAG_SIZE) return SELP_ERR_CRYPTO;
+    size_t plain = len - SELP_GCM_TAG_SIZE;
+
+    uint8_t nonce[12];
+    make_nonce(c, index, salt, nonce);
+
+    int n;
+    size_t done = 0;
+    if (EVP_CipherInit_ex(c->ctx, NULL, NULL, c->key, nonce, 0) != 1) return SELP_ERR_CRYPTO;
+
+    while (done < plain) {
+        int chunk = (plain - done) > (1u << 30) ? (1 << 30) : (int)(plain - done);
+        if (EVP_CipherUpdate(c->ctx, out + done, &n, in + done, chunk) != 1) return SELP_ERR_CRYPTO;
+        done += (size_t)n;
+    }
+    if (EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_SET_TAG, SELP_GCM_TAG_SIZE,
+                            (void *)(in + plain)) != 1) {
+        return SELP_ERR_CRYPTO;
+    }
+    // Échec ici = mauvaise passphrase ou bloc altéré
+    if (EVP_CipherFinal_ex(c->ctx, out + done, &n) != 1) return SELP_ERR_CRYPTO;
+    return SELP_OK;
+}
+
+void selp_cipher_free(selp_cipher_t *c) {
+    if (c->ctx) EVP_CIPHER_CTX_free(c->ctx);
+    OPENSSL_cleanse(c->key, sizeof(c->key));
+    c->ctx = NULL;
+}
+
 // Générer la signature SELP
 void selp_generate_signature(uint32_t signature[8], const uint8_t *data, size_t len) {
     SHA256_CTX sha256;
@@ -8,244 +8,369 @@
 #include <sys/time.h>  
 
 
-// Structure pour parcourir les dossiers
-typedef struct {
-    char path[MAX_PATH];
-    struct stat st;
-} file_info_t;
-
-// Fonction récursive pour parcourir un dossier
-static int scan_directory(const char *dir, file_info_t **files, 
-                          int *count, int follow_links) {
-    DIR *dp = opendir(dir);
-    if (!dp) return SELP_ERR_OPEN;
-    
-    struct dirent *entry;
-    while ((entry = readdir(dp)) != NULL && *count < MAX_FILES) {
-        // Ignorer . et ..
-        if (strcmp(entry->d_name, ".") == 0 || 
-            strcmp(entry->d_name, "..") == 0) continue;
-        
-        char full_path[MAX_PATH];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir, entry->d_name);
-        
-        struct stat st;
-        int stat_result = follow_links ? stat(full_path, &st) : lstat(full_path, &st);
-        
-        if (stat_result == 0) {
-            if (S_ISDIR(st.st_mode)) {
-                // Scanner récursivement le sous-dossier
-                scan_directory(full_path, files, count, follow_links);
-            } else if (S_ISREG(st.st_mode)) {
-                // Ajouter le fichier à la liste
-                file_info_t *fi = malloc(sizeof(file_info_t));
-                if (fi) {
-                    strcpy(fi->path, full_path);
-                    fi->st = st;
-                    files[*count] = fi;
-                    (*count)++;
-                    
-                    if (follow_links) {
-                        printf("📄 Added: %s (%ld bytes)\n", full_path, st.st_size);
-                    } else {
-                        printf("📄 Added: %s (%ld bytes) [no follow]\n", full_path, st.st_size);
-                    }
-                }
-            }
-        }
-    }
-    
-    closedir(dp);
-    return SELP_OK;
-}
-
 // Fonction principale de compression de dossier
 int selp_compress_directory(const char *dir, const char *output,
                            int level, int crypt, const char *author,
                            const char *comment, int follow_links) {
+    return selp_compress_directory_ex(dir, output, level, crypt, author, comment,
+                                      follow_links ? SELP_FLAG_FOLLOW_LINKS : 0);
+}
+
+int selp_compress_directory_ex(const char *dir, const char *output,
+                               int level, int crypt, const char *author,
+                               const char *comment, int flags) {
     printf("📁 Scanning directory: %s\n", dir);
     
-    // Scanner le dossier
-    file_info_t *files[MAX_FILES];
-    int file_count = 0;
-    
-    int result = scan_directory(dir, files, &file_count, follow_links);
-    if (result != SELP_OK || file_count == 0) {
+    // Scanner le dossier (parallèle, sans limite de nombre de fichiers)
+    selp_file_list_t list;
+    int result = selp_scan_tree(dir, flags & SELP_FLAG_FOLLOW_LINKS, 0, &list);
+    if (result == SELP_ERR_MEMORY) {
+        printf("❌ Out of memory while scanning directory\n");
+        return result;
+    }
+    if (result == SELP_ERR_READ) {
+        printf("❌ Some paths cannot be archived, nothing written\n");
+        return result;
+    }
+    if (result != SELP_OK || list.count == 0) {
         printf("❌ No files found in directory\n");
+        selp_file_list_free(&list);
         return SELP_ERR_NOT_FOUND;
     }
     
-    printf("✅ Found %d files\n", file_count);
+    selp_scan_entry_t *files = list.entries;
+    size_t file_count = list.count;
+    printf("✅ Found %zu files\n", file_count);
     
     // Calculer la taille totale
     uint64_t total_size = 0;
-    for (int i = 0; i < file_count; i++) {
-        total_size += files[i]->st.st_size;
+    for (size_t i = 0; i < file_count; i++) {
+        total_size += files[i].st.st_size;
     }
     
     printf("📊 Total size: %.2f KB\n", total_size / 1024.0);
     
     // Créer l'en-tête
     selp_header_t header;
-    memcpy(header.magic, SELP_MAGIC, 4);
-    header.version = SELP_VERSION;
+    memset(&header, 0, sizeof(header));
     header.compression = level;
     header.encryption = crypt;
-    header.flags = follow_links ? 0x01 : 0x00;
-    header.original_size = total_size;
-    header.compressed_size = 0;
-    header.file_count = file_count;
+    header.flags = flags & ~SELP_FLAG_NO_DICT;
     header.timestamp = time(NULL);
     strncpy(header.author, author ? author : "Unknown", MAX_AUTHOR - 1);
     strncpy(header.comment, comment ? comment : "BOOL SELP Archive", MAX_COMMENT - 1);
     
-    // Ouvrir le fichier de sortie
-    FILE *out = fopen(output, "wb");
-    if (!out) {
+    selp_writer_t writer;
+    result = selp_writer_open(&writer, output, &header);
+    if (result != SELP_OK) {
         printf("❌ Cannot create output file\n");
-        return SELP_ERR_OPEN;
+        selp_file_list_free(&list);
+        return result;
     }
     
-    // Écrire l'en-tête (à mettre à jour plus tard)
-    fwrite(&header, sizeof(selp_header_t), 1, out);
-    
-    // Table des offsets pour les entrées
-    uint64_t *offsets = malloc(file_count * sizeof(uint64_t));
-    
-    // Écrire les entrées de fichiers
-    for (int i = 0; i < file_count; i++) {
-        selp_file_entry_t entry;
-        memset(&entry, 0, sizeof(entry));
-        
-        strncpy(entry.path, files[i]->path, MAX_PATH - 1);
+    // Dictionnaire zstd entraîné sur les petits fichiers
+    if (level != SELP_COMPRESS_NONE && !(flags & SELP_FLAG_NO_DICT)) {
+        const char **small = malloc(file_count * sizeof(char *));
+        uint8_t *dict = malloc(SELP_DICT_MAX_SIZE);
+        size_t small_count = 0;
         
-        // Extraire le nom du fichier
-        char *base = strrchr(files[i]->path, '/');
-        if (base) base++; else base = files[i]->path;
-        strncpy(entry.name, base, sizeof(entry.name) - 1);
+        if (small && dict) {
+            for (size_t i = 0; i < file_count; i++) {
+                if (files[i].st.st_size > 0 && files[i].st.st_size <= SELP_DICT_FILE_MAX) {
+                    small[small_count++] = files[i].path;
+                }
+            }
+            
+            size_t dict_size = selp_dict_train(small, small_count, dict, SELP_DICT_MAX_SIZE);
+            if (dict_size > 0) {
+                printf("📚 Dictionary: %.2f KB trained on %zu small files\n",
+                       dict_size / 1024.0, small_count);
+                result = selp_writer_set_dict(&writer, dict, dict_size);
+            }
+        }
         
-        entry.size = files[i]->st.st_size;
-        entry.permissions = files[i]->st.st_mode;
-        entry.mtime = files[i]->st.st_mtime;
-        entry.offset = ftell(out) + sizeof(selp_file_entry_t) * (file_count - i - 1);
-        offsets[i] = entry.offset;
+        free(small);
+        free(dict);
         
-        fwrite(&entry, sizeof(selp_file_entry_t), 1, out);
+        if (result != SELP_OK) {
+            selp_file_list_free(&list);
+            selp_writer_abort(&writer);
+            unlink(output);
+            return result;
+        }
     }
     
-    // Écrire les données des fichiers
-    for (int i = 0; i < file_count; i++) {
-        FILE *in = fopen(files[i]->path, "rb");
-        if (!in) continue;
+    for (size_t i = 0; i < file_count; i++) {
+        // Chemins stockés relativement au dossier source
+        const char *stored = selp_relative_path(dir, files[i].path);
         
-        printf("📦 Writing: %s\n", files[i]->path);
+        printf("📦 Writing: %s\n", files[i].path);
         
-        uint8_t buffer[8192];
-        size_t bytes;
-        while ((bytes = fread(buffer, 1, sizeof(buffer), in)) > 0) {
-            fwrite(buffer, 1, bytes, out);
+        result = selp_writer_add_file(&writer, files[i].path, stored, &files[i].st);
+        if (result == SELP_ERR_OPEN) {
+            printf("⚠️  Skipped (cannot open): %s\n", files[i].path);
+            result = SELP_OK;
         }
-        fclose(in);
         
-        free(files[i]);
+        if (result != SELP_OK) {
+            selp_file_list_free(&list);
+            selp_writer_abort(&writer);
+            unlink(output);
+            printf("❌ Write error\n");
+            return result;
+        }
     }
     
-    // Mettre à jour l'en-tête avec la taille compressée
-    header.compressed_size = ftell(out) - sizeof(selp_header_t);
-    fseek(out, 0, SEEK_SET);
-    fwrite(&header, sizeof(selp_header_t), 1, out);
+    uint64_t dedup_hits = writer.dedup_hits;
+    uint64_t dedup_saved = writer.dedup_saved;
+    uint64_t sparse_saved = writer.sparse_saved;
+    uint64_t hardlinks = writer.hardlinks;
+    uint64_t block_count = writer.header.block_count;
+    selp_file_list_free(&list);
     
-    fclose(out);
-    free(offsets);
+    result = selp_writer_close(&writer);
+    if (result != SELP_OK) {
+        unlink(output);
+        printf("❌ Write error\n");
+        return result;
+    }
+    
+    struct stat out_st;
+    uint64_t out_size = stat(output, &out_st) == 0 ? (uint64_t)out_st.st_size : 0;
     
     printf("\n✅ Directory compressed successfully!\n");
-    printf("   Input:  %s (%d files, %.2f KB)\n", dir, file_count, total_size / 1024.0);
-    printf("   Output: %s (%.2f KB)\n", output, header.compressed_size / 1024.0);
-    printf("   Ratio:  %.1f%%\n", 100.0 * header.compressed_size / total_size);
+    printf("   Input:  %s (%zu files, %.2f KB)\n", dir, file_count, total_size / 1024.0);
+    printf("   Output: %s (%.2f KB)\n", output, out_size / 1024.0);
+    if (flags & SELP_FLAG_DEDUP) {
+        printf("   Dedup:  %llu chunks stored, %llu reused (%.2f KB saved)\n",
+               (unsigned long long)block_count, (unsigned long long)dedup_hits,
+               dedup_saved / 1024.0);
+    }
+    if (sparse_saved > 0) {
+        printf("   Sparse: %.2f KB of holes not read\n", sparse_saved / 1024.0);
+    }
+    if (hardlinks > 0) {
+        printf("   Links:  %llu hardlinks stored once\n", (unsigned long long)hardlinks);
+    }
+    if (total_size > 0) {
+        printf("   Ratio:  %.1f%%\n", 100.0 * out_size / total_size);
+    }
     
     return SELP_OK;
 }
 
+// Crée récursivement les dossiers parents de path
+static void mkdir_parents(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);
+            *p = '/';
+        }
+    }
+}
+
+// Rejette les chemins qui sortiraient du dossier d'extraction
+static int path_is_safe(const char *path) {
+    if (strcmp(path, "..") == 0 || strncmp(path, "../", 3) == 0) return 0;
+    if (strstr(path, "/../") != NULL) return 0;
+    size_t len = strlen(path);
+    if (len >= 3 && strcmp(path + len - 3, "/..") == 0) return 0;
+    return 1;
+}
+
+// Écriture + CRC32C/BLAKE3 en un seul passage
+typedef struct {
+    int out;
+    uint32_t crc;
+    blake3_hasher hasher;
+    int sparse;                  // Au moins un trou : taille fixée par ftruncate
+} extract_sink_t;
+
+static int sink_extract(void *ctx, const uint8_t *data, size_t len) {
+    extract_sink_t *s = ctx;
+    
+    // Trou : on avance sans écrire, le fichier reste creux
+    if (!data) {
+        selp_sum_hole(&s->crc, &s->hasher, len);
+        s->sparse = 1;
+        return lseek(s->out, (off_t)len, SEEK_CUR) >= 0 ? SELP_OK : SELP_ERR_WRITE;
+    }
+    
+    s->crc = selp_crc32c(s->crc, data, len);
+    blake3_hasher_update(&s->hasher, data, len);
+    
+    while (len > 0) {
+        ssize_t n = write(s->out, data, len);
+        if (n <= 0) return SELP_ERR_WRITE;
+        data += n;
+        len -= (size_t)n;
+    }
+    return SELP_OK;
+}
+
+// Bloc brut d'une archive mappée : copie dans le noyau (copy_file_range),
+// sommes calculées directement sur le mapping, sans tampon intermédiaire
+static int extract_raw(selp_toc_t *toc, int in_fd, const selp_block_t *b, extract_sink_t *s) {
+    int ret = selp_block_copy_fd(toc, in_fd, b, s->out);
+    if (ret != SELP_OK) return ret;
+    if (!selp_map_covers(toc->map, toc->map_size, b->offset, b->size)) return SELP_ERR_READ;
+    
+    const uint8_t *data = toc->map + b->offset;
+    s->crc = selp_crc32c(s->crc, data, (size_t)b->size);
+    blake3_hasher_update(&s->hasher, data, (size_t)b->size);
+    return SELP_OK;
+}
+
 // Fonction d'extraction avec reconstruction de l'arborescence
 int selp_extract(const char *archive, const char *output_dir) {
+    return selp_extract_ex(archive, output_dir, 0);
+}
+
+int selp_extract_ex(const char *archive, const char *output_dir, int options) {
     printf("📂 Extracting: %s\n", archive);
     
     FILE *in = fopen(archive, "rb");
     if (!in) return SELP_ERR_OPEN;
     
-    // Lire l'en-tête
-    selp_header_t header;
-    if (fread(&header, sizeof(selp_header_t), 1, in) != 1) {
+    selp_toc_t toc;
+    int result = selp_toc_load(in, &toc);
+    if (result != SELP_OK) {
         fclose(in);
-        return SELP_ERR_READ;
+        return result;
     }
     
-    // Vérifier le magic
-    if (memcmp(header.magic, SELP_MAGIC, 4) != 0) {
-        fclose(in);
-        return SELP_ERR_MAGIC;
-    }
+    printf("📦 Archive contains %llu files\n", (unsigned long long)toc.header.file_count);
     
-    printf("📦 Archive contains %llu files\n", (unsigned long long)header.file_count);
+    // Lecture sans copie si possible, stdio sinon
+    selp_toc_map(&toc, in);
+    int in_fd = fileno(in);
     
-    // Lire les entrées
-    selp_file_entry_t *entries = malloc(header.file_count * sizeof(selp_file_entry_t));
-    fread(entries, sizeof(selp_file_entry_t), header.file_count, in);
+    int check = (toc.header.flags & SELP_FLAG_ENTRY_SUMS) != 0;
+    int salvage = (options & SELP_EXTRACT_SALVAGE) != 0;
     
     // Créer le dossier de sortie
     mkdir(output_dir, 0755);
     
+    uint64_t extracted = 0;
+    uint64_t corrupted = 0;
+    
     // Extraire chaque fichier
-    for (uint64_t i = 0; i < header.file_count; i++) {
+    for (uint64_t i = 0; i < toc.header.file_count; i++) {
+        selp_file_entry_t *e = &toc.entries[i];
+        
         // Construire le chemin de sortie
         char out_path[MAX_PATH];
-        const char *relative = entries[i].path;
+        const char *relative = e->path;
         
         // Enlever le chemin absolu si présent
-        if (relative[0] == '/') relative++;
+        while (relative[0] == '/') relative++;
+        
+        if (!path_is_safe(relative)) {
+            printf("⚠️  Skipped unsafe path: %s\n", e->path);
+            continue;
+        }
         
         snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, relative);
         
         // Créer les sous-dossiers nécessaires
-        char *last_slash = strrchr(out_path, '/');
-        if (last_slash) {
-            *last_slash = '\0';
-            mkdir(out_path, 0755);
-            *last_slash = '/';
-        }
+        mkdir_parents(out_path);
         
         printf("📄 Extracting: %s\n", relative);
         
-        // Lire les données
-        uint8_t *data = malloc(entries[i].size);
-        fread(data, 1, entries[i].size, in);
-        
-        // Écrire le fichier
-        FILE *out = fopen(out_path, "wb");
-        if (out) {
-            fwrite(data, 1, entries[i].size, out);
-            fclose(out);
+        // Lien dur : nouveau nom pour le fichier déjà extrait. Si link()
+        // échoue (cible ignorée, autre système de fichiers), on extrait
+        // les données partagées comme pour un fichier normal.
+        if (e->type == SELP_ENTRY_HARDLINK && e->link < i) {
+            const char *target = toc.entries[e->link].path;
+            while (target[0] == '/') target++;
             
-            // Restaurer les permissions
-            chmod(out_path, entries[i].permissions);
-            
-            // Restaurer le timestamp
-            struct timespec times[2] = {
-                {.tv_sec = entries[i].mtime, .tv_nsec = 0},
-                {.tv_sec = entries[i].mtime, .tv_nsec = 0}
-            };
-            utimensat(AT_FDCWD, out_path, times, 0);
+            char target_path[MAX_PATH];
+            snprintf(target_path, sizeof(target_path), "%s/%s", output_dir, target);
+            unlink(out_path);
+            if (path_is_safe(target) && link(target_path, out_path) == 0) {
+                extracted++;
+                continue;
+            }
+        }
+        
+        extract_sink_t sink;
+        sink.out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (sink.out < 0) {
+            printf("❌ Cannot create: %s\n", out_path);
+            result = SELP_ERR_OPEN;
+            break;
+        }
+        sink.crc = 0;
+        sink.sparse = 0;
+        blake3_hasher_init(&sink.hasher);
+        
+        // Recomposer le fichier à partir de ses blocs
+        for (uint32_t r = 0; r < e->block_count && result == SELP_OK; r++) {
+            const selp_block_t *b = &toc.blocks[toc.refs[e->block_first + r]];
+            if (toc.map && !(b->flags & (SELP_BLOCK_ZSTD | SELP_BLOCK_AES | SELP_BLOCK_HOLE))) {
+                result = extract_raw(&toc, in_fd, b, &sink);
+            } else {
+                result = selp_block_read(in, &toc, b, sink_extract, &sink);
+            }
+        }
+        // Un trou final n'a rien écrit : ftruncate donne la taille réelle
+        if (result == SELP_OK && sink.sparse && ftruncate(sink.out, (off_t)e->size) != 0) {
+            result = SELP_ERR_WRITE;
+        }
+        if (close(sink.out) != 0 && result == SELP_OK) result = SELP_ERR_WRITE;
+        
+        if (result == SELP_OK && check) {
+            uint8_t hash[BLAKE3_OUT_LEN];
+            blake3_hasher_finalize(&sink.hasher, hash, BLAKE3_OUT_LEN);
+            if (sink.crc != e->crc32 || memcmp(hash, e->hash, sizeof(e->hash)) != 0) {
+                result = SELP_ERR_CHECKSUM;
+            }
+        }
+        
+        // Données corrompues : en mode salvage on saute le fichier
+        if (result == SELP_ERR_CHECKSUM || result == SELP_ERR_DECOMPRESS ||
+            result == SELP_ERR_CRYPTO || result == SELP_ERR_READ) {
+            unlink(out_path);
+            printf("❌ Corrupted: %s\n", relative);
+            corrupted++;
+            if (salvage) {
+                result = SELP_OK;
+                continue;
+            }
+        }
+        
+        if (result != SELP_OK) {
+            printf("❌ Cannot extract: %s\n", relative);
+            break;
         }
         
-        free(data);
+        // Restaurer les permissions
+        chmod(out_path, e->permissions & 07777);
+        
+        // Restaurer le timestamp
+        struct timespec times[2] = {
+            {.tv_sec = e->mtime, .tv_nsec = 0},
+            {.tv_sec = e->mtime, .tv_nsec = 0}
+        };
+        utimensat(AT_FDCWD, out_path, times, 0);
+        extracted++;
     }
     
     fclose(in);
-    free(entries);
+    selp_toc_free(&toc);
+    
+    if (result != SELP_OK) return result;
+    
+    if (corrupted > 0) {
+        printf("\n⚠️  Partial extraction: %llu files extracted, %llu corrupted skipped\n",
+               (unsigned long long)extracted, (unsigned long long)corrupted);
+        return SELP_ERR_CHECKSUM;
+    }
     
     printf("\n✅ Extraction complete!\n");
     printf("   %llu files extracted to %s\n", 
-           (unsigned long long)header.file_count, output_dir);
+           (unsigned long long)extracted, output_dir);
     
     return SELP_OK;
 }
@@ -0,0 +1,523 @@
+#include "bool.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+// ============================================================================
+// EN-TÊTE
+// ============================================================================
+
+// Lit l'en-tête v1, v2 ou v3. header_size reçoit la taille réelle sur disque.
+int selp_read_header(FILE *fp, selp_header_t *header, size_t *header_size) {
+    memset(header, 0, sizeof(selp_header_t));
+
+    if (fread(header, SELP_HEADER_V1_SIZE, 1, fp) != 1) {
+        return SELP_ERR_READ;
+    }
+
+    if (memcmp(header->magic, SELP_MAGIC, 4) != 0) {
+        return SELP_ERR_MAGIC;
+    }
+
+    if (header->version > SELP_VERSION) {
+        return SELP_ERR_VERSION;
+    }
+
+    size_t size = SELP_HEADER_V1_SIZE;
+    if (header->version >= 2) {
+        size = header->version == 2 ? SELP_HEADER_V2_SIZE : sizeof(selp_header_t);
+        size_t rest = size - SELP_HEADER_V1_SIZE;
+        if (fread((uint8_t *)header + SELP_HEADER_V1_SIZE, rest, 1, fp) != 1) {
+            return SELP_ERR_READ;
+        }
+    }
+
+    if (header_size) *header_size = size;
+    return SELP_OK;
+}
+
+// Condensat SHA-256 -> header.signature (mots big-endian)
+void selp_signature_from_hash(const uint8_t hash[32], uint32_t signature[8]) {
+    for (int i = 0; i < 8; i++) {
+        signature[i] = ((uint32_t)hash[i*4] << 24) | ((uint32_t)hash[i*4+1] << 16) |
+                       ((uint32_t)hash[i*4+2] << 8) | hash[i*4+3];
+    }
+}
+
+// ============================================================================
+// TABLE DES MATIÈRES
+// ============================================================================
+
+// Compteurs lus dans le fichier : indexés en uint32_t dans la TOC, et
+// count * size doit tenir dans un size_t
+static int toc_count_ok(uint64_t count, size_t size) {
+    return count <= UINT32_MAX && count <= (SIZE_MAX - 1) / size;
+}
+
+static uint64_t toc_file_size(FILE *fp) {
+    struct stat st;
+    return fstat(fileno(fp), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+// Archives v1 : entrées après l'en-tête, données concaténées ensuite.
+// On synthétise un bloc par fichier pour exposer la même vue que la v2.
+static int toc_load_v1(FILE *fp, selp_toc_t *toc) {
+    uint64_t n = toc->header.file_count;
+
+    // Toutes les entrées doivent tenir dans le fichier
+    if (!toc_count_ok(n, sizeof(selp_file_entry_v1_t)) ||
+        n * sizeof(selp_file_entry_v1_t) > toc_file_size(fp)) {
+        return SELP_ERR_READ;
+    }
+
+    selp_file_entry_v1_t *raw = malloc(n * sizeof(selp_file_entry_v1_t) + 1);
+    toc->entries = calloc(n + 1, sizeof(selp_file_entry_t));
+    toc->blocks = calloc(n + 1, sizeof(selp_block_t));
+    toc->refs = calloc(n + 1, sizeof(uint32_t));
+    if (!raw || !toc->entries || !toc->blocks || !toc->refs) {
+        free(raw);
+        return SELP_ERR_MEMORY;
+    }
+
+    if (n > 0 && fread(raw, sizeof(selp_file_entry_v1_t), n, fp) != n) {
+        free(raw);
+        return SELP_ERR_READ;
+    }
+
+    uint64_t data_pos = toc->header_size + n * sizeof(selp_file_entry_v1_t);
+    for (uint64_t i = 0; i < n; i++) {
+        selp_file_entry_t *e = &toc->entries[i];
+        memcpy(e->path, raw[i].path, sizeof(e->path));
+        memcpy(e->name, raw[i].name, sizeof(e->name));
+        e->size = raw[i].size;
+        e->crc32 = raw[i].crc32;
+        memcpy(e->hash, raw[i].hash, sizeof(e->hash));
+        e->permissions = raw[i].permissions;
+        e->mtime = raw[i].mtime;
+        e->offset = data_pos;
+        e->block_first = (uint32_t)i;
+        e->block_count = 1;
+
+        toc->blocks[i].offset = data_pos;
+        toc->blocks[i].size = raw[i].size;
+        toc->blocks[i].stored_size = raw[i].size;
+        toc->refs[i] = (uint32_t)i;
+
+        data_pos += raw[i].size;
+    }
+
+    toc->header.block_count = n;
+    toc->header.ref_count = n;
+    free(raw);
+    return SELP_OK;
+}
+
+static int toc_load_v2(FILE *fp, selp_toc_t *toc) {
+    selp_header_t *h = &toc->header;
+
+    // v2 : entrées sans type ni link, converties plus bas
+    size_t entry_size = h->version == 2 ? sizeof(selp_file_entry_v2_t) : sizeof(selp_file_entry_t);
+    if (!toc_count_ok(h->file_count, entry_size) ||
+        !toc_count_ok(h->block_count, sizeof(selp_block_t)) ||
+        !toc_count_ok(h->ref_count, sizeof(uint32_t))) {
+        return SELP_ERR_READ;
+    }
+
+    size_t entries_size = h->file_count * entry_size;
+    size_t blocks_size = h->block_count * sizeof(selp_block_t);
+    size_t refs_size = h->ref_count * sizeof(uint32_t);
+    if (blocks_size > SIZE_MAX - 1 - entries_size ||
+        refs_size > SIZE_MAX - 1 - entries_size - blocks_size) {
+        return SELP_ERR_READ;
+    }
+    size_t raw_size = entries_size + blocks_size + refs_size;
+
+    // v2 : TOC brute, sa taille découle des compteurs
+    if (h->version == 2) h->toc_size = raw_size;
+
+    uint64_t file_size = toc_file_size(fp);
+    if (h->toc_offset > file_size || h->toc_size > file_size - h->toc_offset) {
+        return SELP_ERR_READ;
+    }
+
+    toc->entries = calloc(h->file_count + 1, sizeof(selp_file_entry_t));
+    toc->blocks = calloc(h->block_count + 1, sizeof(selp_block_t));
+    toc->refs = calloc(h->ref_count + 1, sizeof(uint32_t));
+    if (!toc->entries || !toc->blocks || !toc->refs) return SELP_ERR_MEMORY;
+
+    if (fseeko(fp, (off_t)h->toc_offset, SEEK_SET) != 0) return SELP_ERR_READ;
+
+    size_t stored = (size_t)h->toc_size;
+    int ret = SELP_OK;
+
+    // TOC lue d'un seul tenant : [chiffrée GCM] puis [compressée zstd]
+    uint8_t *packed = malloc(stored + 1);
+    uint8_t *plain = NULL;
+    uint8_t *raw = NULL;
+
+    if (!packed) {
+        ret = SELP_ERR_MEMORY;
+    } else if (fread(packed, 1, stored, fp) != stored) {
+        ret = SELP_ERR_READ;
+    }
+
+    const uint8_t *data = packed;
+    if (ret == SELP_OK && toc->cipher) {
+        if (stored < SELP_GCM_TAG_SIZE || !(plain = malloc(stored))) {
+            ret = stored < SELP_GCM_TAG_SIZE ? SELP_ERR_READ : SELP_ERR_MEMORY;
+        } else if (selp_cipher_open(toc->cipher, SELP_NONCE_TOC | h->toc_offset, h->nonce_salt, packed, stored, plain) != SELP_OK) {
+            ret = SELP_ERR_CRYPTO;
+        } else {
+            data = plain;
+            stored -= SELP_GCM_TAG_SIZE;
+        }
+    }
+
+    if (ret == SELP_OK && h->version >= 3 && (h->flags & SELP_FLAG_TOC_ZSTD)) {
+        // Taille annoncée par la trame avant d'allouer pour les compteurs
+        if (ZSTD_getFrameContentSize(data, stored) != raw_size) {
+            ret = SELP_ERR_DECOMPRESS;
+        } else if (!(raw = malloc(raw_size + 1))) {
+            ret = SELP_ERR_MEMORY;
+        } else {
+            size_t n = ZSTD_decompress(raw, raw_size, data, stored);
+            if (ZSTD_isError(n) || n != raw_size) ret = SELP_ERR_DECOMPRESS;
+            data = raw;
+        }
+    } else if (ret == SELP_OK && stored != raw_size) {
+        ret = SELP_ERR_READ;
+    }
+
+    if (ret == SELP_OK && h->version == 2) {
+        for (uint64_t i = 0; i < h->file_count; i++) {
+            memcpy(&toc->entries[i], data + i * entry_size, entry_size);
+        }
+    } else if (ret == SELP_OK) {
+        memcpy(toc->entries, data, entries_size);
+    }
+    if (ret == SELP_OK) {
+        memcpy(toc->blocks, data + entries_size, blocks_size);
+        memcpy(toc->refs, data + entries_size + blocks_size, refs_size);
+    }
+
+    free(packed);
+    free(plain);
+    free(raw);
+    if (ret != SELP_OK) return ret;
+
+    // Contrôle de cohérence des références
+    for (uint64_t i = 0; i < h->file_count; i++) {
+        selp_file_entry_t *e = &toc->entries[i];
+        if ((uint64_t)e->block_first + e->block_count > h->ref_count) return SELP_ERR_READ;
+        if (e->type == SELP_ENTRY_HARDLINK && e->link >= i) return SELP_ERR_READ;
+        e->path[MAX_PATH - 1] = '\0';
+        e->name[sizeof(e->name) - 1] = '\0';
+    }
+    for (uint64_t i = 0; i < h->ref_count; i++) {
+        if (toc->refs[i] >= h->block_count) return SELP_ERR_READ;
+    }
+
+    return SELP_OK;
+}
+
+int selp_toc_load(FILE *fp, selp_toc_t *toc) {
+    memset(toc, 0, sizeof(selp_toc_t));
+
+    int ret = selp_read_header(fp, &toc->header, &toc->header_size);
+    if (ret != SELP_OK) return ret;
+
+    // Archive chiffrée (v3) : la clé est nécessaire dès la TOC
+    if (toc->header.version >= 3 && toc->header.encryption != SELP_CRYPT_NONE) {
+        toc->cipher = malloc(sizeof(selp_cipher_t));
+        if (!toc->cipher) return SELP_ERR_MEMORY;
+        if (selp_cipher_derive(toc->cipher, &toc->header) != SELP_OK) {
+            free(toc->cipher);
+            toc->cipher = NULL;
+            return SELP_ERR_CRYPTO;
+        }
+    }
+
+    if (toc->header.version >= 2) {
+        ret = toc_load_v2(fp, toc);
+    } else {
+        ret = toc_load_v1(fp, toc);
+    }
+
+    // Dictionnaire zstd embarqué
+    if (ret == SELP_OK && toc->header.dict_size > 0) {
+        size_t size = (size_t)toc->header.dict_size;
+        size_t stored = size + (toc->cipher ? SELP_GCM_TAG_SIZE : 0);
+
+        if (size > SELP_DICT_MAX_SIZE) {
+            ret = SELP_ERR_READ;
+        } else if (!(toc->dict = malloc(stored))) {
+            ret = SELP_ERR_MEMORY;
+        } else if (fseeko(fp, (off_t)toc->header.dict_offset, SEEK_SET) != 0 ||
+                   fread(toc->dict, 1, stored, fp) != stored) {
+            ret = SELP_ERR_READ;
+        } else if (toc->cipher) {
+            uint8_t *plain = malloc(size + 1);
+            if (!plain) {
+                ret = SELP_ERR_MEMORY;
+            } else if (selp_cipher_open(toc->cipher, SELP_NONCE_DICT, 0, toc->dict, stored, plain) != SELP_OK) {
+                free(plain);
+                ret = SELP_ERR_CRYPTO;
+            } else {
+                free(toc->dict);
+                toc->dict = plain;
+            }
+        }
+    }
+
+    if (ret != SELP_OK) selp_toc_free(toc);
+    return ret;
+}
+
+// Copie superficielle pour un thread : tables partagées en lecture,
+// contextes zstd/AES propres. À libérer avec selp_toc_release_codec().
+int selp_toc_fork_codec(const selp_toc_t *src, selp_toc_t *dst) {
+    *dst = *src;
+    dst->dctx = NULL;
+    dst->ddict = NULL;
+    dst->zbuf = NULL;
+    dst->zbuf_cap = 0;
+    dst->cipher = NULL;
+
+    if (src->cipher) {
+        dst->cipher = malloc(sizeof(selp_cipher_t));
+        if (!dst->cipher) return SELP_ERR_MEMORY;
+        if (selp_cipher_clone(dst->cipher, src->cipher) != SELP_OK) {
+            free(dst->cipher);
+            dst->cipher = NULL;
+            return SELP_ERR_CRYPTO;
+        }
+    }
+    return SELP_OK;
+}
+
+// Libère l'état de décompression/déchiffrement seul
+void selp_toc_release_codec(selp_toc_t *toc) {
+    free(toc->zbuf);
+    ZSTD_freeDDict(toc->ddict);
+    ZSTD_freeDCtx(toc->dctx);
+    if (toc->cipher) {
+        selp_cipher_free(toc->cipher);
+        free(toc->cipher);
+    }
+    toc->zbuf = NULL;
+    toc->ddict = NULL;
+    toc->dctx = NULL;
+    toc->cipher = NULL;
+    toc->zbuf_cap = 0;
+}
+
+void selp_toc_free(selp_toc_t *toc) {
+    if (toc->map) selp_unmap_file(toc->map, toc->map_size);
+    toc->map = NULL;
+    toc->map_size = 0;
+    free(toc->entries);
+    free(toc->blocks);
+    free(toc->refs);
+    free(toc->dict);
+    selp_toc_release_codec(toc);
+    toc->entries = NULL;
+    toc->blocks = NULL;
+    toc->refs = NULL;
+    toc->dict = NULL;
+}
+
+// ============================================================================
+// COPIE D'UNE PLAGE DE L'ARCHIVE
+// ============================================================================
+
+int selp_copy_range(FILE *in, uint64_t offset, uint64_t len, FILE *out) {
+    if (fseeko(in, (off_t)offset, SEEK_SET) != 0) return SELP_ERR_READ;
+
+    uint8_t buffer[65536];
+    while (len > 0) {
+        size_t want = len < sizeof(buffer) ? (size_t)len : sizeof(buffer);
+        size_t got = fread(buffer, 1, want, in);
+        if (got == 0) return SELP_ERR_READ;
+        if (fwrite(buffer, 1, got, out) != got) return SELP_ERR_WRITE;
+        len -= got;
+    }
+    return SELP_OK;
+}
+
+// ============================================================================
+// ARCHIVE MAPPÉE
+// ============================================================================
+
+/*
+ * Lecture sans copie : l'archive est mappée en lecture seule et les blocs
+ * bruts sont passés tels quels aux sinks (hachage direct depuis le page
+ * cache). Les blocs compressés ou chiffrés sont décodés depuis le mapping
+ * sans passer par fread. NULL si mmap échoue : on reste sur stdio.
+ *
+ * La taille est figée au mmap : selp_map_covers() ne fait que comparer à
+ * map_size, sans appel système. Le mapping suppose que le fichier ne
+ * rétrécit pas pendant la lecture ; bool ne le fait jamais à une archive
+ * ouverte (--update ajoute puis ne tronque que ce qu'il a ajouté,
+ * --compact remplace par rename). Une troncature par un autre processus
+ * lève SIGBUS, comme pour tout lecteur mmap.
+ */
+const uint8_t *selp_map_file(int fd, size_t *size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) return NULL;
+    if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX) return NULL;
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return NULL;
+
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *size = (size_t)st.st_size;
+    return map;
+}
+
+void selp_unmap_file(const uint8_t *map, size_t size) {
+    munmap((void *)map, size);
+}
+
+// [offset, offset + len) est dans le mapping
+int selp_map_covers(const uint8_t *map, size_t map_size, uint64_t offset, uint64_t len) {
+    return map && offset <= map_size && len <= map_size - offset;
+}
+
+// Mappe l'archive d'une TOC chargée ; le mapping survit à fclose(fp)
+int selp_toc_map(selp_toc_t *toc, FILE *fp) {
+    if (toc->map) return SELP_OK;
+    toc->map = selp_map_file(fileno(fp), &toc->map_size);
+    return toc->map ? SELP_OK : SELP_ERR_READ;
+}
+
+static int block_in_map(const selp_toc_t *toc, const selp_block_t *block, uint64_t len) {
+    return selp_map_covers(toc->map, toc->map_size, block->offset, len);
+}
+
+// Bloc brut vers un fd : copy_file_range dans le noyau, sinon write()
+// depuis le mapping. Pas de tampon intermédiaire dans les deux cas.
+int selp_block_copy_fd(selp_toc_t *toc, int in_fd, const selp_block_t *block, int out_fd) {
+    if (block->flags & (SELP_BLOCK_ZSTD | SELP_BLOCK_AES | SELP_BLOCK_HOLE)) return SELP_ERR_READ;
+    if (!block_in_map(toc, block, block->size)) return SELP_ERR_READ;
+
+    loff_t off = (loff_t)block->offset;
+    uint64_t left = block->size;
+
+    while (left > 0) {
+        size_t want = left > (1u << 30) ? (1u << 30) : (size_t)left;
+        ssize_t n = copy_file_range(in_fd, &off, out_fd, NULL, want, 0);
+        if (n == 0) return SELP_ERR_READ;   // Archive tronquée entre-temps
+        if (n < 0) break;           // ENOSYS, EXDEV, EINVAL... : repli sur write()
+        left -= (uint64_t)n;
+    }
+    if (left > 0 && !selp_map_covers(toc->map, toc->map_size, (uint64_t)off, left)) {
+        return SELP_ERR_READ;
+    }
+
+    while (left > 0) {
+        size_t want = left > (1u << 30) ? (1u << 30) : (size_t)left;
+        ssize_t n = write(out_fd, toc->map + off, want);
+        if (n <= 0) return SELP_ERR_WRITE;
+        off += n;
+        left -= (uint64_t)n;
+    }
+    return SELP_OK;
+}
+
+// ============================================================================
+// LECTURE D'UN BLOC
+// ============================================================================
+
+// Passe le contenu original d'un bloc (brut, déchiffré, décompressé) à sink.
+// block doit pointer dans toc->blocks : son index (et son sel) sert de nonce.
+int selp_block_read(FILE *in, selp_toc_t *toc, const selp_block_t *block,
+                    selp_sink_t sink, void *ctx) {
+    if (block->flags & SELP_BLOCK_HOLE) return sink(ctx, NULL, (size_t)block->size);
+
+    if (!(block->flags & (SELP_BLOCK_ZSTD | SELP_BLOCK_AES))) {
+        if (block_in_map(toc, block, block->size)) {
+            return sink(ctx, toc->map + block->offset, (size_t)block->size);
+        }
+
+        if (fseeko(in, (off_t)block->offset, SEEK_SET) != 0) return SELP_ERR_READ;
+
+        uint8_t buffer[65536];
+        uint64_t len = block->size;
+        while (len > 0) {
+            size_t want = len < sizeof(buffer) ? (size_t)len : sizeof(buffer);
+            size_t got = fread(buffer, 1, want, in);
+            if (got == 0) return SELP_ERR_READ;
+            int ret = sink(ctx, buffer, got);
+            if (ret != SELP_OK) return ret;
+            len -= got;
+        }
+        return SELP_OK;
+    }
+
+    size_t bound = ZSTD_compressBound(SELP_BLOCK_SIZE) + SELP_GCM_TAG_SIZE;
+    if (block->size > SELP_BLOCK_SIZE || block->stored_size > bound) {
+        return SELP_ERR_DECOMPRESS;
+    }
+
+    // Tampon unique : [stocké][déchiffré][décompressé], contexte partagé
+    // par tous les blocs de l'archive
+    if (!toc->zbuf) {
+        toc->zbuf_cap = 2 * bound + SELP_BLOCK_SIZE;
+        toc->zbuf = malloc(toc->zbuf_cap);
+        toc->dctx = ZSTD_createDCtx();
+        if (!toc->zbuf || !toc->dctx) return SELP_ERR_MEMORY;
+    }
+    if ((block->flags & SELP_BLOCK_DICT) && !toc->ddict) {
+        if (!toc->dict) return SELP_ERR_DECOMPRESS;
+        toc->ddict = ZSTD_createDDict(toc->dict, toc->header.dict_size);
+        if (!toc->ddict) return SELP_ERR_MEMORY;
+    }
+
+    const uint8_t *src = toc->zbuf;
+    uint8_t *plain = toc->zbuf + bound;
+    uint8_t *dst = toc->zbuf + 2 * bound;
+
+    if (block_in_map(toc, block, block->stored_size)) {
+        src = toc->map + block->offset;
+    } else if (fseeko(in, (off_t)block->offset, SEEK_SET) != 0 ||
+               fread(toc->zbuf, 1, block->stored_size, in) != block->stored_size) {
+        return SELP_ERR_READ;
+    }
+
+    const uint8_t *data = src;
+    size_t len = block->stored_size;
+
+    if (block->flags & SELP_BLOCK_AES) {
+        if (!toc->cipher) return SELP_ERR_CRYPTO;
+        uint64_t index = (uint64_t)(block - toc->blocks);
+        if (selp_cipher_open(toc->cipher, index, block->reserved, src, len, plain) != SELP_OK) {
+            return SELP_ERR_CRYPTO;
+        }
+        data = plain;
+        len -= SELP_GCM_TAG_SIZE;
+    }
+
+    if (!(block->flags & SELP_BLOCK_ZSTD)) {
+        if (len != block->size) return SELP_ERR_READ;
+        return sink(ctx, data, len);
+    }
+
+    size_t n;
+    if (block->flags & SELP_BLOCK_DICT) {
+        n = ZSTD_decompress_usingDDict(toc->dctx, dst, SELP_BLOCK_SIZE, data, len, toc->ddict);
+    } else {
+        n = ZSTD_decompressDCtx(toc->dctx, dst, SELP_BLOCK_SIZE, data, len);
+    }
+    if (ZSTD_isError(n) || n != block->size) return SELP_ERR_DECOMPRESS;
+
+    return sink(ctx, dst, n);
+}
+
+static int sink_file(void *ctx, const uint8_t *data, size_t len) {
+    if (!data) return fseeko((FILE *)ctx, (off_t)len, SEEK_CUR) == 0 ? SELP_OK : SELP_ERR_WRITE;
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? SELP_OK : SELP_ERR_WRITE;
+}
+
+// Écrit le contenu original d'un bloc dans out
+int selp_block_extract(FILE *in, selp_toc_t *toc, const selp_block_t *block, FILE *out) {
+    return selp_block_read(in, toc, block, sink_file, out);
+}
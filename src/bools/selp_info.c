@@ -10,20 +10,20 @@ int selp_info(const char *archive) {
         return SELP_ERR_OPEN;
     }
     
-    // Lire l'en-tête
-    selp_header_t header;
-    if (fread(&header, sizeof(selp_header_t), 1, fp) != 1) {
+    // Lire l'en-tête et la table des matières
+    selp_toc_t toc;
+    int result = selp_toc_load(fp, &toc);
+    fclose(fp);
+    if (result == SELP_ERR_MAGIC) {
+        printf("❌ Invalid SELP magic number\n");
+        return result;
+    }
+    if (result != SELP_OK) {
         printf("❌ Cannot read header\n");
-        fclose(fp);
-        return SELP_ERR_READ;
+        return result;
     }
     
-    // Vérifier le magic
-    if (memcmp(header.magic, SELP_MAGIC, 4) != 0) {
-        printf("❌ Invalid SELP magic number\n");
-        fclose(fp);
-        return SELP_ERR_MAGIC;
-    }
+    selp_header_t header = toc.header;
     
     printf("\n📦 SELP Archive Information\n");
     printf("═══════════════════════════\n");
@@ -40,6 +40,13 @@ int selp_info(const char *archive) {
            header.encryption == 2 ? "medium" : "strong");
     printf("Flags:        0x%02x\n", header.flags);
     printf("Files:        %llu\n", (unsigned long long)header.file_count);
+    printf("Blocks:       %llu (%llu refs)%s\n",
+           (unsigned long long)header.block_count,
+           (unsigned long long)header.ref_count,
+           (header.flags & SELP_FLAG_DEDUP) ? " [dedup]" : "");
+    if (header.dict_size > 0) {
+        printf("Dictionary:   %llu bytes (zstd)\n", (unsigned long long)header.dict_size);
+    }
     printf("Original:     %llu bytes (%.2f KB / %.2f MB)\n", 
            (unsigned long long)header.original_size,
            header.original_size / 1024.0,
@@ -59,11 +66,8 @@ int selp_info(const char *archive) {
         printf("\n📄 File entries:\n");
         printf("────────────────────────────────\n");
         
-        selp_file_entry_t entry;
         for (uint64_t i = 0; i < header.file_count; i++) {
-            if (fread(&entry, sizeof(selp_file_entry_t), 1, fp) != 1) {
-                break;
-            }
+            selp_file_entry_t entry = toc.entries[i];
             
             char time_str[64];
             struct tm *tm = localtime(&entry.mtime);
@@ -76,6 +80,7 @@ int selp_info(const char *archive) {
             printf("      Perm:  %o\n", entry.permissions);
             printf("      Mtime: %s\n", time_str);
             printf("      CRC32: %08x\n", entry.crc32);
+            printf("      Blocks: %u\n", entry.block_count);
             printf("\n");
         }
     }
@@ -87,7 +92,7 @@ int selp_info(const char *archive) {
     }
     printf("\n");
     
-    fclose(fp);
+    selp_toc_free(&toc);
     return SELP_OK;
 }
 
@@ -96,13 +101,9 @@ int selp_magic_info(const char *path) {
     if (!fp) return SELP_ERR_OPEN;
     
     selp_header_t header;
-    if (fread(&header, sizeof(header), 1, fp) != 1) {
-        fclose(fp);
-        return SELP_ERR_READ;
-    }
+    int result = selp_read_header(fp, &header, NULL);
     fclose(fp);
-    
-    if (memcmp(header.magic, "SELP", 4) != 0) return SELP_ERR_MAGIC;
+    if (result != SELP_OK) return result;
     
     printf("[SELP PASSIB LAB SOCKET 2001x006]\n");
     printf("Version: %d\n", header.version);
@@ -0,0 +1,232 @@
+#include "bool.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// ============================================================================
+// CRC32C (Castagnoli)
+// ============================================================================
+
+/*
+ * Instructions dédiées quand le compilateur les active (-msse4.2 sur x86_64,
+ * armv8.x sur aarch64, cf. CMakeLists.txt), table logicielle sinon.
+ * Convention zlib : selp_crc32c(0, ...) puis on enchaîne avec le résultat.
+ */
+
+#if !defined(__SSE4_2__) && !defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32c_table[256];
+
+__attribute__((constructor))
+static void init_crc32c_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+        }
+        crc32c_table[i] = c;
+    }
+}
+#endif
+
+uint32_t selp_crc32c(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+    crc = ~crc;
+
+#if defined(__SSE4_2__)
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--) crc = _mm_crc32_u8(crc, *p++);
+#elif defined(__ARM_FEATURE_CRC32)
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = __crc32cb(crc, *p++);
+#else
+    while (len--) crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+#endif
+
+    return ~crc;
+}
+
+// Un trou de fichier creux entre dans les sommes comme les zéros qu'il
+// représente : entry->hash reste le BLAKE3 du contenu, quelle que soit la
+// disposition des trous sur le système de fichiers. Les zéros viennent d'une
+// page statique, sans lecture ni allocation.
+void selp_sum_hole(uint32_t *crc, blake3_hasher *hasher, uint64_t len) {
+    static const uint8_t zeros[65536];
+    while (len > 0) {
+        size_t n = len < sizeof(zeros) ? (size_t)len : sizeof(zeros);
+        *crc = selp_crc32c(*crc, zeros, n);
+        blake3_hasher_update(hasher, zeros, n);
+        len -= n;
+    }
+}
+
+// ============================================================================
+// CONTRÔLE D'UNE ENTRÉE
+// ============================================================================
+
+typedef struct {
+    uint32_t crc;
+    blake3_hasher hasher;
+} entry_sum_t;
+
+static int sink_sum(void *ctx, const uint8_t *data, size_t len) {
+    entry_sum_t *sum = ctx;
+    if (!data) {
+        selp_sum_hole(&sum->crc, &sum->hasher, len);
+        return SELP_OK;
+    }
+    sum->crc = selp_crc32c(sum->crc, data, len);
+    blake3_hasher_update(&sum->hasher, data, len);
+    return SELP_OK;
+}
+
+// Relit les blocs d'une entrée et compare CRC32C + BLAKE3.
+// SELP_ERR_CHECKSUM si le contenu ne correspond pas.
+int selp_entry_check(FILE *in, selp_toc_t *toc, const selp_file_entry_t *entry) {
+    entry_sum_t sum;
+    sum.crc = 0;
+    blake3_hasher_init(&sum.hasher);
+
+    for (uint32_t r = 0; r < entry->block_count; r++) {
+        const selp_block_t *b = &toc->blocks[toc->refs[entry->block_first + r]];
+        int ret = selp_block_read(in, toc, b, sink_sum, &sum);
+        if (ret == SELP_ERR_DECOMPRESS || ret == SELP_ERR_CRYPTO) return SELP_ERR_CHECKSUM;
+        if (ret != SELP_OK) return ret;
+    }
+
+    uint8_t hash[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(&sum.hasher, hash, BLAKE3_OUT_LEN);
+
+    if (sum.crc != entry->crc32 || memcmp(hash, entry->hash, sizeof(entry->hash)) != 0) {
+        return SELP_ERR_CHECKSUM;
+    }
+    return SELP_OK;
+}
+
+// ============================================================================
+// VÉRIFICATION PARALLÈLE
+// ============================================================================
+
+typedef struct {
+    const char *archive;
+    selp_toc_t *toc;
+    int *status;                 // Résultat par entrée
+    uint64_t next;               // Prochaine entrée à traiter
+    pthread_mutex_t lock;
+} verify_job_t;
+
+static void *verify_worker(void *arg) {
+    verify_job_t *job = arg;
+
+    FILE *in = fopen(job->archive, "rb");
+
+    // Tables partagées en lecture, contextes zstd/AES propres au thread
+    selp_toc_t local;
+    int ready = in && selp_toc_fork_codec(job->toc, &local) == SELP_OK;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        uint64_t i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->toc->header.file_count) break;
+
+        job->status[i] = ready ? selp_entry_check(in, &local, &job->toc->entries[i])
+                               : SELP_ERR_OPEN;
+    }
+
+    if (ready) selp_toc_release_codec(&local);
+    if (in) fclose(in);
+    return NULL;
+}
+
+// Vérifie chaque entrée en parallèle et nomme les fichiers corrompus.
+// threads <= 0 : un par cœur.
+int selp_verify_entries(const char *archive, int threads) {
+    FILE *fp = fopen(archive, "rb");
+    if (!fp) return SELP_ERR_OPEN;
+
+    selp_toc_t toc;
+    int ret = selp_toc_load(fp, &toc);
+    // Les threads hachent directement depuis le mapping partagé
+    if (ret == SELP_OK) selp_toc_map(&toc, fp);
+    fclose(fp);
+    if (ret != SELP_OK) {
+        printf("❌ Table of contents unreadable: archive cannot be salvaged\n");
+        return ret;
+    }
+
+    if (!(toc.header.flags & SELP_FLAG_ENTRY_SUMS)) {
+        printf("⚠️  Archive has no per-file checksums (created by an older bool)\n");
+        selp_toc_free(&toc);
+        return SELP_OK;
+    }
+
+    uint64_t count = toc.header.file_count;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if ((uint64_t)threads > count) threads = count > 0 ? (int)count : 1;
+
+    verify_job_t job;
+    job.archive = archive;
+    job.toc = &toc;
+    job.status = calloc(count + 1, sizeof(int));
+    job.next = 0;
+    pthread_mutex_init(&job.lock, NULL);
+
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    if (!job.status || !tids) {
+        free(job.status);
+        free(tids);
+        selp_toc_free(&toc);
+        return SELP_ERR_MEMORY;
+    }
+
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, verify_worker, &job) == 0) started++;
+    }
+    if (started == 0) verify_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+
+    uint64_t bad = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (job.status[i] == SELP_OK) continue;
+        bad++;
+        printf("❌ %s: %s\n", toc.entries[i].path,
+               job.status[i] == SELP_ERR_CHECKSUM ? "checksum mismatch" : "unreadable");
+    }
+
+    if (bad == 0) {
+        printf("✅ %llu files OK (CRC32C + BLAKE3, %d threads)\n",
+               (unsigned long long)count, started ? started : 1);
+    } else {
+        printf("⚠️  %llu/%llu files corrupted, the others can be recovered with --salvage\n",
+               (unsigned long long)bad, (unsigned long long)count);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    free(job.status);
+    free(tids);
+    selp_toc_free(&toc);
+
+    return bad ? SELP_ERR_CHECKSUM : SELP_OK;
+}
@@ -4,13 +4,12 @@ int selp_list(const char *archive) {
     FILE *fp = fopen(archive, "rb");
     if (!fp) return SELP_ERR_OPEN;
     
-    selp_header_t header;
-    fread(&header, sizeof(selp_header_t), 1, fp);
+    selp_toc_t toc;
+    int result = selp_toc_load(fp, &toc);
+    fclose(fp);
+    if (result != SELP_OK) return result;
     
-    if (memcmp(header.magic, SELP_MAGIC, 4) != 0) {
-        fclose(fp);
-        return SELP_ERR_MAGIC;
-    }
+    selp_header_t header = toc.header;
     
     printf("\n📦 Archive: %s\n", archive);
     printf("══════════════════════════════════════════════\n");
@@ -18,6 +17,8 @@ int selp_list(const char *archive) {
     printf("Compression: %d\n", header.compression);
     printf("Encryption:  %d\n", header.encryption);
     printf("Files:       %llu\n", (unsigned long long)header.file_count);
+    printf("Blocks:      %llu%s\n", (unsigned long long)header.block_count,
+           (header.flags & SELP_FLAG_DEDUP) ? " (dedup)" : "");
     printf("Author:      %s\n", header.author);
     printf("Comment:     %s\n", header.comment);
     printf("Created:     %s", ctime(&header.timestamp));
@@ -29,13 +30,17 @@ int selp_list(const char *archive) {
     printf("Contents:\n");
     printf("──────────────────────────────────────────────\n");
     
-    selp_file_entry_t entry;
     for (uint64_t i = 0; i < header.file_count; i++) {
-        fread(&entry, sizeof(selp_file_entry_t), 1, fp);
+        selp_file_entry_t *entry = &toc.entries[i];
+        if (entry->type == SELP_ENTRY_HARDLINK) {
+            printf("  %s (%s => %s)\n",
+                   entry->name, entry->path, toc.entries[entry->link].path);
+            continue;
+        }
         printf("  %s (%s, %.2f KB)\n", 
-               entry.name, entry.path, entry.size / 1024.0);
+               entry->name, entry->path, entry->size / 1024.0);
     }
     
-    fclose(fp);
+    selp_toc_free(&toc);
     return SELP_OK;
 }
@@ -1,4 +1,5 @@
 #include "bool.h"
+#include <unistd.h>
 
 int selp_compress_files(int argc, char **argv, const char *output,
                        int level, int crypt, const char *author,
@@ -23,72 +24,50 @@ int selp_compress_files(int argc, char **argv, const char *output,
     
     // Créer l'en-tête
     selp_header_t header;
-    memcpy(header.magic, SELP_MAGIC, 4);
-    header.version = SELP_VERSION;
+    memset(&header, 0, sizeof(header));
     header.compression = level;
     header.encryption = crypt;
-    header.original_size = total_size;
-    header.file_count = argc;
     header.timestamp = time(NULL);
     strncpy(header.author, author ? author : "Unknown", MAX_AUTHOR - 1);
     strncpy(header.comment, comment ? comment : "BOOL SELP Archive", MAX_COMMENT - 1);
     
-    // Ouvrir le fichier de sortie
-    FILE *out = fopen(output, "wb");
-    if (!out) {
+    selp_writer_t writer;
+    int result = selp_writer_open(&writer, output, &header);
+    if (result != SELP_OK) {
         printf("❌ Cannot create output file\n");
-        return SELP_ERR_OPEN;
+        return result;
     }
     
-    // Écrire l'en-tête
-    fwrite(&header, sizeof(selp_header_t), 1, out);
-    
-    // Écrire les entrées
-    for (int i = 0; i < argc; i++) {
-        selp_file_entry_t entry;
-        memset(&entry, 0, sizeof(entry));
-        
-        strncpy(entry.path, argv[i], MAX_PATH - 1);
-        
-        char *base = strrchr(argv[i], '/');
-        if (base) base++; else base = argv[i];
-        strncpy(entry.name, base, sizeof(entry.name) - 1);
-        
-        struct stat st;
-        stat(argv[i], &st);
-        entry.size = st.st_size;
-        entry.permissions = st.st_mode;
-        entry.mtime = st.st_mtime;
-        entry.offset = 0;
-        
-        fwrite(&entry, sizeof(selp_file_entry_t), 1, out);
-    }
-    
-    // Écrire les données
+    // Écrire les fichiers
     for (int i = 0; i < argc; i++) {
-        FILE *in = fopen(argv[i], "rb");
-        if (!in) continue;
+        if (stat(argv[i], &st) != 0) continue;
         
         printf("📦 Writing: %s\n", argv[i]);
         
-        uint8_t buffer[8192];
-        size_t bytes;
-        while ((bytes = fread(buffer, 1, sizeof(buffer), in)) > 0) {
-            fwrite(buffer, 1, bytes, out);
+        result = selp_writer_add_file(&writer, argv[i], argv[i], &st);
+        if (result == SELP_ERR_OPEN) continue;
+        if (result != SELP_OK) {
+            selp_writer_abort(&writer);
+            unlink(output);
+            printf("❌ Write error\n");
+            return result;
         }
-        fclose(in);
     }
     
-    // Mettre à jour la taille compressée
-    header.compressed_size = ftell(out) - sizeof(selp_header_t);
-    fseek(out, 0, SEEK_SET);
-    fwrite(&header, sizeof(selp_header_t), 1, out);
+    result = selp_writer_close(&writer);
+    if (result != SELP_OK) {
+        unlink(output);
+        printf("❌ Write error\n");
+        return result;
+    }
     
-    fclose(out);
+    uint64_t out_size = stat(output, &st) == 0 ? (uint64_t)st.st_size : 0;
     
     printf("\n✅ Files compressed successfully!\n");
-    printf("   Output: %s (%.2f KB)\n", output, header.compressed_size / 1024.0);
-    printf("   Ratio:  %.1f%%\n", 100.0 * header.compressed_size / total_size);
+    printf("   Output: %s (%.2f KB)\n", output, out_size / 1024.0);
+    if (total_size > 0) {
+        printf("   Ratio:  %.1f%%\n", 100.0 * out_size / total_size);
+    }
     
     return SELP_OK;
 }
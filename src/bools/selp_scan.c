@@ -0,0 +1,517 @@
+#include "bool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+// ============================================================================
+// ARÈNE
+// ============================================================================
+
+#define ARENA_BLOCK_SIZE (256 * 1024)
+
+void *selp_arena_alloc(selp_arena_t *a, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+
+    selp_arena_block_t *b = a->head;
+    if (!b || b->size - b->used < size) {
+        size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = malloc(sizeof(selp_arena_block_t) + cap);
+        if (!b) return NULL;
+        b->next = a->head;
+        b->used = 0;
+        b->size = cap;
+        a->head = b;
+    }
+
+    void *p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+char *selp_arena_strndup(selp_arena_t *a, const char *s, size_t len) {
+    char *p = selp_arena_alloc(a, len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+void selp_arena_free(selp_arena_t *a) {
+    selp_arena_block_t *b = a->head;
+    while (b) {
+        selp_arena_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+}
+
+// Rattache les blocs de src à dst (src est vidée)
+static void arena_merge(selp_arena_t *dst, selp_arena_t *src) {
+    if (!src->head) return;
+    selp_arena_block_t *tail = src->head;
+    while (tail->next) tail = tail->next;
+    tail->next = dst->head;
+    dst->head = src->head;
+    src->head = NULL;
+}
+
+// ============================================================================
+// PARCOURS PARALLÈLE
+// ============================================================================
+
+/*
+ * Chaque worker a sa file de dossiers : il dépile les siens par la fin
+ * (parcours en profondeur, bon pour le cache dentry) et vole les plus
+ * anciens des autres par le début quand la sienne est vide. "pending"
+ * compte les dossiers en file ou en cours de lecture ; à 0 tout est fini.
+ * Un worker sans rien à voler dort sur idle_cond : queue_push() le réveille
+ * (seulement s'il y a des dormeurs), le dernier dossier fini réveille tout
+ * le monde.
+ *
+ * Les dossiers sont lus avec getdents64 et d_type : pas de stat pour les
+ * dossiers, statx (relatif au fd du dossier) seulement pour les fichiers
+ * réguliers, les liens suivis et les systèmes de fichiers sans d_type.
+ * Chaque worker remplit sa propre liste et sa propre arène, fusionnées
+ * puis triées par chemin à la fin pour un ordre stable. Un chemin d'au
+ * moins MAX_PATH octets ne tient pas dans une entrée d'archive : il est
+ * signalé et le parcours échoue (SELP_ERR_READ) plutôt que de l'omettre.
+ */
+
+#define SCAN_DIRENT_BUF (64 * 1024)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct {
+    char **items;                // [head, tail) ; le propriétaire travaille en fin
+    size_t head;
+    size_t tail;
+    size_t cap;
+    pthread_mutex_t lock;
+} dir_queue_t;
+
+typedef struct scan_ctx scan_ctx_t;
+
+typedef struct {
+    scan_ctx_t *ctx;
+    int id;
+    dir_queue_t queue;
+    selp_file_list_t found;
+    char *dirent_buf;
+} scan_worker_t;
+
+struct scan_ctx {
+    scan_worker_t *workers;
+    int worker_count;
+    int follow_links;
+    atomic_size_t pending;
+    atomic_size_t queued;        // Dossiers en file (pas encore lus)
+    atomic_int failed;           // SELP_ERR_* du premier échec, 0 sinon
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    atomic_int sleeping;
+    // Dossiers déjà vus (dev, ino), seulement avec follow_links
+    pthread_mutex_t visited_lock;
+    uint64_t *visited;
+    size_t visited_cap;
+    size_t visited_count;
+};
+
+static void scan_fail(scan_ctx_t *ctx, int err) {
+    int none = 0;
+    atomic_compare_exchange_strong(&ctx->failed, &none, err);
+}
+
+static int queue_push(scan_ctx_t *ctx, dir_queue_t *q, char *dir) {
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->cap) {
+        if (q->head > 0) {
+            memmove(q->items, q->items + q->head, (q->tail - q->head) * sizeof(char *));
+            q->tail -= q->head;
+            q->head = 0;
+        }
+        if (q->tail == q->cap) {
+            size_t cap = q->cap ? q->cap * 2 : 64;
+            char **items = realloc(q->items, cap * sizeof(char *));
+            if (!items) {
+                pthread_mutex_unlock(&q->lock);
+                return SELP_ERR_MEMORY;
+            }
+            q->items = items;
+            q->cap = cap;
+        }
+    }
+    q->items[q->tail++] = dir;
+    pthread_mutex_unlock(&q->lock);
+
+    // queued avant sleeping : un worker qui s'endort après ce test le verra
+    atomic_fetch_add(&ctx->queued, 1);
+    if (atomic_load(&ctx->sleeping) > 0) {
+        pthread_mutex_lock(&ctx->idle_lock);
+        pthread_cond_signal(&ctx->idle_cond);
+        pthread_mutex_unlock(&ctx->idle_lock);
+    }
+    return SELP_OK;
+}
+
+static char *queue_pop(dir_queue_t *q) {
+    char *dir = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) dir = q->items[--q->tail];
+    pthread_mutex_unlock(&q->lock);
+    return dir;
+}
+
+static char *queue_steal(dir_queue_t *q) {
+    char *dir = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) dir = q->items[q->head++];
+    pthread_mutex_unlock(&q->lock);
+    return dir;
+}
+
+// statx avec le minimum de champs ; fstatat si le noyau ne l'a pas
+static int stat_at(int dirfd, const char *name, int follow_links, struct stat *st) {
+    int at_flags = follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+
+#ifdef STATX_BASIC_STATS
+    struct statx sx;
+    unsigned int mask = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID |
+                        STATX_INO | STATX_SIZE | STATX_BLOCKS | STATX_MTIME;
+
+    if (statx(dirfd, name, at_flags | AT_STATX_DONT_SYNC, mask, &sx) == 0) {
+        memset(st, 0, sizeof(struct stat));
+        st->st_mode = sx.stx_mode;
+        st->st_nlink = sx.stx_nlink;
+        st->st_uid = sx.stx_uid;
+        st->st_gid = sx.stx_gid;
+        st->st_ino = sx.stx_ino;
+        st->st_dev = makedev(sx.stx_dev_major, sx.stx_dev_minor);
+        st->st_size = sx.stx_size;
+        st->st_blocks = sx.stx_blocks;
+        st->st_blksize = sx.stx_blksize;
+        st->st_mtim.tv_sec = sx.stx_mtime.tv_sec;
+        st->st_mtim.tv_nsec = sx.stx_mtime.tv_nsec;
+        return 0;
+    }
+    if (errno != ENOSYS) return -1;
+#endif
+
+    return fstatat(dirfd, name, st, at_flags);
+}
+
+// Évite les boucles de liens symboliques : 0 si le dossier a déjà été vu
+static int mark_visited(scan_ctx_t *ctx, int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+
+    uint64_t dev = (uint64_t)st.st_dev;
+    uint64_t ino = (uint64_t)st.st_ino;
+    int fresh = 1;
+
+    pthread_mutex_lock(&ctx->visited_lock);
+
+    if ((ctx->visited_count + 1) * 2 > ctx->visited_cap) {
+        size_t cap = ctx->visited_cap ? ctx->visited_cap * 2 : 1024;
+        uint64_t *table = calloc(cap * 2, sizeof(uint64_t));
+        if (!table) {
+            pthread_mutex_unlock(&ctx->visited_lock);
+            return 1;
+        }
+        for (size_t i = 0; i < ctx->visited_cap; i++) {
+            uint64_t d = ctx->visited[2 * i], n = ctx->visited[2 * i + 1];
+            if (d == 0 && n == 0) continue;
+            size_t j = (size_t)((d * 0x9E3779B97F4A7C15ULL) ^ n) & (cap - 1);
+            while (table[2 * j] || table[2 * j + 1]) j = (j + 1) & (cap - 1);
+            table[2 * j] = d;
+            table[2 * j + 1] = n;
+        }
+        free(ctx->visited);
+        ctx->visited = table;
+        ctx->visited_cap = cap;
+    }
+
+    // (0, 0) marque une case vide ; aucun vrai dossier n'a dev et ino nuls
+    size_t mask = ctx->visited_cap - 1;
+    size_t j = (size_t)((dev * 0x9E3779B97F4A7C15ULL) ^ ino) & mask;
+    while (ctx->visited[2 * j] || ctx->visited[2 * j + 1]) {
+        if (ctx->visited[2 * j] == dev && ctx->visited[2 * j + 1] == ino) {
+            fresh = 0;
+            break;
+        }
+        j = (j + 1) & mask;
+    }
+    if (fresh) {
+        ctx->visited[2 * j] = dev;
+        ctx->visited[2 * j + 1] = ino;
+        ctx->visited_count++;
+    }
+
+    pthread_mutex_unlock(&ctx->visited_lock);
+    return fresh;
+}
+
+static int list_append(selp_file_list_t *list, char *path, const struct stat *st) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 1024;
+        selp_scan_entry_t *entries = realloc(list->entries, cap * sizeof(selp_scan_entry_t));
+        if (!entries) return SELP_ERR_MEMORY;
+        list->entries = entries;
+        list->cap = cap;
+    }
+    list->entries[list->count].path = path;
+    list->entries[list->count].st = *st;
+    list->count++;
+    return SELP_OK;
+}
+
+// Joint dir et name dans l'arène du worker ; NULL (échec noté) si trop
+// long ou plus de mémoire
+static char *join_path(scan_worker_t *w, const char *dir, size_t dir_len,
+                       const char *name, size_t name_len) {
+    int root = dir_len == 1 && dir[0] == '/';
+    size_t len = dir_len + (root ? 0 : 1) + name_len;
+    if (len >= MAX_PATH) {
+        printf("❌ Path too long (max %d bytes): %s/%s\n", MAX_PATH - 1, dir, name);
+        scan_fail(w->ctx, SELP_ERR_READ);
+        return NULL;
+    }
+
+    char *path = selp_arena_alloc(&w->found.arena, len + 1);
+    if (!path) {
+        scan_fail(w->ctx, SELP_ERR_MEMORY);
+        return NULL;
+    }
+    memcpy(path, dir, dir_len);
+    if (!root) path[dir_len++] = '/';
+    memcpy(path + dir_len, name, name_len + 1);
+    return path;
+}
+
+static void scan_one(scan_worker_t *w, const char *dir) {
+    scan_ctx_t *ctx = w->ctx;
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    if (ctx->follow_links && !mark_visited(ctx, fd)) {
+        close(fd);
+        return;
+    }
+
+    size_t dir_len = strlen(dir);
+
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, w->dirent_buf, SCAN_DIRENT_BUF);
+        if (n <= 0) break;
+
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(w->dirent_buf + off);
+            off += d->d_reclen;
+
+            const char *name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = d->d_type;
+            struct stat st;
+            int have_stat = 0;
+
+            // Sans d_type, ou lien à suivre : il faut le type réel
+            if (type == DT_UNKNOWN || (type == DT_LNK && ctx->follow_links)) {
+                if (stat_at(fd, name, ctx->follow_links, &st) != 0) continue;
+                have_stat = 1;
+                type = IFTODT(st.st_mode);
+            }
+
+            if (type == DT_DIR) {
+                char *sub = join_path(w, dir, dir_len, name, strlen(name));
+                if (!sub) continue;
+                atomic_fetch_add(&ctx->pending, 1);
+                if (queue_push(ctx, &w->queue, sub) != SELP_OK) {
+                    atomic_fetch_sub(&ctx->pending, 1);
+                    scan_fail(ctx, SELP_ERR_MEMORY);
+                }
+            } else if (type == DT_REG) {
+                if (!have_stat && stat_at(fd, name, ctx->follow_links, &st) != 0) continue;
+                if (!S_ISREG(st.st_mode)) continue;
+
+                char *path = join_path(w, dir, dir_len, name, strlen(name));
+                if (!path) continue;
+                if (list_append(&w->found, path, &st) != SELP_OK) {
+                    scan_fail(ctx, SELP_ERR_MEMORY);
+                }
+            }
+        }
+    }
+
+    close(fd);
+}
+
+static void *scan_worker(void *arg) {
+    scan_worker_t *self = arg;
+    scan_ctx_t *ctx = self->ctx;
+
+    for (;;) {
+        char *dir = queue_pop(&self->queue);
+        for (int i = 1; !dir && i < ctx->worker_count; i++) {
+            dir = queue_steal(&ctx->workers[(self->id + i) % ctx->worker_count].queue);
+        }
+
+        if (!dir) {
+            // Un autre worker lit encore un dossier : on dort jusqu'à ce
+            // qu'il en publie un ou que tout soit fini
+            pthread_mutex_lock(&ctx->idle_lock);
+            atomic_fetch_add(&ctx->sleeping, 1);
+            while (atomic_load(&ctx->queued) == 0 && atomic_load(&ctx->pending) > 0) {
+                pthread_cond_wait(&ctx->idle_cond, &ctx->idle_lock);
+            }
+            atomic_fetch_sub(&ctx->sleeping, 1);
+            pthread_mutex_unlock(&ctx->idle_lock);
+            if (atomic_load(&ctx->pending) == 0) break;
+            continue;
+        }
+
+        atomic_fetch_sub(&ctx->queued, 1);
+        scan_one(self, dir);
+        if (atomic_fetch_sub(&ctx->pending, 1) == 1) {
+            pthread_mutex_lock(&ctx->idle_lock);
+            pthread_cond_broadcast(&ctx->idle_cond);
+            pthread_mutex_unlock(&ctx->idle_lock);
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const selp_scan_entry_t *)a)->path,
+                  ((const selp_scan_entry_t *)b)->path);
+}
+
+// Liste les fichiers réguliers sous dir. threads <= 0 : un par cœur.
+int selp_scan_tree(const char *dir, int follow_links, int threads, selp_file_list_t *list) {
+    memset(list, 0, sizeof(selp_file_list_t));
+
+    struct stat st;
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) return SELP_ERR_OPEN;
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+
+    scan_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.follow_links = follow_links;
+    ctx.worker_count = threads;
+    atomic_init(&ctx.pending, 0);
+    atomic_init(&ctx.queued, 0);
+    atomic_init(&ctx.failed, 0);
+    atomic_init(&ctx.sleeping, 0);
+    pthread_mutex_init(&ctx.visited_lock, NULL);
+    pthread_mutex_init(&ctx.idle_lock, NULL);
+    pthread_cond_init(&ctx.idle_cond, NULL);
+
+    ctx.workers = calloc(threads, sizeof(scan_worker_t));
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    int ret = (ctx.workers && tids) ? SELP_OK : SELP_ERR_MEMORY;
+
+    for (int t = 0; ret == SELP_OK && t < threads; t++) {
+        ctx.workers[t].ctx = &ctx;
+        ctx.workers[t].id = t;
+        pthread_mutex_init(&ctx.workers[t].queue.lock, NULL);
+        ctx.workers[t].dirent_buf = malloc(SCAN_DIRENT_BUF);
+        if (!ctx.workers[t].dirent_buf) ret = SELP_ERR_MEMORY;
+    }
+
+    // Racine sans '/' final pour des chemins "dir/x" propres
+    size_t root_len = strlen(dir);
+    while (root_len > 1 && dir[root_len - 1] == '/') root_len--;
+
+    char *root = NULL;
+    if (ret == SELP_OK) {
+        root = selp_arena_strndup(&ctx.workers[0].found.arena, dir, root_len);
+        if (!root || queue_push(&ctx, &ctx.workers[0].queue, root) != SELP_OK) ret = SELP_ERR_MEMORY;
+    }
+
+    if (ret == SELP_OK) {
+        atomic_store(&ctx.pending, 1);
+
+        // Le worker 0 tourne dans le thread appelant
+        int started = 1;
+        for (int t = 1; t < threads; t++) {
+            if (pthread_create(&tids[t], NULL, scan_worker, &ctx.workers[t]) != 0) break;
+            started++;
+        }
+        scan_worker(&ctx.workers[0]);
+        for (int t = 1; t < started; t++) pthread_join(tids[t], NULL);
+
+        if (atomic_load(&ctx.failed)) ret = atomic_load(&ctx.failed);
+    }
+
+    // Fusion des listes de chaque worker
+    size_t total = 0;
+    for (int t = 0; ctx.workers && t < threads; t++) total += ctx.workers[t].found.count;
+
+    if (ret == SELP_OK && total > 0) {
+        list->entries = malloc(total * sizeof(selp_scan_entry_t));
+        if (!list->entries) ret = SELP_ERR_MEMORY;
+    }
+
+    for (int t = 0; ctx.workers && t < threads; t++) {
+        scan_worker_t *w = &ctx.workers[t];
+        if (ret == SELP_OK && w->found.count > 0) {
+            memcpy(list->entries + list->count, w->found.entries,
+                   w->found.count * sizeof(selp_scan_entry_t));
+            list->count += w->found.count;
+        }
+        arena_merge(&list->arena, &w->found.arena);
+        free(w->found.entries);
+        free(w->queue.items);
+        free(w->dirent_buf);
+        pthread_mutex_destroy(&w->queue.lock);
+    }
+    list->cap = list->count;
+
+    free(ctx.workers);
+    free(tids);
+    free(ctx.visited);
+    pthread_mutex_destroy(&ctx.visited_lock);
+    pthread_mutex_destroy(&ctx.idle_lock);
+    pthread_cond_destroy(&ctx.idle_cond);
+
+    if (ret != SELP_OK) {
+        selp_file_list_free(list);
+        return ret;
+    }
+
+    qsort(list->entries, list->count, sizeof(selp_scan_entry_t), compare_entries);
+    return SELP_OK;
+}
+
+void selp_file_list_free(selp_file_list_t *list) {
+    free(list->entries);
+    selp_arena_free(&list->arena);
+    memset(list, 0, sizeof(selp_file_list_t));
+}
+
+// Chemin stocké dans l'archive : relatif au dossier scanné
+const char *selp_relative_path(const char *dir, const char *path) {
+    size_t dir_len = strlen(dir);
+    while (dir_len > 1 && dir[dir_len - 1] == '/') dir_len--;
+
+    if (strncmp(path, dir, dir_len) == 0 && path[dir_len] == '/') {
+        return path + dir_len + 1;
+    }
+    return path;
+}
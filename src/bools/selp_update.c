@@ -0,0 +1,344 @@
+#include "bool.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// ============================================================================
+// UTILITAIRES
+// ============================================================================
+
+static int compare_entry_path(const void *a, const void *b) {
+    const selp_file_entry_t *x = *(const selp_file_entry_t *const *)a;
+    const selp_file_entry_t *y = *(const selp_file_entry_t *const *)b;
+    return strcmp(x->path, y->path);
+}
+
+// Entrées de la TOC triées par chemin pour la recherche
+static const selp_file_entry_t **sort_entries(const selp_toc_t *toc) {
+    uint64_t n = toc->header.file_count;
+    const selp_file_entry_t **sorted = malloc((n + 1) * sizeof(selp_file_entry_t *));
+    if (!sorted) return NULL;
+    for (uint64_t i = 0; i < n; i++) sorted[i] = &toc->entries[i];
+    qsort(sorted, n, sizeof(selp_file_entry_t *), compare_entry_path);
+    return sorted;
+}
+
+static const selp_file_entry_t *find_entry(const selp_file_entry_t **sorted, uint64_t n,
+                                           const char *path) {
+    selp_file_entry_t key;
+    strncpy(key.path, path, MAX_PATH - 1);
+    key.path[MAX_PATH - 1] = '\0';
+    const selp_file_entry_t *k = &key;
+
+    const selp_file_entry_t **hit = bsearch(&k, sorted, n, sizeof(selp_file_entry_t *),
+                                            compare_entry_path);
+    return hit ? *hit : NULL;
+}
+
+// Même contenu que l'entrée (BLAKE3) : fichier seulement "touché"
+static int same_content(const char *path, const selp_file_entry_t *e) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+
+    uint8_t *buffer = malloc(SELP_BLOCK_SIZE);
+    ssize_t n = -1;
+    while (buffer && (n = read(fd, buffer, SELP_BLOCK_SIZE)) > 0) {
+        blake3_hasher_update(&hasher, buffer, (size_t)n);
+    }
+    close(fd);
+    free(buffer);
+    if (n != 0) return 0;
+
+    uint8_t hash[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
+    return memcmp(hash, e->hash, sizeof(e->hash)) == 0;
+}
+
+// Octets stockés encore référencés par une entrée
+static uint64_t live_bytes(const selp_block_t *blocks, uint64_t block_count,
+                           const uint32_t *refs, uint64_t ref_count) {
+    uint8_t *seen = calloc(block_count + 1, 1);
+    if (!seen) return 0;
+
+    uint64_t live = 0;
+    for (uint64_t i = 0; i < ref_count; i++) {
+        if (refs[i] < block_count && !seen[refs[i]]) {
+            seen[refs[i]] = 1;
+            live += blocks[refs[i]].stored_size;
+        }
+    }
+    free(seen);
+    return live;
+}
+
+static uint64_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+// ============================================================================
+// MISE À JOUR INCRÉMENTALE
+// ============================================================================
+
+/*
+ * bool --update : compare le dossier à la TOC (taille + mtime, puis BLAKE3
+ * quand seule la date a changé). Les fichiers inchangés gardent leurs
+ * blocs ; seuls les fichiers modifiés ou nouveaux sont relus et ajoutés
+ * en fin d'archive, suivis d'une nouvelle TOC. En mode dédup les chunks
+ * déjà présents ne sont pas réécrits.
+ */
+int selp_update_directory(const char *archive, const char *dir) {
+    FILE *fp = fopen(archive, "rb");
+    if (!fp) return SELP_ERR_OPEN;
+
+    selp_toc_t toc;
+    int ret = selp_toc_load(fp, &toc);
+    fclose(fp);
+    if (ret != SELP_OK) return ret;
+
+    // En-tête v1/v2 plus court : la réécriture en v3 écraserait les données
+    if (toc.header.version < 3) {
+        printf("❌ Archive format v%d cannot be updated, run --compact or recreate it with -c\n",
+               toc.header.version);
+        selp_toc_free(&toc);
+        return SELP_ERR_VERSION;
+    }
+
+    printf("📁 Scanning directory: %s\n", dir);
+
+    selp_file_list_t list;
+    ret = selp_scan_tree(dir, toc.header.flags & SELP_FLAG_FOLLOW_LINKS, 0, &list);
+    if (ret != SELP_OK) {
+        selp_toc_free(&toc);
+        return ret == SELP_ERR_MEMORY || ret == SELP_ERR_READ ? ret : SELP_ERR_NOT_FOUND;
+    }
+
+    uint64_t old_count = toc.header.file_count;
+    const selp_file_entry_t **sorted = sort_entries(&toc);
+    const selp_file_entry_t **match = calloc(list.count + 1, sizeof(selp_file_entry_t *));
+    if (!sorted || !match) {
+        free(sorted);
+        free(match);
+        selp_file_list_free(&list);
+        selp_toc_free(&toc);
+        return SELP_ERR_MEMORY;
+    }
+
+    // Premier passage : ce qui a changé, sans toucher à l'archive
+    uint64_t kept = 0, touched = 0, changed = 0, added = 0, matched = 0;
+    int dirty = 0;
+
+    for (size_t i = 0; i < list.count; i++) {
+        const char *stored = selp_relative_path(dir, list.entries[i].path);
+        const struct stat *st = &list.entries[i].st;
+        const selp_file_entry_t *e = find_entry(sorted, old_count, stored);
+
+        if (!e) {
+            added++;
+            dirty = 1;
+            continue;
+        }
+        matched++;
+
+        if (e->size == (uint64_t)st->st_size && e->mtime == st->st_mtime) {
+            match[i] = e;
+            kept++;
+            if (e->permissions != (uint32_t)st->st_mode) dirty = 1;
+        } else if (e->size == (uint64_t)st->st_size &&
+                   (toc.header.flags & SELP_FLAG_ENTRY_SUMS) &&
+                   same_content(list.entries[i].path, e)) {
+            match[i] = e;
+            touched++;
+            dirty = 1;
+        } else {
+            changed++;
+            dirty = 1;
+        }
+    }
+
+    uint64_t removed = old_count - matched;
+    if (removed > 0) dirty = 1;
+
+    if (!dirty) {
+        printf("✅ Archive is up to date (%llu files)\n", (unsigned long long)kept);
+        free(sorted);
+        free(match);
+        selp_file_list_free(&list);
+        selp_toc_free(&toc);
+        return SELP_OK;
+    }
+
+    uint64_t before = file_size(archive);
+
+    selp_writer_t writer;
+    ret = selp_writer_reopen(&writer, archive, &toc);
+
+    // Second passage : entrées reprises ou données ajoutées, dans l'ordre du scan
+    for (size_t i = 0; ret == SELP_OK && i < list.count; i++) {
+        const char *path = list.entries[i].path;
+        const struct stat *st = &list.entries[i].st;
+
+        if (match[i]) {
+            ret = selp_writer_keep_entry(&writer, match[i],
+                                         &toc.refs[match[i]->block_first], st);
+            continue;
+        }
+
+        printf("📦 Writing: %s\n", path);
+        ret = selp_writer_add_file(&writer, path, selp_relative_path(dir, path), st);
+        if (ret == SELP_ERR_OPEN) {
+            printf("⚠️  Skipped (cannot open): %s\n", path);
+            ret = SELP_OK;
+        }
+    }
+
+    uint64_t live = 0;
+    if (ret == SELP_OK) {
+        live = live_bytes(writer.blocks, writer.header.block_count,
+                          writer.refs, writer.header.ref_count);
+        ret = selp_writer_close(&writer);
+    } else {
+        selp_writer_abort(&writer);
+    }
+
+    free(sorted);
+    free(match);
+    selp_file_list_free(&list);
+    selp_toc_free(&toc);
+
+    if (ret != SELP_OK) {
+        printf("❌ Update failed, archive left unchanged\n");
+        return ret;
+    }
+
+    uint64_t after = file_size(archive);
+    uint64_t overhead = writer.header.toc_size + writer.header.dict_size + sizeof(selp_header_t);
+    uint64_t dead = after > live + overhead ? after - live - overhead : 0;
+
+    printf("\n✅ Archive updated: %s\n", archive);
+    printf("   Unchanged: %llu (%llu only touched)\n",
+           (unsigned long long)(kept + touched), (unsigned long long)touched);
+    printf("   Changed:   %llu\n", (unsigned long long)changed);
+    printf("   Added:     %llu\n", (unsigned long long)added);
+    printf("   Removed:   %llu\n", (unsigned long long)removed);
+    printf("   Appended:  %.2f KB\n", (after - before) / 1024.0);
+    if (after > 0 && dead * 4 > after) {
+        printf("💡 %.0f%% of the archive is superseded data, run 'bool --compact %s'\n",
+               100.0 * dead / after, archive);
+    }
+
+    return SELP_OK;
+}
+
+// ============================================================================
+// COMPACTION
+// ============================================================================
+
+/*
+ * bool --compact : réécrit l'archive avec les seuls blocs encore
+ * référencés, dans l'ordre des fichiers. Les blocs sont recopiés sans
+ * décompression ; une archive chiffrée reçoit un sel neuf et ses blocs
+ * sont rescellés (les index changent, donc les nonces aussi).
+ */
+int selp_compact(const char *archive) {
+    FILE *in = fopen(archive, "rb");
+    if (!in) return SELP_ERR_OPEN;
+
+    selp_toc_t toc;
+    int ret = selp_toc_load(in, &toc);
+    if (ret != SELP_OK) {
+        fclose(in);
+        return ret;
+    }
+    if (toc.header.version < 2) {
+        printf("❌ Archive format v1 cannot be compacted, recreate it with -c\n");
+        selp_toc_free(&toc);
+        fclose(in);
+        return SELP_ERR_VERSION;
+    }
+
+    char tmp[MAX_PATH + 16];
+    snprintf(tmp, sizeof(tmp), "%s.compact", archive);
+
+    uint64_t before = file_size(archive);
+    uint64_t block_count = toc.header.block_count;
+
+    uint32_t *map = malloc((block_count + 1) * sizeof(uint32_t));
+    uint32_t *ids = NULL;
+    size_t ids_cap = 0;
+    if (!map) {
+        selp_toc_free(&toc);
+        fclose(in);
+        return SELP_ERR_MEMORY;
+    }
+    for (uint64_t i = 0; i < block_count; i++) map[i] = UINT32_MAX;
+
+    struct stat st;
+    selp_writer_t writer;
+    ret = selp_writer_open(&writer, tmp, &toc.header);
+    // rename() remplace l'archive : la copie reprend ses permissions
+    if (ret == SELP_OK && (fstat(fileno(in), &st) != 0 ||
+                           fchmod(fileno(writer.fp), st.st_mode & 07777) != 0)) {
+        ret = SELP_ERR_WRITE;
+    }
+    if (ret == SELP_OK && !(toc.header.flags & SELP_FLAG_ENTRY_SUMS)) {
+        // Les entrées reprises n'ont pas de sommes à annoncer
+        writer.header.flags &= ~SELP_FLAG_ENTRY_SUMS;
+    }
+    if (ret == SELP_OK && toc.dict) {
+        ret = selp_writer_set_dict(&writer, toc.dict, (size_t)toc.header.dict_size);
+    }
+
+    uint64_t copied = 0;
+    for (uint64_t i = 0; ret == SELP_OK && i < toc.header.file_count; i++) {
+        const selp_file_entry_t *e = &toc.entries[i];
+
+        if (e->block_count > ids_cap) {
+            uint32_t *p = realloc(ids, e->block_count * sizeof(uint32_t));
+            if (!p) {
+                ret = SELP_ERR_MEMORY;
+                break;
+            }
+            ids = p;
+            ids_cap = e->block_count;
+        }
+
+        for (uint32_t r = 0; ret == SELP_OK && r < e->block_count; r++) {
+            uint32_t old = toc.refs[e->block_first + r];
+            if (map[old] == UINT32_MAX) {
+                ret = selp_writer_copy_block(&writer, in, &toc, &toc.blocks[old], &map[old]);
+                copied++;
+            }
+            ids[r] = map[old];
+        }
+
+        if (ret == SELP_OK) ret = selp_writer_keep_entry(&writer, e, ids, NULL);
+    }
+
+    if (ret == SELP_OK) {
+        ret = selp_writer_close(&writer);
+    } else {
+        selp_writer_abort(&writer);
+    }
+
+    free(map);
+    free(ids);
+    selp_toc_free(&toc);
+    fclose(in);
+
+    if (ret == SELP_OK && rename(tmp, archive) != 0) ret = SELP_ERR_WRITE;
+    if (ret != SELP_OK) {
+        unlink(tmp);
+        printf("❌ Compaction failed, archive left unchanged\n");
+        return ret;
+    }
+
+    uint64_t after = file_size(archive);
+    printf("✅ Archive compacted: %s\n", archive);
+    printf("   Blocks: %llu kept, %llu dropped\n",
+           (unsigned long long)copied, (unsigned long long)(block_count - copied));
+    printf("   Size:   %.2f KB -> %.2f KB\n", before / 1024.0, after / 1024.0);
+    return SELP_OK;
+}
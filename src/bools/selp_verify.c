@@ -11,32 +11,58 @@ int selp_verify(const char *path) {
     if (!fp) return SELP_ERR_OPEN;
     
     selp_header_t header;
-    if (fread(&header, sizeof(header), 1, fp) != 1) {
+    int result = selp_read_header(fp, &header, NULL);
+    if (result != SELP_OK) {
         fclose(fp);
-        return SELP_ERR_READ;
+        return result;
     }
     
-    // Lire les données
-    fseek(fp, 0, SEEK_END);
-    long data_size = ftell(fp) - sizeof(header);
-    fseek(fp, sizeof(header), SEEK_SET);
-    
-    uint8_t *data = malloc(data_size);
-    fread(data, 1, data_size, fp);
-    fclose(fp);
+    // Signature sur la TOC stockée (les données sont couvertes par les
+    // sommes par entrée), sur tout ce qui suit l'en-tête sinon
+    uint64_t start = (uint64_t)ftello(fp);
+    uint64_t len = UINT64_MAX;
+    if (header.flags & SELP_FLAG_SIG_TOC) {
+        start = header.toc_offset;
+        len = header.toc_size;
+    }
     
-    // Calculer la signature
     SHA256_CTX sha;
     SHA256_Init(&sha);
-    SHA256_Update(&sha, data, data_size);
+    
+    // Hachage direct depuis le mapping (MADV_SEQUENTIAL) par tranches ; ce
+    // qui dépasse la taille mappée (archive qui grandit) passe par fread
+    int fd = fileno(fp);
+    size_t map_size = 0;
+    const uint8_t *map = selp_map_file(fd, &map_size);
+    if (map && len == UINT64_MAX) len = map_size > start ? map_size - start : 0;
+    
+    uint64_t pos = start;
+    while (map && len > 0) {
+        size_t want = len < SELP_BLOCK_SIZE ? (size_t)len : SELP_BLOCK_SIZE;
+        if (!selp_map_covers(map, map_size, pos, want)) break;
+        SHA256_Update(&sha, map + pos, want);
+        pos += want;
+        len -= want;
+    }
+    if (map) selp_unmap_file(map, map_size);
+    
+    if (len > 0 && fseeko(fp, (off_t)pos, SEEK_SET) == 0) {
+        uint8_t buffer[65536];
+        size_t bytes;
+        while (len > 0) {
+            size_t want = len < sizeof(buffer) ? (size_t)len : sizeof(buffer);
+            if ((bytes = fread(buffer, 1, want, fp)) == 0) break;
+            SHA256_Update(&sha, buffer, bytes);
+            if (len != UINT64_MAX) len -= bytes;
+        }
+    }
+    fclose(fp);
+    
     uint8_t hash[32];
     SHA256_Final(hash, &sha);
     
     uint32_t signature[8];
-    for (int i = 0; i < 8; i++) {
-        signature[i] = (hash[i*4] << 24) | (hash[i*4+1] << 16) |
-                       (hash[i*4+2] << 8) | hash[i*4+3];
-    }
+    selp_signature_from_hash(hash, signature);
     
     // Comparer
     int valid = 1;
@@ -47,8 +73,6 @@ int selp_verify(const char *path) {
         }
     }
     
-    free(data);
-    
     if (valid) {
         printf("✅ Signature valide\n");
         printf("   Version: %d\n", header.version);
@@ -56,9 +80,19 @@ int selp_verify(const char *path) {
         printf("   Original: %llu octets\n", (unsigned long long)header.original_size);
         printf("   Compressé: %llu octets\n", (unsigned long long)header.compressed_size);
         printf("   Ratio: %.1f%%\n", 100.0 * header.compressed_size / header.original_size);
-        return SELP_OK;
     } else {
         printf("❌ Signature invalide !\n");
-        return SELP_ERR_SIGNATURE;
     }
+    
+    // Contrôle fichier par fichier : localise la corruption
+    int entries = SELP_OK;
+    if (header.flags & SELP_FLAG_ENTRY_SUMS) {
+        entries = selp_verify_entries(path, 0);
+        if (!valid && entries == SELP_OK) {
+            printf("⚠️  Tous les fichiers sont intacts : corruption hors données (en-tête/TOC)\n");
+        }
+    }
+    
+    if (entries != SELP_OK) return entries;
+    return valid ? SELP_OK : SELP_ERR_SIGNATURE;
 }
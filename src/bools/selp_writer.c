@@ -0,0 +1,853 @@
+#include "bool.h"
+#include <blake3.h>
+#include <openssl/rand.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define SELP_IO_BUFFER SELP_BLOCK_SIZE
+
+// ============================================================================
+// UTILITAIRES
+// ============================================================================
+
+// Tout ce qui suit l'en-tête passe par ici
+static int write_body(selp_writer_t *w, const void *data, size_t len) {
+    if (len == 0) return SELP_OK;
+    if (fwrite(data, 1, len, w->fp) != len) return SELP_ERR_WRITE;
+    return SELP_OK;
+}
+
+static int ensure_capacity(void **array, size_t *capacity, size_t needed, size_t elem_size) {
+    if (needed <= *capacity) return SELP_OK;
+
+    size_t cap = *capacity ? *capacity : 64;
+    while (cap < needed) cap *= 2;
+
+    void *p = realloc(*array, cap * elem_size);
+    if (!p) return SELP_ERR_MEMORY;
+    *array = p;
+    *capacity = cap;
+    return SELP_OK;
+}
+
+static int push_block(selp_writer_t *w, const selp_block_t *block, uint32_t *id) {
+    size_t n = w->header.block_count;
+    if (ensure_capacity((void **)&w->blocks, &w->block_cap, n + 1, sizeof(selp_block_t)) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+    w->blocks[n] = *block;
+    w->header.block_count++;
+    *id = (uint32_t)n;
+    return SELP_OK;
+}
+
+static int push_ref(selp_writer_t *w, uint32_t block) {
+    size_t n = w->header.ref_count;
+    if (ensure_capacity((void **)&w->refs, &w->ref_cap, n + 1, sizeof(uint32_t)) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+    w->refs[n] = block;
+    w->header.ref_count++;
+    return SELP_OK;
+}
+
+// ============================================================================
+// LIENS DURS
+// ============================================================================
+
+static size_t inode_slot(const selp_writer_t *w, uint64_t dev, uint64_t ino) {
+    return (size_t)((dev * 0x9E3779B97F4A7C15ULL) ^ (ino * 0xC2B2AE3D27D4EB4FULL)) &
+           (w->inode_cap - 1);
+}
+
+// Entrée déjà écrite pour ce (st_dev, st_ino)
+static int inode_find(const selp_writer_t *w, const struct stat *st, uint32_t *entry) {
+    if (w->inode_cap == 0) return 0;
+
+    size_t i = inode_slot(w, (uint64_t)st->st_dev, (uint64_t)st->st_ino);
+    while (w->inodes[i].used) {
+        if (w->inodes[i].dev == (uint64_t)st->st_dev && w->inodes[i].ino == (uint64_t)st->st_ino) {
+            *entry = w->inodes[i].entry;
+            return 1;
+        }
+        i = (i + 1) & (w->inode_cap - 1);
+    }
+    return 0;
+}
+
+static int inode_remember(selp_writer_t *w, const struct stat *st, uint32_t entry) {
+    if ((w->inode_count + 1) * 2 > w->inode_cap) {
+        size_t old_cap = w->inode_cap;
+        selp_inode_slot_t *old = w->inodes;
+
+        w->inode_cap = old_cap ? old_cap * 2 : 256;
+        w->inodes = calloc(w->inode_cap, sizeof(selp_inode_slot_t));
+        if (!w->inodes) {
+            w->inodes = old;
+            w->inode_cap = old_cap;
+            return SELP_ERR_MEMORY;
+        }
+        for (size_t k = 0; k < old_cap; k++) {
+            if (!old[k].used) continue;
+            size_t i = inode_slot(w, old[k].dev, old[k].ino);
+            while (w->inodes[i].used) i = (i + 1) & (w->inode_cap - 1);
+            w->inodes[i] = old[k];
+        }
+        free(old);
+    }
+
+    size_t i = inode_slot(w, (uint64_t)st->st_dev, (uint64_t)st->st_ino);
+    while (w->inodes[i].used) i = (i + 1) & (w->inode_cap - 1);
+    w->inodes[i].dev = (uint64_t)st->st_dev;
+    w->inodes[i].ino = (uint64_t)st->st_ino;
+    w->inodes[i].entry = entry;
+    w->inodes[i].used = 1;
+    w->inode_count++;
+    return SELP_OK;
+}
+
+static void entry_set_path(selp_file_entry_t *e, const char *stored_path) {
+    memset(e->path, 0, sizeof(e->path));
+    memset(e->name, 0, sizeof(e->name));
+    strncpy(e->path, stored_path, MAX_PATH - 1);
+    const char *base = strrchr(stored_path, '/');
+    base = base ? base + 1 : stored_path;
+    strncpy(e->name, base, sizeof(e->name) - 1);
+}
+
+// Second nom d'un inode déjà archivé : entrée qui partage ses blocs
+static int add_link(selp_writer_t *w, const char *stored_path, uint32_t target) {
+    if (ensure_capacity((void **)&w->entries, &w->entry_cap, w->entry_count + 1,
+                        sizeof(selp_file_entry_t)) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+
+    selp_file_entry_t *e = &w->entries[w->entry_count];
+    *e = w->entries[target];
+    entry_set_path(e, stored_path);
+    e->type = SELP_ENTRY_HARDLINK;
+    e->link = target;
+
+    w->entry_count++;
+    w->header.file_count++;
+    w->hardlinks++;
+    return SELP_OK;
+}
+
+// ============================================================================
+// STOCKAGE DES DONNÉES
+// ============================================================================
+
+// Lit au plus len octets sans dépasser *left (fin de l'extent courant)
+static ssize_t read_extent(int fd, uint8_t *buf, size_t len, uint64_t *left) {
+    if (len > *left) len = (size_t)*left;
+    if (len == 0) return 0;
+
+    ssize_t n = read(fd, buf, len);
+    if (n > 0) *left -= (uint64_t)n;
+    return n;
+}
+
+// CRC32C + BLAKE3 du fichier courant, sur les données originales
+static void sum_update(selp_writer_t *w, const uint8_t *data, size_t len) {
+    w->file_crc = selp_crc32c(w->file_crc, data, len);
+    blake3_hasher_update(&w->file_hasher, data, len);
+}
+
+// Écrit un bloc, compressé si c'est rentable, puis chiffré si l'archive
+// l'est. Remplit offset/stored_size/flags. Le nonce GCM est l'index que
+// push_block() va attribuer au bloc.
+static int store_block(selp_writer_t *w, const uint8_t *data, size_t len, selp_block_t *block) {
+    block->offset = (uint64_t)ftello(w->fp);
+    block->size = len;
+    block->stored_size = len;
+    block->flags = 0;
+
+    const uint8_t *payload = data;
+    size_t payload_len = len;
+
+    if (w->cctx) {
+        size_t csize;
+        if (w->use_dict && w->cdict) {
+            csize = ZSTD_compress_usingCDict(w->cctx, w->zbuf, w->zbuf_cap, data, len, w->cdict);
+        } else {
+            csize = ZSTD_compressCCtx(w->cctx, w->zbuf, w->zbuf_cap, data, len, w->zlevel);
+        }
+        if (ZSTD_isError(csize)) return SELP_ERR_COMPRESS;
+
+        // Bloc incompressible : stocké brut
+        if (csize < len) {
+            payload = w->zbuf;
+            payload_len = csize;
+            block->flags = SELP_BLOCK_ZSTD | ((w->use_dict && w->cdict) ? SELP_BLOCK_DICT : 0);
+        }
+    }
+
+    if (w->cipher) {
+        if (selp_cipher_seal(w->cipher, w->header.block_count, w->header.nonce_salt,
+                             payload, payload_len, w->cbuf) != SELP_OK) {
+            return SELP_ERR_CRYPTO;
+        }
+        payload = w->cbuf;
+        payload_len += SELP_GCM_TAG_SIZE;
+        block->flags |= SELP_BLOCK_AES;
+        block->reserved = w->header.nonce_salt;
+    }
+
+    block->stored_size = payload_len;
+    return write_body(w, payload, payload_len);
+}
+
+// Avec compression ou chiffrement : blocs de SELP_BLOCK_SIZE traités
+// indépendamment
+static int add_whole_compressed(selp_writer_t *w, int fd, selp_file_entry_t *e, uint64_t left) {
+    uint64_t total = 0;
+
+    for (;;) {
+        size_t len = 0;
+        while (len < SELP_BLOCK_SIZE) {
+            ssize_t n = read_extent(fd, w->buffer + len, SELP_BLOCK_SIZE - len, &left);
+            if (n < 0) return SELP_ERR_READ;
+            if (n == 0) break;
+            len += (size_t)n;
+        }
+        if (len == 0) break;
+        sum_update(w, w->buffer, len);
+
+        selp_block_t block;
+        memset(&block, 0, sizeof(block));
+        int ret = store_block(w, w->buffer, len, &block);
+        if (ret != SELP_OK) return ret;
+
+        uint32_t id;
+        if (push_block(w, &block, &id) != SELP_OK) return SELP_ERR_MEMORY;
+        if (push_ref(w, id) != SELP_OK) return SELP_ERR_MEMORY;
+        e->block_count++;
+        total += len;
+
+        if (len < SELP_BLOCK_SIZE) break;
+    }
+
+    e->size += total;
+    return SELP_OK;
+}
+
+// Fichier (ou extent) entier dans un seul bloc
+static int add_whole(selp_writer_t *w, int fd, selp_file_entry_t *e, uint64_t left) {
+    if (w->cctx || w->cipher) return add_whole_compressed(w, fd, e, left);
+
+    uint64_t offset = (uint64_t)ftello(w->fp);
+    uint64_t total = 0;
+    ssize_t n;
+
+    while ((n = read_extent(fd, w->buffer, SELP_IO_BUFFER, &left)) > 0) {
+        sum_update(w, w->buffer, (size_t)n);
+        if (write_body(w, w->buffer, (size_t)n) != SELP_OK) return SELP_ERR_WRITE;
+        total += (uint64_t)n;
+    }
+    if (n < 0) return SELP_ERR_READ;
+
+    e->size += total;
+    if (total == 0) return SELP_OK;
+
+    selp_block_t block;
+    memset(&block, 0, sizeof(block));
+    block.offset = offset;
+    block.size = total;
+    block.stored_size = total;
+
+    uint32_t id;
+    if (push_block(w, &block, &id) != SELP_OK) return SELP_ERR_MEMORY;
+    if (push_ref(w, id) != SELP_OK) return SELP_ERR_MEMORY;
+    e->block_count++;
+    return SELP_OK;
+}
+
+// Un chunk : réutilisé s'il est déjà dans l'archive, écrit sinon
+static int add_chunk(selp_writer_t *w, const uint8_t *data, size_t len) {
+    uint8_t hash[BLAKE3_OUT_LEN];
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, len);
+    blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
+
+    uint32_t id;
+    if (selp_chunk_index_find(&w->index, hash, &id)) {
+        w->dedup_hits++;
+        w->dedup_saved += len;
+        return push_ref(w, id);
+    }
+
+    selp_block_t block;
+    memset(&block, 0, sizeof(block));
+    memcpy(block.hash, hash, sizeof(block.hash));
+
+    int ret = store_block(w, data, len, &block);
+    if (ret != SELP_OK) return ret;
+    if (push_block(w, &block, &id) != SELP_OK) return SELP_ERR_MEMORY;
+    if (selp_chunk_index_insert(&w->index, hash, id) != SELP_OK) return SELP_ERR_MEMORY;
+    return push_ref(w, id);
+}
+
+// Découpage FastCDC en flux : le tampon garde toujours au moins
+// SELP_CDC_MAX_SIZE octets d'avance tant que le fichier n'est pas fini.
+static int add_chunked(selp_writer_t *w, int fd, selp_file_entry_t *e, uint64_t left) {
+    size_t len = 0, pos = 0;
+    int eof = 0;
+    uint64_t total = 0;
+
+    for (;;) {
+        if (!eof && len - pos < SELP_CDC_MAX_SIZE) {
+            memmove(w->buffer, w->buffer + pos, len - pos);
+            len -= pos;
+            pos = 0;
+            while (len < SELP_IO_BUFFER) {
+                ssize_t n = read_extent(fd, w->buffer + len, SELP_IO_BUFFER - len, &left);
+                if (n < 0) return SELP_ERR_READ;
+                if (n == 0) {
+                    eof = 1;
+                    break;
+                }
+                len += (size_t)n;
+            }
+        }
+        if (pos == len) break;
+
+        size_t cut = selp_cdc_cut(w->buffer + pos, len - pos);
+        sum_update(w, w->buffer + pos, cut);
+        int ret = add_chunk(w, w->buffer + pos, cut);
+        if (ret != SELP_OK) return ret;
+
+        e->block_count++;
+        pos += cut;
+        total += cut;
+    }
+
+    e->size += total;
+    return SELP_OK;
+}
+
+static int add_data(selp_writer_t *w, int fd, selp_file_entry_t *e, uint64_t left) {
+    return (w->header.flags & SELP_FLAG_DEDUP) ? add_chunked(w, fd, e, left)
+                                               : add_whole(w, fd, e, left);
+}
+
+// Trou : un bloc sans données, compté par sa longueur dans les sommes
+static int add_hole(selp_writer_t *w, selp_file_entry_t *e, uint64_t len) {
+    selp_block_t block;
+    memset(&block, 0, sizeof(block));
+    block.size = len;
+    block.flags = SELP_BLOCK_HOLE;
+
+    selp_sum_hole(&w->file_crc, &w->file_hasher, len);
+
+    uint32_t id;
+    if (push_block(w, &block, &id) != SELP_OK) return SELP_ERR_MEMORY;
+    if (push_ref(w, id) != SELP_OK) return SELP_ERR_MEMORY;
+    e->block_count++;
+    e->size += len;
+    w->sparse_saved += len;
+    return SELP_OK;
+}
+
+// Moins de blocs alloués que la taille : SEEK_HOLE dit s'il y a vraiment des trous
+static int is_sparse(int fd, const struct stat *st) {
+    if (st->st_size <= 0 || (uint64_t)st->st_blocks * 512 >= (uint64_t)st->st_size) return 0;
+
+    off_t hole = lseek(fd, 0, SEEK_HOLE);
+    lseek(fd, 0, SEEK_SET);
+    return hole >= 0 && hole < st->st_size;
+}
+
+// Fichier creux : seuls les extents de données (SEEK_DATA/SEEK_HOLE) sont lus
+static int add_sparse(selp_writer_t *w, int fd, selp_file_entry_t *e, uint64_t size) {
+    uint64_t pos = 0;
+
+    while (pos < size) {
+        off_t data = lseek(fd, (off_t)pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno != ENXIO) return SELP_ERR_READ;
+            data = (off_t)size;                 // Trou jusqu'à la fin
+        }
+        if ((uint64_t)data > size) data = (off_t)size;
+
+        if ((uint64_t)data > pos) {
+            int ret = add_hole(w, e, (uint64_t)data - pos);
+            if (ret != SELP_OK) return ret;
+            pos = (uint64_t)data;
+        }
+        if (pos >= size) break;
+
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0 || (uint64_t)hole > size) hole = (off_t)size;
+        if (lseek(fd, data, SEEK_SET) < 0) return SELP_ERR_READ;
+
+        uint64_t want = (uint64_t)(hole - data);
+        uint64_t before = e->size;
+        int ret = add_data(w, fd, e, want);
+        if (ret != SELP_OK) return ret;
+        if (e->size - before < want) break;     // Fichier raccourci pendant la lecture
+
+        pos = (uint64_t)hole;
+    }
+    return SELP_OK;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Tampons, index de dédup, contexte zstd et tampon de chiffrement
+static int writer_setup(selp_writer_t *w) {
+    w->buffer = malloc(SELP_IO_BUFFER);
+    if (!w->buffer) return SELP_ERR_MEMORY;
+
+    if (w->header.flags & SELP_FLAG_DEDUP) {
+        if (selp_chunk_index_init(&w->index, 4096) != SELP_OK) {
+            selp_writer_abort(w);
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    w->zlevel = selp_zstd_level(w->header.compression);
+    if (w->zlevel > 0) {
+        w->cctx = ZSTD_createCCtx();
+        w->zbuf_cap = ZSTD_compressBound(SELP_BLOCK_SIZE);
+        w->zbuf = malloc(w->zbuf_cap);
+        if (!w->cctx || !w->zbuf) {
+            selp_writer_abort(w);
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    if (w->header.encryption != SELP_CRYPT_NONE) {
+        w->cipher = calloc(1, sizeof(selp_cipher_t));
+        w->cbuf = malloc(ZSTD_compressBound(SELP_BLOCK_SIZE) + SELP_GCM_TAG_SIZE);
+        if (!w->cipher || !w->cbuf) {
+            selp_writer_abort(w);
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    return SELP_OK;
+}
+
+int selp_writer_open(selp_writer_t *w, const char *output, const selp_header_t *tmpl) {
+    memset(w, 0, sizeof(selp_writer_t));
+
+    w->header = *tmpl;
+    memcpy(w->header.magic, SELP_MAGIC, 4);
+    w->header.version = SELP_VERSION;
+    w->header.original_size = 0;
+    w->header.compressed_size = 0;
+    w->header.file_count = 0;
+    w->header.toc_offset = 0;
+    w->header.block_count = 0;
+    w->header.ref_count = 0;
+    w->header.dict_offset = 0;
+    w->header.dict_size = 0;
+    w->header.toc_size = 0;
+    w->header.nonce_salt = 0;
+    w->header.flags &= ~SELP_FLAG_TOC_ZSTD;
+    w->header.flags |= SELP_FLAG_ENTRY_SUMS | SELP_FLAG_SIG_TOC;
+    memset(w->header.signature, 0, sizeof(w->header.signature));
+
+    int ret = writer_setup(w);
+    if (ret != SELP_OK) return ret;
+
+    // Chiffrement : sel et préfixe de nonce neufs pour chaque archive
+    if (w->header.encryption != SELP_CRYPT_NONE) {
+        w->header.kdf_iterations = selp_kdf_iterations(w->header.encryption);
+        if (RAND_bytes(w->header.kdf_salt, SELP_KDF_SALT_SIZE) != 1 ||
+            RAND_bytes(w->header.nonce_prefix, sizeof(w->header.nonce_prefix)) != 1 ||
+            selp_cipher_derive(w->cipher, &w->header) != SELP_OK) {
+            free(w->cipher);
+            w->cipher = NULL;
+            selp_writer_abort(w);
+            return SELP_ERR_CRYPTO;
+        }
+    }
+
+    w->fp = fopen(output, "wb");
+    if (!w->fp) {
+        selp_writer_abort(w);
+        return SELP_ERR_OPEN;
+    }
+
+    // En-tête provisoire, réécrit par selp_writer_close()
+    if (fwrite(&w->header, sizeof(selp_header_t), 1, w->fp) != 1) {
+        selp_writer_abort(w);
+        return SELP_ERR_WRITE;
+    }
+
+    return SELP_OK;
+}
+
+// Le dictionnaire est écrit juste après l'en-tête : à appeler avant le
+// premier selp_writer_add_file()
+int selp_writer_set_dict(selp_writer_t *w, const uint8_t *dict, size_t size) {
+    if (!w->cctx || size == 0) return SELP_OK;
+    if (w->entry_count > 0 || w->header.dict_size > 0) return SELP_ERR_WRITE;
+
+    w->cdict = ZSTD_createCDict(dict, size, w->zlevel);
+    if (!w->cdict) return SELP_ERR_MEMORY;
+
+    w->header.dict_offset = (uint64_t)ftello(w->fp);
+    w->header.dict_size = size;
+
+    // Le dictionnaire est fait d'extraits des fichiers : chiffré lui aussi
+    if (w->cipher) {
+        if (selp_cipher_seal(w->cipher, SELP_NONCE_DICT, 0, dict, size, w->cbuf) != SELP_OK) {
+            return SELP_ERR_CRYPTO;
+        }
+        return write_body(w, w->cbuf, size + SELP_GCM_TAG_SIZE);
+    }
+    return write_body(w, dict, size);
+}
+
+int selp_writer_add_file(selp_writer_t *w, const char *src, const char *stored_path,
+                         const struct stat *st) {
+    uint32_t target;
+    if (st->st_nlink > 1 && inode_find(w, st, &target)) {
+        return add_link(w, stored_path, target);
+    }
+
+    int fd = open(src, O_RDONLY);
+    if (fd < 0) return SELP_ERR_OPEN;
+
+    if (ensure_capacity((void **)&w->entries, &w->entry_cap, w->entry_count + 1,
+                        sizeof(selp_file_entry_t)) != SELP_OK) {
+        close(fd);
+        return SELP_ERR_MEMORY;
+    }
+
+    selp_file_entry_t *e = &w->entries[w->entry_count];
+    memset(e, 0, sizeof(selp_file_entry_t));
+    entry_set_path(e, stored_path);
+
+    e->type = SELP_ENTRY_FILE;
+    e->permissions = st->st_mode;
+    e->mtime = st->st_mtime;
+    e->block_first = (uint32_t)w->header.ref_count;
+    w->use_dict = st->st_size <= SELP_DICT_FILE_MAX;
+    w->file_crc = 0;
+    blake3_hasher_init(&w->file_hasher);
+
+    int ret = is_sparse(fd, st) ? add_sparse(w, fd, e, (uint64_t)st->st_size)
+                                : add_data(w, fd, e, UINT64_MAX);
+    close(fd);
+    if (ret != SELP_OK) return ret;
+    if (st->st_nlink > 1 && inode_remember(w, st, (uint32_t)w->entry_count) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+
+    e->crc32 = w->file_crc;
+    blake3_hasher_finalize(&w->file_hasher, e->hash, sizeof(e->hash));
+
+    if (e->block_count > 0) {
+        e->offset = w->blocks[w->refs[e->block_first]].offset;
+    }
+
+    w->entry_count++;
+    w->header.file_count++;
+    w->header.original_size += e->size;
+    return SELP_OK;
+}
+
+// ============================================================================
+// AJOUT À UNE ARCHIVE EXISTANTE (--update, --compact)
+// ============================================================================
+
+/*
+ * Rouvre une archive v3 pour y ajouter des données : les nouveaux blocs,
+ * puis la nouvelle TOC, sont écrits après la fin actuelle du fichier.
+ * L'ancienne TOC et les blocs qui ne sont plus référencés restent en
+ * place (récupérés par selp_compact). Tous les anciens blocs gardent leur
+ * index et leur sel ; les nouveaux continuent la numérotation sous un sel
+ * de nonce tiré pour cette session. En cas d'échec, selp_writer_abort()
+ * tronque le fichier à sa taille d'origine : un nouvel essai réutilise les
+ * mêmes index et le même toc_offset, mais pas le même sel, donc jamais
+ * les mêmes nonces GCM avec la même clé.
+ */
+int selp_writer_reopen(selp_writer_t *w, const char *archive, const selp_toc_t *toc) {
+    memset(w, 0, sizeof(selp_writer_t));
+
+    // L'en-tête réécrit doit avoir la taille de l'ancien
+    if (toc->header.version < 3) return SELP_ERR_VERSION;
+
+    w->header = toc->header;
+    w->header.version = SELP_VERSION;
+    w->header.file_count = 0;
+    w->header.original_size = 0;
+    w->header.ref_count = 0;
+    w->header.flags &= ~SELP_FLAG_TOC_ZSTD;
+    // Signée par sa nouvelle TOC : les anciennes données ne sont pas relues
+    w->header.flags |= SELP_FLAG_SIG_TOC;
+
+    int ret = writer_setup(w);
+    if (ret != SELP_OK) return ret;
+
+    if (w->cipher && (!toc->cipher || selp_cipher_clone(w->cipher, toc->cipher) != SELP_OK)) {
+        selp_writer_abort(w);
+        return SELP_ERR_CRYPTO;
+    }
+    // Sel non nul et distinct de celui de la TOC en place
+    while (w->cipher && (w->header.nonce_salt == 0 || w->header.nonce_salt == toc->header.nonce_salt)) {
+        if (RAND_bytes((uint8_t *)&w->header.nonce_salt, sizeof(w->header.nonce_salt)) != 1) {
+            selp_writer_abort(w);
+            return SELP_ERR_CRYPTO;
+        }
+    }
+    if (w->cctx && toc->dict && toc->header.dict_size > 0) {
+        w->cdict = ZSTD_createCDict(toc->dict, toc->header.dict_size, w->zlevel);
+        if (!w->cdict) {
+            selp_writer_abort(w);
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    // Anciens blocs repris tels quels ; en dédup leurs chunks restent réutilisables
+    size_t n = toc->header.block_count;
+    if (ensure_capacity((void **)&w->blocks, &w->block_cap, n + 1, sizeof(selp_block_t)) != SELP_OK) {
+        selp_writer_abort(w);
+        return SELP_ERR_MEMORY;
+    }
+    if (n) memcpy(w->blocks, toc->blocks, n * sizeof(selp_block_t));
+    for (size_t i = 0; i < n && (w->header.flags & SELP_FLAG_DEDUP); i++) {
+        if (selp_chunk_index_insert(&w->index, toc->blocks[i].hash, (uint32_t)i) != SELP_OK) {
+            selp_writer_abort(w);
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    w->fp = fopen(archive, "r+b");
+    if (!w->fp) {
+        selp_writer_abort(w);
+        return SELP_ERR_OPEN;
+    }
+
+    if (fseeko(w->fp, 0, SEEK_END) != 0) {
+        selp_writer_abort(w);
+        return SELP_ERR_READ;
+    }
+
+    w->append_from = (uint64_t)ftello(w->fp);
+    return SELP_OK;
+}
+
+// Reprend une entrée sans relire le fichier. blocks : index (dans ce
+// writer) des entry->block_count blocs du fichier. st met à jour
+// permissions et mtime s'il est fourni.
+int selp_writer_keep_entry(selp_writer_t *w, const selp_file_entry_t *entry,
+                           const uint32_t *blocks, const struct stat *st) {
+    // Les liens durs sont recalculés d'après le dossier scanné
+    uint32_t target;
+    if (st && st->st_nlink > 1 && inode_find(w, st, &target)) {
+        return add_link(w, entry->path, target);
+    }
+
+    if (ensure_capacity((void **)&w->entries, &w->entry_cap, w->entry_count + 1,
+                        sizeof(selp_file_entry_t)) != SELP_OK) {
+        return SELP_ERR_MEMORY;
+    }
+
+    selp_file_entry_t *e = &w->entries[w->entry_count];
+    *e = *entry;
+    e->block_first = (uint32_t)w->header.ref_count;
+
+    for (uint32_t r = 0; r < entry->block_count; r++) {
+        if (blocks[r] >= w->header.block_count) return SELP_ERR_READ;
+        if (push_ref(w, blocks[r]) != SELP_OK) return SELP_ERR_MEMORY;
+    }
+    if (e->block_count > 0) e->offset = w->blocks[blocks[0]].offset;
+
+    if (st) {
+        e->permissions = st->st_mode;
+        e->mtime = st->st_mtime;
+        e->type = SELP_ENTRY_FILE;
+        e->link = 0;
+        if (st->st_nlink > 1 && inode_remember(w, st, (uint32_t)w->entry_count) != SELP_OK) {
+            return SELP_ERR_MEMORY;
+        }
+    }
+
+    w->entry_count++;
+    w->header.file_count++;
+    if (e->type != SELP_ENTRY_HARDLINK) w->header.original_size += e->size;
+    else w->hardlinks++;
+    return SELP_OK;
+}
+
+// Recopie un bloc stocké d'une autre archive sans le décompresser.
+// Un bloc chiffré est rouvert avec la clé source puis rescellé avec
+// celle du writer sous son nouvel index et son sel.
+int selp_writer_copy_block(selp_writer_t *w, FILE *in, const selp_toc_t *toc,
+                           const selp_block_t *block, uint32_t *id) {
+    selp_block_t copy = *block;
+    copy.offset = (uint64_t)ftello(w->fp);
+    copy.reserved = (block->flags & SELP_BLOCK_AES) ? w->header.nonce_salt : 0;
+
+    if (fseeko(in, (off_t)block->offset, SEEK_SET) != 0) return SELP_ERR_READ;
+
+    if (!(block->flags & SELP_BLOCK_AES)) {
+        uint64_t len = block->stored_size;
+        while (len > 0) {
+            size_t want = len < SELP_IO_BUFFER ? (size_t)len : SELP_IO_BUFFER;
+            if (fread(w->buffer, 1, want, in) != want) return SELP_ERR_READ;
+            if (write_body(w, w->buffer, want) != SELP_OK) return SELP_ERR_WRITE;
+            len -= want;
+        }
+        return push_block(w, &copy, id);
+    }
+
+    size_t bound = ZSTD_compressBound(SELP_BLOCK_SIZE) + SELP_GCM_TAG_SIZE;
+    if (!w->cipher || !toc->cipher) return SELP_ERR_CRYPTO;
+    if (block->stored_size < SELP_GCM_TAG_SIZE || block->stored_size > bound) return SELP_ERR_READ;
+
+    size_t stored = (size_t)block->stored_size;
+    size_t plain_len = stored - SELP_GCM_TAG_SIZE;
+    uint8_t *sealed = malloc(stored);
+    uint8_t *plain = malloc(plain_len + 1);
+    int ret = (sealed && plain) ? SELP_OK : SELP_ERR_MEMORY;
+
+    if (ret == SELP_OK && fread(sealed, 1, stored, in) != stored) ret = SELP_ERR_READ;
+    if (ret == SELP_OK &&
+        selp_cipher_open(toc->cipher, (uint64_t)(block - toc->blocks), block->reserved,
+                         sealed, stored, plain) != SELP_OK) {
+        ret = SELP_ERR_CRYPTO;
+    }
+    if (ret == SELP_OK &&
+        selp_cipher_seal(w->cipher, w->header.block_count, w->header.nonce_salt,
+                         plain, plain_len, w->cbuf) != SELP_OK) {
+        ret = SELP_ERR_CRYPTO;
+    }
+    if (ret == SELP_OK) ret = write_body(w, w->cbuf, stored);
+    if (ret == SELP_OK) ret = push_block(w, &copy, id);
+
+    free(sealed);
+    free(plain);
+    return ret;
+}
+
+int selp_writer_close(selp_writer_t *w) {
+    int ret = SELP_OK;
+
+    w->header.toc_offset = (uint64_t)ftello(w->fp);
+
+    // La TOC est sérialisée d'un bloc ; compressée quand l'archive l'est
+    // (les entrées à taille fixe se compressent très bien)
+    size_t entries_size = w->entry_count * sizeof(selp_file_entry_t);
+    size_t blocks_size = w->header.block_count * sizeof(selp_block_t);
+    size_t refs_size = w->header.ref_count * sizeof(uint32_t);
+    size_t raw_size = entries_size + blocks_size + refs_size;
+
+    uint8_t *raw = malloc(raw_size + 1);
+    if (!raw) {
+        selp_writer_abort(w);
+        return SELP_ERR_MEMORY;
+    }
+    if (entries_size) memcpy(raw, w->entries, entries_size);
+    if (blocks_size) memcpy(raw + entries_size, w->blocks, blocks_size);
+    if (refs_size) memcpy(raw + entries_size + blocks_size, w->refs, refs_size);
+
+    const uint8_t *toc = raw;
+    size_t toc_size = raw_size;
+    uint8_t *packed = NULL;
+
+    if (w->cctx) {
+        size_t cap = ZSTD_compressBound(raw_size);
+        packed = malloc(cap);
+        if (packed) {
+            size_t n = ZSTD_compressCCtx(w->cctx, packed, cap, raw, raw_size, w->zlevel);
+            if (!ZSTD_isError(n) && n < raw_size) {
+                toc = packed;
+                toc_size = n;
+                w->header.flags |= SELP_FLAG_TOC_ZSTD;
+            }
+        }
+    }
+
+    // TOC chiffrée : les noms de fichiers ne sont pas visibles sans la clé
+    uint8_t *sealed = NULL;
+    if (w->cipher) {
+        sealed = malloc(toc_size + SELP_GCM_TAG_SIZE);
+        if (!sealed || selp_cipher_seal(w->cipher, SELP_NONCE_TOC | w->header.toc_offset,
+                                                w->header.nonce_salt, toc, toc_size, sealed) != SELP_OK) {
+            ret = SELP_ERR_CRYPTO;
+        } else {
+            toc = sealed;
+            toc_size += SELP_GCM_TAG_SIZE;
+        }
+    }
+
+    w->header.toc_size = toc_size;
+    if (ret == SELP_OK && write_body(w, toc, toc_size) != SELP_OK) ret = SELP_ERR_WRITE;
+
+    uint8_t hash[32];
+    SHA256(toc, toc_size, hash);
+    selp_signature_from_hash(hash, w->header.signature);
+
+    free(sealed);
+    free(packed);
+    free(raw);
+
+    w->header.compressed_size = (uint64_t)ftello(w->fp) - sizeof(selp_header_t);
+
+    // --update : nouvelle TOC sur disque avant de basculer l'en-tête dessus
+    if (ret == SELP_OK && w->append_from && fflush(w->fp) != 0) ret = SELP_ERR_WRITE;
+
+    if (ret == SELP_OK) {
+        fseeko(w->fp, 0, SEEK_SET);
+        if (fwrite(&w->header, sizeof(selp_header_t), 1, w->fp) != 1) ret = SELP_ERR_WRITE;
+    }
+
+    // Échec d'un --update : selp_writer_abort() tronque à la taille d'origine
+    if (ret != SELP_OK && w->append_from) {
+        selp_writer_abort(w);
+        return ret;
+    }
+
+    if (fclose(w->fp) != 0 && ret == SELP_OK) ret = SELP_ERR_WRITE;
+    w->fp = NULL;
+
+    selp_writer_abort(w);
+    return ret;
+}
+
+void selp_writer_abort(selp_writer_t *w) {
+    // --update interrompu : l'archive d'origine reste intacte
+    if (w->fp && w->append_from) {
+        fflush(w->fp);
+        ftruncate(fileno(w->fp), (off_t)w->append_from);
+    }
+    if (w->fp) fclose(w->fp);
+    w->fp = NULL;
+    w->append_from = 0;
+
+    free(w->entries);
+    free(w->blocks);
+    free(w->refs);
+    free(w->buffer);
+    free(w->zbuf);
+    selp_chunk_index_free(&w->index);
+    ZSTD_freeCDict(w->cdict);
+    ZSTD_freeCCtx(w->cctx);
+    if (w->cipher) selp_cipher_free(w->cipher);
+    free(w->cipher);
+    free(w->cbuf);
+    free(w->inodes);
+
+    w->entries = NULL;
+    w->blocks = NULL;
+    w->refs = NULL;
+    w->buffer = NULL;
+    w->zbuf = NULL;
+    w->cdict = NULL;
+    w->cctx = NULL;
+    w->cipher = NULL;
+    w->cbuf = NULL;
+    w->inodes = NULL;
+    w->inode_cap = 0;
+    w->inode_count = 0;
+}
@@ -0,0 +1,73 @@
+#include "bool.h"
+#include <zdict.h>
+
+// ============================================================================
+// NIVEAUX
+// ============================================================================
+
+int selp_zstd_level(int compression) {
+    switch (compression) {
+        case SELP_COMPRESS_FAST:  return 3;
+        case SELP_COMPRESS_BEST:  return 12;
+        case SELP_COMPRESS_ULTRA: return 19;
+        default:                  return 0;
+    }
+}
+
+// ============================================================================
+// ENTRAÎNEMENT DU DICTIONNAIRE
+// ============================================================================
+
+/*
+ * Concatène les petits fichiers dans un tampon d'échantillons (au plus
+ * SELP_DICT_SAMPLE_BUDGET octets, soit ~100x la taille du dictionnaire
+ * comme le recommande zstd) puis lance ZDICT_trainFromBuffer.
+ * Quand il y a trop de fichiers on en prend un sur "stride" pour couvrir
+ * toute l'arborescence plutôt que le premier sous-dossier.
+ * Retourne la taille du dictionnaire, 0 si l'entraînement échoue.
+ */
+size_t selp_dict_train(const char *const *paths, size_t count, uint8_t *dict, size_t capacity) {
+    if (count < SELP_DICT_MIN_SAMPLES) return 0;
+
+    uint8_t *samples = malloc(SELP_DICT_SAMPLE_BUDGET);
+    size_t *sizes = malloc(count * sizeof(size_t));
+    if (!samples || !sizes) {
+        free(samples);
+        free(sizes);
+        return 0;
+    }
+
+    size_t stride = count * SELP_DICT_FILE_MAX / SELP_DICT_SAMPLE_BUDGET + 1;
+    size_t used = 0;
+    unsigned n = 0;
+
+    for (size_t i = 0; i < count; i += stride) {
+        FILE *fp = fopen(paths[i], "rb");
+        if (!fp) continue;
+
+        size_t room = SELP_DICT_SAMPLE_BUDGET - used;
+        if (room > SELP_DICT_FILE_MAX) room = SELP_DICT_FILE_MAX;
+
+        size_t got = fread(samples + used, 1, room, fp);
+        fclose(fp);
+
+        if (got == 0) continue;
+        sizes[n++] = got;
+        used += got;
+        if (used == SELP_DICT_SAMPLE_BUDGET) break;
+    }
+
+    // Un dictionnaire trop gros pour le corpus coûte plus qu'il ne rapporte :
+    // on le limite à ~1/16 des échantillons.
+    if (capacity > used / 16) capacity = used / 16;
+
+    size_t dict_size = 0;
+    if (n >= SELP_DICT_MIN_SAMPLES && capacity >= SELP_DICT_MIN_SIZE) {
+        size_t ret = ZDICT_trainFromBuffer(dict, capacity, samples, sizes, n);
+        if (!ZDICT_isError(ret)) dict_size = ret;
+    }
+
+    free(samples);
+    free(sizes);
+    return dict_size;
+}
@@ -3,6 +3,13 @@
 #endif
 
 #include "apkm.h"
+#include "core.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <sys/epoll.h>
@@ -11,8 +18,12 @@
 #include <sys/eventfd.h>
 #include <sys/inotify.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <sys/xattr.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <time.h>
 #include <cap-ng.h>
 #include <lz4.h>
@@ -21,9 +32,11 @@
 #include <jansson.h>
 #include <sqlite3.h>
 #include <curl/curl.h>
+#include <openssl/evp.h>
 #include <archive.h>
 #include <archive_entry.h>
 #include <libgen.h>
+#include <limits.h>
 #include <sys/stat.h>
 
 // ============================================================================
@@ -33,6 +46,8 @@
 #define MAX_PACKAGES 1024
 #define MAX_DEPENDENCIES 256
 #define CACHE_TTL 3600 // 1 heure
+#define CACHE_STALE (24 * 3600) // servi périmé pendant la revalidation
+#define HUB_RETRY_DELAY 60 // hub injoignable : pas de nouvel essai avant
 #define ZARCH_API_TIMEOUT 30
 
 #ifndef SIG_BLOCK
@@ -79,6 +94,8 @@ typedef struct {
     int signal_fd;
     int timer_fd;
     int inotify_fd;
+    CURLM *multi;           // revalidations HTTP d'apkmd (NULL hors démon)
+    int curl_timer_fd;
     int fanotify_fd;
     security_level_t security;
     progress_callback_t progress_cb;
@@ -105,6 +122,27 @@ struct curl_response {
 
 static apkm_context_t ctx = {0};
 
+// Surveillance inotify des sources d'état (voir core.h)
+#define WATCH_MASK (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+                    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+typedef struct {
+    char dir[512];
+    char name[64];      // préfixe du fichier surveillé, "" = tout le répertoire
+    unsigned state;
+    int wd;             // -1 : répertoire absent
+    int retry;          // réessayer tant qu'il est absent (sources de base)
+} state_watch_t;
+
+static state_watch_t *watches = NULL;
+static int watch_count = 0;
+static int watch_capacity = 0;
+static int watch_ready = 0;
+static int watch_armed = 0;     // apkm_watch_init : processus durable (apkmd)
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned volatile_states = 0;  // sources non surveillables : jamais en cache
+static unsigned long state_gen[3];
+
 // ============================================================================
 // CALLBACKS CURL
 // ============================================================================
@@ -131,19 +169,22 @@ static size_t response_callback(void *ptr, size_t size, size_t nmemb, void *user
 // BASE DE DONNÉES SQLITE DES PACKAGES
 // ============================================================================
 
-static int db_init(void) {
-    mkdir(APKM_DB_PATH, 0755);
-    
-    char db_path[512];
-    snprintf(db_path, sizeof(db_path), "%s/packages.db", APKM_DB_PATH);
-    
-    sqlite3 *db;
-    int rc = sqlite3_open(db_path, &db);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "[DB] Cannot open database: %s\n", sqlite3_errmsg(db));
-        return -1;
-    }
-    
+// Chemins d'état, déplaçables par l'environnement (tests, racine isolée)
+const char *apkm_conf_path(void) {
+    const char *path = getenv("APKM_CONF");
+    return path && *path ? path : APKM_CONF_PATH;
+}
+
+const char *apkm_db_dir(void) {
+    const char *dir = getenv("APKM_DB_DIR");
+    return dir && *dir ? dir : APKM_DB_PATH;
+}
+
+// Le CLI n'appelle pas apkm_init() : le schéma est créé à la première
+// connexion du processus, avant tout accès à available_packages
+static int db_schema_ready = 0;
+
+static void db_create_schema(sqlite3 *db) {
     // Table des packages installés
     const char *sql_installed = 
         "CREATE TABLE IF NOT EXISTS installed_packages ("
@@ -209,78 +250,246 @@ static int db_init(void) {
         "('zarch-hub', 'https://gsql-badge.onrender.com', 'zarch');";
     
     sqlite3_exec(db, sql_add_repo, NULL, NULL, NULL);
+}
+
+static int db_init(void) {
+    mkdir(apkm_db_dir(), 0755);
+    
+    char db_path[512];
+    snprintf(db_path, sizeof(db_path), "%s/packages.db", apkm_db_dir());
+    
+    sqlite3 *db;
+    int rc = sqlite3_open(db_path, &db);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "[DB] Cannot open database: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
     
+    db_create_schema(db);
+    db_schema_ready = 1;
     sqlite3_close(db);
     
     printf("[DB] Database initialized at %s\n", db_path);
     return 0;
 }
 
-static int db_search_packages(const char *pattern, package_t *results, int max_results) {
+// Connexion : celle du contexte si apkmd la garde ouverte, sinon une
+// connexion le temps de l'appel
+static sqlite3 *db_acquire(void) {
+    if (ctx.db) {
+        pthread_mutex_lock(&ctx.db_mutex);
+        return ctx.db;
+    }
+    
     char db_path[512];
-    snprintf(db_path, sizeof(db_path), "%s/packages.db", APKM_DB_PATH);
+    snprintf(db_path, sizeof(db_path), "%s/packages.db", apkm_db_dir());
+    if (!db_schema_ready) mkdir(apkm_db_dir(), 0755);
     
     sqlite3 *db;
     if (sqlite3_open(db_path, &db) != SQLITE_OK) {
-        return -1;
+        sqlite3_close(db);
+        return NULL;
+    }
+    if (!db_schema_ready) {
+        db_create_schema(db);
+        db_schema_ready = 1;
     }
+    return db;
+}
+
+static void db_release(sqlite3 *db) {
+    if (db == ctx.db) {
+        pthread_mutex_unlock(&ctx.db_mutex);
+    } else {
+        sqlite3_close(db);
+    }
+}
+
+// Garde la base ouverte pour la durée du processus (apkmd) : l'instantané
+// du catalogue, dont héritent ses fils, y est relu à chaque changement
+static int db_keep_open(void) {
+    if (ctx.db) return 0;
+    
+    sqlite3 *db = db_acquire();
+    if (!db) return -1;
+    ctx.db = db;
+    return 0;
+}
+
+// Colonnes : name, version, release, architecture, description,
+// maintainer, license, sha256, size [, download_url]
+static void db_row_to_package(sqlite3_stmt *stmt, package_t *pkg) {
+    memset(pkg, 0, sizeof(package_t));
     
-    char sql[1024];
-    snprintf(sql, sizeof(sql),
-             "SELECT name, version, release, architecture, description, "
-             "maintainer, license, sha256, size, download_url "
-             "FROM available_packages WHERE name LIKE '%%%s%%' "
-             "OR description LIKE '%%%s%%' LIMIT %d;",
-             pattern, pattern, max_results);
+    strncpy(pkg->name, (const char*)sqlite3_column_text(stmt, 0), sizeof(pkg->name)-1);
+    strncpy(pkg->version, (const char*)sqlite3_column_text(stmt, 1), sizeof(pkg->version)-1);
     
-    sqlite3_stmt *stmt;
-    int count = 0;
+    const char *rel = (const char*)sqlite3_column_text(stmt, 2);
+    if (rel) strncpy(pkg->release, rel, sizeof(pkg->release)-1);
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW && count < max_results) {
-            package_t *pkg = &results[count];
-            memset(pkg, 0, sizeof(package_t));
-            
-            strncpy(pkg->name, (const char*)sqlite3_column_text(stmt, 0), sizeof(pkg->name)-1);
-            strncpy(pkg->version, (const char*)sqlite3_column_text(stmt, 1), sizeof(pkg->version)-1);
-            
-            const char *rel = (const char*)sqlite3_column_text(stmt, 2);
-            if (rel) strncpy(pkg->release, rel, sizeof(pkg->release)-1);
-            
-            const char *arch = (const char*)sqlite3_column_text(stmt, 3);
-            if (arch) strncpy(pkg->architecture, arch, sizeof(pkg->architecture)-1);
-            
-            const char *desc = (const char*)sqlite3_column_text(stmt, 4);
-            if (desc) strncpy(pkg->description, desc, sizeof(pkg->description)-1);
-            
-            const char *maintainer = (const char*)sqlite3_column_text(stmt, 5);
-            if (maintainer) strncpy(pkg->maintainer, maintainer, sizeof(pkg->maintainer)-1);
-            
-            const char *license = (const char*)sqlite3_column_text(stmt, 6);
-            if (license) strncpy(pkg->license, license, sizeof(pkg->license)-1);
-            
-            const char *sha = (const char*)sqlite3_column_text(stmt, 7);
-            if (sha) strncpy(pkg->sha256, sha, sizeof(pkg->sha256)-1);
-            
-            pkg->size = sqlite3_column_int(stmt, 8);
-            
-            count++;
+    const char *arch = (const char*)sqlite3_column_text(stmt, 3);
+    if (arch) strncpy(pkg->architecture, arch, sizeof(pkg->architecture)-1);
+    
+    const char *desc = (const char*)sqlite3_column_text(stmt, 4);
+    if (desc) strncpy(pkg->description, desc, sizeof(pkg->description)-1);
+    
+    const char *maintainer = (const char*)sqlite3_column_text(stmt, 5);
+    if (maintainer) strncpy(pkg->maintainer, maintainer, sizeof(pkg->maintainer)-1);
+    
+    const char *license = (const char*)sqlite3_column_text(stmt, 6);
+    if (license) strncpy(pkg->license, license, sizeof(pkg->license)-1);
+    
+    const char *sha = (const char*)sqlite3_column_text(stmt, 7);
+    if (sha) strncpy(pkg->sha256, sha, sizeof(pkg->sha256)-1);
+    
+    pkg->size = sqlite3_column_int(stmt, 8);
+    
+    const char *download_url = sqlite3_column_count(stmt) > 9 ?
+        (const char*)sqlite3_column_text(stmt, 9) : NULL;
+    if (download_url) strncpy(pkg->url, download_url, sizeof(pkg->url)-1);
+}
+
+// Instantané d'available_packages, reconstruit quand packages.db change
+static struct {
+    package_t *packages;
+    int count;
+    unsigned long generation;
+    int valid;
+} catalogue;
+
+// Appelé avec ctx.cache_lock en écriture
+static void catalogue_load(unsigned long generation) {
+    free(catalogue.packages);
+    catalogue.packages = NULL;
+    catalogue.count = 0;
+    catalogue.valid = 0;
+    
+    sqlite3 *db = db_acquire();
+    if (!db) return;
+    
+    const char *sql =
+        "SELECT name, version, release, architecture, description, "
+        "maintainer, license, sha256, size, download_url "
+        "FROM available_packages ORDER BY name;";
+    
+    sqlite3_stmt *stmt;
+    int capacity = 0;
+    int ok = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK;
+    
+    if (ok) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (catalogue.count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                package_t *grown = realloc(catalogue.packages, capacity * sizeof(package_t));
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                catalogue.packages = grown;
+            }
+            db_row_to_package(stmt, &catalogue.packages[catalogue.count++]);
         }
         sqlite3_finalize(stmt);
     }
+    db_release(db);
+    
+    catalogue.generation = generation;
+    catalogue.valid = ok;
+}
+
+// Prend ctx.cache_lock (lecture, ou écriture s'il a fallu recharger)
+static void catalogue_lock(void) {
+    unsigned long generation = apkm_state_generation(APKM_STATE_CATALOGUE);
+    
+    pthread_rwlock_rdlock(&ctx.cache_lock);
+    if (!catalogue.valid || catalogue.generation != generation) {
+        // Pas de passage écriture -> lecture avec pthread : on garde l'écriture
+        pthread_rwlock_unlock(&ctx.cache_lock);
+        pthread_rwlock_wrlock(&ctx.cache_lock);
+        if (!catalogue.valid || catalogue.generation != generation) {
+            catalogue_load(generation);
+        }
+    }
+}
+
+static int db_search_packages(const char *pattern, package_t *results, int max_results) {
+    catalogue_lock();
+    
+    // Même sélection que LIKE '%pattern%' sur le nom ou la description
+    int count = catalogue.valid ? 0 : -1;
+    for (int i = 0; i < catalogue.count && count < max_results; i++) {
+        const package_t *pkg = &catalogue.packages[i];
+        if (strcasestr(pkg->name, pattern) || strcasestr(pkg->description, pattern)) {
+            results[count++] = *pkg;
+        }
+    }
+    pthread_rwlock_unlock(&ctx.cache_lock);
     
-    sqlite3_close(db);
     return count;
 }
 
-static package_t* db_get_package(const char *name, const char *version) {
-    char db_path[512];
-    snprintf(db_path, sizeof(db_path), "%s/packages.db", APKM_DB_PATH);
+int apkm_catalogue_find(const char *name, package_t *pkg) {
+    const package_t *best = NULL;
+    
+    catalogue_lock();
+    for (int i = 0; i < catalogue.count; i++) {
+        const package_t *p = &catalogue.packages[i];
+        if (strcmp(p->name, name) == 0 &&
+            (!best || strverscmp(p->version, best->version) > 0)) {
+            best = p;
+        }
+    }
+    if (best) *pkg = *best;
+    pthread_rwlock_unlock(&ctx.cache_lock);
     
-    sqlite3 *db;
-    if (sqlite3_open(db_path, &db) != SQLITE_OK) {
-        return NULL;
+    return best ? 0 : -1;
+}
+
+int apkm_catalogue_record(const package_t *pkg, const char *repository) {
+    // Déjà connu tel quel : pas d'écriture (elle invaliderait l'instantané)
+    int known = 0;
+    catalogue_lock();
+    for (int i = 0; i < catalogue.count && !known; i++) {
+        const package_t *p = &catalogue.packages[i];
+        known = strcmp(p->name, pkg->name) == 0 && strcmp(p->version, pkg->version) == 0 &&
+                strcmp(p->architecture, pkg->architecture) == 0 && strcmp(p->url, pkg->url) == 0;
     }
+    pthread_rwlock_unlock(&ctx.cache_lock);
+    if (known) return 0;
+    
+    sqlite3 *db = db_acquire();
+    if (!db) return -1;
+    
+    const char *sql =
+        "INSERT OR REPLACE INTO available_packages "
+        "(name, version, release, architecture, description, maintainer, "
+        "download_url, repository, last_update) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, strftime('%s','now'));";
+    
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, pkg->name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, pkg->version, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, pkg->release, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, pkg->architecture, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, pkg->description, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, pkg->maintainer, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 7, pkg->url, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 8, repository, -1, SQLITE_STATIC);
+        
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        sqlite3_finalize(stmt);
+    }
+    
+    db_release(db);
+    return (rc == SQLITE_OK) ? 0 : -1;
+}
+
+static package_t* db_get_package(const char *name, const char *version) {
+    sqlite3 *db = db_acquire();
+    if (!db) return NULL;
     
     char sql[1024];
     if (version) {
@@ -302,48 +511,21 @@ static package_t* db_get_package(const char *name, const char *version) {
     
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
         if (sqlite3_step(stmt) == SQLITE_ROW) {
-            pkg = calloc(1, sizeof(package_t));
-            
-            strncpy(pkg->name, (const char*)sqlite3_column_text(stmt, 0), sizeof(pkg->name)-1);
-            strncpy(pkg->version, (const char*)sqlite3_column_text(stmt, 1), sizeof(pkg->version)-1);
-            
-            const char *rel = (const char*)sqlite3_column_text(stmt, 2);
-            if (rel) strncpy(pkg->release, rel, sizeof(pkg->release)-1);
-            
-            const char *arch = (const char*)sqlite3_column_text(stmt, 3);
-            if (arch) strncpy(pkg->architecture, arch, sizeof(pkg->architecture)-1);
-            
-            const char *desc = (const char*)sqlite3_column_text(stmt, 4);
-            if (desc) strncpy(pkg->description, desc, sizeof(pkg->description)-1);
-            
-            const char *maintainer = (const char*)sqlite3_column_text(stmt, 5);
-            if (maintainer) strncpy(pkg->maintainer, maintainer, sizeof(pkg->maintainer)-1);
-            
-            const char *license = (const char*)sqlite3_column_text(stmt, 6);
-            if (license) strncpy(pkg->license, license, sizeof(pkg->license)-1);
-            
-            const char *sha = (const char*)sqlite3_column_text(stmt, 7);
-            if (sha) strncpy(pkg->sha256, sha, sizeof(pkg->sha256)-1);
-            
-            pkg->size = sqlite3_column_int(stmt, 8);
+            pkg = malloc(sizeof(package_t));
+            if (pkg) db_row_to_package(stmt, pkg);
         }
         sqlite3_finalize(stmt);
     }
     
-    sqlite3_close(db);
+    db_release(db);
     return pkg;
 }
 
 static int db_register_installed(const char *name, const char *version, 
                           const char *release, const char *arch,
                           const char *binary_path) {
-    char db_path[512];
-    snprintf(db_path, sizeof(db_path), "%s/packages.db", APKM_DB_PATH);
-    
-    sqlite3 *db;
-    if (sqlite3_open(db_path, &db) != SQLITE_OK) {
-        return -1;
-    }
+    sqlite3 *db = db_acquire();
+    if (!db) return -1;
     
     const char *sql = 
         "INSERT OR REPLACE INTO installed_packages "
@@ -364,18 +546,13 @@ static int db_register_installed(const char *name, const char *version,
         sqlite3_finalize(stmt);
     }
     
-    sqlite3_close(db);
+    db_release(db);
     return (rc == SQLITE_OK) ? 0 : -1;
 }
 
 static int db_list_installed(package_t *results, int max_results) {
-    char db_path[512];
-    snprintf(db_path, sizeof(db_path), "%s/packages.db", APKM_DB_PATH);
-    
-    sqlite3 *db;
-    if (sqlite3_open(db_path, &db) != SQLITE_OK) {
-        return -1;
-    }
+    sqlite3 *db = db_acquire();
+    if (!db) return -1;
     
     const char *sql = 
         "SELECT name, version, release, architecture, binary_path, "
@@ -404,7 +581,7 @@ static int db_list_installed(package_t *results, int max_results) {
         sqlite3_finalize(stmt);
     }
     
-    sqlite3_close(db);
+    db_release(db);
     return count;
 }
 
@@ -558,7 +735,10 @@ static int run_install_script(const char *staging_path, const char *pkg_name) {
 int apkm_init(security_level_t security, progress_callback_t progress_cb, error_callback_t error_cb) {
     if (ctx.initialized) return -1;
     
+    // La surveillance inotify a pu démarrer avant (caches du CLI)
+    int inotify_fd = watch_ready ? ctx.inotify_fd : -1;
     memset(&ctx, 0, sizeof(ctx));
+    ctx.inotify_fd = inotify_fd;
     ctx.security = security;
     ctx.progress_cb = progress_cb;
     ctx.error_cb = error_cb;
@@ -719,6 +899,1406 @@ int apkm_update(output_format_t format) {
     return 0;
 }
 
+// ============================================================================
+// CACHE DES RÉPONSES HTTP (MÉTADONNÉES)
+// ============================================================================
+
+#define HTTP_CACHE_BUCKETS 256
+#define HTTP_CACHE_MAX_ENTRIES 512
+#define HTTP_LOCK_TIMEOUT 60
+
+typedef struct http_entry {
+    struct http_entry *next;
+    char *url;
+    char etag[256];
+    char modified[64];
+    time_t fetched;
+    char *body;
+    size_t size;
+} http_entry_t;
+
+// Couche mémoire, sous ctx.cache_lock
+static http_entry_t *http_cache[HTTP_CACHE_BUCKETS];
+static int http_cache_count = 0;
+
+static char http_cache_root[512];
+static pthread_once_t http_cache_once = PTHREAD_ONCE_INIT;
+
+static void mkdir_parents(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(tmp, 0755);
+        *p = '/';
+    }
+    mkdir(tmp, 0755);
+}
+
+static void http_cache_init_dir(void) {
+    const char *env = getenv("APKM_CACHE_DIR");
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    
+    if (env && *env) {
+        snprintf(http_cache_root, sizeof(http_cache_root), "%s/http", env);
+    } else if (access(APKM_CACHE_PATH, W_OK) == 0) {
+        snprintf(http_cache_root, sizeof(http_cache_root), "%s/http", APKM_CACHE_PATH);
+    } else if (xdg && *xdg) {
+        snprintf(http_cache_root, sizeof(http_cache_root), "%s/apkm/http", xdg);
+    } else if (home && *home) {
+        snprintf(http_cache_root, sizeof(http_cache_root), "%s/.cache/apkm/http", home);
+    } else {
+        return;
+    }
+    mkdir_parents(http_cache_root);
+}
+
+// <cache>/http/<sha256(url)><suffix> ; -1 sans répertoire de cache
+static int http_cache_path(const char *url, const char *suffix, char *path, size_t size) {
+    pthread_once(&http_cache_once, http_cache_init_dir);
+    if (!http_cache_root[0]) return -1;
+    
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (!EVP_Digest(url, strlen(url), digest, &len, EVP_sha256(), NULL)) return -1;
+    
+    char hex[2 * EVP_MAX_MD_SIZE + 1];
+    for (unsigned int i = 0; i < len; i++) sprintf(hex + 2 * i, "%02x", digest[i]);
+    
+    int n = snprintf(path, size, "%s/%s%s", http_cache_root, hex, suffix);
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+const char *apkm_cache_dir(void) {
+    pthread_once(&http_cache_once, http_cache_init_dir);
+    return http_cache_root;
+}
+
+// Mode hors ligne : forcé (--offline) ou repli quand un hub ne répond plus.
+// Un hub injoignable est noté dans <cache>/http/<sha256(hôte)>.down ; les
+// processus suivants ne le rappellent qu'après HUB_RETRY_DELAY.
+static int offline_forced = 0;
+static int offline_fallback = 0;
+
+void apkm_set_offline(int offline) {
+    offline_forced = offline;
+    offline_fallback = 0;
+}
+
+int apkm_offline(void) {
+    if (offline_forced) return APKM_OFFLINE_FORCED;
+    return offline_fallback ? APKM_OFFLINE_FALLBACK : APKM_ONLINE;
+}
+
+// Marqueur du hub de l'URL (schéma + hôte)
+static int hub_marker_path(const char *url, char *path, size_t size) {
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    
+    char hub[256];
+    size_t len = strcspn(host, "/") + (size_t)(host - url);
+    if (len >= sizeof(hub)) return -1;
+    memcpy(hub, url, len);
+    hub[len] = '\0';
+    
+    return http_cache_path(hub, ".down", path, size);
+}
+
+int apkm_hub_reachable(const char *url) {
+    if (offline_forced) return 0;
+    
+    char marker[600];
+    struct stat st;
+    if (hub_marker_path(url, marker, sizeof(marker)) == 0 && stat(marker, &st) == 0 &&
+        time(NULL) - st.st_mtime < HUB_RETRY_DELAY) {
+        offline_fallback = 1;
+        return 0;
+    }
+    return 1;
+}
+
+void apkm_hub_result(const char *url, CURLcode res) {
+    char marker[600];
+    if (hub_marker_path(url, marker, sizeof(marker)) != 0) return;
+    
+    switch (res) {
+    case CURLE_COULDNT_RESOLVE_PROXY:
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR: {
+        offline_fallback = 1;
+        // O_TRUNC remet la date à jour si le marqueur existe déjà
+        int fd = open(marker, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+        if (fd >= 0) close(fd);
+        break;
+    }
+    case CURLE_OK:
+        unlink(marker);
+        break;
+    default:
+        break;
+    }
+}
+
+static void http_entry_free(http_entry_t *e) {
+    if (!e) return;
+    free(e->url);
+    free(e->body);
+    free(e);
+}
+
+static http_entry_t *http_entry_dup(const http_entry_t *src) {
+    http_entry_t *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    
+    *e = *src;
+    e->next = NULL;
+    e->url = strdup(src->url);
+    e->body = malloc(src->size + 1);
+    if (!e->url || !e->body) {
+        http_entry_free(e);
+        return NULL;
+    }
+    memcpy(e->body, src->body, src->size);
+    e->body[src->size] = '\0';
+    return e;
+}
+
+static unsigned http_bucket(const char *url) {
+    unsigned h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h % HTTP_CACHE_BUCKETS;
+}
+
+// Appelé avec ctx.cache_lock
+static http_entry_t *http_memory_find(const char *url) {
+    for (http_entry_t *e = http_cache[http_bucket(url)]; e; e = e->next) {
+        if (strcmp(e->url, url) == 0) return e;
+    }
+    return NULL;
+}
+
+// Appelé avec ctx.cache_lock en écriture ; prend possession de e
+static void http_memory_put(http_entry_t *e) {
+    http_entry_t **slot = &http_cache[http_bucket(e->url)];
+    for (http_entry_t **p = slot; *p; p = &(*p)->next) {
+        if (strcmp((*p)->url, e->url) == 0) {
+            http_entry_t *old = *p;
+            e->next = old->next;
+            *p = e;
+            http_entry_free(old);
+            return;
+        }
+    }
+    
+    e->next = *slot;
+    *slot = e;
+    
+    // Plein : on retire la réponse la plus ancienne
+    if (++http_cache_count > HTTP_CACHE_MAX_ENTRIES) {
+        http_entry_t **oldest = NULL;
+        for (int b = 0; b < HTTP_CACHE_BUCKETS; b++) {
+            for (http_entry_t **p = &http_cache[b]; *p; p = &(*p)->next) {
+                if (*p != e && (!oldest || (*p)->fetched < (*oldest)->fetched)) oldest = p;
+            }
+        }
+        if (oldest) {
+            http_entry_t *victim = *oldest;
+            *oldest = victim->next;
+            http_entry_free(victim);
+            http_cache_count--;
+        }
+    }
+}
+
+// Fichier : en-tête "clé valeur" par ligne, ligne vide, puis le corps
+static http_entry_t *http_disk_load(const char *url) {
+    char path[600];
+    if (http_cache_path(url, "", path, sizeof(path)) != 0) return NULL;
+    
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    
+    http_entry_t *e = calloc(1, sizeof(*e));
+    char line[1024];
+    int header_ok = 0;
+    long long fetched = 0;
+    size_t size = 0;
+    
+    while (e && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!line[0]) {
+            header_ok = 1;
+            break;
+        }
+        char *value = strchr(line, ' ');
+        value = value ? value + 1 : line + strlen(line);
+        
+        if (strncmp(line, "url ", 4) == 0) e->url = strdup(value);
+        else if (strncmp(line, "fetched ", 8) == 0) fetched = atoll(value);
+        else if (strncmp(line, "etag ", 5) == 0) snprintf(e->etag, sizeof(e->etag), "%s", value);
+        else if (strncmp(line, "modified ", 9) == 0) snprintf(e->modified, sizeof(e->modified), "%s", value);
+        else if (strncmp(line, "size ", 5) == 0) size = strtoull(value, NULL, 10);
+    }
+    
+    // Collision de hachage ou fichier tronqué : ignoré
+    if (e && header_ok && e->url && strcmp(e->url, url) == 0 && (e->body = malloc(size + 1)) &&
+        fread(e->body, 1, size, f) == size) {
+        e->body[size] = '\0';
+        e->size = size;
+        e->fetched = (time_t)fetched;
+        fclose(f);
+        return e;
+    }
+    
+    fclose(f);
+    http_entry_free(e);
+    return NULL;
+}
+
+static void http_disk_store(const http_entry_t *e) {
+    char path[600], tmp[640];
+    if (http_cache_path(e->url, "", path, sizeof(path)) != 0) return;
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+    
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return;
+    
+    fprintf(f, "url %s\nfetched %lld\netag %s\nmodified %s\nsize %zu\n\n",
+            e->url, (long long)e->fetched, e->etag, e->modified, e->size);
+    int ok = fwrite(e->body, 1, e->size, f) == e->size;
+    if (fclose(f) != 0) ok = 0;
+    
+    // Renommage atomique : un lecteur voit l'ancienne ou la nouvelle réponse
+    if (!ok || rename(tmp, path) != 0) unlink(tmp);
+}
+
+static void http_cache_store(const http_entry_t *e) {
+    http_entry_t *copy = http_entry_dup(e);
+    if (copy) {
+        pthread_rwlock_wrlock(&ctx.cache_lock);
+        http_memory_put(copy);
+        pthread_rwlock_unlock(&ctx.cache_lock);
+    }
+    http_disk_store(e);
+}
+
+// Meilleure réponse connue (copie) : mémoire, ou disque si plus récent
+// (écrit par un autre processus ou une revalidation détachée)
+static http_entry_t *http_cache_lookup(const char *url, time_t now) {
+    pthread_rwlock_rdlock(&ctx.cache_lock);
+    http_entry_t *mem = http_memory_find(url);
+    http_entry_t *copy = mem ? http_entry_dup(mem) : NULL;
+    pthread_rwlock_unlock(&ctx.cache_lock);
+    
+    if (copy && now - copy->fetched < CACHE_TTL) return copy;
+    
+    http_entry_t *disk = http_disk_load(url);
+    if (disk && (!copy || disk->fetched > copy->fetched)) {
+        http_entry_free(copy);
+        copy = http_entry_dup(disk);
+        pthread_rwlock_wrlock(&ctx.cache_lock);
+        http_memory_put(disk);
+        pthread_rwlock_unlock(&ctx.cache_lock);
+        return copy;
+    }
+    http_entry_free(disk);
+    return copy;
+}
+
+typedef struct {
+    struct curl_response resp;
+    char etag[256];
+    char modified[64];
+    struct curl_slist *headers;
+} http_fetch_t;
+
+static void http_header_value(const char *buf, size_t len, const char *name,
+                              char *out, size_t out_size) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || strncasecmp(buf, name, name_len) != 0 || buf[name_len] != ':') return;
+    
+    const char *value = buf + name_len + 1;
+    const char *end = buf + len;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) end--;
+    
+    size_t value_len = (size_t)(end - value);
+    if (value_len >= out_size) return;
+    memcpy(out, value, value_len);
+    out[value_len] = '\0';
+}
+
+static size_t http_header_callback(char *buf, size_t size, size_t nmemb, void *userdata) {
+    http_fetch_t *fetch = (http_fetch_t *)userdata;
+    size_t len = size * nmemb;
+    
+    // Nouvelle réponse (redirection) : on oublie les en-têtes précédents
+    if (len >= 5 && strncmp(buf, "HTTP/", 5) == 0) {
+        fetch->etag[0] = '\0';
+        fetch->modified[0] = '\0';
+    }
+    http_header_value(buf, len, "ETag", fetch->etag, sizeof(fetch->etag));
+    http_header_value(buf, len, "Last-Modified", fetch->modified, sizeof(fetch->modified));
+    return len;
+}
+
+// Prépare le GET conditionnel sur curl (easy ou ajouté à un multi)
+static void http_fetch_prepare(CURL *curl, const char *url, long timeout,
+                               const http_entry_t *cached, http_fetch_t *fetch) {
+    char header[320];
+    
+    if (cached && cached->etag[0]) {
+        snprintf(header, sizeof(header), "If-None-Match: %s", cached->etag);
+        fetch->headers = curl_slist_append(fetch->headers, header);
+    }
+    if (cached && cached->modified[0]) {
+        snprintf(header, sizeof(header), "If-Modified-Since: %s", cached->modified);
+        fetch->headers = curl_slist_append(fetch->headers, header);
+    }
+    
+    curl_easy_reset(curl);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, response_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &fetch->resp);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, http_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, fetch);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, fetch->headers);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "APKM/2.0");
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, APKM_CONNECT_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+}
+
+// Code HTTP (304 : inchangé) ou -1 si le hub ne répond pas
+static long http_fetch_done(CURL *curl, const char *url, CURLcode res, http_fetch_t *fetch) {
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    apkm_hub_result(url, res);
+    
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+    curl_slist_free_all(fetch->headers);
+    fetch->headers = NULL;
+    return res == CURLE_OK ? code : -1;
+}
+
+// Enregistre le résultat ; renvoie la réponse à servir (ou NULL), libère cached
+static http_entry_t *http_fetch_result(const char *url, long code, http_entry_t *cached,
+                                       http_fetch_t *fetch) {
+    time_t now = time(NULL);
+    http_entry_t *result = NULL;
+    
+    if (code == 304 && cached) {
+        cached->fetched = now;
+        if (fetch->etag[0]) snprintf(cached->etag, sizeof(cached->etag), "%s", fetch->etag);
+        http_cache_store(cached);
+        result = cached;
+        cached = NULL;
+    } else if (code >= 200 && code < 300 && (result = calloc(1, sizeof(*result)))) {
+        result->url = strdup(url);
+        result->body = fetch->resp.data ? fetch->resp.data : calloc(1, 1);
+        result->size = fetch->resp.size;
+        result->fetched = now;
+        snprintf(result->etag, sizeof(result->etag), "%s", fetch->etag);
+        snprintf(result->modified, sizeof(result->modified), "%s", fetch->modified);
+        fetch->resp.data = NULL;
+        if (result->url && result->body) {
+            http_cache_store(result);
+        } else {
+            http_entry_free(result);
+            result = NULL;
+        }
+    } else if (cached) {
+        // Hub injoignable ou en erreur : dernière réponse connue
+        result = cached;
+        cached = NULL;
+    }
+    
+    free(fetch->resp.data);
+    fetch->resp.data = NULL;
+    http_entry_free(cached);
+    return result;
+}
+
+// Revalide et enregistre en bloquant ; mêmes règles que http_fetch_result
+static http_entry_t *http_refresh(CURL *curl, const char *url, long timeout, http_entry_t *cached) {
+    http_fetch_t fetch = {0};
+    http_fetch_prepare(curl, url, timeout, cached, &fetch);
+    CURLcode res = curl_easy_perform(curl);
+    long code = http_fetch_done(curl, url, res, &fetch);
+    return http_fetch_result(url, code, cached, &fetch);
+}
+
+// Une revalidation à la fois par URL, entre processus ; verrou abandonné
+// au bout de HTTP_LOCK_TIMEOUT. 0 si le verrou est pris
+static int http_lock_acquire(const char *url, char *lock, size_t size) {
+    if (http_cache_path(url, ".lock", lock, size) != 0) return -1;
+    
+    int fd = open(lock, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd < 0 && errno == EEXIST && stat(lock, &st) == 0 &&
+        time(NULL) - st.st_mtime > HTTP_LOCK_TIMEOUT) {
+        unlink(lock);
+        fd = open(lock, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) return -1;
+    close(fd);
+    return 0;
+}
+
+// Revalidation dans un processus détaché : l'appelant sert la réponse périmée
+static void http_revalidate_detached(const char *url, long timeout, const http_entry_t *cached) {
+    char lock[640];
+    if (http_lock_acquire(url, lock, sizeof(lock)) != 0) return;
+    
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (fork() == 0) {
+            setsid();
+            // Rien du parent ne doit survivre : ni ses sorties (le lecteur
+            // d'un tube attendrait la fin de la revalidation), ni ses sockets
+            int null = open("/dev/null", O_RDWR);
+            if (null >= 0) {
+                dup2(null, STDIN_FILENO);
+                dup2(null, STDOUT_FILENO);
+                dup2(null, STDERR_FILENO);
+            }
+            close_range(3, ~0U, 0);
+            
+            sigset_t none;
+            sigemptyset(&none);
+            sigprocmask(SIG_SETMASK, &none, NULL);
+            signal(SIGPIPE, SIG_DFL);
+            
+            // Connexions du parent inutilisables : un handle neuf
+            CURL *curl = curl_easy_init();
+            if (curl) {
+                http_entry_free(http_refresh(curl, url, timeout, http_entry_dup(cached)));
+            }
+            unlink(lock);
+            _exit(0);
+        }
+        _exit(0);
+    }
+    
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        unlink(lock);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Revalidation dans la boucle d'apkmd (curl multi sur ctx.epoll_fd)
+// ----------------------------------------------------------------------------
+
+typedef struct http_async {
+    struct http_async *next;
+    CURL *curl;
+    char *url;
+    http_entry_t *cached;
+    http_fetch_t fetch;
+    char lock[640];
+} http_async_t;
+
+static http_async_t *http_async_pending = NULL;
+
+// Fils d'apkmd -> boucle : "<timeout> <url>\n" à revalider (une écriture
+// de moins de PIPE_BUF, donc jamais mêlée à celle d'un autre fils)
+static int http_request_fd[2] = { -1, -1 };
+static char http_request_buf[2 * PIPE_BUF];
+static size_t http_request_len = 0;
+
+static void http_async_free(http_async_t *a) {
+    curl_multi_remove_handle(ctx.multi, a->curl);
+    curl_easy_cleanup(a->curl);
+    curl_slist_free_all(a->fetch.headers);
+    free(a->fetch.resp.data);
+    unlink(a->lock);
+    http_entry_free(a->cached);
+    free(a->url);
+    free(a);
+}
+
+static int http_multi_socket(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    (void)easy; (void)userp; (void)socketp;
+    
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(ctx.epoll_fd, EPOLL_CTL_DEL, s, NULL);
+        return 0;
+    }
+    struct epoll_event ev = { .data.fd = s };
+    if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+    if (epoll_ctl(ctx.epoll_fd, EPOLL_CTL_MOD, s, &ev) != 0 && errno == ENOENT) {
+        epoll_ctl(ctx.epoll_fd, EPOLL_CTL_ADD, s, &ev);
+    }
+    return 0;
+}
+
+// curl_multi_socket_action est interdit ici : on passe par le timerfd
+static int http_multi_timer(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi; (void)userp;
+    struct itimerspec its = {0};
+    
+    if (timeout_ms == 0) {
+        its.it_value.tv_nsec = 1;
+    } else if (timeout_ms > 0) {
+        its.it_value.tv_sec = timeout_ms / 1000;
+        its.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+    }
+    timerfd_settime(ctx.curl_timer_fd, 0, &its, NULL);
+    return 0;
+}
+
+static int http_async_init(void) {
+    ctx.curl_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (ctx.curl_timer_fd < 0) return -1;
+    
+    ctx.multi = curl_multi_init();
+    if (!ctx.multi) {
+        close(ctx.curl_timer_fd);
+        ctx.curl_timer_fd = -1;
+        return -1;
+    }
+    curl_multi_setopt(ctx.multi, CURLMOPT_SOCKETFUNCTION, http_multi_socket);
+    curl_multi_setopt(ctx.multi, CURLMOPT_TIMERFUNCTION, http_multi_timer);
+    
+    if (pipe2(http_request_fd, O_CLOEXEC | O_NONBLOCK) != 0) {
+        http_request_fd[0] = http_request_fd[1] = -1;
+    }
+    return 0;
+}
+
+// Arrêt du démon : les revalidations en cours sont abandonnées
+static void http_async_cleanup(void) {
+    if (!ctx.multi) return;
+    while (http_async_pending) {
+        http_async_t *a = http_async_pending;
+        http_async_pending = a->next;
+        http_async_free(a);
+    }
+    curl_multi_cleanup(ctx.multi);
+    close(ctx.curl_timer_fd);
+    ctx.multi = NULL;
+    ctx.curl_timer_fd = -1;
+    
+    for (int i = 0; i < 2; i++) {
+        if (http_request_fd[i] >= 0) close(http_request_fd[i]);
+        http_request_fd[i] = -1;
+    }
+}
+
+// Fils d'apkmd : le multi et ses sockets appartiennent au parent, les
+// revalidations lui sont demandées par le tube (http_revalidate_request)
+static void http_async_reset(void) {
+    if (!ctx.multi) return;
+    close(ctx.curl_timer_fd);
+    ctx.multi = NULL;
+    ctx.curl_timer_fd = -1;
+    http_async_pending = NULL;
+    
+    if (http_request_fd[0] >= 0) close(http_request_fd[0]);
+    http_request_fd[0] = -1;
+}
+
+// Dans un fils d'apkmd ; -1 s'il faut revalider soi-même
+static int http_revalidate_request(const char *url, long timeout) {
+    if (http_request_fd[1] < 0) return -1;
+    
+    char line[PIPE_BUF];
+    int n = snprintf(line, sizeof(line), "%ld %s\n", timeout, url);
+    if (n <= 0 || (size_t)n >= sizeof(line)) return -1;
+    return write(http_request_fd[1], line, (size_t)n) == n ? 0 : -1;
+}
+
+static void http_revalidate_async(const char *url, long timeout, const http_entry_t *cached) {
+    http_async_t *a = calloc(1, sizeof(*a));
+    if (!a) return;
+    if (http_lock_acquire(url, a->lock, sizeof(a->lock)) != 0) {
+        free(a);
+        return;
+    }
+    
+    a->curl = curl_easy_init();
+    a->url = strdup(url);
+    a->cached = http_entry_dup(cached);
+    if (!a->curl || !a->url || !a->cached) {
+        http_async_free(a);
+        return;
+    }
+    
+    http_fetch_prepare(a->curl, url, timeout, a->cached, &a->fetch);
+    curl_easy_setopt(a->curl, CURLOPT_PRIVATE, a);
+    if (curl_multi_add_handle(ctx.multi, a->curl) != CURLM_OK) {
+        http_async_free(a);
+        return;
+    }
+    a->next = http_async_pending;
+    http_async_pending = a;
+}
+
+// Transferts terminés : enregistrés comme une revalidation bloquante
+static void http_async_collect(void) {
+    CURLMsg *msg;
+    int left;
+    
+    while ((msg = curl_multi_info_read(ctx.multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        
+        http_async_t *a = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&a);
+        if (!a) continue;
+        
+        long code = http_fetch_done(a->curl, a->url, msg->data.result, &a->fetch);
+        http_entry_free(http_fetch_result(a->url, code, a->cached, &a->fetch));
+        a->cached = NULL;
+        
+        for (http_async_t **p = &http_async_pending; *p; p = &(*p)->next) {
+            if (*p == a) {
+                *p = a->next;
+                break;
+            }
+        }
+        http_async_free(a);
+    }
+}
+
+static void http_async_requests(void) {
+    ssize_t n;
+    while ((n = read(http_request_fd[0], http_request_buf + http_request_len,
+                     sizeof(http_request_buf) - http_request_len)) > 0) {
+        http_request_len += (size_t)n;
+        
+        char *line = http_request_buf;
+        char *nl;
+        while ((nl = memchr(line, '\n', http_request_len - (size_t)(line - http_request_buf)))) {
+            *nl = '\0';
+            char *url;
+            long timeout = strtol(line, &url, 10);
+            time_t now = time(NULL);
+            
+            // Un autre fils a pu la demander, ou elle a déjà été revalidée
+            http_entry_t *cached = *url == ' ' ? http_cache_lookup(url + 1, now) : NULL;
+            if (cached && now - cached->fetched >= CACHE_TTL && apkm_hub_reachable(url + 1)) {
+                http_revalidate_async(url + 1, timeout, cached);
+            }
+            http_entry_free(cached);
+            line = nl + 1;
+        }
+        
+        http_request_len -= (size_t)(line - http_request_buf);
+        memmove(http_request_buf, line, http_request_len);
+        // Ligne plus longue que le tampon : impossible (< PIPE_BUF), on jette
+        if (http_request_len == sizeof(http_request_buf)) http_request_len = 0;
+    }
+}
+
+// Événement de la boucle d'apkmd ; 0 si fd n'appartient pas à curl
+static int http_async_event(int fd, uint32_t events) {
+    if (!ctx.multi) return 0;
+    int running;
+    
+    if (fd == http_request_fd[0]) {
+        http_async_requests();
+    } else if (fd == ctx.curl_timer_fd) {
+        uint64_t expirations;
+        if (read(ctx.curl_timer_fd, &expirations, sizeof(expirations)) < 0) return 1;
+        curl_multi_socket_action(ctx.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    } else {
+        int action = 0;
+        if (events & EPOLLIN) action |= CURL_CSELECT_IN;
+        if (events & EPOLLOUT) action |= CURL_CSELECT_OUT;
+        if (events & (EPOLLERR | EPOLLHUP)) action |= CURL_CSELECT_ERR;
+        curl_multi_socket_action(ctx.multi, fd, action, &running);
+    }
+    http_async_collect();
+    return 1;
+}
+
+int apkm_http_get(CURL *curl, const char *url, long timeout, char **body, size_t *size) {
+    time_t now = time(NULL);
+    http_entry_t *cached = http_cache_lookup(url, now);
+    int stale = !cached || now - cached->fetched >= CACHE_TTL;
+    
+    // Hors ligne, la dernière réponse est servie quel que soit son âge
+    if (stale && apkm_hub_reachable(url)) {
+        if (!cached) {
+            cached = http_refresh(curl, url, timeout, NULL);
+        } else if (now - cached->fetched < CACHE_TTL + CACHE_STALE) {
+            if (ctx.multi) http_revalidate_async(url, timeout, cached);
+            else if (http_revalidate_request(url, timeout) != 0) {
+                http_revalidate_detached(url, timeout, cached);
+            }
+        } else {
+            cached = http_refresh(curl, url, timeout, cached);
+        }
+    }
+    
+    if (!cached) return -1;
+    
+    *body = cached->body;
+    if (size) *size = cached->size;
+    cached->body = NULL;
+    http_entry_free(cached);
+    return 0;
+}
+
+// ============================================================================
+// INVALIDATION DES CACHES (INOTIFY)
+// ============================================================================
+
+static int state_index(unsigned state) {
+    return state == APKM_STATE_INSTALLED ? 0 : state == APKM_STATE_REPOS ? 1 : 2;
+}
+
+static int watch_add(const char *dir, const char *name, unsigned state, int retry) {
+    for (int i = 0; i < watch_count; i++) {
+        if (watches[i].state == state && strcmp(watches[i].dir, dir) == 0 &&
+            strcmp(watches[i].name, name) == 0) return 0;
+    }
+    
+    if (strlen(dir) >= sizeof(watches[0].dir) || strlen(name) >= sizeof(watches[0].name)) {
+        volatile_states |= state;
+        return -1;
+    }
+    
+    if (watch_count == watch_capacity) {
+        int capacity = watch_capacity ? watch_capacity * 2 : 64;
+        state_watch_t *grown = realloc(watches, capacity * sizeof(*watches));
+        if (!grown) {
+            volatile_states |= state;
+            return -1;
+        }
+        watches = grown;
+        watch_capacity = capacity;
+    }
+    
+    state_watch_t *w = &watches[watch_count++];
+    strcpy(w->dir, dir);
+    strcpy(w->name, name);
+    w->state = state;
+    w->retry = retry;
+    w->wd = inotify_add_watch(ctx.inotify_fd, dir, WATCH_MASK);
+    
+    // Absent : le fichier ne peut pas exister non plus, on réessaiera
+    if (w->wd < 0 && errno != ENOENT) volatile_states |= state;
+    return 0;
+}
+
+// Surveille le répertoire d'un fichier, filtré sur son nom
+static void watch_add_file(const char *path, unsigned state) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash) return;
+    *slash = '\0';
+    watch_add(dir, slash + 1, state, 1);
+}
+
+// Appelé avec watch_lock
+static int watch_init(void) {
+    if (watch_ready) return ctx.inotify_fd >= 0 ? 0 : -1;
+    watch_ready = 1;
+    
+    ctx.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ctx.inotify_fd < 0) {
+        volatile_states = APKM_STATE_ALL;
+        return -1;
+    }
+    
+    watch_add_file(ALPINE_DB_PATH, APKM_STATE_INSTALLED);
+    watch_add(APKM_LOCAL_DB_PATH, "", APKM_STATE_INSTALLED, 1);
+    watch_add_file(apkm_conf_path(), APKM_STATE_REPOS);
+    // packages.db, packages.db-journal, packages.db-wal
+    char db_path[512];
+    snprintf(db_path, sizeof(db_path), "%s/packages.db", apkm_db_dir());
+    watch_add_file(db_path, APKM_STATE_CATALOGUE);
+    return 0;
+}
+
+int apkm_watch_init(void) {
+    pthread_mutex_lock(&watch_lock);
+    watch_armed = 1;
+    int ret = watch_init();
+    pthread_mutex_unlock(&watch_lock);
+    return ret;
+}
+
+int apkm_watch_path(const char *dir, unsigned state) {
+    // Processus éphémère : un add_watch par paquet ne servirait à rien
+    if (!watch_armed) return 0;
+    
+    pthread_mutex_lock(&watch_lock);
+    int ret = watch_init() == 0 ? watch_add(dir, "", state, 0) : -1;
+    pthread_mutex_unlock(&watch_lock);
+    return ret;
+}
+
+// Fils d'apkmd : la file inotify appartient au parent
+static void apkm_watch_reset(void) {
+    if (watch_ready && ctx.inotify_fd >= 0) close(ctx.inotify_fd);
+    ctx.inotify_fd = -1;
+    watch_ready = 0;
+    watch_armed = 0;
+    watch_count = 0;
+    volatile_states = 0;
+}
+
+unsigned apkm_watch_poll(void) {
+    unsigned changed = 0;
+    
+    pthread_mutex_lock(&watch_lock);
+    if (watch_init() == 0) {
+        // Répertoires apparus depuis : leur contenu est neuf
+        for (int i = 0; i < watch_count; i++) {
+            if (watches[i].wd >= 0 || !watches[i].retry) continue;
+            watches[i].wd = inotify_add_watch(ctx.inotify_fd, watches[i].dir, WATCH_MASK);
+            if (watches[i].wd >= 0) changed |= watches[i].state;
+        }
+        
+        char buf[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t n;
+        while ((n = read(ctx.inotify_fd, buf, sizeof(buf))) > 0) {
+            for (char *p = buf; p < buf + n; ) {
+                const struct inotify_event *ev = (const struct inotify_event *)p;
+                p += sizeof(struct inotify_event) + ev->len;
+                
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    changed |= APKM_STATE_ALL;
+                    continue;
+                }
+                
+                for (int i = 0; i < watch_count; i++) {
+                    state_watch_t *w = &watches[i];
+                    if (w->wd != ev->wd) continue;
+                    
+                    if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                        changed |= w->state;
+                        w->wd = -1;
+                    } else if (!w->name[0] ||
+                               (ev->len && strncmp(ev->name, w->name, strlen(w->name)) == 0)) {
+                        changed |= w->state;
+                    }
+                }
+            }
+        }
+        
+        // Répertoires de paquets supprimés : on les oublie
+        int kept = 0;
+        for (int i = 0; i < watch_count; i++) {
+            if (watches[i].wd < 0 && !watches[i].retry) continue;
+            watches[kept++] = watches[i];
+        }
+        watch_count = kept;
+    }
+    
+    changed |= volatile_states;
+    for (unsigned s = APKM_STATE_INSTALLED; s <= APKM_STATE_CATALOGUE; s <<= 1) {
+        if (changed & s) state_gen[state_index(s)]++;
+    }
+    pthread_mutex_unlock(&watch_lock);
+    return changed;
+}
+
+unsigned long apkm_state_generation(unsigned state) {
+    apkm_watch_poll();
+    pthread_mutex_lock(&watch_lock);
+    unsigned long generation = state_gen[state_index(state)];
+    pthread_mutex_unlock(&watch_lock);
+    return generation;
+}
+
+// ============================================================================
+// DÉMON APKMD
+// ============================================================================
+
+#define APKMD_MAX_REQUEST 8192
+#define APKMD_MAX_ARGS 64
+#define APKMD_MAX_EVENTS 16
+#define APKMD_MAX_CLIENTS 64
+#define APKMD_REQUEST_TIMEOUT 2
+#define APKMD_FDS 4             // stdin, stdout, stderr, dossier courant
+
+int apkmd_socket_path(char *path, size_t size) {
+    const char *env = getenv("APKMD_SOCK");
+    int n = snprintf(path, size, "%s", env && *env ? env : APKMD_SOCKET_PATH);
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+static int apkmd_connect(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (apkmd_socket_path(addr.sun_path, sizeof(addr.sun_path)) != 0) return -1;
+    
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    // Seul un démon root ou du même utilisateur est écouté
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 ||
+        (cred.uid != 0 && cred.uid != getuid())) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Envoie une requête (et éventuellement des descripteurs), lit la réponse
+static int apkmd_request(const char *req, size_t len, const int *fds, int nfds,
+                         char *reply, size_t reply_size) {
+    int fd = apkmd_connect();
+    if (fd < 0) return -1;
+    
+    struct iovec iov = { .iov_base = (void *)req, .iov_len = len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    char cbuf[CMSG_SPACE(sizeof(int) * APKMD_FDS)];
+    
+    if (nfds > 0) {
+        memset(cbuf, 0, sizeof(cbuf));
+        msg.msg_control = cbuf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    }
+    
+    ssize_t n = -1;
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) == (ssize_t)len) {
+        // Pas de délai : une installation peut durer
+        do {
+            n = recv(fd, reply, reply_size - 1, 0);
+        } while (n < 0 && errno == EINTR);
+    }
+    close(fd);
+    
+    if (n <= 0) return -1;
+    reply[n] = '\0';
+    return 0;
+}
+
+int apkmd_forward(int argc, char **argv, int *status) {
+    char req[APKMD_MAX_REQUEST];
+    size_t len = 0;
+    
+    // Racines du client : le démon ne sert que celles qu'il a chargées
+    const char *fields[APKMD_MAX_ARGS + 4] = { "RUN", apkm_conf_path(), apkm_db_dir(),
+                                               apkm_cache_dir() };
+    int count = 4;
+    for (int i = 1; i < argc; i++) {
+        if (i > APKMD_MAX_ARGS) return -1;
+        fields[count++] = argv[i];
+    }
+    for (int i = 0; i < count; i++) {
+        size_t field_len = strlen(fields[i]) + 1;
+        if (len + field_len > sizeof(req)) return -1;
+        memcpy(req + len, fields[i], field_len);
+        len += field_len;
+    }
+    
+    // Le dossier courant voyage comme descripteur (chemins relatifs)
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd < 0) return -1;
+    
+    int fds[APKMD_FDS] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, cwd };
+    char reply[64];
+    fflush(stdout);
+    fflush(stderr);
+    int ret = apkmd_request(req, len, fds, APKMD_FDS, reply, sizeof(reply));
+    close(cwd);
+    if (ret != 0) return -1;
+    
+    // FALLBACK : le démon laisse la commande au client (droits ou racines
+    // différents)
+    if (sscanf(reply, "OK %d", status) != 1) return -1;
+    return 0;
+}
+
+int apkmd_status(long *pid) {
+    char reply[64];
+    if (apkmd_request("STATUS", 7, NULL, 0, reply, sizeof(reply)) != 0) return -1;
+    
+    long p;
+    if (sscanf(reply, "OK %ld", &p) != 1) return -1;
+    if (pid) *pid = p;
+    return 0;
+}
+
+int apkmd_stop(void) {
+    char reply[64];
+    if (apkmd_request("STOP", 5, NULL, 0, reply, sizeof(reply)) != 0) return -1;
+    return strncmp(reply, "OK", 2) == 0 ? 0 : -1;
+}
+
+// Réponse courte sur une socket neuve : ne bloque pas
+static void apkmd_reply(int fd, const char *format, ...) {
+    char buf[64];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0) send(fd, buf, (size_t)n, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+// Connexions acceptées dont la requête n'est pas encore arrivée
+typedef struct {
+    int fd;
+    time_t since;
+} apkmd_pending_t;
+
+// Requêtes en cours dans un fils ; le parent répond à sa fin
+typedef struct {
+    pid_t pid;
+    int client;
+} apkmd_child_t;
+
+static apkmd_pending_t apkmd_pending[APKMD_MAX_CLIENTS];
+static int apkmd_pending_count = 0;
+static apkmd_child_t apkmd_children[APKMD_MAX_CLIENTS];
+static int apkmd_child_count = 0;
+
+static time_t apkmd_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static int apkmd_pending_find(int fd) {
+    for (int i = 0; i < apkmd_pending_count; i++) {
+        if (apkmd_pending[i].fd == fd) return i;
+    }
+    return -1;
+}
+
+static void apkmd_pending_drop(int i) {
+    epoll_ctl(ctx.epoll_fd, EPOLL_CTL_DEL, apkmd_pending[i].fd, NULL);
+    close(apkmd_pending[i].fd);
+    apkmd_pending[i] = apkmd_pending[--apkmd_pending_count];
+}
+
+// Clients silencieux au-delà d'APKMD_REQUEST_TIMEOUT : abandonnés
+static void apkmd_pending_expire(void) {
+    time_t now = apkmd_now();
+    for (int i = apkmd_pending_count - 1; i >= 0; i--) {
+        if (now - apkmd_pending[i].since >= APKMD_REQUEST_TIMEOUT) apkmd_pending_drop(i);
+    }
+}
+
+// idle_timeout à 0 désarme le timer
+static void apkmd_arm_idle(int idle_timeout) {
+    struct itimerspec its = { .it_value = { .tv_sec = idle_timeout } };
+    timerfd_settime(ctx.timer_fd, 0, &its, NULL);
+}
+
+// Dans le fils : stdio et dossier du client, rien d'autre du démon que le
+// tube de revalidation
+static void apkmd_child_setup(const int fds[APKMD_FDS], const sigset_t *orig_mask) {
+    sigprocmask(SIG_SETMASK, orig_mask, NULL);
+    signal(SIGPIPE, SIG_DFL);
+    
+    // Connexions SQLite et curl, file inotify du parent inutilisables ici
+    ctx.db = NULL;
+    apkm_watch_reset();
+    http_async_reset();
+    
+    for (int i = 0; i < 3; i++) dup2(fds[i], i);
+    if (fchdir(fds[APKMD_FDS - 1]) != 0) _exit(1);
+    
+    int keep = http_request_fd[1];
+    if (keep >= 0 && keep != 3) {
+        dup2(keep, 3);
+        fcntl(3, F_SETFD, FD_CLOEXEC);
+        keep = 3;
+    }
+    close_range(keep >= 0 ? 4 : 3, ~0U, 0);
+    http_request_fd[1] = keep;
+    ctx.epoll_fd = ctx.signal_fd = ctx.timer_fd = -1;
+    
+    setvbuf(stdout, NULL, _IOLBF, 0);
+}
+
+// Une requête ; renvoie 1 si le démon doit s'arrêter. Le client est fermé
+// ici, sauf s'il attend la fin d'un fils (apkmd_children)
+static int apkmd_handle(const apkmd_ops_t *ops, int client, const sigset_t *orig_mask) {
+    char buf[APKMD_MAX_REQUEST + 1];
+    char cbuf[CMSG_SPACE(sizeof(int) * APKMD_FDS)];
+    struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) - 1 };
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = cbuf, .msg_controllen = sizeof(cbuf)
+    };
+    
+    ssize_t n = recvmsg(client, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (n <= 0) {
+        close(client);
+        return 0;
+    }
+    buf[n] = '\0';
+    
+    int fds[APKMD_FDS] = { -1, -1, -1, -1 };
+    int nfds = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        nfds = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        if (nfds > APKMD_FDS) nfds = APKMD_FDS;
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * nfds);
+    }
+    
+    struct ucred cred = {0};
+    socklen_t len = sizeof(cred);
+    getsockopt(client, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+    int owner = cred.uid == 0 || cred.uid == geteuid();
+    int stop = 0;
+    int waiting = 0;
+    
+    // RUN\0conf\0db\0cache\0arg... : les chaînes de la requête
+    char *fields[APKMD_MAX_ARGS + 5];
+    int count = 0;
+    for (char *p = buf; p < buf + n && count < APKMD_MAX_ARGS + 4; p += strlen(p) + 1) {
+        fields[count++] = p;
+    }
+    
+    if (strcmp(buf, "STATUS") == 0) {
+        apkmd_reply(client, "OK %ld", (long)getpid());
+    } else if (strcmp(buf, "STOP") == 0) {
+        if (owner) {
+            apkmd_reply(client, "OK");
+            stop = 1;
+        } else {
+            apkmd_reply(client, "ERR permission denied");
+        }
+    } else if (strcmp(buf, "RUN") == 0 && nfds == APKMD_FDS && count >= 4) {
+        if (cred.uid != geteuid() || strcmp(fields[1], apkm_conf_path()) != 0 ||
+            strcmp(fields[2], apkm_db_dir()) != 0 || strcmp(fields[3], apkm_cache_dir()) != 0 ||
+            apkmd_child_count == APKMD_MAX_CLIENTS) {
+            // Autre utilisateur : même une recherche écrit le cache HTTP, les
+            // marqueurs .down et available_packages. Autres racines ($APKM_CONF,
+            // $APKM_DB_DIR, $APKM_CACHE_DIR) : les caches du démon ne sont pas
+            // les siens. Le client exécute la commande lui-même
+            apkmd_reply(client, "FALLBACK");
+        } else {
+            char **argv = fields + 3;
+            int argc = count - 3;
+            argv[0] = "apkm";
+            argv[argc] = NULL;
+            
+            // Chaque commande dans un fils, héritier des caches chauds : un
+            // client qui ne lit pas sa sortie ou une recherche qui attend le
+            // hub ne bloque que lui
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid == 0) {
+                apkmd_child_setup(fds, orig_mask);
+                if (ops->after_fork) ops->after_fork();
+                int status = ops->run(argc, argv);
+                fflush(stdout);
+                fflush(stderr);
+                _exit(status & 0xff);
+            }
+            if (pid < 0) {
+                apkmd_reply(client, "FALLBACK");
+            } else {
+                apkmd_children[apkmd_child_count].pid = pid;
+                apkmd_children[apkmd_child_count++].client = client;
+                waiting = 1;
+            }
+        }
+    } else {
+        apkmd_reply(client, "ERR bad request");
+    }
+    
+    for (int i = 0; i < nfds; i++) close(fds[i]);
+    if (!waiting) close(client);
+    return stop;
+}
+
+// Fils terminés : code de sortie au client
+static void apkmd_reap(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < apkmd_child_count; i++) {
+            if (apkmd_children[i].pid != pid) continue;
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            apkmd_reply(apkmd_children[i].client, "OK %d", code);
+            close(apkmd_children[i].client);
+            apkmd_children[i] = apkmd_children[--apkmd_child_count];
+            break;
+        }
+    }
+}
+
+// Caches du parent rechargés à l'avance : les fils en héritent
+static void apkmd_warm(const apkmd_ops_t *ops) {
+    if (ops->warm) ops->warm();
+    catalogue_lock();
+    pthread_rwlock_unlock(&ctx.cache_lock);
+}
+
+int apkmd_serve(const apkmd_ops_t *ops, int idle_timeout) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (apkmd_socket_path(addr.sun_path, sizeof(addr.sun_path)) != 0) return -1;
+    
+    // Un seul démon par socket
+    if (apkmd_status(NULL) == 0) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    
+    if (!ctx.initialized) apkm_init(SECURITY_MEDIUM, NULL, NULL);
+    db_keep_open();
+    
+    char dir[sizeof(addr.sun_path)];
+    strcpy(dir, addr.sun_path);
+    mkdir(dirname(dir), 0755);
+    unlink(addr.sun_path);
+    
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0) return -1;
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 128) != 0) {
+        close(listen_fd);
+        return -1;
+    }
+    // Tout le monde peut se connecter (status, repli rapide) ; seules les
+    // commandes du propriétaire sont exécutées (voir apkmd_handle)
+    chmod(addr.sun_path, 0666);
+    
+    sigset_t mask, orig_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &orig_mask);
+    // Un client qui ferme sa socket ne doit pas tuer le démon
+    signal(SIGPIPE, SIG_IGN);
+    
+    ctx.signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    ctx.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    ctx.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    
+    int ret = -1;
+    // Les caches du démon suivent les changements d'état (inotify)
+    apkm_watch_init();
+    
+    if (ctx.signal_fd >= 0 && ctx.timer_fd >= 0 && ctx.epoll_fd >= 0) {
+        // Revalidations HTTP dans la boucle plutôt que dans un fils détaché
+        http_async_init();
+        int watch[] = { listen_fd, ctx.signal_fd, ctx.timer_fd, ctx.inotify_fd,
+                        ctx.multi ? ctx.curl_timer_fd : -1, http_request_fd[0] };
+        ret = 0;
+        for (size_t i = 0; i < sizeof(watch) / sizeof(watch[0]); i++) {
+            if (watch[i] < 0) continue;
+            struct epoll_event ev = { .events = EPOLLIN, .data.fd = watch[i] };
+            if (epoll_ctl(ctx.epoll_fd, EPOLL_CTL_ADD, watch[i], &ev) != 0) ret = -1;
+        }
+    }
+    apkmd_arm_idle(idle_timeout);
+    apkmd_warm(ops);
+    
+    int running = ret == 0;
+    
+    while (running) {
+        struct epoll_event events[APKMD_MAX_EVENTS];
+        int n = epoll_wait(ctx.epoll_fd, events, APKMD_MAX_EVENTS,
+                           apkmd_pending_count ? 1000 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ret = -1;
+            break;
+        }
+        
+        for (int i = 0; i < n && running; i++) {
+            int fd = events[i].data.fd;
+            int pending;
+            
+            if (fd == listen_fd) {
+                // La requête est lue quand elle arrive, jamais en attendant
+                int client;
+                while ((client = accept4(listen_fd, NULL, NULL,
+                                         SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+                    struct epoll_event ev = { .events = EPOLLIN, .data.fd = client };
+                    if (apkmd_pending_count == APKMD_MAX_CLIENTS ||
+                        epoll_ctl(ctx.epoll_fd, EPOLL_CTL_ADD, client, &ev) != 0) {
+                        close(client);
+                        continue;
+                    }
+                    apkmd_pending[apkmd_pending_count].fd = client;
+                    apkmd_pending[apkmd_pending_count++].since = apkmd_now();
+                }
+                apkmd_arm_idle(idle_timeout);
+            } else if ((pending = apkmd_pending_find(fd)) >= 0) {
+                epoll_ctl(ctx.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+                apkmd_pending[pending] = apkmd_pending[--apkmd_pending_count];
+                if (apkmd_handle(ops, fd, &orig_mask)) running = 0;
+            } else if (fd == ctx.signal_fd) {
+                struct signalfd_siginfo si;
+                while (read(ctx.signal_fd, &si, sizeof(si)) == sizeof(si)) {
+                    if (si.ssi_signo == SIGHUP) {
+                        if (ops->reload) ops->reload();
+                        apkmd_warm(ops);
+                    } else if (si.ssi_signo == SIGCHLD) {
+                        apkmd_reap();
+                    } else {
+                        running = 0;
+                    }
+                }
+            } else if (fd == ctx.inotify_fd) {
+                if (apkm_watch_poll()) apkmd_warm(ops);
+            } else if (fd == ctx.timer_fd) {
+                // Inactif : on part, sauf si une commande tourne encore
+                uint64_t expirations;
+                if (read(ctx.timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    if (apkmd_child_count == 0) running = 0;
+                    else apkmd_arm_idle(idle_timeout);
+                }
+            } else {
+                http_async_event(fd, events[i].events);
+            }
+        }
+        apkmd_pending_expire();
+    }
+    
+    while (apkmd_pending_count > 0) apkmd_pending_drop(apkmd_pending_count - 1);
+    // Les commandes en cours finissent seules ; leurs clients n'auront pas
+    // de code de sortie
+    for (int i = 0; i < apkmd_child_count; i++) close(apkmd_children[i].client);
+    apkmd_child_count = 0;
+    
+    close(listen_fd);
+    unlink(addr.sun_path);
+    http_async_cleanup();
+    if (ctx.epoll_fd >= 0) close(ctx.epoll_fd);
+    if (ctx.signal_fd >= 0) close(ctx.signal_fd);
+    if (ctx.timer_fd >= 0) close(ctx.timer_fd);
+    ctx.epoll_fd = ctx.signal_fd = ctx.timer_fd = -1;
+    sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+    signal(SIGPIPE, SIG_DFL);
+    
+    if (ctx.db) {
+        sqlite3_close(ctx.db);
+        ctx.db = NULL;
+    }
+    return ret;
+}
+
 // ============================================================================
 // FONCTIONS DU THREAD WORKER (simplifiées)
 // ============================================================================
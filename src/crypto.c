@@ -1,4 +1,5 @@
 #include "apkm.h"
+#include "crypto.h"
 #include <sodium.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
@@ -8,6 +9,11 @@
 #include <blake3.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // ============================================================================
 // INITIALISATION DE SODIUM
@@ -188,28 +194,157 @@ void blake3_hash(const void* data, size_t len, unsigned char* hash) {
     blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
 }
 
-int blake3_hash_file(const char *filename, unsigned char *hash) {
-    if (!filename || !hash) return -1;
-    
-    FILE *f = fopen(filename, "rb");
-    if (!f) return -1;
+/*
+ * Fichiers : au-delà de BLAKE3_MMAP_MIN on mappe le fichier et on passe
+ * tout le contenu en un seul update. libblake3 peut alors hacher plusieurs
+ * chunks de 1 KiB à la fois avec son backend SIMD (SSE4.1/AVX2/AVX-512/NEON,
+ * choisi à l'exécution), ce que la boucle de 8 KB empêchait.
+ * Si libblake3 est compilée avec TBB, les sous-arbres sont répartis sur
+ * tous les cœurs (blake3_hasher_update_tbb).
+ */
+#define BLAKE3_MMAP_MIN   (64 * 1024)
+#define BLAKE3_READ_SIZE  (1024 * 1024)
+
+static void blake3_update_large(blake3_hasher *hasher, const void *data, size_t len) {
+#ifdef HAVE_BLAKE3_TBB
+    blake3_hasher_update_tbb(hasher, data, len);
+#else
+    blake3_hasher_update(hasher, data, len);
+#endif
+}
+
+static int blake3_hash_fd(int fd, unsigned char *hash) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
     
     blake3_hasher hasher;
     blake3_hasher_init(&hasher);
     
-    unsigned char buffer[8192];
-    size_t bytes;
+    if (S_ISREG(st.st_mode) && st.st_size >= BLAKE3_MMAP_MIN &&
+        (uint64_t)st.st_size <= SIZE_MAX) {
+        size_t len = (size_t)st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, len, MADV_SEQUENTIAL);
+            madvise(map, len, MADV_WILLNEED);
+            blake3_update_large(&hasher, map, len);
+            munmap(map, len);
+            blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
+            return 0;
+        }
+        // mmap impossible (espace d'adressage, FS exotique) : lecture classique
+    }
+    
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    
+    unsigned char *buffer = malloc(BLAKE3_READ_SIZE);
+    if (!buffer) return -1;
     
-    while ((bytes = fread(buffer, 1, sizeof(buffer), f)) > 0) {
-        blake3_hasher_update(&hasher, buffer, bytes);
+    ssize_t bytes;
+    while ((bytes = read(fd, buffer, BLAKE3_READ_SIZE)) > 0) {
+        blake3_update_large(&hasher, buffer, (size_t)bytes);
     }
+    free(buffer);
+    if (bytes < 0) return -1;
     
     blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
-    
-    fclose(f);
     return 0;
 }
 
+int blake3_hash_file(const char *filename, unsigned char *hash) {
+    if (!filename || !hash) return -1;
+    
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    int ret = blake3_hash_fd(fd, hash);
+    close(fd);
+    return ret;
+}
+
+// ============================================================================
+// BLAKE3 PAR LOT (un fichier par thread)
+// ============================================================================
+
+typedef struct {
+    const char *const *filenames;
+    unsigned char (*hashes)[BLAKE3_HASH_LEN];
+    int *status;
+    size_t count;
+    size_t next;
+    size_t failed;
+    pthread_mutex_t lock;
+} blake3_batch_t;
+
+static void *blake3_batch_worker(void *arg) {
+    blake3_batch_t *batch = arg;
+    
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        
+        if (i >= batch->count) break;
+        
+        int ret = blake3_hash_file(batch->filenames[i], batch->hashes[i]);
+        if (batch->status) batch->status[i] = ret;
+        
+        if (ret != 0) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failed++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+    
+    return NULL;
+}
+
+/*
+ * Hache count fichiers en parallèle. hashes[i] reçoit le BLAKE3 de
+ * filenames[i] ; status[i] (optionnel) vaut 0 ou -1.
+ * threads <= 0 : un thread par cœur. Retourne le nombre d'échecs.
+ */
+int blake3_hash_files(const char *const *filenames, size_t count,
+                      unsigned char (*hashes)[BLAKE3_HASH_LEN], int *status,
+                      int threads) {
+    if (!filenames || !hashes) return -1;
+    if (count == 0) return 0;
+    
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > count) threads = (int)count;
+    
+    blake3_batch_t batch = {
+        .filenames = filenames,
+        .hashes = hashes,
+        .status = status,
+        .count = count,
+        .next = 0,
+        .failed = 0
+    };
+    pthread_mutex_init(&batch.lock, NULL);
+    
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    int started = 0;
+    
+    if (tids) {
+        for (int t = 0; t < threads; t++) {
+            if (pthread_create(&tids[t], NULL, blake3_batch_worker, &batch) == 0) {
+                started++;
+            }
+        }
+    }
+    
+    // Pas de thread disponible : on fait le travail nous-mêmes
+    if (started == 0) blake3_batch_worker(&batch);
+    
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    
+    free(tids);
+    pthread_mutex_destroy(&batch.lock);
+    return (int)batch.failed;
+}
+
 // ============================================================================
 // ARGON2ID (Dérivation de clé)
 // ============================================================================
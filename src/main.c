@@ -9,17 +9,16 @@
 #include <libgen.h>
 #include <time.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include "apkm.h"
+#include "core.h"
+#include "manifest.h"
 #include <json-c/json.h>
 
 #define ZARCH_HUB_URL "https://gsql-badge.onrender.com"
 #define ZARCH_API_URL ZARCH_HUB_URL "/v5.2"
 #define ZARCH_PACKAGE_URL ZARCH_HUB_URL "/package/download"
 
-// Configuration
-#define APKM_CONF_PATH "/etc/apkm/repositories.conf"
-#define APKM_LOCAL_DB_PATH "/usr/local/share/apkm/database"
-#define APKM_CACHE_PATH "/usr/local/share/apkm/cache"
 
 struct curl_response {
     char *data;
@@ -40,18 +39,27 @@ typedef struct {
 #define MAX_REPOS 32
 static repository_t repositories[MAX_REPOS];
 static int repo_count = 0;
+static int repos_loaded = 0;
+static unsigned long repos_generation = 0;
 
-// Structure pour Manifest.toml
+// Paquets de la base locale, gardés tant qu'inotify ne signale rien
 typedef struct {
-    char name[256];
-    char version[64];
-    char release[16];
-    char arch[32];
-    char description[1024];
-    char maintainer[256];
-    char license[64];
-    char dependencies[1024];
-} manifest_t;
+    char *name;
+    char *version;
+    char *release;
+    char *description;
+    char **bins;                  // Noms de base des [[file]] du manifest
+    size_t bin_count;
+} installed_entry_t;
+
+static installed_entry_t *installed = NULL;
+static int installed_count = 0;
+static int installed_loaded = 0;
+static unsigned long installed_generation = 0;
+
+// Handle curl réutilisé d'une recherche à l'autre : ses connexions restent
+// ouvertes (décisif dans apkmd, qui enchaîne les requêtes)
+static CURL *search_curl = NULL;
 
 // ============================================================================
 // FONCTIONS UTILITAIRES
@@ -145,18 +153,18 @@ void print_step(const char *format, ...) {
 // ============================================================================
 
 int load_repositories(void) {
-    FILE *f = fopen(APKM_CONF_PATH, "r");
+    FILE *f = fopen(apkm_conf_path(), "r");
     if (!f) {
         // Créer le fichier par défaut
         mkdir("/etc/apkm", 0755);
-        f = fopen(APKM_CONF_PATH, "w");
+        f = fopen(apkm_conf_path(), "w");
         if (f) {
             fprintf(f, "# APKM Repositories\n");
             fprintf(f, "# Format: name url [priority]\n");
             fprintf(f, "zarch-hub https://gsql-badge.onrender.com 5\n");
             fclose(f);
         }
-        f = fopen(APKM_CONF_PATH, "r");
+        f = fopen(apkm_conf_path(), "r");
     }
     
     if (!f) return -1;
@@ -181,92 +189,63 @@ int load_repositories(void) {
     }
     
     fclose(f);
+    repos_loaded = 1;
     return repo_count;
 }
 
+// Dépôts rechargés seulement si repositories.conf a changé (ou sur SIGHUP)
+static int ensure_repositories(void) {
+    unsigned long generation = apkm_state_generation(APKM_STATE_REPOS);
+    if (repos_loaded && generation == repos_generation) return repo_count;
+    
+    repos_generation = generation;
+    return load_repositories();
+}
+
 // ============================================================================
-// PARSEUR SIMPLE DE MANIFEST.TOML
+// MANIFESTS INSTALLÉS
 // ============================================================================
 
-int parse_manifest(const char *path, manifest_t *manifest) {
-    FILE *f = fopen(path, "r");
-    if (!f) return -1;
-    
-    char line[1024];
-    char section[64] = "";
-    
-    memset(manifest, 0, sizeof(manifest_t));
-    
-    while (fgets(line, sizeof(line), f)) {
-        // Enlever le saut de ligne
-        line[strcspn(line, "\n")] = 0;
-        
-        // Ignorer les commentaires et lignes vides
-        if (line[0] == '#' || line[0] == '\0') continue;
-        
-        // Détection des sections
-        if (line[0] == '[') {
-            char *end = strchr(line, ']');
-            if (end) {
-                *end = 0;
-                strcpy(section, line + 1);
-            }
-            continue;
-        }
-        
-        // Parser les clés/valeurs
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
-        
-        *eq = 0;
-        char *key = line;
-        char *value = eq + 1;
-        
-        // Nettoyer les espaces
-        while (*key == ' ') key++;
-        char *kend = key + strlen(key) - 1;
-        while (kend > key && *kend == ' ') *kend-- = 0;
-        
-        while (*value == ' ') value++;
-        if (*value == '"') {
-            value++;
-            char *vend = strchr(value, '"');
-            if (vend) *vend = 0;
-        }
-        
-        if (strcmp(section, "metadata") == 0) {
-            if (strcmp(key, "name") == 0) strcpy(manifest->name, value);
-            else if (strcmp(key, "version") == 0) strcpy(manifest->version, value);
-            else if (strcmp(key, "release") == 0) strcpy(manifest->release, value);
-            else if (strcmp(key, "arch") == 0) strcpy(manifest->arch, value);
-            else if (strcmp(key, "description") == 0) strcpy(manifest->description, value);
-            else if (strcmp(key, "maintainer") == 0) strcpy(manifest->maintainer, value);
-            else if (strcmp(key, "license") == 0) strcpy(manifest->license, value);
-        }
-        else if (strcmp(section, "dependencies") == 0) {
-            // Pour l'instant, on stocke juste la ligne
-            if (strlen(manifest->dependencies) > 0)
-                strcat(manifest->dependencies, ";");
-            strcat(manifest->dependencies, value);
-        }
+// Conserve le Manifest.toml du paquet dans la base locale et compile son
+// cache binaire : list/resolver le relisent sans parser le TOML
+int record_installed_manifest(const char *manifest_path, const manifest_t *manifest,
+                              const char *fallback_name) {
+    const char *name = manifest->name[0] ? manifest->name : fallback_name;
+    if (strchr(name, '/') || strcmp(name, "..") == 0 || strcmp(name, ".") == 0) return -1;
+    
+    char dir[512], dest[600];
+    snprintf(dir, sizeof(dir), "%s/%s", APKM_LOCAL_DB_PATH, name);
+    snprintf(dest, sizeof(dest), "%s/Manifest.toml", dir);
+    mkdir(dir, 0755);
+    
+    FILE *in = fopen(manifest_path, "rb");
+    FILE *out = in ? fopen(dest, "wb") : NULL;
+    int ret = out ? 0 : -1;
+    char buf[8192];
+    size_t n;
+    while (ret == 0 && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) ret = -1;
     }
+    if (out && fclose(out) != 0) ret = -1;
+    if (in) fclose(in);
     
-    fclose(f);
-    return 0;
+    if (ret == 0) ret = manifest_compile(dest, manifest);
+    debug_print("Recorded manifest %s (%s)", dest, ret == 0 ? "cached" : "failed");
+    return ret;
 }
 
 // ============================================================================
 // RECHERCHE DE PACKAGE
 // ============================================================================
 int search_package(const char *name, char *version, char *url, char *author, int *downloads) {
-    load_repositories();
+    ensure_repositories();
+    
+    if (!search_curl) search_curl = curl_easy_init();
+    if (!search_curl) return -1;
     
     for (int i = 0; i < repo_count; i++) {
         if (!repositories[i].enabled) continue;
         
-        CURL *curl = curl_easy_init();
-        if (!curl) continue;
-        
         // --- URL CORRECTE ---
         char search_url[512];
         snprintf(search_url, sizeof(search_url), "%s/v5.2/package/%s", 
@@ -274,16 +253,9 @@ int search_package(const char *name, char *version, char *url, char *author, int
         
         debug_print("Searching: %s", search_url);
         
+        // Réponse en cache si fraîche (voir apkm_http_get)
         struct curl_response resp = {0};
-        curl_easy_setopt(curl, CURLOPT_URL, search_url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, response_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-        
-        CURLcode res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        
-        if (res == CURLE_OK && resp.data) {
+        if (apkm_http_get(search_curl, search_url, 5L, &resp.data, &resp.size) == 0) {
             debug_print("Response: %s", resp.data);
             
             struct json_object *parsed = json_tokener_parse(resp.data);
@@ -321,6 +293,18 @@ int search_package(const char *name, char *version, char *url, char *author, int
                                  repositories[i].url, name, version, release, arch);
                     }
                     
+                    // Gardé dans available_packages pour le mode hors ligne
+                    if (version && url && !apkm_offline()) {
+                        package_t pkg = {0};
+                        snprintf(pkg.name, sizeof(pkg.name), "%s", name);
+                        snprintf(pkg.version, sizeof(pkg.version), "%s", version);
+                        snprintf(pkg.release, sizeof(pkg.release), "%s", release);
+                        snprintf(pkg.architecture, sizeof(pkg.architecture), "%s", arch);
+                        if (author) snprintf(pkg.maintainer, sizeof(pkg.maintainer), "%s", author);
+                        snprintf(pkg.url, sizeof(pkg.url), "%s", url);
+                        apkm_catalogue_record(&pkg, repositories[i].name);
+                    }
+                    
                     json_object_put(parsed);
                     free(resp.data);
                     return 0; // Succès
@@ -330,14 +314,41 @@ int search_package(const char *name, char *version, char *url, char *author, int
             free(resp.data);
         }
     }
+    
+    // Hors ligne : la dernière version connue du catalogue local
+    package_t pkg;
+    if (apkm_offline() && apkm_catalogue_find(name, &pkg) == 0) {
+        debug_print("Resolved %s %s from available_packages", name, pkg.version);
+        if (version) strcpy(version, pkg.version);
+        if (author) strcpy(author, pkg.maintainer);
+        if (downloads) *downloads = 0;
+        if (url) snprintf(url, 512, "%s", pkg.url);
+        return 0;
+    }
     return -1; // Non trouvé
 }
+
+// Paquet introuvable : hors ligne, c'est qu'il n'est pas en cache
+static void print_not_found(const char *name) {
+    switch (apkm_offline()) {
+    case APKM_OFFLINE_FORCED:
+        print_error("Package '%s' not cached (offline)", name);
+        break;
+    case APKM_OFFLINE_FALLBACK:
+        print_error("Package '%s' not cached and hub unreachable", name);
+        break;
+    default:
+        print_error("Package '%s' not found", name);
+        break;
+    }
+}
 // ============================================================================
 // TÉLÉCHARGEMENT
 // ============================================================================
 
 int download_package(const char *url, const char *output_path) {
     debug_print("Downloading from: %s", url);
+    if (!apkm_hub_reachable(url)) return -1;
     
     CURL *curl = curl_easy_init();
     if (!curl) return -1;
@@ -353,11 +364,13 @@ int download_package(const char *url, const char *output_path) {
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, APKM_CONNECT_TIMEOUT);
     curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "APKM/2.0");
     
     CURLcode res = curl_easy_perform(curl);
     fclose(fp);
+    apkm_hub_result(url, res);
     
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
@@ -483,7 +496,7 @@ int install_package(const char *name, const char *version_specific) {
     print_step("Searching for %s", name);
     
     if (search_package(name, version, url, author, &downloads) != 0) {
-        print_error("Package '%s' not found", name);
+        print_not_found(name);
         return -1;
     }
     
@@ -491,23 +504,50 @@ int install_package(const char *name, const char *version_specific) {
     print_info("  Author: %s", author);
     print_info("  Downloads: %d", downloads);
     
-    char tmp_path[512];
+    // Archive gardée dans APKM_CACHE_PATH pour les installations hors ligne
+    char tmp_path[512], cached_path[512], part_path[520];
     snprintf(tmp_path, sizeof(tmp_path), "/tmp/%s-%s.tar.bool", name, version);
+    snprintf(cached_path, sizeof(cached_path), "%s/%s-%s.tar.bool", APKM_CACHE_PATH, name, version);
+    snprintf(part_path, sizeof(part_path), "%s.part", cached_path);
+    int cacheable = access(APKM_CACHE_PATH, W_OK) == 0;
+    const char *pkg_path = NULL;
+    
+    if (!apkm_offline()) {
+        print_step("Downloading");
+        if (download_package(url, cacheable ? part_path : tmp_path) == 0) {
+            print_success("Download complete");
+            if (!cacheable) {
+                pkg_path = tmp_path;
+            } else if (rename(part_path, cached_path) == 0) {
+                pkg_path = cached_path;
+            } else {
+                unlink(part_path);
+            }
+        }
+    }
     
-    print_step("Downloading");
-    if (download_package(url, tmp_path) != 0) {
-        print_error("Download failed");
-        return -1;
+    if (!pkg_path) {
+        if (access(cached_path, R_OK) != 0) {
+            if (apkm_offline()) {
+                print_error("Package %s %s not cached (%s)", name, version,
+                            apkm_offline() == APKM_OFFLINE_FORCED ? "offline" : "hub unreachable");
+            } else {
+                print_error("Download failed");
+            }
+            return -1;
+        }
+        print_info("Using cached %s", cached_path);
+        pkg_path = cached_path;
     }
-    print_success("Download complete");
     
     char extract_dir[512];
     snprintf(extract_dir, sizeof(extract_dir), "/tmp/apkm_extract_%d", getpid());
     
     print_step("Extracting");
-    if (extract_package(tmp_path, extract_dir) != 0) {
+    if (extract_package(pkg_path, extract_dir) != 0) {
         print_error("Extraction failed");
-        unlink(tmp_path);
+        // Archive corrompue : ne pas la resservir
+        unlink(pkg_path);
         return -1;
     }
     print_success("Extraction complete");
@@ -522,11 +562,13 @@ int install_package(const char *name, const char *version_specific) {
         print_info("Found Manifest.toml");
         
         manifest_t manifest;
-        if (parse_manifest(manifest_path, &manifest) == 0) {
+        if (manifest_parse_file(manifest_path, &manifest) == 0) {
             if (strlen(manifest.description) > 0) {
                 print_info("Description: %s", manifest.description);
             }
             install_from_manifest(extract_dir, &manifest);
+            record_installed_manifest(manifest_path, &manifest, name);
+            manifest_free(&manifest);
         } else {
             print_warning("Failed to parse Manifest.toml");
             use_legacy = 1;
@@ -550,7 +592,7 @@ int install_package(const char *name, const char *version_specific) {
     char cleanup_cmd[1024];
     snprintf(cleanup_cmd, sizeof(cleanup_cmd), "rm -rf %s", extract_dir);
     system(cleanup_cmd);
-    unlink(tmp_path);
+    if (pkg_path == tmp_path) unlink(tmp_path);
     
     print_success("Package %s installed", name);
     return 0;
@@ -560,27 +602,184 @@ int install_package(const char *name, const char *version_specific) {
 // LISTE DES PACKAGES INSTALLÉS
 // ============================================================================
 
+static void free_installed(void) {
+    for (int i = 0; i < installed_count; i++) {
+        free(installed[i].name);
+        free(installed[i].version);
+        free(installed[i].release);
+        free(installed[i].description);
+        for (size_t j = 0; j < installed[i].bin_count; j++) free(installed[i].bins[j]);
+        free(installed[i].bins);
+    }
+    free(installed);
+    installed = NULL;
+    installed_count = 0;
+    installed_loaded = 0;
+}
+
+// Paquets enregistrés dans la base locale (cache binaire des manifests)
+static int load_installed(void) {
+    unsigned long generation = apkm_state_generation(APKM_STATE_INSTALLED);
+    if (installed_loaded && generation == installed_generation) return installed_count;
+    
+    free_installed();
+    installed_generation = generation;
+    installed_loaded = 1;
+    debug_print("Loading installed packages from %s", APKM_LOCAL_DB_PATH);
+    
+    DIR *dir = opendir(APKM_LOCAL_DB_PATH);
+    if (!dir) return 0;
+    
+    int capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') continue;
+        
+        char pkg_dir[512], path[768];
+        snprintf(pkg_dir, sizeof(pkg_dir), "%s/%s", APKM_LOCAL_DB_PATH, ent->d_name);
+        snprintf(path, sizeof(path), "%s/Manifest.toml", pkg_dir);
+        
+        // Surveillé avant lecture : une réinstallation pendant ce temps invalide
+        apkm_watch_path(pkg_dir, APKM_STATE_INSTALLED);
+        
+        manifest_t manifest;
+        if (manifest_load(path, &manifest) != 0) continue;
+        debug_print("%s: %s", path, manifest.from_cache ? "binary cache" : "parsed");
+        
+        if (installed_count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            installed_entry_t *grown = realloc(installed, capacity * sizeof(*installed));
+            if (!grown) {
+                manifest_free(&manifest);
+                break;
+            }
+            installed = grown;
+        }
+        
+        installed_entry_t *entry = &installed[installed_count++];
+        entry->name = strdup(manifest.name[0] ? manifest.name : ent->d_name);
+        entry->version = strdup(manifest.version);
+        entry->release = strdup(manifest.release);
+        entry->description = strdup(manifest.description);
+        entry->bins = calloc(manifest.file_count + 1, sizeof(char *));
+        entry->bin_count = 0;
+        for (size_t i = 0; entry->bins && i < manifest.file_count; i++) {
+            const char *base = strrchr(manifest.files[i].dest, '/');
+            entry->bins[entry->bin_count++] = strdup(base ? base + 1 : manifest.files[i].dest);
+        }
+        manifest_free(&manifest);
+    }
+    closedir(dir);
+    return installed_count;
+}
+
+static int list_recorded_packages(void) {
+    int count = load_installed();
+    
+    for (int i = 0; i < count; i++) {
+        const installed_entry_t *entry = &installed[i];
+        printf("  • %-20s %s-%s", entry->name, entry->version, entry->release);
+        if (entry->description[0]) printf("  %s", entry->description);
+        printf("\n");
+    }
+    return count;
+}
+
+// Binaire de /usr/local/bin appartenant à un paquet enregistré
+static int owned_by_recorded(const char *bin) {
+    for (int i = 0; i < installed_count; i++) {
+        if (strcmp(installed[i].name, bin) == 0) return 1;
+        for (size_t j = 0; j < installed[i].bin_count; j++) {
+            if (installed[i].bins[j] && strcmp(installed[i].bins[j], bin) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_bin_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Installations à l'ancienne (sans manifest) : exécutables de /usr/local/bin
+// qu'aucun paquet enregistré ne revendique
+static void list_legacy_binaries(void) {
+    DIR *dir = opendir("/usr/local/bin");
+    if (!dir) return;
+    
+    char **names = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.' || owned_by_recorded(ent->d_name)) continue;
+        
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **grown = realloc(names, capacity * sizeof(char *));
+            if (!grown) break;
+            names = grown;
+        }
+        names[count++] = strdup(ent->d_name);
+    }
+    closedir(dir);
+    
+    if (count > 0) qsort(names, count, sizeof(char *), compare_bin_names);
+    for (size_t i = 0; i < count; i++) {
+        char path[512];
+        struct stat st;
+        snprintf(path, sizeof(path), "/usr/local/bin/%s", names[i]);
+        if (names[i] && stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0) {
+            printf("  • %-20s (%lld KB)\n", names[i], (long long)st.st_size / 1024);
+        }
+        free(names[i]);
+    }
+    free(names);
+}
+
 int cmd_list_installed(void) {
     printf("\n📦 Installed packages:\n");
     printf("──────────────────────\n");
     
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), 
-             "ls -1 /usr/local/bin/ 2>/dev/null | "
-             "while read f; do "
-             "  if [ -x \"/usr/local/bin/$f\" ]; then "
-             "    size=$(du -b \"/usr/local/bin/$f\" 2>/dev/null | cut -f1); "
-             "    if [ -n \"$size\" ]; then "
-             "      printf \"  • %-20s (%d KB)\\n\" \"$f\" $((size/1024)); "
-             "    else "
-             "      printf \"  • %s\\n\" \"$f\"; "
-             "    fi; "
-             "  fi; "
-             "done | sort");
-    
-    fflush(stdout);
-    system(cmd);
+    list_recorded_packages();
+    list_legacy_binaries();
+    return 0;
+}
+
+// ============================================================================
+// INFORMATIONS SUR UN PACKAGE
+// ============================================================================
+
+int cmd_info(const char *name) {
+    if (!strchr(name, '/')) {
+        char path[768];
+        snprintf(path, sizeof(path), "%s/%s/Manifest.toml", APKM_LOCAL_DB_PATH, name);
+        
+        manifest_t manifest;
+        if (manifest_load(path, &manifest) == 0) {
+            printf("\n📦 %s %s-%s (installed)\n", manifest.name[0] ? manifest.name : name,
+                   manifest.version, manifest.release);
+            if (manifest.description[0]) printf("  Description: %s\n", manifest.description);
+            if (manifest.arch[0]) printf("  Arch: %s\n", manifest.arch);
+            if (manifest.maintainer[0]) printf("  Maintainer: %s\n", manifest.maintainer);
+            if (manifest.license[0]) printf("  License: %s\n", manifest.license);
+            if (manifest.homepage[0]) printf("  Homepage: %s\n", manifest.homepage);
+            for (size_t i = 0; i < manifest.dep_count; i++) {
+                printf("  Depends: %s %s\n", manifest.deps[i].name, manifest.deps[i].constraint);
+            }
+            manifest_free(&manifest);
+            return 0;
+        }
+    }
     
+    char ver[64] = "", url[512] = "", author[256] = "";
+    int downloads = 0;
+    if (search_package(name, ver, url, author, &downloads) != 0) {
+        print_not_found(name);
+        return 1;
+    }
+    printf("\n📦 %s %s\n", name, ver);
+    printf("  Author: %s\n", author);
+    printf("  Downloads: %d\n", downloads);
+    printf("  URL: %s\n", url);
     return 0;
 }
 
@@ -589,7 +788,7 @@ int cmd_list_installed(void) {
 // ============================================================================
 
 int cmd_list_repos(void) {
-    load_repositories();
+    ensure_repositories();
     
     printf("\n📋 Configured repositories:\n");
     printf("────────────────────────────\n");
@@ -620,13 +819,26 @@ void print_help(void) {
     printf("COMMANDS:\n");
     printf("  install <pkg>        Install a package from repository\n");
     printf("  search <term>        Search for packages\n");
+    printf("  info <pkg>           Show package details\n");
     printf("  list                  List installed packages\n");
     printf("  repo list             List configured repositories\n");
+    printf("  daemon [start|stop|status]  Persistent apkmd serving CLI requests\n");
     printf("  help                   Show this help\n\n");
     
     printf("OPTIONS:\n");
     printf("  --debug               Enable debug output\n");
-    printf("  --quiet               Suppress output\n\n");
+    printf("  --quiet               Suppress output\n");
+    printf("  --offline             Resolve from the local catalogue and caches only\n");
+    printf("  --foreground          daemon: stay attached to the terminal\n");
+    printf("  --idle <sec>          daemon: exit after <sec> without requests\n\n");
+    
+    printf("ENVIRONMENT:\n");
+    printf("  APKMD_SOCK            apkmd socket (default: %s)\n", APKMD_SOCKET_PATH);
+    printf("  APKM_NO_DAEMON        Always run in-process\n");
+    printf("  APKM_OFFLINE          Same as --offline when set to 1\n");
+    printf("  APKM_CACHE_DIR        Hub response cache (default: %s/http)\n", APKM_CACHE_PATH);
+    printf("  APKM_CONF             Repository list (default: %s)\n", APKM_CONF_PATH);
+    printf("  APKM_DB_DIR           Package catalogue directory (default: %s)\n\n", APKM_DB_PATH);
     
     printf("EXAMPLES:\n");
     printf("  apkm install nginx\n");
@@ -638,21 +850,126 @@ void print_help(void) {
 }
 
 // ============================================================================
-// MAIN
+// DÉMON APKMD
 // ============================================================================
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        print_help();
+static void reload_state(void) {
+    repos_loaded = 0;
+    installed_loaded = 0;
+}
+
+// Dans apkmd, avant de servir : les fils héritent de ces caches
+static void warm_state(void) {
+    ensure_repositories();
+    load_installed();
+}
+
+static void drop_connections(void) {
+    // Les sockets appartiennent aussi au parent : ne pas les fermer ici
+    search_curl = NULL;
+}
+
+static int run_command(int argc, char *argv[]);
+
+static const apkmd_ops_t daemon_ops = {
+    .run = run_command,
+    .reload = reload_state,
+    .warm = warm_state,
+    .after_fork = drop_connections,
+};
+
+int cmd_daemon(int argc, char *argv[]) {
+    const char *action = "start";
+    int foreground = 0;
+    int idle = 0;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--foreground") == 0) foreground = 1;
+        else if (strcmp(argv[i], "--idle") == 0 && i + 1 < argc) idle = atoi(argv[++i]);
+        else action = argv[i];
+    }
+    
+    char sock[108];
+    apkmd_socket_path(sock, sizeof(sock));
+    long pid;
+    
+    if (strcmp(action, "status") == 0) {
+        if (apkmd_status(&pid) != 0) {
+            print_info("apkmd not running (%s)", sock);
+            return 1;
+        }
+        print_success("apkmd running (pid %ld, %s)", pid, sock);
         return 0;
     }
     
-    // Créer les répertoires nécessaires
-    mkdir("/usr/local/share/apkm", 0755);
-    mkdir(APKM_LOCAL_DB_PATH, 0755);
-    mkdir(APKM_CACHE_PATH, 0755);
+    if (strcmp(action, "stop") == 0) {
+        if (apkmd_stop() != 0) {
+            print_error("apkmd not running or not ours (%s)", sock);
+            return 1;
+        }
+        print_success("apkmd stopped");
+        return 0;
+    }
     
-    curl_global_init(CURL_GLOBAL_ALL);
+    if (strcmp(action, "start") != 0) {
+        print_error("Unknown daemon command: %s", action);
+        return 1;
+    }
+    
+    if (apkmd_status(&pid) == 0) {
+        print_info("apkmd already running (pid %ld)", pid);
+        return 0;
+    }
+    
+    if (foreground) {
+        print_info("apkmd listening on %s", sock);
+        if (apkmd_serve(&daemon_ops, idle) != 0) {
+            print_error("Cannot start apkmd on %s", sock);
+            return 1;
+        }
+        return 0;
+    }
+    
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        print_error("Cannot fork apkmd");
+        return 1;
+    }
+    if (child == 0) {
+        setsid();
+        int null = open("/dev/null", O_RDWR);
+        if (null >= 0) {
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+            if (null > STDERR_FILENO) close(null);
+        }
+        _exit(apkmd_serve(&daemon_ops, idle) == 0 ? 0 : 1);
+    }
+    
+    // Attendre que la socket réponde
+    for (int i = 0; i < 100; i++) {
+        if (apkmd_status(&pid) == 0) {
+            print_success("apkmd started (pid %ld, %s)", pid, sock);
+            return 0;
+        }
+        if (waitpid(child, NULL, WNOHANG) == child) break;
+        usleep(50000);
+    }
+    print_error("Cannot start apkmd on %s", sock);
+    return 1;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+// Une commande apkm ; appelée par main() ou par apkmd pour un client
+static int run_command(int argc, char *argv[]) {
+    debug_mode = 0;
+    quiet_mode = 0;
+    int offline = 0;
     
     // Parser les options globales
     int args_processed = 1;
@@ -665,6 +982,10 @@ int main(int argc, char *argv[]) {
             quiet_mode = 1;
             args_processed++;
         }
+        else if (strcmp(argv[i], "--offline") == 0) {
+            offline = 1;
+            args_processed++;
+        }
         else {
             break;
         }
@@ -674,6 +995,12 @@ int main(int argc, char *argv[]) {
         argv += args_processed - 1;
         argc -= args_processed - 1;
     }
+    apkm_set_offline(offline);
+    
+    if (argc < 2) {
+        print_help();
+        return 0;
+    }
     
     int result = 0;
     
@@ -697,10 +1024,18 @@ int main(int argc, char *argv[]) {
                 printf("  Author: %s\n", author);
                 printf("  Downloads: %d\n", downloads);
             } else {
-                print_error("Package '%s' not found", argv[2]);
+                print_not_found(argv[2]);
             }
         }
     }
+    else if (strcmp(argv[1], "info") == 0) {
+        if (argc < 3) {
+            print_error("Missing package name");
+            result = 1;
+        } else {
+            result = cmd_info(argv[2]);
+        }
+    }
     else if (strcmp(argv[1], "list") == 0) {
         result = cmd_list_installed();
     }
@@ -712,6 +1047,9 @@ int main(int argc, char *argv[]) {
             result = 1;
         }
     }
+    else if (strcmp(argv[1], "daemon") == 0) {
+        result = cmd_daemon(argc, argv);
+    }
     else if (strcmp(argv[1], "help") == 0 || strcmp(argv[1], "--help") == 0) {
         print_help();
     }
@@ -721,6 +1059,55 @@ int main(int argc, char *argv[]) {
         result = 1;
     }
     
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        print_help();
+        return 0;
+    }
+    
+    // APKM_OFFLINE=1 : --offline, transmis tel quel à apkmd
+    const char *offline_env = getenv("APKM_OFFLINE");
+    char **offline_argv = NULL;
+    if (offline_env && strcmp(offline_env, "1") == 0) {
+        offline_argv = malloc((argc + 2) * sizeof(char *));
+        if (offline_argv) {
+            offline_argv[0] = argv[0];
+            offline_argv[1] = "--offline";
+            memcpy(offline_argv + 2, argv + 1, argc * sizeof(char *));
+            argv = offline_argv;
+            argc++;
+        }
+    }
+    
+    // Client léger : apkmd répond avec ses caches chauds s'il tourne
+    int is_daemon_cmd = 0;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        is_daemon_cmd = strcmp(argv[i], "daemon") == 0;
+        break;
+    }
+    if (!is_daemon_cmd && !getenv("APKM_NO_DAEMON")) {
+        int status;
+        if (apkmd_forward(argc, argv, &status) == 0) {
+            free(offline_argv);
+            return status;
+        }
+    }
+    
+    // Créer les répertoires nécessaires
+    mkdir("/usr/local/share/apkm", 0755);
+    mkdir(APKM_LOCAL_DB_PATH, 0755);
+    mkdir(APKM_CACHE_PATH, 0755);
+    
+    curl_global_init(CURL_GLOBAL_ALL);
+    
+    int result = run_command(argc, argv);
+    
+    if (search_curl) curl_easy_cleanup(search_curl);
     curl_global_cleanup();
+    free(offline_argv);
     return result;
 }
@@ -0,0 +1,608 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "manifest.h"
+
+#define MANIFEST_CHUNK_SIZE 4096
+#define MANIFEST_CACHE_EXT ".bin"
+#define MANIFEST_CACHE_MAGIC "APKMMF\0\1"
+#define MANIFEST_CACHE_VERSION 1
+
+struct manifest_chunk {
+    manifest_chunk_t *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+enum {
+#define MANIFEST_FIELD_ID(field, section, key) MANIFEST_F_##field,
+    MANIFEST_FIELDS(MANIFEST_FIELD_ID)
+#undef MANIFEST_FIELD_ID
+    MANIFEST_FIELD_COUNT
+};
+
+static const struct {
+    const char *section;
+    const char *key;
+    size_t offset;
+} field_table[MANIFEST_FIELD_COUNT] = {
+#define MANIFEST_FIELD_ENTRY(field, sec, k) { sec, k, offsetof(manifest_t, field) },
+    MANIFEST_FIELDS(MANIFEST_FIELD_ENTRY)
+#undef MANIFEST_FIELD_ENTRY
+};
+
+#define FIELD(m, i) (*(const char **)((char *)(m) + field_table[i].offset))
+
+// ============================================================================
+// ARÈNE
+// ============================================================================
+
+static void *arena_alloc(manifest_t *m, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+
+    manifest_chunk_t *c = m->arena;
+    if (!c || c->size - c->used < size) {
+        size_t cap = size > MANIFEST_CHUNK_SIZE ? size : MANIFEST_CHUNK_SIZE;
+        c = malloc(sizeof(*c) + cap);
+        if (!c) return NULL;
+        c->size = cap;
+        c->used = 0;
+        // Le gros bloc (fichier) passe derrière le bloc courant
+        if (m->arena && size > MANIFEST_CHUNK_SIZE) {
+            c->next = m->arena->next;
+            m->arena->next = c;
+        } else {
+            c->next = m->arena;
+            m->arena = c;
+        }
+    }
+
+    void *p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+void manifest_init(manifest_t *m) {
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < MANIFEST_FIELD_COUNT; i++) FIELD(m, i) = "";
+}
+
+void manifest_free(manifest_t *m) {
+    if (!m) return;
+    manifest_chunk_t *c = m->arena;
+    while (c) {
+        manifest_chunk_t *next = c->next;
+        free(c);
+        c = next;
+    }
+    manifest_init(m);
+}
+
+// ============================================================================
+// DÉCOUPAGE TOML
+// ============================================================================
+
+typedef enum {
+    SEC_OTHER,
+    SEC_METADATA,
+    SEC_DEPS,
+    SEC_BUILD_DEPS,
+    SEC_SCRIPTS,
+    SEC_SIGNATURE,
+    SEC_FILE
+} section_t;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Ligne suivante : [*line, *eol) ; renvoie 0 en fin de tampon
+static int next_line(char **p, char *end, char **line, char **eol) {
+    if (*p >= end) return 0;
+    *line = *p;
+    char *nl = memchr(*p, '\n', end - *p);
+    *eol = nl ? nl : end;
+    *p = nl ? nl + 1 : end;
+    while (*line < *eol && is_space(**line)) (*line)++;
+    while (*eol > *line && is_space((*eol)[-1])) (*eol)--;
+    return 1;
+}
+
+static section_t section_of(const char *s, size_t len) {
+    static const struct { const char *name; section_t sec; } sections[] = {
+        {"metadata", SEC_METADATA},
+        {"dependencies", SEC_DEPS},
+        {"build-dependencies", SEC_BUILD_DEPS},
+        {"scripts", SEC_SCRIPTS},
+        {"signature", SEC_SIGNATURE},
+    };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        if (strlen(sections[i].name) == len && memcmp(sections[i].name, s, len) == 0) {
+            return sections[i].sec;
+        }
+    }
+    return SEC_OTHER;
+}
+
+// En-tête "[x]" ou "[[x]]" : 1 si la ligne en est un
+static int parse_header(char *line, char *eol, section_t *sec, int *new_file) {
+    if (line >= eol || *line != '[') return 0;
+
+    int array = eol - line >= 2 && line[1] == '[';
+    char *s = line + (array ? 2 : 1);
+    char *e = memchr(s, ']', eol - s);
+    if (!e) e = eol;
+    while (s < e && is_space(*s)) s++;
+    while (e > s && is_space(e[-1])) e--;
+
+    *new_file = 0;
+    if (array) {
+        *new_file = e - s == 4 && memcmp(s, "file", 4) == 0;
+        *sec = *new_file ? SEC_FILE : SEC_OTHER;
+    } else {
+        *sec = section_of(s, e - s);
+    }
+    return 1;
+}
+
+// Encode un point de code en UTF-8 dans dst, renvoie la longueur
+static size_t utf8_encode(char *dst, uint32_t cp) {
+    if (cp < 0x80) {
+        dst[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        dst[0] = (char)(0xC0 | (cp >> 6));
+        dst[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dst[0] = (char)(0xE0 | (cp >> 12));
+        dst[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dst[0] = (char)(0xF0 | ((cp >> 18) & 0x07));
+    dst[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Chaîne "..." déséchappée sur place (le résultat est toujours plus court)
+static char *parse_basic_string(char *s, char *eol) {
+    char *dst = s, *p = s + 1;
+
+    while (p < eol && *p != '"') {
+        if (*p != '\\' || p + 1 >= eol) {
+            *dst++ = *p++;
+            continue;
+        }
+        p++;
+        switch (*p) {
+        case 'n':  *dst++ = '\n'; p++; break;
+        case 't':  *dst++ = '\t'; p++; break;
+        case 'r':  *dst++ = '\r'; p++; break;
+        case 'b':  *dst++ = '\b'; p++; break;
+        case 'f':  *dst++ = '\f'; p++; break;
+        case 'u':
+        case 'U': {
+            int digits = *p == 'u' ? 4 : 8;
+            if (eol - p - 1 < digits) {
+                *dst++ = *p++;
+                break;
+            }
+            char hex[9];
+            memcpy(hex, p + 1, digits);
+            hex[digits] = '\0';
+            char *hend;
+            uint32_t cp = (uint32_t)strtoul(hex, &hend, 16);
+            if (hend != hex + digits || cp > 0x10FFFF) {
+                *dst++ = *p++;
+                break;
+            }
+            dst += utf8_encode(dst, cp);
+            p += digits + 1;
+            break;
+        }
+        default:   *dst++ = *p++; break;    // \" et \\ inclus
+        }
+    }
+    *dst = '\0';
+    return s;
+}
+
+// Valeur de "clé = valeur" : chaîne, littéral ou texte brut (nombres,
+// tableaux, tables en ligne), sans commentaire final
+static const char *parse_value(char *s, char *eol) {
+    while (s < eol && is_space(*s)) s++;
+    if (s >= eol) {
+        *s = '\0';
+        return s;
+    }
+
+    if (*s == '"') return parse_basic_string(s, eol);
+
+    if (*s == '\'') {
+        char *e = memchr(s + 1, '\'', eol - s - 1);
+        if (!e) e = eol;
+        *e = '\0';
+        return s + 1;
+    }
+
+    char *e = eol;
+    if (*s != '[' && *s != '{') {
+        char *hash = memchr(s, '#', eol - s);
+        if (hash) e = hash;
+    }
+    while (e > s && is_space(e[-1])) e--;
+    *e = '\0';
+    return s;
+}
+
+// Sépare "clé = valeur" ; la clé peut être entre guillemets
+static int split_key(char *line, char *eol, char **key, char **value) {
+    char *eq;
+    if (*line == '"' || *line == '\'') {
+        char *q = memchr(line + 1, *line, eol - line - 1);
+        if (!q) return -1;
+        eq = memchr(q, '=', eol - q);
+        if (!eq) return -1;
+        *key = line + 1;
+        *q = '\0';
+    } else {
+        eq = memchr(line, '=', eol - line);
+        if (!eq) return -1;
+        char *ke = eq;
+        while (ke > line && is_space(ke[-1])) ke--;
+        *key = line;
+        *ke = '\0';
+    }
+    *value = eq + 1;
+    return 0;
+}
+
+static int parse_in_place(char *buf, size_t len, manifest_t *m) {
+    char *end = buf + len;
+    char *p, *line, *eol;
+    section_t sec = SEC_OTHER;
+    int new_file;
+
+    // Première passe : taille des tableaux, alloués une fois dans l'arène
+    size_t ndeps = 0, nbuild = 0, nfiles = 0;
+    for (p = buf; next_line(&p, end, &line, &eol);) {
+        if (line == eol || *line == '#') continue;
+        if (parse_header(line, eol, &sec, &new_file)) {
+            nfiles += new_file;
+            continue;
+        }
+        if (!memchr(line, '=', eol - line)) continue;
+        if (sec == SEC_DEPS) ndeps++;
+        else if (sec == SEC_BUILD_DEPS) nbuild++;
+    }
+
+    m->deps = ndeps ? arena_alloc(m, ndeps * sizeof(manifest_dep_t)) : NULL;
+    m->build_deps = nbuild ? arena_alloc(m, nbuild * sizeof(manifest_dep_t)) : NULL;
+    m->files = nfiles ? arena_alloc(m, nfiles * sizeof(manifest_file_t)) : NULL;
+    if ((ndeps && !m->deps) || (nbuild && !m->build_deps) || (nfiles && !m->files)) return -1;
+
+    sec = SEC_OTHER;
+    for (p = buf; next_line(&p, end, &line, &eol);) {
+        if (line == eol || *line == '#') continue;
+        if (parse_header(line, eol, &sec, &new_file)) {
+            if (new_file) {
+                manifest_file_t *f = &m->files[m->file_count++];
+                f->source = "";
+                f->dest = "";
+                f->mode = 0644;
+            }
+            continue;
+        }
+
+        char *key, *raw;
+        if (split_key(line, eol, &key, &raw) != 0) continue;
+        const char *value = parse_value(raw, eol);
+
+        switch (sec) {
+        case SEC_DEPS:
+        case SEC_BUILD_DEPS: {
+            manifest_dep_t *d = sec == SEC_DEPS ? &m->deps[m->dep_count++]
+                                                : &m->build_deps[m->build_dep_count++];
+            d->name = key;
+            d->constraint = *value ? value : "*";
+            break;
+        }
+        case SEC_FILE: {
+            manifest_file_t *f = &m->files[m->file_count - 1];
+            if (strcmp(key, "source") == 0) f->source = value;
+            else if (strcmp(key, "dest") == 0) f->dest = value;
+            else if (strcmp(key, "mode") == 0) f->mode = (uint32_t)strtoul(value, NULL, 8);
+            break;
+        }
+        case SEC_OTHER:
+            break;
+        default: {
+            const char *sname = sec == SEC_METADATA ? "metadata" :
+                                sec == SEC_SCRIPTS ? "scripts" : "signature";
+            for (int i = 0; i < MANIFEST_FIELD_COUNT; i++) {
+                if (strcmp(field_table[i].section, sname) == 0 &&
+                    strcmp(field_table[i].key, key) == 0) {
+                    FIELD(m, i) = value;
+                    break;
+                }
+            }
+            break;
+        }
+        }
+    }
+    return 0;
+}
+
+int manifest_parse_buffer(const char *data, size_t len, manifest_t *m) {
+    manifest_init(m);
+    char *buf = arena_alloc(m, len + 1);
+    if (!buf) return -1;
+    memcpy(buf, data, len);
+    buf[len] = '\0';
+    if (parse_in_place(buf, len, m) != 0) {
+        manifest_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+// Lit tout le fichier dans l'arène ; renvoie le tampon (terminé par '\0')
+static char *read_whole(manifest_t *m, int fd, size_t size, size_t *len) {
+    char *buf = arena_alloc(m, size + 1);
+    if (!buf) return NULL;
+
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, buf + got, size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return NULL;
+        if (n == 0) break;
+        got += n;
+    }
+    buf[got] = '\0';
+    *len = got;
+    return buf;
+}
+
+int manifest_parse_file(const char *path, manifest_t *m) {
+    manifest_init(m);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    size_t len = 0;
+    char *buf = fstat(fd, &st) == 0 ? read_whole(m, fd, (size_t)st.st_size, &len) : NULL;
+    close(fd);
+
+    if (!buf || parse_in_place(buf, len, m) != 0) {
+        manifest_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// CACHE BINAIRE
+// ============================================================================
+
+// Fichier : en-tête, offsets des champs, des dépendances et des fichiers
+// (uint32, dans la table de chaînes), puis la table de chaînes elle-même.
+// Ordre d'octets de la machine : c'est un cache local, pas un format d'échange.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t field_count;
+    uint64_t src_size;
+    int64_t src_mtime_sec;
+    int64_t src_mtime_nsec;
+    uint64_t src_ino;
+    uint32_t dep_count;
+    uint32_t build_dep_count;
+    uint32_t file_count;
+    uint32_t strings_size;
+} manifest_cache_header_t;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} strtab_t;
+
+static int strtab_add(strtab_t *t, const char *s, uint32_t *off) {
+    size_t n = strlen(s) + 1;
+    if (t->len + n > t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 1024;
+        while (cap < t->len + n) cap *= 2;
+        char *data = realloc(t->data, cap);
+        if (!data) return -1;
+        t->data = data;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    *off = (uint32_t)t->len;
+    t->len += n;
+    return 0;
+}
+
+static void cache_path(const char *path, char *out, size_t size) {
+    snprintf(out, size, "%s" MANIFEST_CACHE_EXT, path);
+}
+
+int manifest_compile(const char *path, const manifest_t *m) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+
+    size_t noff = MANIFEST_FIELD_COUNT + 2 * m->dep_count + 2 * m->build_dep_count +
+                  3 * m->file_count;
+    uint32_t *offs = malloc((noff ? noff : 1) * sizeof(uint32_t));
+    strtab_t tab = {0};
+    int ret = offs ? 0 : -1;
+
+    size_t k = 0;
+    for (int i = 0; ret == 0 && i < MANIFEST_FIELD_COUNT; i++) {
+        ret = strtab_add(&tab, FIELD(m, i), &offs[k++]);
+    }
+    for (size_t i = 0; ret == 0 && i < m->dep_count; i++) {
+        ret = strtab_add(&tab, m->deps[i].name, &offs[k++]);
+        if (ret == 0) ret = strtab_add(&tab, m->deps[i].constraint, &offs[k++]);
+    }
+    for (size_t i = 0; ret == 0 && i < m->build_dep_count; i++) {
+        ret = strtab_add(&tab, m->build_deps[i].name, &offs[k++]);
+        if (ret == 0) ret = strtab_add(&tab, m->build_deps[i].constraint, &offs[k++]);
+    }
+    for (size_t i = 0; ret == 0 && i < m->file_count; i++) {
+        ret = strtab_add(&tab, m->files[i].source, &offs[k++]);
+        if (ret == 0) ret = strtab_add(&tab, m->files[i].dest, &offs[k++]);
+        offs[k++] = m->files[i].mode;
+    }
+
+    manifest_cache_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MANIFEST_CACHE_MAGIC, sizeof(h.magic));
+    h.version = MANIFEST_CACHE_VERSION;
+    h.field_count = MANIFEST_FIELD_COUNT;
+    h.src_size = (uint64_t)st.st_size;
+    h.src_mtime_sec = st.st_mtim.tv_sec;
+    h.src_mtime_nsec = st.st_mtim.tv_nsec;
+    h.src_ino = (uint64_t)st.st_ino;
+    h.dep_count = (uint32_t)m->dep_count;
+    h.build_dep_count = (uint32_t)m->build_dep_count;
+    h.file_count = (uint32_t)m->file_count;
+    h.strings_size = (uint32_t)tab.len;
+
+    char out[4096], tmp[4200];
+    cache_path(path, out, sizeof(out));
+    snprintf(tmp, sizeof(tmp), "%s.%d", out, (int)getpid());
+
+    FILE *f = ret == 0 ? fopen(tmp, "wb") : NULL;
+    if (f) {
+        int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                 (noff == 0 || fwrite(offs, sizeof(uint32_t), noff, f) == noff) &&
+                 (tab.len == 0 || fwrite(tab.data, 1, tab.len, f) == tab.len);
+        if (fclose(f) != 0) ok = 0;
+        ret = ok && rename(tmp, out) == 0 ? 0 : -1;
+        if (ret != 0) unlink(tmp);
+    } else {
+        ret = -1;
+    }
+
+    free(offs);
+    free(tab.data);
+    return ret;
+}
+
+// Cache valide pour ce fichier source : 0 et m rempli, sinon -1
+static int load_cache(const char *path, const struct stat *src, manifest_t *m) {
+    char cpath[4096];
+    cache_path(path, cpath, sizeof(cpath));
+
+    int fd = open(cpath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    size_t len = 0;
+    char *buf = fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(manifest_cache_header_t)
+                ? read_whole(m, fd, (size_t)st.st_size, &len) : NULL;
+    close(fd);
+    if (!buf || len < sizeof(manifest_cache_header_t)) return -1;
+
+    manifest_cache_header_t h;
+    memcpy(&h, buf, sizeof(h));
+    if (memcmp(h.magic, MANIFEST_CACHE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != MANIFEST_CACHE_VERSION || h.field_count != MANIFEST_FIELD_COUNT) {
+        return -1;
+    }
+    if (h.src_size != (uint64_t)src->st_size || h.src_ino != (uint64_t)src->st_ino ||
+        h.src_mtime_sec != src->st_mtim.tv_sec || h.src_mtime_nsec != src->st_mtim.tv_nsec) {
+        return -1;
+    }
+
+    uint64_t noff = (uint64_t)MANIFEST_FIELD_COUNT + 2ull * h.dep_count +
+                    2ull * h.build_dep_count + 3ull * h.file_count;
+    uint64_t need = sizeof(h) + noff * sizeof(uint32_t) + h.strings_size;
+    if (need != len || h.strings_size == 0) return -1;
+
+    const uint32_t *offs = (const uint32_t *)(buf + sizeof(h));
+    const char *strings = buf + sizeof(h) + noff * sizeof(uint32_t);
+    if (strings[h.strings_size - 1] != '\0') return -1;
+
+    // Tous les offsets doivent tomber dans la table (terminée par '\0')
+    size_t k = 0;
+#define STR(out) do { \
+        if (offs[k] >= h.strings_size) return -1; \
+        (out) = strings + offs[k++]; \
+    } while (0)
+
+    for (int i = 0; i < MANIFEST_FIELD_COUNT; i++) STR(FIELD(m, i));
+
+    m->deps = h.dep_count ? arena_alloc(m, h.dep_count * sizeof(manifest_dep_t)) : NULL;
+    m->build_deps = h.build_dep_count ?
+                    arena_alloc(m, h.build_dep_count * sizeof(manifest_dep_t)) : NULL;
+    m->files = h.file_count ? arena_alloc(m, h.file_count * sizeof(manifest_file_t)) : NULL;
+    if ((h.dep_count && !m->deps) || (h.build_dep_count && !m->build_deps) ||
+        (h.file_count && !m->files)) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < h.dep_count; i++) {
+        STR(m->deps[i].name);
+        STR(m->deps[i].constraint);
+    }
+    for (uint32_t i = 0; i < h.build_dep_count; i++) {
+        STR(m->build_deps[i].name);
+        STR(m->build_deps[i].constraint);
+    }
+    for (uint32_t i = 0; i < h.file_count; i++) {
+        STR(m->files[i].source);
+        STR(m->files[i].dest);
+        m->files[i].mode = offs[k++];
+    }
+#undef STR
+
+    m->dep_count = h.dep_count;
+    m->build_dep_count = h.build_dep_count;
+    m->file_count = h.file_count;
+    m->from_cache = 1;
+    return 0;
+}
+
+int manifest_load(const char *path, manifest_t *m) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+
+    manifest_init(m);
+    if (load_cache(path, &st, m) == 0) return 0;
+    manifest_free(m);
+
+    if (manifest_parse_file(path, m) != 0) return -1;
+    manifest_compile(path, m);
+    return 0;
+}
+
+char *manifest_join_deps(const manifest_dep_t *deps, size_t count) {
+    size_t len = 1;
+    for (size_t i = 0; i < count; i++) {
+        len += strlen(deps[i].name) + strlen(deps[i].constraint) + 2;
+    }
+
+    char *out = malloc(len);
+    if (!out) return NULL;
+
+    char *p = out;
+    *p = '\0';
+    for (size_t i = 0; i < count; i++) {
+        p += sprintf(p, "%s%s=%s", i ? ";" : "", deps[i].name, deps[i].constraint);
+    }
+    return out;
+}
@@ -2,23 +2,73 @@
 #include <string.h>
 #include <stdlib.h>
 #include "../include/apkm.h"
+#include "../include/manifest.h"
+#include "../include/core.h"
 
-// Vérifie si un paquet spécifique est déjà sur le système Alpine
-int is_dep_installed(const char *pkg_name) {
-    FILE *fp = fopen(ALPINE_DB_PATH, "r");
-    if (!fp) return 0;
+// Noms des paquets Alpine installés (triés), relus quand la base change
+static char **alpine_installed = NULL;
+static size_t alpine_count = 0;
+static int alpine_loaded = 0;
+static unsigned long alpine_generation = 0;
 
-    char line[1024];
-    char search_pattern[130];
-    snprintf(search_pattern, sizeof(search_pattern), "P:%s\n", pkg_name);
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
 
+static void load_alpine_installed(void) {
+    unsigned long generation = apkm_state_generation(APKM_STATE_INSTALLED);
+    if (alpine_loaded && generation == alpine_generation) return;
+    
+    for (size_t i = 0; i < alpine_count; i++) free(alpine_installed[i]);
+    free(alpine_installed);
+    alpine_installed = NULL;
+    alpine_count = 0;
+    alpine_generation = generation;
+    alpine_loaded = 1;
+    
+    FILE *fp = fopen(ALPINE_DB_PATH, "r");
+    if (!fp) return;
+    
+    char line[1024];
+    size_t capacity = 0;
     while (fgets(line, sizeof(line), fp)) {
-        if (strcmp(line, search_pattern) == 0) {
-            fclose(fp);
-            return 1; // Trouvé !
+        if (strncmp(line, "P:", 2) != 0) continue;
+        line[strcspn(line, "\n")] = '\0';
+        
+        if (alpine_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            char **grown = realloc(alpine_installed, capacity * sizeof(char *));
+            if (!grown) break;
+            alpine_installed = grown;
         }
+        char *name = strdup(line + 2);
+        if (name) alpine_installed[alpine_count++] = name;
     }
     fclose(fp);
+    
+    qsort(alpine_installed, alpine_count, sizeof(char *), compare_names);
+}
+
+// Vérifie si un paquet spécifique est déjà sur le système Alpine
+int is_dep_installed(const char *pkg_name) {
+    load_alpine_installed();
+    if (alpine_count > 0 &&
+        bsearch(&pkg_name, alpine_installed, alpine_count, sizeof(char *), compare_names)) {
+        return 1; // Trouvé !
+    }
+    
+    // Nom venu d'un APKMBUILD : pas de sortie de la base locale
+    if (strchr(pkg_name, '/') || strstr(pkg_name, "..")) return 0;
+    
+    // Paquets installés par apkm : manifest lu via son cache binaire
+    char manifest_path[512];
+    snprintf(manifest_path, sizeof(manifest_path), "%s/%s/Manifest.toml",
+             APKM_LOCAL_DB_PATH, pkg_name);
+    manifest_t manifest;
+    if (manifest_load(manifest_path, &manifest) == 0) {
+        manifest_free(&manifest);
+        return 1;
+    }
     return 0; // Manquant
 }
 
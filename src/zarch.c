@@ -1,4 +1,5 @@
 #include "apkm.h"
+#include "core.h"
 #include <curl/curl.h>
 #include <json-c/json.h>
 #include <string.h>
@@ -80,15 +81,10 @@ int zarch_search(const char *query, zarch_package_t *results, int max_results) {
     char url[512];
     snprintf(url, sizeof(url), "%s/package/search?q=%s", ZARCH_API_URL, query);
     
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, zarch_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-    
-    CURLcode res = curl_easy_perform(curl);
+    int res = apkm_http_get(curl, url, 10L, &resp.data, &resp.size);
     
     int count = 0;
-    if (res == CURLE_OK && resp.data) {
+    if (res == 0 && resp.data) {
         struct json_object *parsed = json_tokener_parse(resp.data);
         if (parsed) {
             struct json_object *results_obj;
@@ -183,14 +179,10 @@ int zarch_list_repos(output_format_t format) {
     char url[512];
     snprintf(url, sizeof(url), "%s/package/search?q=", ZARCH_API_URL);
     
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, zarch_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
-    
-    CURLcode res = curl_easy_perform(curl);
+    int res = apkm_http_get(curl, url, 10L, &resp.data, &resp.size);
     curl_easy_cleanup(curl);
     
-    if (res == CURLE_OK && resp.data) {
+    if (res == 0 && resp.data) {
         if (format == OUTPUT_JSON) {
             printf("%s\n", resp.data);
         } else {
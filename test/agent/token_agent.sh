@@ -0,0 +1,57 @@
+#!/bin/sh
+# Test de l'agent de token d'apsm :
+#   0. ni agent ni fichier -> pas authentifié
+#   1. agent démarré, token ajouté par stdin -> apsm authentifié sans fichier
+#   2. logout -> l'agent oublie le token
+#   3. TTL écoulé -> l'agent s'arrête et retire sa socket
+#
+# Usage: token_agent.sh <apsm>
+
+set -eu
+
+APSM=$1
+WORK=$(mktemp -d)
+
+cleanup() {
+    "$APSM" agent stop >/dev/null 2>&1 || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+export HOME="$WORK/home"
+export APKM_AGENT_SOCK="$WORK/agent.sock"
+# Jamais le token du développeur : logout le supprimerait
+export APSM_TOKEN_PATH="$WORK/auth.token"
+unset APSM_TOKEN || true
+
+# 0. Sans agent ni fichier : pas authentifié
+if "$APSM" status 2>/dev/null | grep -q "Authenticated"; then
+    fail "authenticated without any token"
+fi
+
+# 1. Token servi par l'agent
+"$APSM" agent start >/dev/null || fail "agent did not start"
+[ -S "$APKM_AGENT_SOCK" ] || fail "agent socket missing"
+echo agent-token | "$APSM" agent add >/dev/null || fail "agent add failed"
+"$APSM" status | grep -q "Authenticated" || fail "token not served by the agent"
+
+# 2. Logout
+"$APSM" logout >/dev/null
+"$APSM" agent status | grep -q "no token" || fail "logout did not clear the agent"
+"$APSM" agent stop >/dev/null || fail "agent stop failed"
+
+# 3. Expiration
+"$APSM" agent start --ttl 1 >/dev/null || fail "agent did not restart"
+echo agent-token | "$APSM" agent add --ttl 1 >/dev/null
+sleep 2
+if "$APSM" agent status >/dev/null; then
+    fail "agent still running after token expiry"
+fi
+[ ! -e "$APKM_AGENT_SOCK" ] || fail "socket left behind"
+
+echo "token agent: OK"
@@ -0,0 +1,80 @@
+/*
+ * blake3_hash_files doit donner, fichier par fichier, le même BLAKE3 que
+ * blake3_hash_file et que blake3_hash sur le contenu en mémoire. Tailles
+ * choisies autour des seuils de crypto.c (mmap à 64 KiB, lectures de
+ * 1 MiB), plus un fichier absent qui doit échouer seul.
+ *
+ * Usage: blake3_batch_test [répertoire de travail]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "crypto.h"
+
+static const size_t sizes[] = {
+    0, 1, 1023, 1024, 65535, 65536, 65537, 1048576, 1048577, 3 * 1048576 + 17
+};
+#define FILE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+static int fail(const char *what, size_t i) {
+    fprintf(stderr, "FAIL: %s (file %zu)\n", what, i);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/blake3_batch.XXXXXX", argc > 1 ? argv[1] : "/tmp");
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    char paths[FILE_COUNT + 1][600];
+    const char *names[FILE_COUNT + 1];
+    unsigned char expected[FILE_COUNT][BLAKE3_HASH_LEN];
+    int ret = 0;
+
+    srand(42);
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/f%zu", dir, i);
+        names[i] = paths[i];
+
+        unsigned char *data = malloc(sizes[i] + 1);
+        for (size_t j = 0; j < sizes[i]; j++) data[j] = (unsigned char)rand();
+
+        FILE *f = fopen(paths[i], "wb");
+        if (!f || fwrite(data, 1, sizes[i], f) != sizes[i] || fclose(f) != 0) {
+            free(data);
+            return fail("write", i);
+        }
+        blake3_hash(data, sizes[i], expected[i]);
+        free(data);
+    }
+    snprintf(paths[FILE_COUNT], sizeof(paths[FILE_COUNT]), "%s/missing", dir);
+    names[FILE_COUNT] = paths[FILE_COUNT];
+
+    unsigned char batch[FILE_COUNT + 1][BLAKE3_HASH_LEN];
+    int status[FILE_COUNT + 1];
+
+    for (int threads = 1; threads <= 4 && ret == 0; threads += 3) {
+        memset(batch, 0, sizeof(batch));
+        int failed = blake3_hash_files(names, FILE_COUNT + 1, batch, status, threads);
+        if (failed != 1) ret = fail("failure count", FILE_COUNT);
+        if (status[FILE_COUNT] != -1) ret = fail("missing file not reported", FILE_COUNT);
+
+        for (size_t i = 0; i < FILE_COUNT && ret == 0; i++) {
+            unsigned char single[BLAKE3_HASH_LEN];
+            if (status[i] != 0) ret = fail("batch status", i);
+            else if (blake3_hash_file(names[i], single) != 0) ret = fail("single hash", i);
+            else if (memcmp(batch[i], single, BLAKE3_HASH_LEN) != 0) ret = fail("batch != single", i);
+            else if (memcmp(single, expected[i], BLAKE3_HASH_LEN) != 0) ret = fail("file != memory", i);
+        }
+    }
+
+    for (size_t i = 0; i < FILE_COUNT; i++) unlink(paths[i]);
+    rmdir(dir);
+
+    if (ret == 0) printf("blake3 batch: OK (%zu files)\n", (size_t)FILE_COUNT);
+    return ret;
+}
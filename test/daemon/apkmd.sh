@@ -0,0 +1,85 @@
+#!/bin/sh
+# Test du démon apkmd :
+#   1. démarrage, les commandes en lecture passent par le démon avec la même
+#      sortie qu'en local
+#   2. arrêt : socket retirée, le client repasse en local
+#   3. --idle : le démon s'arrête seul sans requêtes
+#   4. repositories.conf modifié sous le démon : seuls les dépôts sont relus
+#   5. APKM_CONF du client différent de celui du démon : exécuté en local
+#
+# Usage: apkmd.sh <apkm>
+
+set -eu
+
+APKM=$1
+WORK=$(mktemp -d)
+export APKMD_SOCK="$WORK/apkmd.sock"
+export APKM_CONF="$WORK/repositories.conf"
+export APKM_DB_DIR="$WORK/db"
+export APKM_CACHE_DIR="$WORK/cache"
+echo "first http://127.0.0.1:1 5" > "$APKM_CONF"
+
+cleanup() {
+    "$APKM" daemon stop >/dev/null 2>&1 || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# 1. Requêtes servies par le démon
+"$APKM" daemon start >/dev/null || fail "apkmd did not start"
+[ -S "$APKMD_SOCK" ] || fail "socket missing"
+"$APKM" daemon status >/dev/null || fail "status failed"
+"$APKM" repo list > "$WORK/daemon.out" 2>&1
+APKM_NO_DAEMON=1 "$APKM" repo list > "$WORK/local.out" 2>&1
+cmp -s "$WORK/daemon.out" "$WORK/local.out" || fail "daemon output differs"
+
+# 2. Arrêt
+"$APKM" daemon stop >/dev/null || fail "stop failed"
+i=0
+while [ -e "$APKMD_SOCK" ]; do
+    i=$((i + 1))
+    [ $i -gt 50 ] && fail "socket left behind"
+    sleep 0.1
+done
+"$APKM" repo list > "$WORK/fallback.out" 2>&1
+cmp -s "$WORK/fallback.out" "$WORK/local.out" || fail "in-process fallback differs"
+
+# 3. Arrêt sur inactivité
+"$APKM" daemon start --idle 1 >/dev/null || fail "apkmd did not restart"
+sleep 3
+if "$APKM" daemon status >/dev/null; then
+    fail "apkmd still running after idle timeout"
+fi
+
+# 4. Invalidation ciblée (inotify) : le démon recharge lui-même ce qui a
+#    changé, avant de servir ; son journal --debug le montre
+"$APKM" --debug daemon start --foreground > "$WORK/apkmd.log" 2>&1 &
+i=0
+until "$APKM" daemon status >/dev/null 2>&1; do
+    i=$((i + 1))
+    [ $i -gt 50 ] && fail "foreground apkmd did not start"
+    sleep 0.1
+done
+"$APKM" list > /dev/null 2>&1
+grep -q "Loading installed" "$WORK/apkmd.log" || fail "cold apkmd did not load installed packages"
+loads=$(grep -c "Loading installed" "$WORK/apkmd.log" || true)
+echo "second http://127.0.0.1:1 9" >> "$APKM_CONF"
+"$APKM" repo list > "$WORK/repos.out" 2>&1
+grep -q "second" "$WORK/repos.out" || fail "repositories.conf change not served"
+grep -q "Loaded repository: second" "$WORK/apkmd.log" || fail "repositories.conf change not picked up"
+[ "$(grep -c "Loading installed" "$WORK/apkmd.log")" -eq "$loads" ] ||
+    fail "repositories.conf change reloaded installed packages"
+
+# 5. Autre repositories.conf côté client : pas les caches du démon
+echo "other http://127.0.0.1:1 5" > "$WORK/other.conf"
+APKM_CONF="$WORK/other.conf" "$APKM" repo list > "$WORK/other.out" 2>&1
+grep -q "other" "$WORK/other.out" || fail "client APKM_CONF ignored by apkmd"
+grep -q "second" "$WORK/other.out" && fail "client served from the daemon's repositories"
+"$APKM" daemon stop >/dev/null || fail "foreground apkmd stop failed"
+
+echo "apkmd: OK"
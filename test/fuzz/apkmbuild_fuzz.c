@@ -0,0 +1,92 @@
+/*
+ * Fuzzer du parseur APKMBUILD (src/bools/apkmbuild.c).
+ *
+ *   cmake -DBUILD_FUZZERS=ON -DCMAKE_C_COMPILER=clang ..
+ *   ./bin/apkmbuild_fuzz ../test/fuzz/apkmbuild
+ *
+ * Sans clang (APKMBUILD_FUZZ_REPLAY), le binaire rejoue simplement le
+ * corpus : chaque fichier doit être parsé sans plantage.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "apkmbuild.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    build_info_t info;
+    char err[256];
+
+    if (apkmbuild_parse_buffer((const char *)data, size, &info, err, sizeof(err)) == 0) {
+        // Les champs doivent rester des chaînes valides
+        volatile size_t n = strlen(info.name) + strlen(info.build_cmd) +
+                            strlen(info.install_cmd) + strlen(info.check_cmd) +
+                            strlen(info.readme_path) + strlen(info.docs);
+        for (size_t i = 0; i < info.file_count; i++) {
+            n += strlen(info.files[i].source) + strlen(info.files[i].dest);
+        }
+        (void)n;
+    }
+    apkmbuild_free(&info);
+    return 0;
+}
+
+#ifdef APKMBUILD_FUZZ_REPLAY
+
+static int replay_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(size > 0 ? size : 1);
+    size_t got = data ? fread(data, 1, size, f) : 0;
+    fclose(f);
+    if (!data) return -1;
+
+    LLVMFuzzerTestOneInput(data, got);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int count = 0, failed = 0;
+
+    for (int a = 1; a < argc; a++) {
+        struct stat st;
+        if (stat(argv[a], &st) != 0 || !S_ISDIR(st.st_mode)) {
+            failed |= replay_file(argv[a]) != 0;
+            count++;
+            continue;
+        }
+
+        DIR *dir = opendir(argv[a]);
+        if (!dir) {
+            perror(argv[a]);
+            return 1;
+        }
+        struct dirent *ent;
+        while ((ent = readdir(dir))) {
+            if (ent->d_name[0] == '.') continue;
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", argv[a], ent->d_name);
+            failed |= replay_file(path) != 0;
+            count++;
+        }
+        closedir(dir);
+    }
+
+    printf("apkmbuild_fuzz: %d input(s) replayed\n", count);
+    return failed;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#!/bin/sh
+# Test du cache HTTP des métadonnées d'apkm contre hub_stub.py :
+#   1. première requête -> hub interrogé ; aussitôt répétée -> servie du cache
+#   2. périmée (TTL dépassé) -> ancienne réponse servie sans attendre le hub,
+#      revalidée en arrière-plan (le lecteur d'un tube n'attend pas)
+#   3. trop vieille pour être servie -> revalidation bloquante, 304 du hub
+#   4. comme 2, mais servie par apkmd (revalidation dans sa boucle)
+#
+# Usage: http_cache.sh <apkm> [python3]
+
+set -eu
+
+APKM=$1
+PYTHON=${2:-python3}
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+SERVER_PID=
+
+cleanup() {
+    APKM_NO_DAEMON= "$APKM" daemon stop >/dev/null 2>&1 || true
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+export APKM_NO_DAEMON=1
+export APKM_CONF="$WORK/repositories.conf"
+export APKM_DB_DIR="$WORK/db"
+export APKM_CACHE_DIR="$WORK/cache"
+export APKMD_SOCK="$WORK/apkmd.sock"
+export HOME="$WORK/home"
+unset APKM_OFFLINE || true
+
+STATE="$WORK/hub"
+mkdir -p "$STATE"
+publish() {
+    echo "{\"hello\": {\"version\": \"$1\", \"author\": \"stub\", \"release\": \"r1\", \"arch\": \"x86_64\"}}" \
+        > "$STATE/packages.json"
+}
+publish 1.0.0
+"$PYTHON" "$HERE/hub_stub.py" "$STATE" &
+SERVER_PID=$!
+i=0
+while [ ! -f "$STATE/port" ]; do
+    i=$((i + 1))
+    [ $i -gt 100 ] && fail "server did not start"
+    sleep 0.1
+done
+echo "stub http://127.0.0.1:$(cat "$STATE/port") 5" > "$APKM_CONF"
+touch "$STATE/requests.log"
+
+requests() {
+    grep -c "^hello $1\$" "$STATE/requests.log" || true
+}
+
+# Vieillit les réponses en cache de $1 secondes
+age_cache() {
+    when=$(($(date +%s) - $1))
+    for f in "$APKM_CACHE_DIR"/http/*; do
+        case "$f" in *.lock|*.down|*.tmp) continue ;; esac
+        sed -i "s/^fetched .*/fetched $when/" "$f"
+    done
+}
+
+# Attend la n-ième réponse $1 du hub
+wait_requests() {
+    i=0
+    while [ "$(requests "$1")" -lt "$2" ]; do
+        i=$((i + 1))
+        [ $i -gt 100 ] && fail "no background revalidation ($1)"
+        sleep 0.1
+    done
+}
+
+# Servi à partir du cache sans attendre le hub (qui répond en 4 s)
+query_stale() {
+    echo 4 > "$STATE/delay"
+    timeout 3 sh -c "\"$APKM\" info hello | cat" > "$WORK/stale.out" 2>&1 ||
+        fail "stale answer waited for the hub ($1)"
+    grep -q "hello $1" "$WORK/stale.out" || fail "stale answer is not $1"
+}
+
+# 1. Frais
+"$APKM" info hello > "$WORK/first.out" 2>&1 || fail "first lookup failed"
+grep -q "hello 1.0.0" "$WORK/first.out" || fail "first lookup did not reach the hub"
+[ "$(requests 200)" -eq 1 ] || fail "expected one request"
+"$APKM" info hello > /dev/null 2>&1 || fail "cached lookup failed"
+[ "$(requests 200)" -eq 1 ] || fail "fresh answer was revalidated"
+
+# 2. Périmé : servi tel quel, revalidé à côté
+publish 1.1.0
+age_cache 7200
+query_stale 1.0.0
+wait_requests 200 2
+rm -f "$STATE/delay"
+sleep 0.2
+"$APKM" info hello > "$WORK/revalidated.out" 2>&1 || fail "lookup after revalidation failed"
+grep -q "hello 1.1.0" "$WORK/revalidated.out" || fail "background revalidation not stored"
+[ "$(requests 200)" -eq 2 ] || fail "revalidated answer fetched again"
+
+# 3. Trop vieux : revalidation bloquante, réponse inchangée -> 304
+age_cache $((2 * 86400))
+"$APKM" info hello > "$WORK/old.out" 2>&1 || fail "lookup of expired answer failed"
+grep -q "hello 1.1.0" "$WORK/old.out" || fail "expired answer lost"
+[ "$(requests 304)" -eq 1 ] || fail "expired answer not revalidated with a conditional GET"
+"$APKM" info hello > /dev/null 2>&1
+[ "$(requests 304)" -eq 1 ] || fail "304 did not refresh the cache date"
+
+# 4. Même chose servie par apkmd
+publish 1.2.0
+age_cache 7200
+unset APKM_NO_DAEMON
+"$APKM" daemon start > /dev/null || fail "apkmd did not start"
+query_stale 1.1.0
+wait_requests 200 3
+rm -f "$STATE/delay"
+sleep 0.2
+"$APKM" info hello > "$WORK/daemon.out" 2>&1 || fail "daemon lookup failed"
+grep -q "hello 1.2.0" "$WORK/daemon.out" || fail "daemon revalidation not stored"
+[ "$(requests 200)" -eq 3 ] || fail "daemon fetched the revalidated answer again"
+ls "$APKM_CACHE_DIR"/http/*.lock > /dev/null 2>&1 && fail "revalidation lock left behind"
+
+echo "http_cache: OK"
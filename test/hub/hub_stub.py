@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+Serveur Zarch Hub minimal pour les métadonnées lues par `apkm`.
+
+Sert GET /v5.2/package/<nom> depuis <dir>/packages.json
+({"nom": {"version": ..., "author": ..., "release": ..., "arch": ...}},
+relu à chaque requête) avec un ETag ; If-None-Match identique -> 304.
+État dans <dir> :
+  port          port d'écoute (écrit au démarrage)
+  requests.log  une ligne "<nom> <code>" par requête servie
+  delay         si présent, contient N : chaque réponse attend N secondes
+
+Usage: hub_stub.py <dir>
+"""
+
+import hashlib
+import json
+import os
+import re
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+API = "/v5.2"
+
+state_dir = sys.argv[1]
+lock = threading.Lock()
+
+
+def read_state(name, default):
+    try:
+        with open(os.path.join(state_dir, name)) as f:
+            return f.read()
+    except FileNotFoundError:
+        return default
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def log_request_result(self, name, code):
+        with lock, open(os.path.join(state_dir, "requests.log"), "a") as f:
+            f.write(f"{name} {code}\n")
+
+    def do_GET(self):
+        delay = read_state("delay", "").strip()
+        if delay:
+            time.sleep(float(delay))
+
+        m = re.fullmatch(API + r"/package/([\w.+-]+)", self.path)
+        packages = json.loads(read_state("packages.json", "{}"))
+        if not m or m.group(1) not in packages:
+            self.log_request_result(m.group(1) if m else "-", 404)
+            body = b'{"error": "not found"}'
+            self.send_response(404)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+            return
+
+        name = m.group(1)
+        body = json.dumps({"package": dict(packages[name], name=name)}).encode()
+        etag = '"' + hashlib.sha256(body).hexdigest()[:16] + '"'
+
+        if self.headers.get("If-None-Match") == etag:
+            self.log_request_result(name, 304)
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+
+        self.log_request_result(name, 200)
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("ETag", etag)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+with open(os.path.join(state_dir, "port.tmp"), "w") as f:
+    f.write(str(server.server_address[1]))
+os.rename(os.path.join(state_dir, "port.tmp"), os.path.join(state_dir, "port"))
+server.serve_forever()
@@ -0,0 +1,71 @@
+#!/bin/sh
+# Test du mode hors ligne d'apkm contre le serveur local hub_stub.py :
+#   1. info en ligne -> réponse du hub, paquet noté dans available_packages
+#   2. --offline, cache HTTP vidé et hub arrêté -> résolu depuis le catalogue
+#   3. --offline, paquet jamais vu -> "not cached (offline)", code non nul
+#
+# Usage: offline.sh <apkm> [python3]
+
+set -eu
+
+APKM=$1
+PYTHON=${2:-python3}
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+SERVER_PID=
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# Tout l'état d'apkm dans $WORK, sans démon
+export APKM_NO_DAEMON=1
+export APKM_CONF="$WORK/repositories.conf"
+export APKM_DB_DIR="$WORK/db"
+export APKM_CACHE_DIR="$WORK/cache"
+export HOME="$WORK/home"
+unset APKM_OFFLINE || true
+
+STATE="$WORK/hub"
+mkdir -p "$STATE"
+cat > "$STATE/packages.json" <<'EOF'
+{"hello": {"version": "2.1.0", "author": "stub", "release": "r3", "arch": "x86_64"}}
+EOF
+"$PYTHON" "$HERE/hub_stub.py" "$STATE" &
+SERVER_PID=$!
+i=0
+while [ ! -f "$STATE/port" ]; do
+    i=$((i + 1))
+    [ $i -gt 100 ] && fail "server did not start"
+    sleep 0.1
+done
+echo "stub http://127.0.0.1:$(cat "$STATE/port") 5" > "$APKM_CONF"
+
+# 1. En ligne
+"$APKM" info hello > "$WORK/online.out" 2>&1 || fail "online lookup failed"
+grep -q "hello 2.1.0" "$WORK/online.out" || fail "online lookup did not reach the hub"
+grep -q "^hello 200$" "$STATE/requests.log" || fail "hub not queried"
+
+# 2. Hors ligne : ni hub ni réponse HTTP en cache, seulement le catalogue
+kill "$SERVER_PID"
+wait "$SERVER_PID" 2>/dev/null || true
+SERVER_PID=
+rm -rf "$APKM_CACHE_DIR/http"
+"$APKM" --offline info hello > "$WORK/offline.out" 2>&1 || fail "offline resolve failed"
+grep -q "hello 2.1.0" "$WORK/offline.out" || fail "offline resolve returned another version"
+grep -q "/hello/2.1.0/r3/x86_64" "$WORK/offline.out" || fail "offline download URL lost"
+
+# 3. Hors ligne, paquet inconnu
+if "$APKM" --offline info missing > "$WORK/missing.out" 2>&1; then
+    fail "unknown package resolved offline"
+fi
+grep -q "not cached (offline)" "$WORK/missing.out" || fail "missing 'not cached' error"
+
+echo "offline: OK"
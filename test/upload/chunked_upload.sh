@@ -0,0 +1,130 @@
+#!/bin/sh
+# Test de `apsm push` contre le serveur local zarch_stub.py :
+#   1. upload interrompu (parties >= 3 refusées) -> échec, journal conservé
+#   2. relance -> seules les parties manquantes partent, paquet identique
+#   3. même paquet republié -> rien n'est envoyé
+#   4. paquet modifié en fin de fichier -> seules les parties changées partent
+#      (la première, qui porte l'en-tête tar, et la dernière)
+#   5. publish --batch : trois paquets et un paquet sans manifest, rapport JSON
+#   6. hub sans upload découpé -> repli sur l'ancien POST multipart
+#
+# Usage: chunked_upload.sh <apsm> [python3]
+
+set -eu
+
+APSM=$1
+PYTHON=${2:-python3}
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+SERVER_PID=
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+start_server() {
+    mkdir -p "$1"
+    "$PYTHON" "$HERE/zarch_stub.py" "$@" &
+    SERVER_PID=$!
+    i=0
+    while [ ! -f "$1/port" ]; do
+        i=$((i + 1))
+        [ $i -gt 100 ] && fail "server did not start"
+        sleep 0.1
+    done
+    export APSM_API_URL="http://127.0.0.1:$(cat "$1/port")/v5.2"
+}
+
+# Paquet : Manifest.toml + 4,5 Mio de données (5 parties de 1 Mio)
+mkdir -p "$WORK/pkg"
+cat > "$WORK/pkg/Manifest.toml" <<'EOF'
+[metadata]
+name = "uploadtest"
+version = "1.0.0"
+release = "r1"
+arch = "x86_64"
+description = "Chunked upload test package"
+EOF
+head -c 4718592 /dev/urandom > "$WORK/pkg/payload.bin"
+PKG="$WORK/uploadtest-1.0.0.tar.bool"
+tar -C "$WORK/pkg" -cf "$PKG" Manifest.toml payload.bin
+
+export HOME="$WORK/home"
+export XDG_CACHE_HOME="$WORK/cache"
+export APSM_TOKEN=test-token
+
+STATE="$WORK/state"
+start_server "$STATE"
+
+# 1. Interruption
+echo 3 > "$STATE/fail"
+if "$APSM" --quiet push --yes --chunk-size 1 --jobs 4 "$PKG"; then
+    fail "upload should fail while the server rejects chunks"
+fi
+[ "$(wc -l < "$STATE/puts.log")" -eq 3 ] || fail "expected 3 accepted chunks before interruption"
+ls "$XDG_CACHE_HOME"/apsm/uploads/*.journal >/dev/null 2>&1 || fail "resume journal missing"
+
+# 2. Reprise
+rm "$STATE/fail"
+"$APSM" --quiet push --yes --chunk-size 1 --jobs 4 "$PKG" || fail "resumed upload failed"
+[ "$(wc -l < "$STATE/puts.log")" -eq 5 ] || fail "resume re-sent chunks already on the server"
+cmp -s "$PKG" "$STATE/packages/uploadtest.tar.bool" || fail "assembled package differs"
+if ls "$XDG_CACHE_HOME"/apsm/uploads/*.journal >/dev/null 2>&1; then
+    fail "journal not removed after commit"
+fi
+
+# 3. Republication à l'identique
+"$APSM" --quiet push --yes --chunk-size 1 "$PKG" || fail "republish failed"
+[ "$(wc -l < "$STATE/puts.log")" -eq 5 ] || fail "republish sent chunks"
+tail -n 1 "$STATE/heads.log" | grep -q " 200$" || fail "existence check not used"
+
+# 4. Nouvelle version : seules les parties modifiées sont envoyées
+printf 'trailer' >> "$WORK/pkg/payload.bin"
+tar -C "$WORK/pkg" -cf "$PKG" Manifest.toml payload.bin
+"$APSM" --quiet push --yes --chunk-size 1 "$PKG" || fail "delta upload failed"
+[ "$(wc -l < "$STATE/puts.log")" -eq 7 ] || fail "delta upload re-sent unchanged chunks"
+cmp -s "$PKG" "$STATE/packages/uploadtest.tar.bool" || fail "assembled delta package differs"
+
+# 5. Lot
+mkdir -p "$WORK/batch" "$WORK/broken"
+for n in 1 2 3; do
+    mkdir -p "$WORK/batch-$n"
+    printf '[metadata]\nname = "batch%d"\nversion = "0.%d.0"\n' $n $n > "$WORK/batch-$n/Manifest.toml"
+    head -c $((n * 600000)) /dev/urandom > "$WORK/batch-$n/data.bin"
+    tar -C "$WORK/batch-$n" -cf "$WORK/batch/batch$n-0.$n.0.tar.bool" Manifest.toml data.bin
+done
+echo x > "$WORK/broken/x"
+tar -C "$WORK/broken" -cf "$WORK/batch/broken.tar.bool" x
+if "$APSM" publish --batch "$WORK/batch" --chunk-size 1 --parallel 2 --report - \
+        < /dev/null > "$WORK/report.json" 2>/dev/null; then
+    fail "batch with an invalid package should fail"
+fi
+"$PYTHON" - "$WORK/report.json" <<'PY' || fail "unexpected batch report"
+import json, sys
+r = json.load(open(sys.argv[1]))
+status = {p["name"] or p["file"].rsplit("/", 1)[-1]: p["status"] for p in r["packages"]}
+assert status == {"batch1": "published", "batch2": "published", "batch3": "published",
+                  "broken.tar.bool": "invalid"}, status
+assert r["published"] == 3 and r["invalid"] == 1
+PY
+for n in 1 2 3; do
+    cmp -s "$WORK/batch/batch$n-0.$n.0.tar.bool" "$STATE/packages/batch$n.tar.bool" ||
+        fail "batch package $n differs"
+done
+
+kill "$SERVER_PID"
+wait "$SERVER_PID" 2>/dev/null || true
+SERVER_PID=
+
+# 6. Hub sans upload découpé
+start_server "$WORK/legacy" --legacy
+"$APSM" --quiet push --yes "$PKG" || fail "legacy upload failed"
+
+echo "chunked upload: OK"
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Serveur Zarch Hub minimal pour tester `apsm push` (upload découpé).
+
+Implémente le protocole décrit dans include/publish.h et garde son état
+dans <dir> :
+  port          port d'écoute (écrit au démarrage)
+  puts.log      une ligne "<upload_id> <index>" par partie acceptée
+  heads.log     une ligne "<sha256> <code>" par test d'existence
+  fail          si présent, contient N : les parties d'index >= N renvoient 503
+  packages/     paquets assemblés après commit (<nom>.tar.bool)
+
+Usage: zarch_stub.py <dir> [--legacy]
+  --legacy  hub sans upload découpé (404), seul /package/upload/public répond
+"""
+
+import hashlib
+import json
+import os
+import re
+import sys
+import threading
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+API = "/v5.2"
+
+state_dir = sys.argv[1]
+legacy = "--legacy" in sys.argv[2:]
+lock = threading.Lock()
+sessions = {}
+chunks = {}       # sha256 -> octets (parties indexées par contenu)
+packages = set()  # sha256 des paquets publiés
+
+
+def log_put(upload_id, index):
+    with lock, open(os.path.join(state_dir, "puts.log"), "a") as f:
+        f.write(f"{upload_id} {index}\n")
+
+
+def fail_from():
+    try:
+        with open(os.path.join(state_dir, "fail")) as f:
+            return int(f.read().strip() or 0)
+    except FileNotFoundError:
+        return None
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply(self, code, obj=None):
+        body = json.dumps(obj if obj is not None else {}).encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return self.rfile.read(length) if length else b""
+
+    def authorized(self):
+        if self.headers.get("Authorization", "").startswith("Bearer "):
+            return True
+        self.body()
+        self.reply(401, {"error": "unauthorized"})
+        return False
+
+    def do_HEAD(self):
+        m = re.fullmatch(API + r"/package/sha256/([0-9a-f]{64})", self.path)
+        code = 404 if legacy or not m else 200 if m.group(1) in packages else 404
+        with lock, open(os.path.join(state_dir, "heads.log"), "a") as f:
+            f.write(f"{m.group(1) if m else '-'} {code}\n")
+        self.send_response(code)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def do_GET(self):
+        if not self.authorized():
+            return
+        m = re.fullmatch(API + r"/package/upload/chunked/([\w.-]+)", self.path)
+        with lock:
+            session = sessions.get(m.group(1)) if m else None
+            received = sorted(session["parts"]) if session else None
+        if session is None:
+            self.reply(404, {"error": "unknown upload"})
+        else:
+            self.reply(200, {"upload_id": m.group(1), "received": received})
+
+    def do_POST(self):
+        if not self.authorized():
+            return
+        data = self.body()
+
+        if legacy:
+            if re.fullmatch(API + r"/package/upload/public/[\w.+-]+", self.path):
+                self.reply(200, {"success": True})
+            else:
+                self.reply(404, {"error": "not found"})
+            return
+
+        m = re.fullmatch(API + r"/package/upload/chunked/([\w.+-]+)/commit", self.path)
+        if m:
+            return self.commit(m.group(1), json.loads(data))
+
+        m = re.fullmatch(API + r"/package/upload/chunked/([\w.+-]+)", self.path)
+        if m:
+            req = json.loads(data)
+            upload_id = uuid.uuid4().hex
+            with lock:
+                parts = {i: chunks[h] for i, h in enumerate(req.get("chunk_hashes", []))
+                         if h in chunks}
+                sessions[upload_id] = {"name": m.group(1), "meta": req, "parts": parts}
+            return self.reply(201, {"upload_id": upload_id, "received": sorted(parts)})
+
+        self.reply(404, {"error": "not found"})
+
+    def do_PUT(self):
+        if not self.authorized():
+            return
+        data = self.body()
+        m = re.fullmatch(API + r"/package/upload/chunked/([\w.-]+)/(\d+)", self.path)
+        with lock:
+            session = sessions.get(m.group(1)) if m else None
+        if session is None:
+            return self.reply(404, {"error": "unknown upload"})
+
+        index = int(m.group(2))
+        limit = fail_from()
+        if limit is not None and index >= limit:
+            return self.reply(503, {"error": "try again later"})
+        if hashlib.sha256(data).hexdigest() != self.headers.get("X-Chunk-SHA256"):
+            return self.reply(422, {"error": "chunk hash mismatch"})
+
+        with lock:
+            session["parts"][index] = data
+            chunks[hashlib.sha256(data).hexdigest()] = data
+        log_put(m.group(1), index)
+        self.reply(200, {"index": index})
+
+    def commit(self, upload_id, req):
+        with lock:
+            session = sessions.get(upload_id)
+        if session is None:
+            return self.reply(404, {"error": "unknown upload"})
+
+        parts = session["parts"]
+        if sorted(parts) != list(range(req["chunks"])):
+            return self.reply(409, {"error": "missing chunks"})
+        blob = b"".join(parts[i] for i in range(req["chunks"]))
+        if len(blob) != req["size"] or hashlib.sha256(blob).hexdigest() != req["sha256"]:
+            return self.reply(422, {"error": "package hash mismatch"})
+
+        os.makedirs(os.path.join(state_dir, "packages"), exist_ok=True)
+        with open(os.path.join(state_dir, "packages", session["name"] + ".tar.bool"), "wb") as f:
+            f.write(blob)
+        with lock:
+            del sessions[upload_id]
+            packages.add(req["sha256"])
+        self.reply(200, {"success": True, "sha256": req["sha256"]})
+
+
+server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+with open(os.path.join(state_dir, "port.tmp"), "w") as f:
+    f.write(str(server.server_address[1]))
+os.rename(os.path.join(state_dir, "port.tmp"), os.path.join(state_dir, "port"))
+server.serve_forever()